@@ -92,6 +92,7 @@ LOCAL_SRC_FILES := \
     device/src/UltrasoundDevice.cpp \
     session/src/Session.cpp \
     session/src/PayloadBuilder.cpp \
+    session/src/CalibrationCache.cpp \
     session/src/SessionAlsaPcm.cpp \
     session/src/SessionAgm.cpp \
     session/src/SessionAlsaUtils.cpp \
@@ -99,17 +100,21 @@ LOCAL_SRC_FILES := \
     session/src/SessionAlsaVoice.cpp \
     session/src/SoundTriggerEngine.cpp \
     session/src/SoundTriggerEngineCapi.cpp \
+    session/src/SecondStageScheduler.cpp \
     session/src/SoundTriggerEngineGsl.cpp \
     session/src/ContextDetectionEngine.cpp \
     context_manager/src/ContextManager.cpp \
     session/src/ACDEngine.cpp \
     resource_manager/src/ResourceManager.cpp \
     resource_manager/src/SndCardMonitor.cpp \
+    resource_manager/src/BufferPolicy.cpp \
+    resource_manager/src/EventDispatcher.cpp \
     utils/src/SoundTriggerXmlParser.cpp \
     utils/src/SoundTriggerPlatformInfo.cpp \
     utils/src/ACDPlatformInfo.cpp \
     utils/src/PalRingBuffer.cpp \
     utils/src/SoundTriggerUtils.cpp \
+    utils/src/SoundModelCache.cpp \
     utils/src/SignalHandler.cpp
 ifeq ($(strip $(AUDIO_FEATURE_ENABLED_EC_REF_CAPTURE)),true)
 LOCAL_SRC_FILES += device/src/ECRefDevice.cpp
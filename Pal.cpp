@@ -30,6 +30,7 @@
 
 #define LOG_TAG "PAL: API"
 
+#include <new>
 #include <set>
 #include <unistd.h>
 #include <stdlib.h>
@@ -434,6 +435,200 @@ ssize_t pal_stream_read(pal_stream_handle_t *stream_handle, struct pal_buffer *b
     return status;
 }
 
+static ssize_t pal_stream_queue_buffers(pal_stream_handle_t *stream_handle,
+                                       struct pal_buffer *bufs, uint32_t count,
+                                       bool is_write)
+{
+    Stream *s = NULL;
+    int status;
+    std::shared_ptr<ResourceManager> rm = NULL;
+
+    rm = ResourceManager::getInstance();
+    if (!rm) {
+        PAL_ERR(LOG_TAG, "Invalid resource manager");
+        status = -EINVAL;
+        return status;
+    }
+    rm->lockValidStreamMutex();
+    if (!stream_handle || !rm->isActiveStream(stream_handle) || !bufs || !count) {
+        rm->unlockValidStreamMutex();
+        status = -EINVAL;
+        PAL_ERR(LOG_TAG, "Invalid input parameters status %d", status);
+        return status;
+    }
+
+    PAL_VERBOSE(LOG_TAG, "Enter. Stream handle :%pK count %u", stream_handle, count);
+    s =  reinterpret_cast<Stream *>(stream_handle);
+    status = rm->increaseStreamUserCounter(s);
+    if (0 != status) {
+        rm->unlockValidStreamMutex();
+        PAL_ERR(LOG_TAG, "failed to increase stream user count");
+        return status;
+    }
+    rm->unlockValidStreamMutex();
+
+    if (is_write)
+        status = s->writeBuffers(bufs, count);
+    else
+        status = s->readBuffers(bufs, count);
+    if (status < 0) {
+        PAL_ERR(LOG_TAG, "stream %s buffers failed status %d",
+                is_write ? "write" : "read", status);
+    }
+
+    rm->lockValidStreamMutex();
+    rm->decreaseStreamUserCounter(s);
+    rm->unlockValidStreamMutex();
+    PAL_VERBOSE(LOG_TAG, "Exit. status %d", status);
+    return status;
+}
+
+ssize_t pal_stream_read_buffers(pal_stream_handle_t *stream_handle,
+                                struct pal_buffer *bufs, uint32_t count)
+{
+    return pal_stream_queue_buffers(stream_handle, bufs, count, false);
+}
+
+ssize_t pal_stream_write_buffers(pal_stream_handle_t *stream_handle,
+                                 struct pal_buffer *bufs, uint32_t count)
+{
+    return pal_stream_queue_buffers(stream_handle, bufs, count, true);
+}
+
+int32_t pal_stream_register_read_buffer(pal_stream_handle_t *stream_handle,
+                                        int fd, size_t size)
+{
+    int32_t status = 0;
+    std::shared_ptr<ResourceManager> rm = NULL;
+
+    rm = ResourceManager::getInstance();
+    if (!rm) {
+        PAL_ERR(LOG_TAG, "Invalid resource manager");
+        return -EINVAL;
+    }
+    rm->lockValidStreamMutex();
+    if (!stream_handle || !rm->isActiveStream(stream_handle) ||
+        (fd >= 0 && !size)) {
+        status = -EINVAL;
+        PAL_ERR(LOG_TAG, "Invalid input parameters status %d", status);
+    }
+    rm->unlockValidStreamMutex();
+    /* reads in process fill buf->buffer directly, nothing to set up */
+    PAL_VERBOSE(LOG_TAG, "handle %pK fd %d size %zu status %d", stream_handle,
+                fd, size, status);
+    return status;
+}
+
+struct pal_batch {
+    uint32_t flags;
+    uint32_t count;
+    std::vector<uint8_t> ops;
+};
+
+pal_batch_t *pal_batch_begin(uint32_t flags)
+{
+    pal_batch_t *batch = new (std::nothrow) pal_batch_t;
+
+    if (!batch) {
+        PAL_ERR(LOG_TAG, "Memory alloc failed");
+        return NULL;
+    }
+    batch->flags = flags;
+    batch->count = 0;
+    return batch;
+}
+
+int32_t pal_batch_add(pal_batch_t *batch, uint32_t op,
+                      pal_stream_handle_t *stream_handle, uint32_t arg,
+                      const void *data, size_t size)
+{
+    struct pal_batch_op *rec = NULL;
+    size_t offset = 0;
+
+    if (!batch || !stream_handle || (size && !data) || size > UINT32_MAX) {
+        PAL_ERR(LOG_TAG, "Invalid input parameters");
+        return -EINVAL;
+    }
+
+    offset = batch->ops.size();
+    batch->ops.resize(offset + PAL_BATCH_OP_SIZE(size));
+    rec = (struct pal_batch_op *)(batch->ops.data() + offset);
+    rec->op = op;
+    rec->arg = arg;
+    rec->stream_handle = (uint64_t)stream_handle;
+    rec->size = (uint32_t)size;
+    rec->reserved = 0;
+    if (size)
+        ar_mem_cpy(rec->data, size, data, size);
+    batch->count++;
+    return 0;
+}
+
+static int32_t pal_batch_run_op(struct pal_batch_op *rec)
+{
+    pal_stream_handle_t *stream_handle = (pal_stream_handle_t *)rec->stream_handle;
+    pal_param_payload *param = (pal_param_payload *)rec->data;
+    struct pal_volume_data *volume = (struct pal_volume_data *)rec->data;
+
+    switch (rec->op) {
+    case PAL_BATCH_OP_STREAM_SET_PARAM:
+        if (rec->size < sizeof(*param) ||
+            rec->size - sizeof(*param) < param->payload_size)
+            return -EINVAL;
+        return pal_stream_set_param(stream_handle, rec->arg, param);
+    case PAL_BATCH_OP_STREAM_SET_VOLUME:
+        if (rec->size < sizeof(*volume) ||
+            (rec->size - sizeof(*volume)) / sizeof(struct pal_channel_vol_kv) <
+            volume->no_of_volpair)
+            return -EINVAL;
+        return pal_stream_set_volume(stream_handle, volume);
+    case PAL_BATCH_OP_STREAM_SET_MUTE:
+        return pal_stream_set_mute(stream_handle, !!rec->arg);
+    case PAL_BATCH_OP_STREAM_SET_DEVICE:
+        if (rec->size / sizeof(struct pal_device) < rec->arg)
+            return -EINVAL;
+        return pal_stream_set_device(stream_handle, rec->arg,
+                                     (struct pal_device *)rec->data);
+    default:
+        PAL_ERR(LOG_TAG, "unknown batch op %u", rec->op);
+        return -EINVAL;
+    }
+}
+
+int32_t pal_batch_commit(pal_batch_t *batch, int32_t *status, uint32_t count)
+{
+    struct pal_batch_op *rec = NULL;
+    int32_t ret = 0;
+    int32_t op_status = 0;
+    size_t offset = 0;
+
+    if (!batch) {
+        PAL_ERR(LOG_TAG, "Invalid batch");
+        return -EINVAL;
+    }
+
+    PAL_DBG(LOG_TAG, "Enter. %u ops", batch->count);
+    for (uint32_t i = 0; i < batch->count; i++) {
+        rec = (struct pal_batch_op *)(batch->ops.data() + offset);
+        offset += PAL_BATCH_OP_SIZE(rec->size);
+        if (ret && (batch->flags & PAL_BATCH_FLAG_STOP_ON_ERROR))
+            op_status = -ECANCELED;
+        else
+            op_status = pal_batch_run_op(rec);
+        if (op_status && !ret) {
+            PAL_ERR(LOG_TAG, "batch op %u (%u) failed, status %d", i,
+                    rec->op, op_status);
+            ret = op_status;
+        }
+        if (status && i < count)
+            status[i] = op_status;
+    }
+    delete batch;
+
+    PAL_DBG(LOG_TAG, "Exit. status %d", ret);
+    return ret;
+}
+
 int32_t pal_stream_get_param(pal_stream_handle_t *stream_handle,
                              uint32_t param_id, pal_param_payload **param_payload)
 {
@@ -855,6 +1050,50 @@ int32_t pal_stream_suspend(pal_stream_handle_t *stream_handle)
     return status;
 }
 
+int32_t pal_stream_get_buffer_size(pal_stream_handle_t *stream_handle,
+                                   size_t *in_buffer, size_t *out_buffer)
+{
+    Stream *s = NULL;
+    int status;
+    size_t in_count = 0, out_count = 0;
+    std::shared_ptr<ResourceManager> rm = NULL;
+
+    rm = ResourceManager::getInstance();
+    if (!rm) {
+        PAL_ERR(LOG_TAG, "Invalid resource manager");
+        status = -EINVAL;
+        return status;
+    }
+
+    rm->lockValidStreamMutex();
+    if (!stream_handle || !rm->isActiveStream(stream_handle)) {
+        rm->unlockValidStreamMutex();
+        status = -EINVAL;
+        PAL_ERR(LOG_TAG, "Invalid stream handle status %d", status);
+        return status;
+    }
+
+    PAL_DBG(LOG_TAG, "Enter. Stream handle :%pK", stream_handle);
+    s =  reinterpret_cast<Stream *>(stream_handle);
+    status = rm->increaseStreamUserCounter(s);
+    if (0 != status) {
+        rm->unlockValidStreamMutex();
+        PAL_ERR(LOG_TAG, "failed to increase stream user count");
+        return status;
+    }
+    rm->unlockValidStreamMutex();
+
+    status = s->getBufferSize(in_buffer, &in_count, out_buffer, &out_count);
+    if (0 != status) {
+        PAL_ERR(LOG_TAG, "pal_stream_get_buffer_size failed with status %d", status);
+    }
+    rm->lockValidStreamMutex();
+    rm->decreaseStreamUserCounter(s);
+    rm->unlockValidStreamMutex();
+    PAL_DBG(LOG_TAG, "Exit. status %d", status);
+    return status;
+}
+
 int32_t pal_stream_set_buffer_size (pal_stream_handle_t *stream_handle,
                                     pal_buffer_config *in_buffer_cfg,
                                     pal_buffer_config *out_buffer_cfg)
@@ -1283,6 +1522,63 @@ int32_t pal_stream_get_mmap_position(pal_stream_handle_t *stream_handle,
     return status;
 }
 
+int32_t pal_stream_get_position_mirror(pal_stream_handle_t *stream_handle,
+                                       const pal_position_mirror_t **mirror)
+{
+    Stream *s = NULL;
+    int status;
+    std::shared_ptr<ResourceManager> rm = NULL;
+
+    rm = ResourceManager::getInstance();
+    if (!rm) {
+        PAL_ERR(LOG_TAG, "Invalid resource manager");
+        return -EINVAL;
+    }
+
+    /* only bookkeeping on the stream, done under the valid stream lock */
+    rm->lockValidStreamMutex();
+    if (!stream_handle || !rm->isActiveStream(stream_handle) || !mirror) {
+        rm->unlockValidStreamMutex();
+        status = -EINVAL;
+        PAL_ERR(LOG_TAG, "Invalid input parameters status %d", status);
+        return status;
+    }
+    s = reinterpret_cast<Stream *>(stream_handle);
+    status = s->getPositionMirror(mirror);
+    rm->unlockValidStreamMutex();
+
+    PAL_DBG(LOG_TAG, "Stream handle :%pK status %d", stream_handle, status);
+    return status;
+}
+
+int32_t pal_stream_set_position_mirror(pal_stream_handle_t *stream_handle,
+                                       pal_position_mirror_t *mirror)
+{
+    Stream *s = NULL;
+    int status;
+    std::shared_ptr<ResourceManager> rm = NULL;
+
+    rm = ResourceManager::getInstance();
+    if (!rm) {
+        PAL_ERR(LOG_TAG, "Invalid resource manager");
+        return -EINVAL;
+    }
+
+    rm->lockValidStreamMutex();
+    if (!stream_handle || !rm->isActiveStream(stream_handle)) {
+        rm->unlockValidStreamMutex();
+        status = -EINVAL;
+        PAL_ERR(LOG_TAG, "Invalid stream handle status %d", status);
+        return status;
+    }
+    s = reinterpret_cast<Stream *>(stream_handle);
+    status = s->setPositionMirror(mirror);
+    rm->unlockValidStreamMutex();
+
+    PAL_DBG(LOG_TAG, "Stream handle :%pK status %d", stream_handle, status);
+    return status;
+}
+
 int32_t pal_stream_create_mmap_buffer(pal_stream_handle_t *stream_handle,
                               int32_t min_size_frames,
                               struct pal_mmap_buffer *info)
@@ -39,8 +39,13 @@
 #ifndef PAL_API_H
 #define PAL_API_H
 
+#include <errno.h>
+#include <string.h>
 #include "PalDefs.h"
 
+/** attempts of pal_position_mirror_read before it gives up */
+#define PAL_POSITION_MIRROR_READ_TRIES 64
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -300,6 +305,104 @@ ssize_t pal_stream_read(pal_stream_handle_t *stream_handle, struct pal_buffer *b
   */
 ssize_t pal_stream_write(pal_stream_handle_t *stream_handle, struct pal_buffer *buf);
 
+/**
+  * Queue several capture buffers of a non tunnel stream at once.
+  * Supported for streams opened with PAL_STREAM_FLAG_EXTERN_MEM and a
+  * callback. The call returns as soon as the buffers are queued, each
+  * one is handed back through its own PAL_STREAM_CBK_EVENT_READ_DONE
+  * event in queue order.
+  *
+  * \param[in] stream_handle - Valid stream handle obtained
+  *       from pal_stream_open
+  * \param[in] bufs - array of count pal_buffers to be filled.
+  * \param[in] count - number of buffers in bufs.
+  *
+  * \return number of buffers queued, or error code if none was queued.
+  */
+ssize_t pal_stream_read_buffers(pal_stream_handle_t *stream_handle,
+                                struct pal_buffer *bufs, uint32_t count);
+
+/**
+  * Queue several buffers of a non tunnel stream for rendering at once.
+  * Supported for streams opened with PAL_STREAM_FLAG_EXTERN_MEM and a
+  * callback. The call returns as soon as the buffers are queued, each
+  * one is handed back through its own PAL_STREAM_CBK_EVENT_WRITE_READY
+  * event in queue order.
+  *
+  * \param[in] stream_handle - Valid stream handle obtained
+  *       from pal_stream_open
+  * \param[in] bufs - array of count pal_buffers to be rendered.
+  * \param[in] count - number of buffers in bufs.
+  *
+  * \return number of buffers queued, or error code if none was queued.
+  */
+ssize_t pal_stream_write_buffers(pal_stream_handle_t *stream_handle,
+                                 struct pal_buffer *bufs, uint32_t count);
+
+/**
+  * Register a shared memory region that capture buffers of the stream
+  * are read into in place. A later pal_stream_read whose
+  * buf->alloc_info.alloc_handle is the registered fd gets its data
+  * written straight into the region at buf->alloc_info.offset, buf->buffer
+  * being the caller's mapping of that offset. Across the IPC this saves
+  * the copies through the reply, in process reads already land in the
+  * caller's buffer and the call only validates its arguments.
+  *
+  * \param[in] stream_handle - Valid stream handle obtained
+  *       from pal_stream_open
+  * \param[in] fd - memfd/ashmem/dma-buf fd of the region, -1 to
+  *       unregister.
+  * \param[in] size - size of the region in bytes.
+  *
+  * \return 0 on success, error code otherwise.
+  */
+int32_t pal_stream_register_read_buffer(pal_stream_handle_t *stream_handle,
+                                        int fd, size_t size);
+
+/**
+  * Start a batch of stream control operations. The operations added
+  * to the batch are only applied by pal_batch_commit, in the order they
+  * were added, and across the IPC they travel in a single transaction.
+  *
+  * \param[in] flags - PAL_BATCH_FLAG_* flags.
+  *
+  * \return batch handle, NULL on failure.
+  */
+pal_batch_t *pal_batch_begin(uint32_t flags);
+
+/**
+  * Append an operation to a batch. data is copied, its layout depends
+  * on op as described by pal_batch_op_id_t.
+  *
+  * \param[in] batch - batch from pal_batch_begin
+  * \param[in] op - pal_batch_op_id_t
+  * \param[in] stream_handle - Valid stream handle obtained
+  *       from pal_stream_open
+  * \param[in] arg - op argument
+  * \param[in] data - op data, size bytes
+  * \param[in] size - size of data
+  *
+  * \return 0 on success, error code otherwise.
+  */
+int32_t pal_batch_add(pal_batch_t *batch, uint32_t op,
+                      pal_stream_handle_t *stream_handle, uint32_t arg,
+                      const void *data, size_t size);
+
+/**
+  * Apply the operations of a batch in order and release it. The
+  * operations are not atomic, each one takes the locks of its single
+  * call counterpart. With PAL_BATCH_FLAG_STOP_ON_ERROR the operations
+  * after a failed one are skipped and report -ECANCELED.
+  *
+  * \param[in] batch - batch from pal_batch_begin
+  * \param[out] status - optional, status of each operation
+  * \param[in] count - number of entries in status
+  *
+  * \return 0 if every operation succeeded, else status of the first
+  *       failed operation or error code.
+  */
+int32_t pal_batch_commit(pal_batch_t *batch, int32_t *status, uint32_t count);
+
 /**
   * \brief get current device on stream.
   *
@@ -512,6 +615,68 @@ int32_t pal_stream_create_mmap_buffer(pal_stream_handle_t *stream_handle,
 int32_t pal_stream_get_mmap_position(pal_stream_handle_t *stream_handle,
                               struct pal_mmap_position *position);
 
+/**
+  * Get the position mirror of a stream. PAL updates the page at every
+  * period boundary with the frames transferred and the hardware position,
+  * and with the DSP timestamp whenever one is read, so position polling
+  * needs no call into PAL. The page is read only for the client and stays
+  * valid until the stream is closed; across the IPC it is shared memory
+  * the server writes into.
+  *
+  * \param[in] stream_handle - Valid stream handle obtained
+  *       from pal_stream_open
+  * \param[out] mirror - position mirror of the stream
+  *
+  * \return 0 on success, error code otherwise
+  */
+int32_t pal_stream_get_position_mirror(pal_stream_handle_t *stream_handle,
+                                       const pal_position_mirror_t **mirror);
+
+/**
+  * Publish the position of a stream into caller provided memory instead,
+  * e.g. a page shared with another process. The memory must stay valid
+  * until it is replaced, detached with NULL or the stream is closed. Only
+  * available in process.
+  *
+  * \param[in] stream_handle - Valid stream handle obtained
+  *       from pal_stream_open
+  * \param[in] mirror - memory to publish into, NULL to detach
+  *
+  * \return 0 on success, error code otherwise
+  */
+int32_t pal_stream_set_position_mirror(pal_stream_handle_t *stream_handle,
+                                       pal_position_mirror_t *mirror);
+
+/**
+  * Take a consistent snapshot of a position mirror. Retries while PAL
+  * is updating the page.
+  *
+  * \param[in] mirror - page from pal_stream_get_position_mirror
+  * \param[out] snapshot - copy of the page
+  *
+  * \return 0 on success, -EAGAIN if no stable copy could be taken
+  */
+static inline int32_t pal_position_mirror_read(const pal_position_mirror_t *mirror,
+                                               pal_position_mirror_t *snapshot)
+{
+    uint32_t seq = 0;
+    int tries = 0;
+
+    if (!mirror || !snapshot)
+        return -EINVAL;
+
+    for (tries = 0; tries < PAL_POSITION_MIRROR_READ_TRIES; tries++) {
+        seq = __atomic_load_n(&mirror->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1)
+            continue;
+        memcpy(snapshot, mirror, sizeof(*snapshot));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&mirror->seq, __ATOMIC_RELAXED) == seq)
+            return 0;
+    }
+    return -EAGAIN;
+}
+
 /**
   * \brief Register global callback to pal.
   *        This can be used to inform client about any information
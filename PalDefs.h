@@ -630,6 +630,7 @@ typedef enum {
     PAL_STREAM_CBK_EVENT_PARTIAL_DRAIN_READY, /* partial drain completed */
     PAL_STREAM_CBK_EVENT_READ_DONE, /* stream hit some error, let AF take action */
     PAL_STREAM_CBK_EVENT_ERROR, /* stream hit some error, let AF take action */
+    PAL_STREAM_CBK_EVENT_XRUN, /* pcm under/overrun, payload is pal_param_xrun_stats_t */
 } pal_stream_callback_event_t;
 
 /* type of global callback events. */
@@ -745,6 +746,11 @@ typedef struct pal_extern_alloc_buff_info{
     uint32_t offset;      /**< offset of buffer within extern allocation */
 } pal_extern_alloc_buff_info_t;
 
+/** pal_buffer flag of reads filled in a region from pal_stream_register_read_buffer */
+#define PAL_BUFF_FLAG_SHMEM_READ 0x80000000
+/** pal_buffer flag of the zero sized write handing a position mirror page to the IPC server */
+#define PAL_BUFF_FLAG_POSITION_MIRROR 0x40000000
+
 /** PAL buffer structure used for reading/writing buffers from/to the stream */
 struct pal_buffer {
     uint8_t *buffer;                  /**<  buffer pointer */
@@ -813,6 +819,36 @@ struct pal_volume_data {
     struct pal_channel_vol_kv volume_pair[];     /**< channel mask and volume pair */
 };
 
+/** control operations carried by a pal batch */
+typedef enum {
+    PAL_BATCH_OP_STREAM_SET_PARAM = 1,  /**< arg param id, data pal_param_payload */
+    PAL_BATCH_OP_STREAM_SET_VOLUME,     /**< data pal_volume_data */
+    PAL_BATCH_OP_STREAM_SET_MUTE,       /**< arg mute state, no data */
+    PAL_BATCH_OP_STREAM_SET_DEVICE,     /**< arg number of devices, data pal_device array */
+} pal_batch_op_id_t;
+
+/** pal_batch_begin flags */
+#define PAL_BATCH_FLAG_STOP_ON_ERROR 0x1 /**< skip the ops after a failed one */
+
+/** param id the IPC layer carries a batch under */
+#define PAL_BATCH_IPC_PARAM_ID 0xBA7C0001
+
+/** one operation of a batch, records are packed back to back on 8 bytes */
+struct pal_batch_op {
+    uint32_t op;               /**< pal_batch_op_id_t */
+    uint32_t arg;              /**< op argument */
+    uint64_t stream_handle;    /**< stream the op applies to */
+    uint32_t size;             /**< bytes of data */
+    uint32_t reserved;
+    uint8_t data[];            /**< op data */
+};
+
+/** bytes taken by an op record carrying size bytes of data */
+#define PAL_BATCH_OP_SIZE(size) \
+    ((sizeof(struct pal_batch_op) + (size) + 7) & ~(size_t)7)
+
+typedef struct pal_batch pal_batch_t;
+
 struct pal_time_us {
     uint32_t value_lsw;   /** Lower 32 bits of 64 bit time value in microseconds */
     uint32_t value_msw;   /** Upper 32 bits of 64 bit time value in microseconds */
@@ -826,6 +862,22 @@ struct pal_session_time {
     struct pal_time_us timestamp;      /** Value of the last processed time stamp in microseconds */
 };
 
+/**
+ * Stream position PAL publishes at every period boundary into a page the
+ * client maps, see pal_stream_get_position_mirror. The page is updated
+ * under a sequence count, read it with pal_position_mirror_read.
+ */
+typedef struct pal_position_mirror {
+    uint32_t seq;                     /**< odd while an update is in progress */
+    uint32_t sample_rate;             /**< rate of the frame counts */
+    uint64_t frames;                  /**< frames written (playback) or read (capture) */
+    uint64_t hw_frames;               /**< frames rendered or captured by the hardware at hw_time_ns */
+    int64_t  hw_time_ns;              /**< CLOCK_MONOTONIC time of hw_frames, 0 if unknown */
+    int64_t  update_time_ns;          /**< CLOCK_MONOTONIC time of the last period boundary */
+    struct pal_session_time dsp_time; /**< last DSP timestamp, read by pal_get_timestamp or per compress fragment */
+    int64_t  dsp_time_update_ns;      /**< CLOCK_MONOTONIC time dsp_time was read, 0 if never */
+} pal_position_mirror_t;
+
 /** EVENT configurations data strucutre defintion used as
  *  argument for mute command */
 //typedef union {
@@ -903,6 +955,8 @@ typedef enum {
     PAL_PARAM_ID_VOLUME_USING_SET_PARAM = 55,
     PAL_PARAM_ID_UHQA_FLAG = 56,
     PAL_PARAM_ID_STREAM_ATTRIBUTES = 57,
+    PAL_PARAM_ID_XRUN_STATS = 58,
+    PAL_PARAM_ID_XRUN_RECOVERY = 59,
 } pal_param_id_type_t;
 
 /** HDMI/DP */
@@ -1371,6 +1425,27 @@ typedef struct pal_device_mute_t {
     bool mute;
 }pal_device_mute_t;
 
+/**
+ * Payload of PAL_PARAM_ID_XRUN_STATS, cumulative over the life of the
+ * stream. The client passes a pal_param_payload with payload_size set to
+ * sizeof(pal_param_xrun_stats_t), or a NULL payload in which case PAL
+ * allocates one that the client frees.
+ */
+typedef struct pal_param_xrun_stats {
+    uint32_t underruns;         /**< playback xruns */
+    uint32_t overruns;          /**< capture xruns */
+    uint64_t frames_lost;       /**< frames dropped or played as silence */
+    uint64_t last_xrun_time_us; /**< CLOCK_MONOTONIC time of the last xrun */
+} pal_param_xrun_stats_t;
+
+/**
+ * Recovery bits of PAL_PARAM_ID_XRUN_RECOVERY (uint32_t payload). The pcm
+ * is always re-prepared and the transfer retried; the bits add to that.
+ */
+#define PAL_XRUN_RECOVERY_PREPARE 0x0 /**< prepare and continue */
+#define PAL_XRUN_RECOVERY_SILENCE 0x1 /**< prime playback with a period of silence */
+#define PAL_XRUN_RECOVERY_NOTIFY  0x2 /**< raise PAL_STREAM_CBK_EVENT_XRUN */
+
 /**
  * Event payload passed to client with PAL_STREAM_CBK_EVENT_READ_DONE and
   * PAL_STREAM_CBK_EVENT_WRITE_READY events
@@ -127,6 +127,15 @@ typedef struct edidAudioInfo {
     unsigned int  channelMask;
 } edidAudioInfo;
 
+/* sink capabilities folded over all audio blocks once the EDID is parsed */
+typedef struct edidAudioCaps {
+    unsigned char samplingFreqBitmask;
+    unsigned char bitsPerSampleBitmask;
+    int maxChannel;
+    int highestSR;
+    int highestBps;
+} edidAudioCaps;
+
 class DisplayPort : public Device
 {
     uint32_t dp_controller;
@@ -155,6 +164,9 @@ public:
     static int32_t getExtDispType(struct audio_mixer *mixer, int controller, int stream);
     static int getEdidInfo(struct audio_mixer *mixer, int controller, int stream);
     static void cacheEdid(struct audio_mixer *mixer, int controller, int stream);
+    static void invalidateEdid(int controller, int stream);
+    static bool isEdidCached(int controller, int stream);
+    static void updateEdidCaps(edidAudioInfo *info, edidAudioCaps *caps);
     static const char * edidFormatToStr(unsigned char format);
     static bool isSampleRateSupported(unsigned char srByte, int samplingRate);
     static unsigned char getEdidBpsByte(unsigned char byte, unsigned char format);
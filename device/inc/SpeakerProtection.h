@@ -35,6 +35,7 @@
 #include "sp_vi.h"
 #include "sp_rx.h"
 #include <tinyalsa/asoundlib.h>
+#include <atomic>
 #include <mutex>
 #include <condition_variable>
 #include <thread>
@@ -53,6 +54,9 @@ class Device;
 #define CPS_WSA_VBATT_LOWER_THRESHOLD_1 168
 #define CPS_WSA_VBATT_LOWER_THRESHOLD_2 148
 
+/* devices with their own calibration, speaker and handset */
+#define SPKR_CAL_SLOTS 2
+
 typedef enum speaker_prot_cal_state {
     SPKR_NOT_CALIBRATED,     /* Speaker not calibrated  */
     SPKR_CALIBRATED,         /* Speaker calibrated  */
@@ -122,6 +126,9 @@ protected :
     struct spDeviceInfo spDevInfo;
     void *viCustomPayload;
     size_t viCustomPayloadSize;
+    /* temperature controls resolved on first read, by speaker and by channel */
+    std::vector<struct mixer_ctl *> spkrTempCtls;
+    std::vector<struct mixer_ctl *> devTempCtls;
 
 private :
     static bool isSharedBE;
@@ -135,10 +142,18 @@ public:
     std::mutex deviceMutex;
     static std::mutex calibrationMutex;
     static std::mutex calSharedBeMutex;
+    /* wakes the calibration threads on speaker use changes */
+    static std::condition_variable calSchedCv;
+    static std::mutex calSchedMutex;
+    /* speaker starts waiting for calibrationMutex, per device (speaker, handset) */
+    static std::atomic<int> calPreempted[SPKR_CAL_SLOTS];
+    void setCalibrationPreempted(bool preempt);
     void spkrCalibrationThread();
     void spkrCalibrationThreadV2();
     int getSpeakerTemperature(int spkr_pos);
     void spkrCalibrateWait();
+    void spkrCalibrateWaitForIdle(bool *inUse, unsigned long sec);
+    bool isCalibrationPreempted(bool inUse);
     int spkrStartCalibration();
     int spkrStartCalibrationV2();
     int viTxSetupThreadLoop();
@@ -70,7 +70,9 @@
 #include "SessionAlsaUtils.h"
 #include <tinyalsa/asoundlib.h>
 #include <vector>
+#include <list>
 #include <map>
+#include <mutex>
 #include <system/audio.h>
 
 #define USB_BUFF_SIZE           4096
@@ -90,6 +92,10 @@
 #define DEFAULT_SERVICE_INTERVAL_US    0
 #define USB_IN_JACK_SUFFIX "Input Jack"
 #define USB_OUT_JACK_SUFFIX "Output Jack"
+/* parsed capability sets kept across reconnects */
+#define USB_CAPABILITY_CACHE_SIZE 4
+#define USB_FNV1A_64_OFFSET 0xcbf29ce484222325ULL
+#define USB_FNV1A_64_PRIME 0x100000001b3ULL
 
 typedef enum usb_usecase_type{
     USB_CAPTURE = 0,
@@ -130,14 +136,50 @@ public:
     unsigned int getSRMask(usb_usecase_type_t type) {return supported_sample_rates_mask_[type];} ;
 };
 
+/*
+ * parsed card stream info indexed by type, each direction is filled in by
+ * the first connect asking for it
+ */
+struct USBCapability {
+    bool parsed[2] = {false, false};
+    int status[2] = {0, 0};
+    int endian[2] = {0, 0};
+    std::vector <std::shared_ptr<USBDeviceConfig>> configs[2];
+};
+
+/* a device is identified by its address and the hash of its stream info */
+struct USBCapabilityEntry {
+    struct pal_usb_device_address addr;
+    uint64_t hash;
+    std::shared_ptr<USBCapability> cap;
+};
+
 class USBCardConfig {
 protected:
     struct pal_usb_device_address address_;
     int endian_;
     std::multimap<uint32_t, std::shared_ptr<USBDeviceConfig>> format_list_map;
     std::vector <std::shared_ptr<USBDeviceConfig>> usb_device_config_list_;
+    /* profiles per type keyed on bit width and channels, in parse order */
+    std::map<std::pair<unsigned int, unsigned int>,
+             std::vector<std::shared_ptr<USBDeviceConfig>>> profile_index_[2];
+    unsigned int max_channels_[2] = {1, 1};
     unsigned int usb_supported_sample_rates_mask_[2] = {0};
+    static std::mutex capability_lock_;
+    static std::list<USBCapabilityEntry> capability_cache_;
     void usb_info_dump(char* read_buf, int type);
+    int parseCapability(usb_usecase_type_t type, char *read_buf,
+                        struct pal_usb_device_address addr,
+                        std::vector<std::shared_ptr<USBDeviceConfig>> &configs,
+                        int *endian);
+    static std::shared_ptr<USBCapability> findCapability_l(
+                                        struct pal_usb_device_address addr, uint64_t hash);
+    std::shared_ptr<USBCapability> lookupCapability(usb_usecase_type_t type,
+                                                    struct pal_usb_device_address addr,
+                                                    bool *cached);
+    void setProfiles(const std::vector<std::shared_ptr<USBDeviceConfig>> &configs,
+                     int endian);
+    void indexProfiles();
 public:
     USBCardConfig(struct pal_usb_device_address address);
     bool isConfigCached(struct pal_usb_device_address addr);
@@ -261,7 +261,7 @@ int Bluetooth::configureA2dpEncoderDecoder()
             goto error;
         }
         dev->updateCustomPayload(paramData, paramSize);
-        free(paramData);
+        builder->freePayload(paramData);
         paramData = NULL;
         paramSize = 0;
     }
@@ -278,7 +278,7 @@ int Bluetooth::configureA2dpEncoderDecoder()
             goto error;
         }
         dev->updateCustomPayload(paramData, paramSize);
-        free(paramData);
+        builder->freePayload(paramData);
         paramData = NULL;
         paramSize = 0;
     }
@@ -328,7 +328,7 @@ int Bluetooth::configureA2dpEncoderDecoder()
                                   isTwsMonoModeOn, codecFormat);
         if (paramSize) {
             dev->updateCustomPayload(paramData, paramSize);
-            free(paramData);
+            builder->freePayload(paramData);
             paramData = NULL;
             paramSize = 0;
         } else {
@@ -343,7 +343,7 @@ int Bluetooth::configureA2dpEncoderDecoder()
                                   isLC3MonoModeOn);
         if (paramSize) {
             dev->updateCustomPayload(paramData, paramSize);
-            free(paramData);
+            builder->freePayload(paramData);
             paramData = NULL;
             paramSize = 0;
         } else {
@@ -365,7 +365,7 @@ int Bluetooth::configureA2dpEncoderDecoder()
                     copMiid, codecInfo, false /* StreamMapOut */);
             if (paramSize) {
                 dev->updateCustomPayload(paramData, paramSize);
-                delete [] paramData;
+                builder->freePayload(paramData);
                 paramData = NULL;
                 paramSize = 0;
             } else {
@@ -378,7 +378,7 @@ int Bluetooth::configureA2dpEncoderDecoder()
                     copMiid, codecInfo, true /* StreamMapIn */);
             if (paramSize) {
                 dev->updateCustomPayload(paramData, paramSize);
-                delete [] paramData;
+                builder->freePayload(paramData);
                 paramData = NULL;
                 paramSize = 0;
             } else {
@@ -396,7 +396,7 @@ int Bluetooth::configureA2dpEncoderDecoder()
                 builder->payloadRATConfig(&paramData, &paramSize, ratMiid, &codecConfig);
                 if (paramSize) {
                     dev->updateCustomPayload(paramData, paramSize);
-                    free(paramData);
+                    builder->freePayload(paramData);
                     paramData = NULL;
                     paramSize = 0;
                 } else {
@@ -417,7 +417,7 @@ int Bluetooth::configureA2dpEncoderDecoder()
             builder->payloadPcmCnvConfig(&paramData, &paramSize, cnvMiid, &codecConfig, false /* isRx */);
             if (paramSize) {
                 dev->updateCustomPayload(paramData, paramSize);
-                delete [] paramData;
+                builder->freePayload(paramData);
                 paramData = NULL;
                 paramSize = 0;
             } else {
@@ -441,7 +441,7 @@ int Bluetooth::configureA2dpEncoderDecoder()
         builder->payloadCopV2PackConfig(&paramData, &paramSize, copMiid, codecInfo);
         if (paramSize) {
             dev->updateCustomPayload(paramData, paramSize);
-            delete [] paramData;
+            builder->freePayload(paramData);
             paramData = NULL;
             paramSize = 0;
         } else {
@@ -454,7 +454,7 @@ int Bluetooth::configureA2dpEncoderDecoder()
         builder->payloadCopPackConfig(&paramData, &paramSize, copMiid, &deviceAttr.config);
         if (paramSize) {
             dev->updateCustomPayload(paramData, paramSize);
-            delete [] paramData;
+            builder->freePayload(paramData);
             paramData = NULL;
             paramSize = 0;
         } else {
@@ -479,7 +479,7 @@ int Bluetooth::configureA2dpEncoderDecoder()
         builder->payloadCopPackConfig(&paramData, &paramSize, copMiid, &deviceAttr.config);
         if (paramSize) {
             dev->updateCustomPayload(paramData, paramSize);
-            delete [] paramData;
+            builder->freePayload(paramData);
             paramData = NULL;
             paramSize = 0;
         } else {
@@ -492,7 +492,7 @@ int Bluetooth::configureA2dpEncoderDecoder()
             builder->payloadScramblingConfig(&paramData, &paramSize, copMiid, isScramblingEnabled);
             if (paramSize) {
                 dev->updateCustomPayload(paramData, paramSize);
-                delete [] paramData;
+                builder->freePayload(paramData);
                 paramData = NULL;
                 paramSize = 0;
             } else {
@@ -520,7 +520,7 @@ int Bluetooth::configureA2dpEncoderDecoder()
         builder->payloadRATConfig(&paramData, &paramSize, ratMiid, &codecConfig);
         if (paramSize) {
             dev->updateCustomPayload(paramData, paramSize);
-            free(paramData);
+            builder->freePayload(paramData);
             paramData = NULL;
             paramSize = 0;
         } else {
@@ -541,7 +541,7 @@ int Bluetooth::configureA2dpEncoderDecoder()
     builder->payloadPcmCnvConfig(&paramData, &paramSize, cnvMiid, &codecConfig, true /* isRx */);
     if (paramSize) {
         dev->updateCustomPayload(paramData, paramSize);
-        delete [] paramData;
+        builder->freePayload(paramData);
         paramData = NULL;
         paramSize = 0;
     } else {
@@ -611,7 +611,7 @@ int Bluetooth::configureNrecParameters(bool isNrecEnabled)
             goto exit;
         }
         dev->updateCustomPayload(paramData, paramSize);
-        free(paramData);
+        builder->freePayload(paramData);
         paramData = NULL;
         paramSize = 0;
     } else {
@@ -832,7 +832,7 @@ void Bluetooth::startAbr()
 
         ret = SessionAlsaUtils::setDeviceCustomPayload(rm, backEndName,
                 paramData, paramSize);
-        free(paramData);
+        builder->freePayload(paramData);
         if (ret) {
             PAL_ERR(LOG_TAG, "Error: Dev setParam failed for %d", fbDevice.id);
             goto disconnect_fe;
@@ -890,7 +890,7 @@ void Bluetooth::startAbr()
 
             ret = SessionAlsaUtils::setDeviceCustomPayload(rm, backEndName,
                     paramData, paramSize);
-            delete [] paramData;
+            builder->freePayload(paramData);
             if (ret) {
                 PAL_ERR(LOG_TAG, "Error: Dev setParam failed for %d", fbDevice.id);
                 goto disconnect_fe;
@@ -927,7 +927,7 @@ void Bluetooth::startAbr()
                       (uint32_t *)blk->payload, blk->payload_sz, miid, blk->param_id);
             if (paramSize) {
                 fbDev->updateCustomPayload(paramData, paramSize);
-                free(paramData);
+                builder->freePayload(paramData);
                 paramData = NULL;
                 paramSize = 0;
             } else {
@@ -952,7 +952,7 @@ void Bluetooth::startAbr()
                 builder->payloadCopV2DepackConfig(&paramData, &paramSize, miid, codecInfo, false /* StreamMapOut */);
                 if (paramSize) {
                     fbDev->updateCustomPayload(paramData, paramSize);
-                    delete [] paramData;
+                    builder->freePayload(paramData);
                     paramData = NULL;
                     paramSize = 0;
                 } else {
@@ -964,7 +964,7 @@ void Bluetooth::startAbr()
                 builder->payloadCopV2DepackConfig(&paramData, &paramSize, miid, codecInfo, true /* StreamMapIn */);
                 if (paramSize) {
                     fbDev->updateCustomPayload(paramData, paramSize);
-                    delete [] paramData;
+                    builder->freePayload(paramData);
                     paramData = NULL;
                     paramSize = 0;
                 } else {
@@ -986,7 +986,7 @@ void Bluetooth::startAbr()
                 builder->payloadCopV2PackConfig(&paramData, &paramSize, miid, codecInfo);
                 if (paramSize) {
                     fbDev->updateCustomPayload(paramData, paramSize);
-                    delete [] paramData;
+                    builder->freePayload(paramData);
                     paramData = NULL;
                     paramSize = 0;
                 } else {
@@ -999,7 +999,7 @@ void Bluetooth::startAbr()
                 builder->payloadCopPackConfig(&paramData, &paramSize, miid, &fbDevice.config);
                 if (paramSize) {
                     fbDev->updateCustomPayload(paramData, paramSize);
-                    delete [] paramData;
+                    builder->freePayload(paramData);
                     paramData = NULL;
                     paramSize = 0;
                 } else {
@@ -1019,7 +1019,7 @@ void Bluetooth::startAbr()
                 builder->payloadRATConfig(&paramData, &paramSize, miid, &fbDev->codecConfig);
                 if (paramSize) {
                     fbDev->updateCustomPayload(paramData, paramSize);
-                    free(paramData);
+                    builder->freePayload(paramData);
                     paramData = NULL;
                     paramSize = 0;
                 } else {
@@ -1040,7 +1040,7 @@ void Bluetooth::startAbr()
                         (codecType == DEC ? true : false) /* isRx */);
                 if (paramSize) {
                     fbDev->updateCustomPayload(paramData, paramSize);
-                    delete [] paramData;
+                    builder->freePayload(paramData);
                     paramData = NULL;
                     paramSize = 0;
                 } else {
@@ -63,6 +63,7 @@ static struct extDispState {
     void *edidInfo = NULL;
     bool valid = false;
     int type = EXT_DISPLAY_TYPE_NONE;
+    edidAudioCaps caps = {0, 0, 2, SAMPLINGRATE_48K, BITWIDTH_16};
 } extDisp[MAX_CONTROLLERS][MAX_STREAMS_PER_CONTROLLER];
 
 std::shared_ptr<Device> DisplayPort::objRx = nullptr;
@@ -419,10 +420,17 @@ int DisplayPort::init(pal_param_device_connection_t device_conn)
     return 0;
 }
 
-int DisplayPort::deinit(pal_param_device_connection_t device_conn __unused)
+int DisplayPort::deinit(pal_param_device_connection_t device_conn)
 {
-    updateAudioAckState(EXT_DISPLAY_PLUG_STATUS_NOTIFY_DISCONNECT, dp_controller, dp_stream);
-    //To-Do : Have to invalidate the cahed EDID
+    /*
+     * objRx is shared by all sinks and holds the last connected one, the
+     * sink going away is the one in the disconnect request
+     */
+    pal_param_disp_port_config_params* dp_config = (pal_param_disp_port_config_params*) &device_conn.device_config.dp_config;
+
+    updateAudioAckState(EXT_DISPLAY_PLUG_STATUS_NOTIFY_DISCONNECT, dp_config->controller, dp_config->stream);
+    /* the next sink on this controller/stream may differ, read it again on connect */
+    invalidateEdid(dp_config->controller, dp_config->stream);
     return 0;
 }
 
@@ -455,6 +463,31 @@ void DisplayPort::resetEdidInfo() {
     }
 }
 
+void DisplayPort::invalidateEdid(int controller, int stream)
+{
+    struct extDispState *state = NULL;
+
+    if (getDisplayPortCtlIndex(controller, stream) < 0)
+        return;
+
+    PAL_DBG(LOG_TAG," invalidate edid of controller/stream %d/%d", controller, stream);
+    state = &extDisp[controller][stream];
+    state->type = EXT_DISPLAY_TYPE_NONE;
+    if (state->edidInfo) {
+        free(state->edidInfo);
+        state->edidInfo = NULL;
+    }
+    state->valid = false;
+}
+
+bool DisplayPort::isEdidCached(int controller, int stream)
+{
+    if (getDisplayPortCtlIndex(controller, stream) < 0)
+        return false;
+
+    return extDisp[controller][stream].valid;
+}
+
 /*
  * returns index for mixer controls
  *
@@ -657,6 +690,7 @@ int DisplayPort::getEdidInfo(struct audio_mixer *mixer, int controller, int stre
         PAL_ERR(LOG_TAG," Failed to get extn disp sink capabilities");
         goto fail;
     }
+    updateEdidCaps((struct edidAudioInfo *)state->edidInfo, &state->caps);
     state->valid = true;
     return 0;
 fail:
@@ -1672,24 +1706,55 @@ bool DisplayPort::getSinkCaps(edidAudioInfo* info, char *edidData)
     return true;
 }
 
-bool DisplayPort::isSupportedSR(edidAudioInfo* info, int sr)
+void DisplayPort::updateEdidCaps(edidAudioInfo *info, edidAudioCaps *caps)
 {
     int i = 0;
+
+    caps->samplingFreqBitmask = 0;
+    caps->bitsPerSampleBitmask = 0;
+    caps->maxChannel = 2;
+
+    for (i = 0; i < info->audioBlocks && i < MAX_EDID_BLOCKS; i++) {
+        caps->samplingFreqBitmask |= info->audioBlocksArray[i].samplingFreqBitmask;
+        caps->bitsPerSampleBitmask |= info->audioBlocksArray[i].bitsPerSampleBitmask;
+        if (info->audioBlocksArray[i].formatId == LPCM &&
+            caps->maxChannel < info->audioBlocksArray[i].channels)
+            caps->maxChannel = info->audioBlocksArray[i].channels;
+    }
+
+    caps->highestSR = getHighestEdidSF(caps->samplingFreqBitmask);
+    if (caps->highestSR == 0) {
+        PAL_ERR(LOG_TAG,"Unable to get Highest SR. Setting default SR");
+        caps->highestSR = SAMPLINGRATE_48K;
+    }
+
+    if (isSupportedBps(caps->bitsPerSampleBitmask, 24)) {
+        caps->highestBps = 24;
+    } else {
+        if (!isSupportedBps(caps->bitsPerSampleBitmask, BITWIDTH_16))
+            PAL_ERR(LOG_TAG, "None of the supported BPS is highest");
+        caps->highestBps = BITWIDTH_16;
+    }
+
+    PAL_DBG(LOG_TAG," sr mask 0x%x bps mask 0x%x max ch %d highest sr %d bps %d",
+            caps->samplingFreqBitmask, caps->bitsPerSampleBitmask,
+            caps->maxChannel, caps->highestSR, caps->highestBps);
+}
+
+bool DisplayPort::isSupportedSR(edidAudioInfo* info, int sr)
+{
     struct extDispState *state = NULL;
+    edidAudioCaps caps = {0, 0, 2, SAMPLINGRATE_48K, BITWIDTH_16};
 
     state = &extDisp[dp_controller][dp_stream];
-    if (state && state->edidInfo)
-    {
-        info = (edidAudioInfo*) state->edidInfo;
-    }
-    if (info != NULL && sr != 0) {
-        for (i = 0; i < info->audioBlocks && i < MAX_EDID_BLOCKS; i++) {
-        if (isSampleRateSupported(info->audioBlocksArray[i].samplingFreqBitmask,
-                    sr)) {
-                PAL_DBG(LOG_TAG," Returns true for sample rate [%d]", sr);
-                return true;
-            }
-        }
+    if (state->valid)
+        caps = state->caps;
+    else if (info != NULL)
+        updateEdidCaps(info, &caps);
+
+    if (sr != 0 && isSampleRateSupported(caps.samplingFreqBitmask, sr)) {
+        PAL_DBG(LOG_TAG," Returns true for sample rate [%d]", sr);
+        return true;
     }
     PAL_ERR(LOG_TAG," Returns false for sample rate [%d]", sr);
     return false;
@@ -1697,28 +1762,13 @@ bool DisplayPort::isSupportedSR(edidAudioInfo* info, int sr)
 
 int DisplayPort::getMaxChannel()
 {
-    int i = 0;
-    struct extDispState *state = NULL;
-    int max_channel = 2;
-    edidAudioInfo *info = NULL;
+    struct extDispState *state = &extDisp[dp_controller][dp_stream];
 
-    state = &extDisp[dp_controller][dp_stream];
-    if (state && state->edidInfo)
-    {
-        info = (edidAudioInfo*) state->edidInfo;
-    }
+    if (!state->valid)
+        return 2;
 
-    if (info != NULL) {
-        for (i = 0; i < info->audioBlocks && i < MAX_EDID_BLOCKS; i++) {
-            if (info->audioBlocksArray[i].formatId == LPCM) {
-                if (max_channel < info->audioBlocksArray[i].channels) {
-                    max_channel = info->audioBlocksArray[i].channels;
-                    PAL_DBG(LOG_TAG," Max channels updated to [%d]", max_channel);
-                }
-            }
-        }
-    }
-    return max_channel;
+    PAL_DBG(LOG_TAG," Max channels [%d]", state->caps.maxChannel);
+    return state->caps.maxChannel;
 }
 
 bool DisplayPort::isSupportedBps(edidAudioInfo* info, int bps)
@@ -1745,69 +1795,25 @@ bool DisplayPort::isSupportedBps(edidAudioInfo* info, int bps)
 
 int DisplayPort::getHighestSupportedSR()
 {
-    int sr = 0;
-    int highestSR = 0;
-    int i;
-    struct extDispState *state = NULL;
-    edidAudioInfo *info = NULL;
+    struct extDispState *state = &extDisp[dp_controller][dp_stream];
 
-    state = &extDisp[dp_controller][dp_stream];
-    if (state && state->edidInfo)
-    {
-        info = (edidAudioInfo*) state->edidInfo;
-    }
-
-    if (info != NULL) {
-        for (i = 0; i < info->audioBlocks && i < MAX_EDID_BLOCKS; i++) {
-          sr = getHighestEdidSF(info->audioBlocksArray[i].samplingFreqBitmask);
-          if (sr > highestSR)
-            highestSR = sr;
-        }
-    }
-    else {
+    if (!state->valid) {
         PAL_ERR(LOG_TAG," info is NULL");
-        highestSR = SAMPLINGRATE_48K;
+        return SAMPLINGRATE_48K;
     }
 
-    if (highestSR == 0) {
-        PAL_ERR(LOG_TAG,"Unable to get Highest SR. Setting default SR");
-        highestSR = SAMPLINGRATE_48K;
-    }
-
-    PAL_VERBOSE(LOG_TAG," returns [%d] for highest supported sr", highestSR);
-    return highestSR;
+    PAL_VERBOSE(LOG_TAG," returns [%d] for highest supported sr", state->caps.highestSR);
+    return state->caps.highestSR;
 }
 
 int DisplayPort::getHighestSupportedBps()
 {
-    int bpsMask = 0;
-    int highestBps = 0;
-    int i;
-    struct extDispState *state = NULL;
-    edidAudioInfo *info = NULL;
+    struct extDispState *state = &extDisp[dp_controller][dp_stream];
 
-    state = &extDisp[dp_controller][dp_stream];
-    if (state && state->edidInfo)
-    {
-        info = (edidAudioInfo*) state->edidInfo;
-    }
-
-    if (info != NULL) {
-        for (i = 0; i < info->audioBlocks && i < MAX_EDID_BLOCKS; i++) {
-            bpsMask = info->audioBlocksArray[i].bitsPerSampleBitmask;
-            if (isSupportedBps(bpsMask, 24)) {
-                highestBps = 24;
-                break;
-            }
-            else if (isSupportedBps(bpsMask, BITWIDTH_16))
-                if (highestBps < BITWIDTH_16)
-                    highestBps = BITWIDTH_16;
-        }
-    }
-
-    if (highestBps == 0) {
+    if (!state->valid) {
         PAL_ERR(LOG_TAG, "None of the supported BPS is highest");
-        highestBps = 16;
+        return BITWIDTH_16;
     }
-    return highestBps;
+
+    return state->caps.highestBps;
 }
@@ -93,6 +93,9 @@ std::condition_variable SpeakerProtection::cv;
 std::mutex SpeakerProtection::cvMutex;
 std::mutex SpeakerProtection::calibrationMutex;
 std::mutex SpeakerProtection::calSharedBeMutex;
+std::condition_variable SpeakerProtection::calSchedCv;
+std::mutex SpeakerProtection::calSchedMutex;
+std::atomic<int> SpeakerProtection::calPreempted[SPKR_CAL_SLOTS];
 
 bool SpeakerProtection::isSharedBE;
 bool SpeakerProtection::isSpkrInUse;
@@ -215,14 +218,18 @@ void SpeakerProtection::spkrProtSetSpkrStatusV2(bool enable)
 {
     PAL_DBG(LOG_TAG, "Enter");
 
-    if (enable)
-        spDevInfo.isDeviceInUse = true;
-    else {
-        spDevInfo.isDeviceInUse = false;
-        clock_gettime(CLOCK_BOOTTIME, &spDevInfo.deviceLastTimeUsed);
-        PAL_INFO(LOG_TAG, "Speaker used last time %ld",
-                        spDevInfo.deviceLastTimeUsed.tv_sec);
+    {
+        std::lock_guard<std::mutex> lock(calSchedMutex);
+        if (enable)
+            spDevInfo.isDeviceInUse = true;
+        else {
+            spDevInfo.isDeviceInUse = false;
+            clock_gettime(CLOCK_BOOTTIME, &spDevInfo.deviceLastTimeUsed);
+            PAL_INFO(LOG_TAG, "Speaker used last time %ld",
+                            spDevInfo.deviceLastTimeUsed.tv_sec);
+        }
     }
+    calSchedCv.notify_all();
 
     PAL_DBG(LOG_TAG, "Exit");
 }
@@ -232,13 +239,17 @@ void SpeakerProtection::spkrProtSetSpkrStatus(bool enable)
 {
     PAL_DBG(LOG_TAG, "Enter");
 
-    if (enable)
-        isSpkrInUse = true;
-    else {
-        isSpkrInUse = false;
-        clock_gettime(CLOCK_BOOTTIME, &spkrLastTimeUsed);
-        PAL_INFO(LOG_TAG, "Speaker used last time %ld", spkrLastTimeUsed.tv_sec);
+    {
+        std::lock_guard<std::mutex> lock(calSchedMutex);
+        if (enable)
+            isSpkrInUse = true;
+        else {
+            isSpkrInUse = false;
+            clock_gettime(CLOCK_BOOTTIME, &spkrLastTimeUsed);
+            PAL_INFO(LOG_TAG, "Speaker used last time %ld", spkrLastTimeUsed.tv_sec);
+        }
     }
+    calSchedCv.notify_all();
 
     PAL_DBG(LOG_TAG, "Exit");
 }
@@ -251,6 +262,56 @@ void SpeakerProtection::spkrCalibrateWait()
             std::chrono::milliseconds(WAKEUP_MIN_IDLE_CHECK));
 }
 
+/* Sleeps until the next calibration event instead of polling: while the speaker
+ * is in use until it is released, otherwise until it has been idle for
+ * minIdleTime or is used again. inUse is only written under calSchedMutex.
+ */
+void SpeakerProtection::spkrCalibrateWaitForIdle(bool *inUse, unsigned long sec)
+{
+    std::unique_lock<std::mutex> lock(calSchedMutex);
+
+    if (*inUse) {
+        calSchedCv.wait(lock, [inUse] { return !*inUse; });
+        return;
+    }
+
+    if (sec < (unsigned long)minIdleTime)
+        calSchedCv.wait_for(lock, std::chrono::seconds(minIdleTime - sec),
+                            [inUse] { return *inUse; });
+}
+
+/* calPreempted slot of the speaker or handset */
+static int spkrCalSlot(uint32_t id)
+{
+    return id == PAL_DEVICE_OUT_HANDSET ? 1 : 0;
+}
+
+/*
+ * A start preempts the calibration of its own device, and of the other one
+ * as well when speaker and handset share the backend, as both calibrations
+ * then hold it.
+ */
+void SpeakerProtection::setCalibrationPreempted(bool preempt)
+{
+    int slot = spkrCalSlot(mDeviceAttr.id);
+    int delta = preempt ? 1 : -1;
+
+    calPreempted[slot] += delta;
+    if (isSharedBE)
+        calPreempted[1 - slot] += delta;
+}
+
+/* a start is pending or running on this backend, calibration must not hold it */
+bool SpeakerProtection::isCalibrationPreempted(bool inUse)
+{
+    if (calPreempted[spkrCalSlot(mDeviceAttr.id)] > 0 || inUse) {
+        PAL_INFO(LOG_TAG, "calibration preempted by speaker start");
+        return true;
+    }
+
+    return false;
+}
+
 // Callback from DSP for Ressistance value
 void SpeakerProtection::handleSPCallback (uint64_t hdl __unused, uint32_t event_id,
                                             void *event_data, uint32_t event_size)
@@ -322,19 +383,30 @@ int SpeakerProtection::getSpeakerTemperature(int spkr_pos)
      * TODO: Get the channel from RM.xml
      */
     PAL_DBG(LOG_TAG, "Enter Speaker Get Temperature %d", spkr_pos);
-    mixer_ctl_name = rm->getSpkrTempCtrl(spkr_pos);
-    if (mixer_ctl_name.empty()) {
-        PAL_DBG(LOG_TAG, "Using default mixer control");
-        mixer_ctl_name = getDefaultSpkrTempCtrl(spkr_pos);
-    }
+    if (spkr_pos < 0)
+        return -EINVAL;
 
-    PAL_DBG(LOG_TAG, "audio_mixer %pK", hwMixer);
+    /* the control list of the mixer is walked once per speaker */
+    if ((size_t)spkr_pos < spkrTempCtls.size() && spkrTempCtls[spkr_pos]) {
+        ctl = spkrTempCtls[spkr_pos];
+    } else {
+        mixer_ctl_name = rm->getSpkrTempCtrl(spkr_pos);
+        if (mixer_ctl_name.empty()) {
+            PAL_DBG(LOG_TAG, "Using default mixer control");
+            mixer_ctl_name = getDefaultSpkrTempCtrl(spkr_pos);
+        }
 
-    ctl = mixer_get_ctl_by_name(hwMixer, mixer_ctl_name.c_str());
-    if (!ctl) {
-        PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", mixer_ctl_name.c_str());
-        status = -EINVAL;
-        return status;
+        PAL_DBG(LOG_TAG, "audio_mixer %pK", hwMixer);
+
+        ctl = mixer_get_ctl_by_name(hwMixer, mixer_ctl_name.c_str());
+        if (!ctl) {
+            PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", mixer_ctl_name.c_str());
+            status = -EINVAL;
+            return status;
+        }
+        if ((size_t)spkr_pos >= spkrTempCtls.size())
+            spkrTempCtls.resize(spkr_pos + 1, NULL);
+        spkrTempCtls[spkr_pos] = ctl;
     }
 
     status = mixer_ctl_get_value(ctl, 0);
@@ -470,6 +542,11 @@ int SpeakerProtection::spkrStartCalibrationV2()
         goto exit;
     }
 
+    if (isCalibrationPreempted(spDevInfo.isDeviceInUse)) {
+        ret = -EBUSY;
+        goto exit;
+    }
+
     // Configure device attribute
     rm->getChannelMap(&(ch_info.ch_map[0]), spDevInfo.dev_vi_device.channels);
     ch_info.channels = spDevInfo.dev_vi_device.channels;
@@ -712,6 +789,11 @@ int SpeakerProtection::spkrStartCalibrationV2()
         }
     }
 
+    if (isCalibrationPreempted(spDevInfo.isDeviceInUse)) {
+        ret = -EBUSY;
+        goto free_fe;
+    }
+
     txPcm = pcm_open(rm->getVirtualSndCard(), pcmDevIdsTx.at(0), flags, &config);
     if (!txPcm) {
         PAL_ERR(LOG_TAG, "txPcm open failed");
@@ -758,6 +840,11 @@ int SpeakerProtection::spkrStartCalibrationV2()
     }
     isTxStarted = true;
 
+    if (isCalibrationPreempted(spDevInfo.isDeviceInUse)) {
+        ret = -EBUSY;
+        goto err_pcm_open;
+    }
+
     // Setup RX path
     deviceRx.id = mDeviceAttr.id;
     ret = rm->getSndDeviceName(deviceRx.id, mSndDeviceName_rx);
@@ -849,6 +936,11 @@ int SpeakerProtection::spkrStartCalibrationV2()
         goto err_pcm_open;
     }
 
+    if (isCalibrationPreempted(spDevInfo.isDeviceInUse)) {
+        ret = -EBUSY;
+        goto err_pcm_open;
+    }
+
     /* Retrieve Hostless PCM device id */
     sAttr.type = PAL_STREAM_LOW_LATENCY;
     sAttr.direction = PAL_AUDIO_INPUT_OUTPUT;
@@ -931,6 +1023,11 @@ int SpeakerProtection::spkrStartCalibrationV2()
         }
     }
 
+    if (isCalibrationPreempted(spDevInfo.isDeviceInUse)) {
+        ret = -EBUSY;
+        goto err_pcm_open;
+    }
+
     rxPcm = pcm_open(rm->getVirtualSndCard(), pcmDevIdsRx.at(0), flags, &config);
     if (!rxPcm) {
         PAL_ERR(LOG_TAG, "pcm open failed for RX path");
@@ -954,6 +1051,12 @@ int SpeakerProtection::spkrStartCalibrationV2()
     }
     isRxStarted = true;
 
+    /* a start queued on the lock would only stop this run again, tear down now */
+    if (isCalibrationPreempted(spDevInfo.isDeviceInUse)) {
+        ret = -EBUSY;
+        goto err_pcm_open;
+    }
+
     spkrCalState = SPKR_CALIB_IN_PROGRESS;
     spDevInfo.deviceCalState = SPKR_CALIB_IN_PROGRESS;
 
@@ -1133,6 +1236,11 @@ int SpeakerProtection::spkrStartCalibration()
         goto exit;
     }
 
+    if (isCalibrationPreempted(isSpkrInUse)) {
+        ret = -EBUSY;
+        goto exit;
+    }
+
     // Configure device attribute
     rm->getChannelMap(&(ch_info.ch_map[0]), vi_device.channels);
     switch (vi_device.channels) {
@@ -1364,6 +1472,11 @@ int SpeakerProtection::spkrStartCalibration()
         }
     }
 
+    if (isCalibrationPreempted(isSpkrInUse)) {
+        ret = -EBUSY;
+        goto free_fe;
+    }
+
     txPcm = pcm_open(rm->getVirtualSndCard(), pcmDevIdsTx.at(0), flags, &config);
     if (!txPcm) {
         PAL_ERR(LOG_TAG, "txPcm open failed");
@@ -1410,6 +1523,11 @@ int SpeakerProtection::spkrStartCalibration()
     }
     isTxStarted = true;
 
+    if (isCalibrationPreempted(isSpkrInUse)) {
+        ret = -EBUSY;
+        goto err_pcm_open;
+    }
+
     // Setup RX path
     deviceRx.id = PAL_DEVICE_OUT_SPEAKER;
     ret = rm->getSndDeviceName(deviceRx.id, mSndDeviceName_rx);
@@ -1501,6 +1619,11 @@ int SpeakerProtection::spkrStartCalibration()
         goto err_pcm_open;
     }
 
+    if (isCalibrationPreempted(isSpkrInUse)) {
+        ret = -EBUSY;
+        goto err_pcm_open;
+    }
+
     /* Retrieve Hostless PCM device id */
     sAttr.type = PAL_STREAM_LOW_LATENCY;
     sAttr.direction = PAL_AUDIO_INPUT_OUTPUT;
@@ -1583,6 +1706,11 @@ int SpeakerProtection::spkrStartCalibration()
         }
     }
 
+    if (isCalibrationPreempted(isSpkrInUse)) {
+        ret = -EBUSY;
+        goto err_pcm_open;
+    }
+
     rxPcm = pcm_open(rm->getVirtualSndCard(), pcmDevIdsRx.at(0), flags, &config);
     if (!rxPcm) {
         PAL_ERR(LOG_TAG, "pcm open failed for RX path");
@@ -1606,6 +1734,12 @@ int SpeakerProtection::spkrStartCalibration()
     }
     isRxStarted = true;
 
+    /* a start queued on the lock would only stop this run again, tear down now */
+    if (isCalibrationPreempted(isSpkrInUse)) {
+        ret = -EBUSY;
+        goto err_pcm_open;
+    }
+
     spkrCalState = SPKR_CALIB_IN_PROGRESS;
 
     PAL_DBG(LOG_TAG, "Waiting for the event from DSP or PAL");
@@ -1717,7 +1851,7 @@ bool SpeakerProtection::canDeviceProceedForCalibration(unsigned long *sec)
     if (isDeviceInUse(sec)) {
         PAL_DBG(LOG_TAG, "Device %d in use. Wait for proper time",
                 mDeviceAttr.id);
-        spkrCalibrateWait();
+        spkrCalibrateWaitForIdle(&spDevInfo.isDeviceInUse, *sec);
         PAL_DBG(LOG_TAG, "Waiting done");
         return false;
     }
@@ -1727,8 +1861,8 @@ bool SpeakerProtection::canDeviceProceedForCalibration(unsigned long *sec)
     if (isDynamicCalTriggered) {
         PAL_DBG(LOG_TAG, "Dynamic Calibration triggered");
     } else if (*sec < minIdleTime) {
-        PAL_DBG(LOG_TAG, "Device not idle for minimum time. %lu", sec);
-        spkrCalibrateWait();
+        PAL_DBG(LOG_TAG, "Device not idle for minimum time. %lu", *sec);
+        spkrCalibrateWaitForIdle(&spDevInfo.isDeviceInUse, *sec);
         PAL_DBG(LOG_TAG, "Waited for device to be idle for min time");
         return false;
     }
@@ -1822,11 +1956,28 @@ int SpeakerProtection::getDeviceTemperatureList()
 
     /* Get the  mixer controls for temperature based on the device id */
 
-    temp_ctrls = rm->getDeviceTempCtrl(mDeviceAttr.id);
-    if (temp_ctrls.empty()) {
-        PAL_ERR(LOG_TAG,"map not found fallback to v2");
-        /* TODO: Assume handset is not present and call default temperature function */
-        return -EINVAL;
+    if (devTempCtls.size() < (size_t)spDevInfo.numChannels) {
+        temp_ctrls = rm->getDeviceTempCtrl(mDeviceAttr.id);
+        if (temp_ctrls.empty()) {
+            PAL_ERR(LOG_TAG,"map not found fallback to v2");
+            /* TODO: Assume handset is not present and call default temperature function */
+            return -EINVAL;
+        }
+
+        /* resolved once, the controls stay valid for the lifetime of the mixer */
+        devTempCtls.clear();
+        for (i = 0; i < spDevInfo.numChannels; i++) {
+            PAL_ERR(LOG_TAG, "audio_mixer %pK", hwMixer);
+            mixer_ctl_name = temp_ctrls[i];
+            ctl = mixer_get_ctl_by_name(hwMixer, mixer_ctl_name.c_str());
+            if(!ctl) {
+                PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n",
+                        mixer_ctl_name.c_str());
+                devTempCtls.clear();
+                return -EINVAL;
+            }
+            devTempCtls.push_back(ctl);
+        }
     }
 
     /*
@@ -1837,17 +1988,9 @@ int SpeakerProtection::getDeviceTemperatureList()
      */
 
     for(i = 0; i < spDevInfo.numChannels; i++) {
-        PAL_ERR(LOG_TAG, "audio_mixer %pK", hwMixer);
-        mixer_ctl_name = temp_ctrls[i];
-        ctl = mixer_get_ctl_by_name(hwMixer, mixer_ctl_name.c_str());
-        if(!ctl) {
-            PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n",
-                    mixer_ctl_name.c_str());
-            return -EINVAL;
-        }
-
+        ctl = devTempCtls[i];
         value = mixer_ctl_get_value(ctl, 0);
-        PAL_INFO(LOG_TAG, "Device Get Temperature %s  %d",mixer_ctl_name.c_str(),
+        PAL_INFO(LOG_TAG, "Device Get Temperature %s  %d", mixer_ctl_get_name(ctl),
                                                                            value);
         if ((value == -EINVAL) ||
             (value > TZ_TEMP_MAX_THRESHOLD) ||
@@ -1895,7 +2038,7 @@ void SpeakerProtection::spkrCalibrationThread()
         proceed = false;
         if (isSpeakerInUse(&sec)) {
             PAL_DBG(LOG_TAG, "Speaker in use. Wait for proper time");
-            spkrCalibrateWait();
+            spkrCalibrateWaitForIdle(&isSpkrInUse, sec);
             PAL_DBG(LOG_TAG, "Waiting done");
             continue;
         }
@@ -1906,7 +2049,7 @@ void SpeakerProtection::spkrCalibrationThread()
             }
             else if (sec < minIdleTime) {
                 PAL_DBG(LOG_TAG, "Speaker not idle for minimum time. %lu", sec);
-                spkrCalibrateWait();
+                spkrCalibrateWaitForIdle(&isSpkrInUse, sec);
                 PAL_DBG(LOG_TAG, "Waited for speaker to be idle for min time");
                 continue;
             }
@@ -1940,7 +2083,7 @@ void SpeakerProtection::spkrCalibrationThread()
         proceed = false;
         if (isSpeakerInUse(&sec)) {
             PAL_DBG(LOG_TAG, "Speaker in use. Wait for proper time");
-            spkrCalibrateWait();
+            spkrCalibrateWaitForIdle(&isSpkrInUse, sec);
             PAL_DBG(LOG_TAG, "Waiting done");
             continue;
         }
@@ -1951,7 +2094,7 @@ void SpeakerProtection::spkrCalibrationThread()
             }
             else if (sec < minIdleTime) {
                 PAL_DBG(LOG_TAG, "Speaker not idle for minimum time. %lu", sec);
-                spkrCalibrateWait();
+                spkrCalibrateWaitForIdle(&isSpkrInUse, sec);
                 PAL_DBG(LOG_TAG, "Waited for speaker to be idle for min time");
                 continue;
             }
@@ -2355,11 +2498,21 @@ int32_t SpeakerProtection::spkrProtProcessingModeV2(bool flag)
     Session *session = NULL;
     std::vector<Stream*> activeStreams;
     PayloadBuilder* builder = new PayloadBuilder();
-    std::unique_lock<std::mutex> lock(calibrationMutex);
+    std::unique_lock<std::mutex> lock(calibrationMutex, std::defer_lock);
+    struct timespec startTs, lockedTs;
+    bool calActive = false;
     struct pal_device_info devinfo = {};
     struct pal_device dattr;
 
     PAL_DBG(LOG_TAG, "Enter %s Flag %d Device id: %d", __func__, flag, mDeviceAttr.id);
+    /* calibration checks this between setup steps and backs off early */
+    if (flag)
+        setCalibrationPreempted(true);
+    clock_gettime(CLOCK_MONOTONIC, &startTs);
+    if (!lock.try_lock()) {
+        calActive = true;
+        lock.lock();
+    }
     deviceMutex.lock();
 
 
@@ -2379,7 +2532,14 @@ int32_t SpeakerProtection::spkrProtProcessingModeV2(bool flag)
             txPcm = NULL;
             rxPcm = NULL;
             PAL_DBG(LOG_TAG, "Stopped calibration mode");
-        }
+            calActive = true;
+        }
+        setCalibrationPreempted(false);
+        clock_gettime(CLOCK_MONOTONIC, &lockedTs);
+        PAL_INFO(LOG_TAG, "speaker start waited %lld us, calibration %s",
+                 (long long)(lockedTs.tv_sec - startTs.tv_sec) * 1000000LL +
+                 (lockedTs.tv_nsec - startTs.tv_nsec) / 1000,
+                 calActive ? "active" : "idle");
         numberOfRequest++;
         if (numberOfRequest > 1) {
             // R0T0 already set, we don't need to process the request
@@ -3502,9 +3662,19 @@ int32_t SpeakerProtection::spkrProtProcessingMode(bool flag)
     Session *session = NULL;
     std::vector<Stream*> activeStreams;
     PayloadBuilder* builder = new PayloadBuilder();
-    std::unique_lock<std::mutex> lock(calibrationMutex);
+    std::unique_lock<std::mutex> lock(calibrationMutex, std::defer_lock);
+    struct timespec startTs, lockedTs;
+    bool calActive = false;
 
     PAL_DBG(LOG_TAG, "Flag %d", flag);
+    /* calibration checks this between setup steps and backs off early */
+    if (flag)
+        setCalibrationPreempted(true);
+    clock_gettime(CLOCK_MONOTONIC, &startTs);
+    if (!lock.try_lock()) {
+        calActive = true;
+        lock.lock();
+    }
     deviceMutex.lock();
 
     if (flag) {
@@ -3517,7 +3687,14 @@ int32_t SpeakerProtection::spkrProtProcessingMode(bool flag)
             txPcm = NULL;
             rxPcm = NULL;
             PAL_DBG(LOG_TAG, "Stopped calibration mode");
-        }
+            calActive = true;
+        }
+        setCalibrationPreempted(false);
+        clock_gettime(CLOCK_MONOTONIC, &lockedTs);
+        PAL_INFO(LOG_TAG, "speaker start waited %lld us, calibration %s",
+                 (long long)(lockedTs.tv_sec - startTs.tv_sec) * 1000000LL +
+                 (lockedTs.tv_nsec - startTs.tv_nsec) / 1000,
+                 calActive ? "active" : "idle");
         numberOfRequest++;
         if (numberOfRequest > 1) {
             // R0T0 already set, we don't need to process the request
@@ -3918,7 +4095,7 @@ int32_t SpeakerProtection::getFTMParameter(void **param)
     PAL_DBG(LOG_TAG, "Got FTM value with status %d", ftm_ret[0].status);
 
     if (payload) {
-        delete payload;
+        builder->freePayload(payload);
         payloadSize = 0;
         payload = NULL;
     }
@@ -3954,7 +4131,7 @@ int32_t SpeakerProtection::getFTMParameter(void **param)
     PAL_DBG(LOG_TAG, "Got FTM Excursion value with status %d", exFtm_ret[0].status);
 
     if (payload) {
-        delete payload;
+        builder->freePayload(payload);
         payloadSize = 0;
         payload = NULL;
     }
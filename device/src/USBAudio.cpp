@@ -42,6 +42,8 @@
 
 std::shared_ptr<Device> USB::objRx = nullptr;
 std::shared_ptr<Device> USB::objTx = nullptr;
+std::mutex USBCardConfig::capability_lock_;
+std::list<USBCapabilityEntry> USBCardConfig::capability_cache_;
 
 std::shared_ptr<Device> USB::getInstance(struct pal_device *device,
                                              std::shared_ptr<ResourceManager> Rm)
@@ -159,7 +161,7 @@ int USB::configureUsb()
     builder->payloadUsbAudioConfig(&payload, &payloadSize, miid, &cfg);
     if (payloadSize) {
         status = updateCustomPayload(payload, payloadSize);
-        delete[] payload;
+        free(payload);
         if (0 != status) {
             PAL_ERR(LOG_TAG,"updateCustomPayload Failed\n");
             goto exit;
@@ -391,21 +393,27 @@ void USBCardConfig::usb_info_dump(char* read_buf, int type) {
     const char s[2] = "\n";
     char* token;
     char *tmp = nullptr;
+    char *dump_buf = nullptr;
 
     const char* direction = type == USB_PLAYBACK ? PLAYBACK_PROFILE_STR : CAPTURE_PROFILE_STR;
 
+    /* tokenize a copy, the caller keeps using read_buf */
     start = strstr(read_buf, direction);
-    token = strtok_r(start, s, &tmp);
+    if (!start || !(dump_buf = strdup(start)))
+        return;
+    token = strtok_r(dump_buf, s, &tmp);
     while (token != nullptr) {
         PAL_DBG(LOG_TAG, "  %s", token);
         token = strtok_r(nullptr, s, &tmp);
     }
+    free(dump_buf);
 }
 
-int USBCardConfig::getCapability(usb_usecase_type_t type,
-                                        struct pal_usb_device_address addr) {
+int USBCardConfig::parseCapability(usb_usecase_type_t type, char *read_buf,
+                                   struct pal_usb_device_address addr,
+                                   std::vector<std::shared_ptr<USBDeviceConfig>> &configs,
+                                   int *endian) {
     int32_t size = 0;
-    FILE *fd = NULL;
     int32_t channels_no;
     char *str_start = NULL;
     char *str_end = NULL;
@@ -413,61 +421,31 @@ int USBCardConfig::getCapability(usb_usecase_type_t type,
     char *bit_width_start = NULL;
     char *rates_str_start = NULL;
     char *target = NULL;
-    char *read_buf = NULL;
     char *rates_str = NULL;
     char *interval_str_start = NULL;
-    char path[128];
     int ret = 0;
     char *bit_width_str = NULL;
-    size_t num_read = 0;
     const char* suffix;
     bool jack_status;
-    //std::shared_ptr<USBDeviceConfig> usb_device_info = nullptr;
-
     bool check = false;
 
-    memset(path, 0, sizeof(path));
     PAL_INFO(LOG_TAG, "for %s", (type == USB_PLAYBACK) ?
           PLAYBACK_PROFILE_STR : CAPTURE_PROFILE_STR);
 
-    ret = snprintf(path, sizeof(path), "/proc/asound/card%u/stream0",
-             addr.card_id);
-    if(ret < 0) {
-        PAL_ERR(LOG_TAG, "failed on snprintf (%d) to path %s\n", ret, path);
-        ret = -EINVAL;
-        goto done;
-    }
-
-    fd = fopen(path, "r");
-    if (!fd) {
-        PAL_ERR(LOG_TAG, "failed to open config file %s error: %d\n", path, errno);
-        ret = -EINVAL;
-        goto done;
-    }
-
-    read_buf = (char *)calloc(1, USB_BUFF_SIZE + 1);
-    if (!read_buf) {
-        PAL_ERR(LOG_TAG, "Failed to create read_buf");
-        ret = -ENOMEM;
-        goto done;
-    }
-
-    if ((num_read = fread(read_buf, 1, USB_BUFF_SIZE, fd)) < 0) {
-        PAL_ERR(LOG_TAG, "file read error");
-        goto done;
-    }
-    read_buf[num_read] = '\0';
-
     str_start = strstr(read_buf, ((type == USB_PLAYBACK) ?
                        PLAYBACK_PROFILE_STR : CAPTURE_PROFILE_STR));
     if (str_start == NULL) {
         PAL_INFO(LOG_TAG, "error %s section not found in usb config file",
                 ((type == USB_PLAYBACK) ?
                PLAYBACK_PROFILE_STR : CAPTURE_PROFILE_STR));
-        ret = -ENOENT;
-        goto done;
+        return -ENOENT;
     }
 
+    /* the jack is per card and direction, same for every altset */
+    suffix = (type == USB_PLAYBACK) ? USB_OUT_JACK_SUFFIX : USB_IN_JACK_SUFFIX;
+    jack_status = getJackConnectionStatus(addr.card_id, suffix);
+    PAL_DBG(LOG_TAG, "jack_status %d", jack_status);
+
     str_end = strstr(read_buf, ((type == USB_PLAYBACK) ?
                        CAPTURE_PROFILE_STR : PLAYBACK_PROFILE_STR));
 
@@ -515,7 +493,7 @@ int USBCardConfig::getCapability(usb_usecase_type_t type,
             const char * s = strstr(bit_width_str, formats[i]);
             if (s) {
                 usb_device_info->setBitWidth(bit_width[i]);
-                setEndian(strstr(s, "BE") ? 1 : 0);
+                *endian = strstr(s, "BE") ? 1 : 0;
                 break;
             }
         }
@@ -571,18 +549,116 @@ int USBCardConfig::getCapability(usb_usecase_type_t type,
                 PAL_INFO(LOG_TAG, "error unable to get service interval, assume default");
             }
         }
-        /* jack status parsing */
-        suffix = (type == USB_PLAYBACK) ? USB_OUT_JACK_SUFFIX : USB_IN_JACK_SUFFIX;
-        jack_status = getJackConnectionStatus(addr.card_id, suffix);
-        PAL_DBG(LOG_TAG, "jack_status %d", jack_status);
         usb_device_info->setJackStatus(jack_status);
 
         /* Add to list if every field is valid */
-        usb_device_config_list_.push_back(usb_device_info);
-        format_list_map.insert( std::pair<int, std::shared_ptr<USBDeviceConfig>>(usb_device_info->getBitWidth(),usb_device_info));
+        configs.push_back(usb_device_info);
     }
 
-     usb_info_dump(read_buf, type);
+    usb_info_dump(read_buf, type);
+
+    return ret;
+}
+
+/* most recently used entries live at the front, capability_lock_ held */
+std::shared_ptr<USBCapability> USBCardConfig::findCapability_l(
+                                        struct pal_usb_device_address addr,
+                                        uint64_t hash) {
+    for (auto iter = capability_cache_.begin();
+         iter != capability_cache_.end(); iter++) {
+        if (iter->addr.card_id == addr.card_id &&
+            iter->addr.device_num == addr.device_num &&
+            iter->hash == hash) {
+            capability_cache_.splice(capability_cache_.begin(),
+                                     capability_cache_, iter);
+            return capability_cache_.front().cap;
+        }
+    }
+
+    return nullptr;
+}
+
+std::shared_ptr<USBCapability> USBCardConfig::lookupCapability(
+                                        usb_usecase_type_t type,
+                                        struct pal_usb_device_address addr,
+                                        bool *cached) {
+    FILE *fd = NULL;
+    char *read_buf = NULL;
+    char path[128];
+    size_t num_read = 0;
+    uint64_t hash = USB_FNV1A_64_OFFSET;
+    std::shared_ptr<USBCapability> cap = nullptr;
+    std::vector<std::shared_ptr<USBDeviceConfig>> configs;
+    int endian = 0;
+    int status = 0;
+    int ret = 0;
+
+    memset(path, 0, sizeof(path));
+    ret = snprintf(path, sizeof(path), "/proc/asound/card%u/stream0",
+             addr.card_id);
+    if(ret < 0) {
+        PAL_ERR(LOG_TAG, "failed on snprintf (%d) to path %s\n", ret, path);
+        goto done;
+    }
+
+    fd = fopen(path, "r");
+    if (!fd) {
+        PAL_ERR(LOG_TAG, "failed to open config file %s error: %d\n", path, errno);
+        goto done;
+    }
+
+    read_buf = (char *)calloc(1, USB_BUFF_SIZE + 1);
+    if (!read_buf) {
+        PAL_ERR(LOG_TAG, "Failed to create read_buf");
+        goto done;
+    }
+
+    num_read = fread(read_buf, 1, USB_BUFF_SIZE, fd);
+    read_buf[num_read] = '\0';
+
+    /* the stream file carries the descriptors, identical for the same device */
+    for (size_t i = 0; i < num_read; i++) {
+        hash ^= (uint8_t)read_buf[i];
+        hash *= USB_FNV1A_64_PRIME;
+    }
+
+    {
+        std::lock_guard<std::mutex> lck(capability_lock_);
+        cap = findCapability_l(addr, hash);
+        if (cap && cap->parsed[type]) {
+            *cached = true;
+            PAL_INFO(LOG_TAG, "usb %s capability of card %d found in cache",
+                     (type == USB_PLAYBACK) ? "playback" : "capture", addr.card_id);
+            goto done;
+        }
+    }
+
+    /*
+     * only the requested direction, the USB device of the other one parses
+     * it from its own read when it connects
+     */
+    status = parseCapability(type, read_buf, addr, configs, &endian);
+
+    {
+        std::lock_guard<std::mutex> lck(capability_lock_);
+        if (!cap)
+            cap = findCapability_l(addr, hash);
+        if (!cap) {
+            USBCapabilityEntry entry = {addr, hash, std::make_shared<USBCapability>()};
+
+            cap = entry.cap;
+            capability_cache_.push_front(entry);
+            if (capability_cache_.size() > USB_CAPABILITY_CACHE_SIZE)
+                capability_cache_.pop_back();
+        }
+        /* a racing connect may have stored this direction meanwhile */
+        if (!cap->parsed[type]) {
+            cap->status[type] = status;
+            cap->endian[type] = endian;
+            cap->configs[type] = configs;
+            cap->parsed[type] = true;
+        }
+    }
 
 done:
     if (fd)
@@ -591,7 +667,58 @@ done:
     if (read_buf)
         free(read_buf);
 
-    return ret;
+    return cap;
+}
+
+int USBCardConfig::getCapability(usb_usecase_type_t type,
+                                        struct pal_usb_device_address addr) {
+    bool cached = false;
+    std::shared_ptr<USBCapability> cap = lookupCapability(type, addr, &cached);
+    const char* suffix;
+    bool jack_status;
+
+    if (!cap)
+        return -EINVAL;
+
+    /* the descriptors are unchanged, only the jack may differ since parsing */
+    if (cached && !cap->configs[type].empty()) {
+        suffix = (type == USB_PLAYBACK) ? USB_OUT_JACK_SUFFIX : USB_IN_JACK_SUFFIX;
+        jack_status = getJackConnectionStatus(addr.card_id, suffix);
+        for (auto &config : cap->configs[type])
+            config->setJackStatus(jack_status);
+    }
+
+    setProfiles(cap->configs[type], cap->endian[type]);
+
+    return cap->status[type];
+}
+
+void USBCardConfig::setProfiles(const std::vector<std::shared_ptr<USBDeviceConfig>> &configs,
+                                int endian) {
+    usb_device_config_list_ = configs;
+    format_list_map.clear();
+    for (auto &config : usb_device_config_list_)
+        format_list_map.insert(std::pair<int, std::shared_ptr<USBDeviceConfig>>(
+                                   config->getBitWidth(), config));
+    if (!usb_device_config_list_.empty())
+        setEndian(endian);
+    indexProfiles();
+}
+
+/* groups the profiles by direction, bit width and channels for readBestConfig */
+void USBCardConfig::indexProfiles() {
+    for (int type = USB_CAPTURE; type <= USB_PLAYBACK; type++) {
+        profile_index_[type].clear();
+        max_channels_[type] = 1;
+    }
+
+    for (auto &config : usb_device_config_list_) {
+        unsigned int type = config->getType();
+
+        profile_index_[type][std::make_pair(config->getBitWidth(),
+                                            config->getChannels())].push_back(config);
+        max_channels_[type] = getMax(max_channels_[type], config->getChannels());
+    }
 }
 
 USBCardConfig::USBCardConfig(struct pal_usb_device_address address) {
@@ -622,16 +749,7 @@ int USBCardConfig::getMaxBitWidth(bool is_playback)
 
 int USBCardConfig::getMaxChannels(bool is_playback)
 {
-    unsigned int max_ch = 1;
-    typename std::vector<std::shared_ptr<USBDeviceConfig>>::iterator iter;
-
-    for (iter = usb_device_config_list_.begin();
-         iter != usb_device_config_list_.end(); iter++) {
-         if ((*iter)->getType() == is_playback)
-             max_ch = getMax(max_ch, (*iter)->getChannels());
-    }
-
-    return max_ch;
+    return max_channels_[is_playback ? USB_PLAYBACK : USB_CAPTURE];
 }
 
 unsigned int USBCardConfig::getFormatByBitWidth(int bitwidth) {
@@ -813,8 +931,7 @@ int USBCardConfig::readBestConfig(struct pal_media_config *config,
     int ret = -EINVAL;
     struct pal_media_config media_config;
     std::map<int, std::shared_ptr<USBDeviceConfig>> candidate_list;
-    std::vector<std::shared_ptr<USBDeviceConfig>> profile_list_max_ch;
-    std::vector<std::shared_ptr<USBDeviceConfig>> profile_list_match_ch;
+    usb_usecase_type_t type = is_playback ? USB_PLAYBACK : USB_CAPTURE;
     int target_bit_width = devinfo->bit_width == 0 ?
                            config->bit_width : devinfo->bit_width;
 
@@ -844,28 +961,24 @@ int USBCardConfig::readBestConfig(struct pal_media_config *config,
     }
     max_channel = getMaxChannels(is_playback);
     if (!format_list_map.empty()) {
-        auto profile_list = format_list_map.equal_range(target_bit_width);
-        for (auto iter = profile_list.first; iter != profile_list.second; ++iter) {
-            auto cfg_iter = iter->second;
-            if (cfg_iter->getType() != is_playback)
-                continue;
-            if (cfg_iter->getChannels() == media_config.ch_info.channels) {
-                profile_list_match_ch.push_back(cfg_iter);
-            } else if(cfg_iter->getChannels() == max_channel) {
-                profile_list_max_ch.push_back(cfg_iter);
-            }
-        }
-
-        std::vector<std::shared_ptr<USBDeviceConfig>> profile_list_ch;
-        if (!profile_list_match_ch.empty()) {
+        static const std::vector<std::shared_ptr<USBDeviceConfig>> no_profiles;
+        auto match_ch = profile_index_[type].find(std::make_pair(
+                            (unsigned int)target_bit_width, media_config.ch_info.channels));
+        auto max_ch = profile_index_[type].find(std::make_pair(
+                            (unsigned int)target_bit_width, (unsigned int)max_channel));
+
+        const std::vector<std::shared_ptr<USBDeviceConfig>> *profile_list = &no_profiles;
+        if (match_ch != profile_index_[type].end()) {
             /*2. channal matches */
-            profile_list_ch = profile_list_match_ch;
+            profile_list = &match_ch->second;
             PAL_INFO(LOG_TAG, "found matching channels = %d", media_config.ch_info.channels);
         } else {
-            profile_list_ch = profile_list_max_ch;
+            if (max_ch != profile_index_[type].end())
+                profile_list = &max_ch->second;
             PAL_INFO(LOG_TAG, "Target Channel of %d is not supported by USB. Use USB channel of %d",
                          media_config.ch_info.channels, max_channel);
         }
+        const std::vector<std::shared_ptr<USBDeviceConfig>> &profile_list_ch = *profile_list;
 
         if (!profile_list_ch.empty()) {
             /*3. get best Sample Rate */
@@ -32,6 +32,14 @@
 #include <hidl/MQDescriptor.h>
 #include <hidl/Status.h>
 #include <log/log.h>
+#include <algorithm>
+#include <cutils/ashmem.h>
+#include <map>
+#include <mutex>
+#include <new>
+#include <vector>
+#include <sys/mman.h>
+#include <unistd.h>
 #include "PalApi.h"
 #include "inc/PalCallback.h"
 
@@ -48,6 +56,23 @@ sp<server_death_notifier> Server_death_notifier = NULL;
 
 std::mutex gLock;
 
+/*read regions registered per stream, reads landing there skip the reply copy*/
+struct read_region {
+    int fd;
+    size_t size;
+};
+std::mutex gReadRegionLock;
+std::map<pal_stream_handle_t *, struct read_region> gReadRegions;
+
+/*position mirror pages shared with the server, unmapped once the stream is closed*/
+struct position_mirror {
+    int fd;
+    void *addr;
+    size_t size;
+};
+std::mutex gMirrorLock;
+std::map<pal_stream_handle_t *, struct position_mirror> gPositionMirrors;
+
 void server_death_notifier::serviceDied(uint64_t cookie,
                    const android::wp<::android::hidl::base::V1_0::IBase>& who)
 {
@@ -299,7 +324,21 @@ int32_t pal_stream_close(pal_stream_handle_t *stream_handle)
         if (pal_client == nullptr)
             return -EINVAL;
 
-        return pal_client->ipc_pal_stream_close((PalStreamHandle)stream_handle);
+        {
+            std::lock_guard<std::mutex> guard(gReadRegionLock);
+            gReadRegions.erase(stream_handle);
+        }
+        int32_t ret = pal_client->ipc_pal_stream_close((PalStreamHandle)stream_handle);
+        {
+            std::lock_guard<std::mutex> guard(gMirrorLock);
+            auto it = gPositionMirrors.find(stream_handle);
+            if (it != gPositionMirrors.end()) {
+                munmap(it->second.addr, it->second.size);
+                close(it->second.fd);
+                gPositionMirrors.erase(it);
+            }
+        }
+        return ret;
     }
     return -EINVAL;
 }
@@ -500,9 +539,122 @@ done:
     return ret;
 }
 
+/*
+ * The page is allocated here and handed to the server with a zero sized
+ * write flagged PAL_BUFF_FLAG_POSITION_MIRROR, the server publishes into
+ * it from then on.
+ */
+int32_t pal_stream_get_position_mirror(pal_stream_handle_t *stream_handle,
+                                       const pal_position_mirror_t **mirror)
+{
+    int32_t ret = -EINVAL;
+    struct position_mirror pm = {-1, MAP_FAILED, 0};
+    native_handle_t *allocHidlHandle = nullptr;
+
+    if (stream_handle == NULL || mirror == NULL || pal_server_died)
+        return ret;
+
+    std::lock_guard<std::mutex> guard(gMirrorLock);
+    auto it = gPositionMirrors.find(stream_handle);
+    if (it != gPositionMirrors.end()) {
+        *mirror = (const pal_position_mirror_t *)it->second.addr;
+        return 0;
+    }
+
+    android::sp<IPAL> pal_client = get_pal_server();
+    if (pal_client == nullptr)
+        return ret;
+
+    pm.size = getpagesize();
+    pm.fd = ashmem_create_region("pal_position_mirror", pm.size);
+    if (pm.fd < 0) {
+        ALOGE("%s: Failed to create position mirror region", __func__);
+        return -ENOMEM;
+    }
+    pm.addr = mmap(NULL, pm.size, PROT_READ, MAP_SHARED, pm.fd, 0);
+    if (pm.addr == MAP_FAILED) {
+        ALOGE("%s: Failed to map position mirror, errno %d", __func__, errno);
+        ret = -ENOMEM;
+        goto exit;
+    }
+
+    allocHidlHandle = native_handle_create(1, 1);
+    if (!allocHidlHandle) {
+        ALOGE("%s:%d Failed to create allocHidlHandle", __func__, __LINE__);
+        ret = -ENOMEM;
+        goto exit;
+    }
+    allocHidlHandle->data[0] = pm.fd;
+    allocHidlHandle->data[1] = pm.fd;
+    {
+        hidl_vec<PalBuffer> buf_hidl;
+        buf_hidl.resize(1);
+        PalBuffer *palBuff = buf_hidl.data();
+        palBuff->size = 0;
+        palBuff->flags = PAL_BUFF_FLAG_POSITION_MIRROR;
+        palBuff->alloc_info.alloc_handle = hidl_memory("arpal_alloc_handle",
+                                                       hidl_handle(allocHidlHandle), pm.size);
+        palBuff->alloc_info.alloc_size = pm.size;
+        palBuff->alloc_info.offset = 0;
+        ret = pal_client->ipc_pal_stream_write((PalStreamHandle)stream_handle, buf_hidl);
+    }
+    native_handle_delete(allocHidlHandle);
+
+exit:
+    if (ret) {
+        if (pm.addr != MAP_FAILED)
+            munmap(pm.addr, pm.size);
+        close(pm.fd);
+        return ret;
+    }
+    gPositionMirrors[stream_handle] = pm;
+    *mirror = (const pal_position_mirror_t *)pm.addr;
+    return 0;
+}
+
+/*the server only publishes into pages it shares with the client*/
+int32_t pal_stream_set_position_mirror(pal_stream_handle_t *stream_handle __unused,
+                                       pal_position_mirror_t *mirror __unused)
+{
+    return -ENOSYS;
+}
+
+int32_t pal_stream_register_read_buffer(pal_stream_handle_t *stream_handle,
+                                        int fd, size_t size)
+{
+    if (stream_handle == NULL || (fd >= 0 && !size))
+        return -EINVAL;
+
+    std::lock_guard<std::mutex> guard(gReadRegionLock);
+    if (fd < 0) {
+        gReadRegions.erase(stream_handle);
+        return 0;
+    }
+    gReadRegions[stream_handle] = {fd, size};
+    ALOGD("%s: handle %pK fd %d size %zu", __func__, stream_handle, fd, size);
+    return 0;
+}
+
+static bool is_in_read_region(pal_stream_handle_t *stream_handle,
+                              struct pal_buffer *buf, size_t *region_size)
+{
+    std::lock_guard<std::mutex> guard(gReadRegionLock);
+    auto it = gReadRegions.find(stream_handle);
+
+    if (it == gReadRegions.end() ||
+        it->second.fd != buf->alloc_info.alloc_handle ||
+        (uint64_t)buf->alloc_info.offset + buf->size > it->second.size)
+        return false;
+
+    *region_size = it->second.size;
+    return true;
+}
+
 ssize_t pal_stream_read(pal_stream_handle_t *stream_handle, struct pal_buffer *buf)
 {
     int ret = -EINVAL;
+    bool inPlace = false;
+    size_t regionSize = 0;
 
     if (stream_handle == NULL)
        goto done;
@@ -523,12 +675,14 @@ ssize_t pal_stream_read(pal_stream_handle_t *stream_handle, struct pal_buffer *b
         allocHidlHandle->data[0] = buf->alloc_info.alloc_handle;
         allocHidlHandle->data[1] = buf->alloc_info.alloc_handle;
 
+        inPlace = is_in_read_region(stream_handle, buf, &regionSize);
         palBuff->size = buf->size;
         palBuff->offset = buf->offset;
         palBuff->metadataSz = buf->metadata_size;
+        palBuff->flags = inPlace ? PAL_BUFF_FLAG_SHMEM_READ : 0;
+        palBuff->alloc_info.alloc_size = inPlace ? regionSize : buf->alloc_info.alloc_size;
         palBuff->alloc_info.alloc_handle = hidl_memory("arpal_alloc_handle", hidl_handle(allocHidlHandle),
-                                                         buf->alloc_info.alloc_size);
-        palBuff->alloc_info.alloc_size = buf->alloc_info.alloc_size;
+                                                         palBuff->alloc_info.alloc_size);
         palBuff->alloc_info.offset = buf->alloc_info.offset;
 
         ALOGV("%s:%d size %d %d",__func__,__LINE__,buf_hidl.data()->size, buf->size);
@@ -554,7 +708,8 @@ ssize_t pal_stream_read(pal_stream_handle_t *stream_handle, struct pal_buffer *b
                               }
                               buf->flags = ret_buf_hidl.data()->flags;
 
-                              if (buf->buffer)
+                              /*in place reads are already in the caller's region*/
+                              if (buf->buffer && !inPlace)
                                    memcpy(buf->buffer,
                                           ret_buf_hidl.data()->buffer.data(),
                                           buf->size);
@@ -570,6 +725,129 @@ done:
     return ret;
 }
 
+/*
+ * The IPAL interface carries one buffer per transaction, queue the buffers
+ * one by one so that clients of the queued API work across the IPC too.
+ */
+ssize_t pal_stream_read_buffers(pal_stream_handle_t *stream_handle,
+                                struct pal_buffer *bufs, uint32_t count)
+{
+    ssize_t ret = -EINVAL;
+    uint32_t i = 0;
+
+    if (stream_handle == NULL || bufs == NULL || !count)
+        return ret;
+
+    for (i = 0; i < count; i++) {
+        ret = pal_stream_read(stream_handle, &bufs[i]);
+        if (ret < 0)
+            break;
+    }
+    return i ? (ssize_t)i : ret;
+}
+
+ssize_t pal_stream_write_buffers(pal_stream_handle_t *stream_handle,
+                                 struct pal_buffer *bufs, uint32_t count)
+{
+    ssize_t ret = -EINVAL;
+    uint32_t i = 0;
+
+    if (stream_handle == NULL || bufs == NULL || !count)
+        return ret;
+
+    for (i = 0; i < count; i++) {
+        ret = pal_stream_write(stream_handle, &bufs[i]);
+        if (ret < 0)
+            break;
+    }
+    return i ? (ssize_t)i : ret;
+}
+
+struct pal_batch {
+    uint32_t flags;
+    uint32_t count;
+    std::vector<uint8_t> ops;
+};
+
+pal_batch_t *pal_batch_begin(uint32_t flags)
+{
+    pal_batch_t *batch = new (std::nothrow) pal_batch_t;
+
+    if (batch == NULL) {
+        ALOGE("%s: Not enough memory for batch", __func__);
+        return NULL;
+    }
+    batch->flags = flags;
+    batch->count = 0;
+    return batch;
+}
+
+int32_t pal_batch_add(pal_batch_t *batch, uint32_t op,
+                      pal_stream_handle_t *stream_handle, uint32_t arg,
+                      const void *data, size_t size)
+{
+    struct pal_batch_op *rec = NULL;
+    size_t offset = 0;
+
+    if (batch == NULL || stream_handle == NULL || (size && data == NULL) ||
+        size > UINT32_MAX)
+        return -EINVAL;
+
+    offset = batch->ops.size();
+    batch->ops.resize(offset + PAL_BATCH_OP_SIZE(size));
+    rec = (struct pal_batch_op *)(batch->ops.data() + offset);
+    rec->op = op;
+    rec->arg = arg;
+    rec->stream_handle = (uint64_t)stream_handle;
+    rec->size = (uint32_t)size;
+    rec->reserved = 0;
+    if (size)
+        memcpy(rec->data, data, size);
+    batch->count++;
+    return 0;
+}
+
+/*
+ * The whole batch crosses in one transaction through the otherwise unused
+ * ipc_pal_gef_rw_param: flags, op count and the op records go in, the
+ * status of every op comes back.
+ */
+int32_t pal_batch_commit(pal_batch_t *batch, int32_t *status, uint32_t count)
+{
+    int32_t ret = -EINVAL;
+
+    if (batch == NULL)
+        return ret;
+    if (!pal_server_died) {
+        android::sp<IPAL> pal_client = get_pal_server();
+        if (pal_client == nullptr)
+            goto exit;
+
+        hidl_vec<uint8_t> payload;
+        payload.resize(2 * sizeof(uint32_t) + batch->ops.size());
+        memcpy(payload.data(), &batch->flags, sizeof(uint32_t));
+        memcpy(payload.data() + sizeof(uint32_t), &batch->count, sizeof(uint32_t));
+        if (!batch->ops.empty())
+            memcpy(payload.data() + 2 * sizeof(uint32_t), batch->ops.data(),
+                   batch->ops.size());
+
+        pal_client->ipc_pal_gef_rw_param(PAL_BATCH_IPC_PARAM_ID, payload,
+                                         payload.size(), (PalDeviceId)0,
+                                         (PalStreamType)0, 0,
+               [&](int32_t ret_, hidl_vec<uint8_t> status_hidl)
+                  {
+                      size_t n = std::min((size_t)count,
+                                          status_hidl.size() / sizeof(int32_t));
+                      if (status != NULL && n)
+                          memcpy(status, status_hidl.data(), n * sizeof(int32_t));
+                      ret = ret_;
+                  });
+    }
+exit:
+    delete batch;
+    return ret;
+}
+
 int32_t pal_stream_set_param(pal_stream_handle_t *stream_handle,
                              uint32_t param_id,
                              pal_param_payload *param_payload)
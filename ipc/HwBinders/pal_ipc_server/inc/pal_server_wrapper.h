@@ -36,7 +36,11 @@
 #include <hidl/MQDescriptor.h>
 #include <hidl/Status.h>
 #include <utils/RefBase.h>
+#include <list>
 #include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <sys/stat.h>
 #include "PalApi.h"
 #include<log/log.h>
 
@@ -60,6 +64,72 @@ using ::android::sp;
 
 class PalClientDeathRecipient;
 
+/*
+ * Shared memory fds imported from the client for one stream. A client
+ * buffer is looked up by its fd number in the client and the inode behind
+ * it. That is not unique: ion and older dma-buf files share one anonymous
+ * inode, and the client may close a buffer and reuse its fd number. So a
+ * hit is only taken when kcmp() confirms the received fd is the same open
+ * file as the import. Otherwise the import is retired, and closed once PAL
+ * returns it. Each buffer is dup'ed once and the dup is handed to PAL on
+ * every later read/write of the same buffer. Idle imports are evicted
+ * least recently used first beyond MAX_CACHE_SIZE entries, the rest are
+ * closed with the stream. Read regions the client registered are mapped on
+ * first use and stay mapped as long as their import.
+ */
+class SharedMemFdCache {
+    public :
+    SharedMemFdCache() {}
+    ~SharedMemFdCache();
+    /* returns the server side fd of the buffer, or -1 if it cannot be imported */
+    int acquire(int inputFd, int receivedFd);
+    /* returns the client fd the server side fd was imported from, or -1 */
+    int find(int dupFd);
+    /* the buffer is back from PAL, its import may be evicted from now on */
+    void release(int dupFd);
+    /* maps the first size bytes of an acquired buffer, nullptr on failure */
+    uint8_t *map(int dupFd, size_t size);
+    void clear();
+    /* bytes of memory behind a client fd, -1 if it cannot be sized */
+    static int64_t regionSize(int fd);
+    /* 1 when both fds refer to the same open file, 0 if not, -1 unknown */
+    static int sameFile(int fd1, int fd2);
+
+    private :
+    struct key {
+        int inputFd;
+        dev_t dev;
+        ino_t ino;
+        bool operator==(const key &k) const {
+            return inputFd == k.inputFd && dev == k.dev && ino == k.ino;
+        }
+    };
+    struct keyHash {
+        size_t operator()(const key &k) const {
+            return std::hash<uint64_t>()(((uint64_t)k.ino << 16) ^
+                                         ((uint64_t)k.dev << 8) ^ k.inputFd);
+        }
+    };
+    struct entry {
+        struct key id;
+        int dupFd;
+        uint32_t inFlight;
+        uint8_t *addr;
+        size_t mapSize;
+        /* the client fd names another buffer now, close once back from PAL */
+        bool retired;
+    };
+
+    void evict();
+    static void unmap(struct entry &e);
+
+    std::mutex mLock;
+    /* most recently used imports live at the front */
+    std::list<struct entry> mLru;
+    std::unordered_map<struct key, std::list<struct entry>::iterator, keyHash> mByInput;
+    std::unordered_map<int, std::list<struct entry>::iterator> mByDup;
+};
+
 
 class SrvrClbk : public ::android::RefBase {
     public :
@@ -68,7 +138,7 @@ class SrvrClbk : public ::android::RefBase {
     struct pal_stream_attributes session_attr;
     int pid_;
     bool client_died;
-    std::vector<std::pair<int, int>> sharedMemFdList;
+    SharedMemFdCache sharedMemFds;
 
     SrvrClbk()
     {
@@ -94,15 +164,18 @@ class SrvrClbk : public ::android::RefBase {
     }
 };
 
+struct client_info;
+
 typedef struct session_info {
     uint64_t session_handle;
     sp<SrvrClbk> callback_binder;
+    std::weak_ptr<client_info> client;
 }session_info;
 
 struct client_info {
     int pid;
-    std::vector<session_info> mActiveSessions;
-    std::mutex mActiveSessionsLock;
+    /* handles of the sessions opened by this client */
+    std::unordered_set<uint64_t> mActiveSessions;
 };
 
 struct PAL : public IPAL /*, public android::hardware::hidl_death_recipient*/{
@@ -193,11 +266,20 @@ struct PAL : public IPAL /*, public android::hardware::hidl_death_recipient*/{
                                      uint32_t size,
                                      ipc_pal_stream_get_tags_with_module_info_cb _hidl_cb) override;
     sp<PalClientDeathRecipient> mDeathRecipient;
-    std::vector<std::shared_ptr<client_info>> mPalClients;
+    sp<SrvrClbk> find_session_clbk(const uint64_t streamHandle);
+    /* detaches the client and returns the sessions it left open */
+    std::vector<std::shared_ptr<session_info>> remove_client(int pid);
 private:
     static PAL* sInstance;
-    int find_dup_fd_from_input_fd(const uint64_t streamHandle, int input_fd, int *dup_fd);
-    void add_input_and_dup_fd(const uint64_t streamHandle, int input_fd, int dup_fd);
+    int32_t attach_position_mirror(const uint64_t streamHandle, const PalBuffer *buff);
+    /*
+     * Sessions are looked up by stream handle on every call that touches
+     * session state, clients by pid on open and death. Both maps are
+     * guarded by mPalClientsLock, which is never held across PAL calls.
+     */
+    std::mutex mPalClientsLock;
+    std::unordered_map<int, std::shared_ptr<client_info>> mPalClients;
+    std::unordered_map<uint64_t, std::shared_ptr<session_info>> mPalSessions;
 };
 
 class PalClientDeathRecipient : public android::hardware::hidl_death_recipient
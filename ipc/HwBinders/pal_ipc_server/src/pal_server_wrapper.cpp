@@ -34,6 +34,9 @@
 #define LOG_TAG "pal_server_wrapper"
 #include "inc/pal_server_wrapper.h"
 #include <hwbinder/IPCThreadState.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/kcmp.h>
 
 #define MAX_CACHE_SIZE 64
 
@@ -57,68 +60,249 @@ void PalClientDeathRecipient::serviceDied(uint64_t cookie,
     std::lock_guard<std::mutex> guard(mLock);
     ALOGD("%s : client died pid : %d", __func__, cookie);
     int pid = (int) cookie;
-    auto &clients = mPalInstance->mPalClients;
-    for (auto itr = clients.begin(); itr != clients.end(); itr++) {
-        auto client = *itr;
-        if (client->pid == pid) {
-            {
-                std::lock_guard<std::mutex> lock(client->mActiveSessionsLock);
-                for (auto sItr = client->mActiveSessions.begin();
-                          sItr != client->mActiveSessions.end(); sItr++) {
-                   ALOGD("Closing the session %pK", sItr->session_handle);
-                   ALOGV("hdle %x binder %p", sItr->session_handle, sItr->callback_binder.get());
-                   sItr->callback_binder->client_died = true;
-                   pal_stream_stop((pal_stream_handle_t *)sItr->session_handle);
-                   pal_stream_close((pal_stream_handle_t *)sItr->session_handle);
-                   /*close the dupped fds in PAL server context*/
-                   for (int i = 0; i < sItr->callback_binder->sharedMemFdList.size(); i++) {
-                       close(sItr->callback_binder->sharedMemFdList[i].second);
-                   }
-                   sItr->callback_binder->sharedMemFdList.clear();
-                   sItr->callback_binder.clear();
-                }
-                client->mActiveSessions.clear();
-            }
-            itr = clients.erase(itr);
-            break;
+    auto sessions = mPalInstance->remove_client(pid);
+
+    /*only the streams of the dead client are torn down*/
+    for (auto &session : sessions) {
+        ALOGD("Closing the session %pK", session->session_handle);
+        ALOGV("hdle %x binder %p", session->session_handle, session->callback_binder.get());
+        session->callback_binder->client_died = true;
+        pal_stream_stop((pal_stream_handle_t *)session->session_handle);
+        pal_stream_close((pal_stream_handle_t *)session->session_handle);
+        /*close the dupped fds in PAL server context*/
+        session->callback_binder->sharedMemFds.clear();
+        session->callback_binder.clear();
+    }
+}
+
+SharedMemFdCache::~SharedMemFdCache()
+{
+    clear();
+}
+
+int SharedMemFdCache::acquire(int inputFd, int receivedFd)
+{
+    struct stat st;
+    struct key id;
+    struct entry e;
+
+    if (fstat(receivedFd, &st)) {
+        ALOGE("%s: fstat failed for fd %d, errno %d", __func__, receivedFd, errno);
+        return -1;
+    }
+    id.inputFd = inputFd;
+    id.dev = st.st_dev;
+    id.ino = st.st_ino;
+
+    std::lock_guard<std::mutex> lock(mLock);
+    auto it = mByInput.find(id);
+    if (it != mByInput.end()) {
+        if (sameFile(it->second->dupFd, receivedFd) == 1) {
+            mLru.splice(mLru.begin(), mLru, it->second);
+            it->second->inFlight++;
+            return it->second->dupFd;
         }
+        ALOGV("%s: fd [input %d - dup %d] names another buffer now", __func__,
+                inputFd, it->second->dupFd);
+        it->second->retired = true;
+        mByInput.erase(it);
     }
+
+    e.id = id;
+    e.dupFd = dup(receivedFd);
+    e.inFlight = 1;
+    e.addr = nullptr;
+    e.mapSize = 0;
+    e.retired = false;
+    if (e.dupFd < 0) {
+        ALOGE("%s: dup failed for fd %d, errno %d", __func__, receivedFd, errno);
+        return -1;
+    }
+    mLru.push_front(e);
+    mByInput[id] = mLru.begin();
+    mByDup[e.dupFd] = mLru.begin();
+    ALOGV("%s: import fd [input %d - dup %d], %zu cached", __func__,
+            inputFd, e.dupFd, mLru.size());
+    evict();
+
+    return e.dupFd;
 }
 
-void PAL::add_input_and_dup_fd(const uint64_t streamHandle, int input_fd, int dup_fd)
+int SharedMemFdCache::find(int dupFd)
 {
-    std::vector<std::pair<int, int>>::iterator it;
-    for (auto& s: mPalClients) {
-        std::lock_guard<std::mutex> lock(s->mActiveSessionsLock);
-        for (int i = 0; i < s->mActiveSessions.size(); i++) {
-            session_info session = s->mActiveSessions[i];
-            if (session.session_handle == streamHandle) {
-                /*If number of FDs increase than the MAX Cache size we delete the oldest one
-                  NOTE: We still create a new fd for every input fd*/
-                if (session.callback_binder->sharedMemFdList.size() > MAX_CACHE_SIZE) {
-                    ALOGE("%s cache limit exceeded handle %p fd [input %d - dup %d]",
-                            __func__ , streamHandle, input_fd, dup_fd );
-                }
-                session.callback_binder->sharedMemFdList.push_back(
-                                            std::make_pair(input_fd, dup_fd));
-            }
+    std::lock_guard<std::mutex> lock(mLock);
+    auto it = mByDup.find(dupFd);
+
+    if (it == mByDup.end())
+        return -1;
+
+    return it->second->id.inputFd;
+}
+
+int SharedMemFdCache::sameFile(int fd1, int fd2)
+{
+    static bool warned = false;
+    pid_t pid = getpid();
+    int ret = syscall(SYS_kcmp, pid, pid, KCMP_FILE, fd1, fd2);
+
+    if (ret < 0) {
+        if (!warned) {
+            ALOGW("%s: kcmp failed, errno %d, shared memory fds are not reused",
+                    __func__, errno);
+            warned = true;
         }
+        return -1;
+    }
+    return ret == 0;
+}
+
+void SharedMemFdCache::release(int dupFd)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    auto it = mByDup.find(dupFd);
+
+    if (it == mByDup.end())
+        return;
+    if (it->second->inFlight)
+        it->second->inFlight--;
+    evict();
+}
+
+/*
+ * Size of the memory behind a client fd. ashmem reports 0 through fstat
+ * but supports SEEK_END, the fd offset is restored as the client shares it.
+ */
+int64_t SharedMemFdCache::regionSize(int fd)
+{
+    struct stat st;
+    off_t cur = 0;
+    off_t end = 0;
+
+    if (!fstat(fd, &st) && st.st_size > 0)
+        return st.st_size;
+
+    cur = lseek(fd, 0, SEEK_CUR);
+    end = lseek(fd, 0, SEEK_END);
+    if (cur >= 0)
+        lseek(fd, cur, SEEK_SET);
+    if (end < 0) {
+        ALOGE("%s: cannot size fd %d, errno %d", __func__, fd, errno);
+        return -1;
+    }
+    return end;
+}
+
+uint8_t *SharedMemFdCache::map(int dupFd, size_t size)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    auto it = mByDup.find(dupFd);
+    void *addr = nullptr;
+    int64_t regionBytes = 0;
+
+    if (it == mByDup.end() || !size)
+        return nullptr;
+    if (it->second->addr && it->second->mapSize >= size)
+        return it->second->addr;
+
+    /*pages past the end of the client's region would fault on access*/
+    regionBytes = regionSize(dupFd);
+    if (regionBytes < 0 || (uint64_t)regionBytes < size) {
+        ALOGE("%s: %zu bytes requested, fd %d holds %lld", __func__, size,
+                dupFd, (long long)regionBytes);
+        return nullptr;
+    }
+
+    unmap(*it->second);
+    addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, dupFd, 0);
+    if (addr == MAP_FAILED) {
+        ALOGE("%s: mmap of %zu bytes failed for fd %d, errno %d", __func__,
+                size, dupFd, errno);
+        return nullptr;
     }
+    it->second->addr = (uint8_t *)addr;
+    it->second->mapSize = size;
+    ALOGV("%s: mapped %zu bytes of fd %d", __func__, size, dupFd);
+
+    return it->second->addr;
 }
 
+void SharedMemFdCache::unmap(struct entry &e)
+{
+    if (e.addr)
+        munmap(e.addr, e.mapSize);
+    e.addr = nullptr;
+    e.mapSize = 0;
+}
 
-static void printFdList(const std::vector<std::pair<int, int>> &list, const char * caller) {
-    if (list.size() > 0 ) {
-        std::string s;
-        for (auto & x : list) {
-            s.append( "{ ");
-            s.append(std::to_string(x.first));
-            s.append( " : ");
-            s.append(std::to_string(x.second));
-            s.append("} ");
+/*
+ * called with mLock held, buffers still queued in PAL are never closed.
+ * Retired imports go as soon as they are idle, the others beyond
+ * MAX_CACHE_SIZE.
+ */
+void SharedMemFdCache::evict()
+{
+    auto it = mLru.end();
+    size_t cached = mLru.size();
+
+    while (it != mLru.begin()) {
+        it--;
+        if (it->inFlight || (!it->retired && cached <= MAX_CACHE_SIZE))
+            continue;
+        ALOGV("%s: evict fd [input %d - dup %d]", __func__,
+                it->id.inputFd, it->dupFd);
+        unmap(*it);
+        close(it->dupFd);
+        if (!it->retired)
+            mByInput.erase(it->id);
+        mByDup.erase(it->dupFd);
+        it = mLru.erase(it);
+        cached--;
+    }
+}
+
+void SharedMemFdCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mLock);
+
+    for (auto &e : mLru) {
+        unmap(e);
+        close(e.dupFd);
+    }
+    mLru.clear();
+    mByInput.clear();
+    mByDup.clear();
+}
+
+sp<SrvrClbk> PAL::find_session_clbk(const uint64_t streamHandle)
+{
+    std::lock_guard<std::mutex> lock(mPalClientsLock);
+    auto itr = mPalSessions.find(streamHandle);
+
+    if (itr == mPalSessions.end())
+        return nullptr;
+    return itr->second->callback_binder;
+}
+
+std::vector<std::shared_ptr<session_info>> PAL::remove_client(int pid)
+{
+    std::vector<std::shared_ptr<session_info>> sessions;
+    std::lock_guard<std::mutex> lock(mPalClientsLock);
+    auto itr = mPalClients.find(pid);
+
+    if (itr == mPalClients.end())
+        return sessions;
+
+    for (auto handle : itr->second->mActiveSessions) {
+        auto sItr = mPalSessions.find(handle);
+        if (sItr != mPalSessions.end()) {
+            sessions.push_back(sItr->second);
+            mPalSessions.erase(sItr);
         }
-        ALOGV("%s size %d, list %s", caller, list.size(), s.c_str());
     }
+    itr->second->mActiveSessions.clear();
+    mPalClients.erase(itr);
+
+    return sessions;
 }
 
 static int32_t pal_callback(pal_stream_handle_t *stream_handle,
@@ -131,15 +315,7 @@ static int32_t pal_callback(pal_stream_handle_t *stream_handle,
            ALOGE("%s: No PAL instance running", __func__);
            return false;
         }
-        for (auto& s: PAL::getInstance()->mPalClients) {
-            std::lock_guard<std::mutex> lock(s->mActiveSessionsLock);
-            for (int idx = 0; idx < s->mActiveSessions.size(); idx++) {
-                session_info session = s->mActiveSessions[idx];
-                if (session.session_handle == stream_handle)
-                    return true;
-            }
-        }
-        return false;
+        return PAL::getInstance()->find_session_clbk(stream_handle) != nullptr;
     };
 
     if (!isPalSessionActive((uint64_t)stream_handle)) {
@@ -157,7 +333,6 @@ static int32_t pal_callback(pal_stream_handle_t *stream_handle,
         PalEventReadWriteDonePayload *rwDonePayload;
         struct pal_event_read_write_done_payload *rw_done_payload;
         int input_fd = -1;
-        int fdToBeClosed = -1;
         native_handle_t *allocHidlHandle = nullptr;
         allocHidlHandle = native_handle_create(1, 1);
         if (!allocHidlHandle) {
@@ -167,31 +342,13 @@ static int32_t pal_callback(pal_stream_handle_t *stream_handle,
 
         rw_done_payload = (struct pal_event_read_write_done_payload *)event_data;
         /*
-         * Find the original fd that was passed by client based on what
-         * input and dup fd list and send that back.
+         * Find the original fd that was passed by client, the dup stays
+         * cached for the next read/write of the same buffer.
          */
-        for (auto& s: PAL::getInstance()->mPalClients) {
-            std::lock_guard<std::mutex> lock(s->mActiveSessionsLock);
-            for (int idx = 0; idx < s->mActiveSessions.size(); idx++) {
-                session_info session = s->mActiveSessions[idx];
-                if (session.session_handle == (uint64_t)stream_handle) {
-                    std::vector<std::pair<int, int>>::iterator it;
-                    for (int i = 0; i < sr_clbk_dat->sharedMemFdList.size(); i++) {
-                        if (sr_clbk_dat->sharedMemFdList[i].second ==
-                                rw_done_payload->buff.alloc_info.alloc_handle) {
-                            input_fd = sr_clbk_dat->sharedMemFdList[i].first;
-                            it = (sr_clbk_dat->sharedMemFdList.begin() + i);
-                            if (it != sr_clbk_dat->sharedMemFdList.end()) {
-                                fdToBeClosed = sr_clbk_dat->sharedMemFdList[i].second;
-                                sr_clbk_dat->sharedMemFdList.erase(it);
-                                ALOGV("Removing fd [input %d - dup %d]", input_fd, fdToBeClosed);
-                            }
-                            break;
-                        }
-                    }
-                }
-            }
-        }
+        input_fd = sr_clbk_dat->sharedMemFds.find(
+                                      rw_done_payload->buff.alloc_info.alloc_handle);
+        if (input_fd == -1)
+            ALOGE("Error finding fd %d", rw_done_payload->buff.alloc_info.alloc_handle);
 
         rwDonePayloadHidl.resize(sizeof(struct pal_event_read_write_done_payload));
         rwDonePayload =(PalEventReadWriteDonePayload *)rwDonePayloadHidl.data();
@@ -241,12 +398,9 @@ static int32_t pal_callback(pal_stream_handle_t *stream_handle,
         } else
             ALOGE("Client died dropping this event %d", event_id);
 
-        if (fdToBeClosed != -1) {
-            ALOGV("closing dup fd %d ", fdToBeClosed);
-            close(fdToBeClosed);
-        } else {
-            ALOGE("Error finding fd %d", rw_done_payload->buff.alloc_info.alloc_handle);
-        }
+        /*the dup may be evicted once the event no longer refers to it*/
+        if (input_fd != -1)
+            sr_clbk_dat->sharedMemFds.release(rw_done_payload->buff.alloc_info.alloc_handle);
         if (allocHidlHandle)
             native_handle_delete(allocHidlHandle);
     } else {
@@ -414,42 +568,35 @@ Return<void> PAL::ipc_pal_stream_open(const hidl_vec<PalStreamAttributes>& attr_
                           callback, (uint64_t)sr_clbk_data.get(), &stream_handle);
 
     if (!ret) {
-        for(auto& client: mPalClients) {
-            if (client->pid == pid) {
+        auto session = std::make_shared<session_info>();
+        session->session_handle = (uint64_t)stream_handle;
+        session->callback_binder = sr_clbk_data;
+        ALOGV("hdle %x binder %p", session->session_handle, session->callback_binder.get());
+        {
+            std::lock_guard<std::mutex> lock(mPalClientsLock);
+            auto itr = mPalClients.find(pid);
+            if (itr != mPalClients.end()) {
                 /*Another session from the same client*/
                 ALOGI("Add session for existing client %d session %pK total sessions %d", pid,
-                        (uint64_t)stream_handle, client->mActiveSessions.size());
-                struct session_info session;
-                session.session_handle = (uint64_t)stream_handle;
-                session.callback_binder = sr_clbk_data;
-                ALOGV("hdle %x binder %p", session.session_handle, session.callback_binder.get());
-                {
-                    std::lock_guard<std::mutex> lock(client->mActiveSessionsLock);
-                    client->mActiveSessions.push_back(session);
-                }
+                        (uint64_t)stream_handle, itr->second->mActiveSessions.size());
+                session->client = itr->second;
+                itr->second->mActiveSessions.insert(session->session_handle);
                 new_client = false;
-                break;
+            } else {
+                auto client = std::make_shared<client_info>();
+                ALOGI("Add session from new client %d session %pK", pid, (uint64_t)stream_handle);
+                client->pid = pid;
+                client->mActiveSessions.insert(session->session_handle);
+                session->client = client;
+                mPalClients[pid] = client;
             }
+            mPalSessions[session->session_handle] = session;
         }
-        if (new_client) {
-            auto client = std::make_shared<client_info>();
-            struct session_info session;
-            ALOGI("Add session from new client %d session %pK", pid, (uint64_t)stream_handle);
-            client->pid = pid;
-            session.session_handle = (uint64_t)stream_handle;
-            session.callback_binder = sr_clbk_data;
-            ALOGV("hdle %x binder %p", session.session_handle, session.callback_binder.get());
-            {
-                std::lock_guard<std::mutex> lock(client->mActiveSessionsLock);
-                client->mActiveSessions.push_back(session);
-            }
-            mPalClients.push_back(client);
-            if (cb != NULL) {
-                if (this->mDeathRecipient.get() == nullptr) {
-                    this->mDeathRecipient = new PalClientDeathRecipient(this);
-                }
-                cb->linkToDeath(this->mDeathRecipient, pid);
+        if (new_client && cb != NULL) {
+            if (this->mDeathRecipient.get() == nullptr) {
+                this->mDeathRecipient = new PalClientDeathRecipient(this);
             }
+            cb->linkToDeath(this->mDeathRecipient, pid);
         }
     } else {
         /*stream_open failed, free the callback binder object*/
@@ -469,40 +616,60 @@ exit:
 Return<int32_t> PAL::ipc_pal_stream_close(const uint64_t streamHandle)
 {
     int pid = ::android::hardware::IPCThreadState::self()->getCallingPid();
-    Return<int32_t> status = pal_stream_close((pal_stream_handle_t *)streamHandle);
-
-    for (auto itr = mPalClients.begin(); itr != mPalClients.end(); ) {
-        auto client = *itr;
-        if (client->pid == pid) {
-            {
-                std::lock_guard<std::mutex> lock(client->mActiveSessionsLock);
-                auto sItr = client->mActiveSessions.begin();
-                for (; sItr != client->mActiveSessions.end(); sItr++) {
-                    if (sItr->session_handle == streamHandle) {
-                        /*close the shared mem fds dupped in PAL server context*/
-                        for (int i=0; i < sItr->callback_binder->sharedMemFdList.size(); i++) {
-                             close(sItr->callback_binder->sharedMemFdList[i].second);
-                        }
-                        ALOGV("Closing the session %pK", streamHandle);
-                        sItr->callback_binder->sharedMemFdList.clear();
-                        sItr->callback_binder.clear();
-                        break;
-                    }
-                }
-                if (sItr != client->mActiveSessions.end()) {
-                    ALOGV("Delete session info %pK", sItr->session_handle);
-                    client->mActiveSessions.erase(sItr);
-                }
+    std::shared_ptr<session_info> session = nullptr;
+    std::shared_ptr<client_info> client = nullptr;
+    int32_t status = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(mPalClientsLock);
+        auto sItr = mPalSessions.find(streamHandle);
+        if (sItr != mPalSessions.end()) {
+            session = sItr->second;
+            client = session->client.lock();
+            /*only the client that opened the stream may close it*/
+            if (client && client->pid != pid) {
+                ALOGE("%s: pid %d does not own session %pK of client %d",
+                        __func__, pid, streamHandle, client->pid);
+                return -EPERM;
             }
+        }
+    }
+
+    status = pal_stream_close((pal_stream_handle_t *)streamHandle);
+    if (status) {
+        ALOGE("%s: close of session %pK failed %d, keeping it", __func__,
+                streamHandle, status);
+        return status;
+    }
+
+    if (!session)
+        return status;
+
+    /*
+     * once PAL freed the stream an open running concurrently may have got
+     * the same handle and registered its own session, that one is kept
+     */
+    {
+        std::lock_guard<std::mutex> lock(mPalClientsLock);
+        auto sItr = mPalSessions.find(streamHandle);
+        bool reused = (sItr != mPalSessions.end() && sItr->second != session);
+
+        ALOGV("Delete session info %pK", streamHandle);
+        if (!reused && sItr != mPalSessions.end())
+            mPalSessions.erase(sItr);
+        if (client && !(reused && sItr->second->client.lock() == client)) {
+            client->mActiveSessions.erase(streamHandle);
             if (client->mActiveSessions.empty()) {
                 ALOGV("Delete client info");
-                itr = mPalClients.erase(itr);
-            } else {
-                itr++;
+                mPalClients.erase(client->pid);
             }
-            break;
         }
     }
+
+    /*close the shared mem fds dupped in PAL server context*/
+    ALOGV("Closing the session %pK", streamHandle);
+    session->callback_binder->sharedMemFds.clear();
+    session->callback_binder.clear();
     return status;
 }
 
@@ -587,12 +754,44 @@ Return<void> PAL::ipc_pal_stream_get_buffer_size(const uint64_t streamHandle,
 }
 
 
+/*
+ * The client hands over the page the stream position is mirrored into.
+ * The import stays pinned, and so mapped, until the stream is closed.
+ */
+int32_t PAL::attach_position_mirror(const uint64_t streamHandle, const PalBuffer *buff)
+{
+    int32_t ret = -EINVAL;
+    int dupFd = -1;
+    uint8_t *page = nullptr;
+    const native_handle *allochandle = buff->alloc_info.alloc_handle.handle();
+    sp<SrvrClbk> sr_clbk_dat = find_session_clbk(streamHandle);
+
+    if (sr_clbk_dat == nullptr || allochandle == nullptr || allochandle->numFds < 1 ||
+        buff->alloc_info.alloc_size < sizeof(pal_position_mirror_t)) {
+        ALOGE("%s: invalid position mirror for handle %pK", __func__, streamHandle);
+        return ret;
+    }
+    dupFd = sr_clbk_dat->sharedMemFds.acquire(allochandle->data[1], allochandle->data[0]);
+    if (dupFd < 0)
+        return ret;
+    page = sr_clbk_dat->sharedMemFds.map(dupFd, buff->alloc_info.alloc_size);
+    if (page)
+        ret = pal_stream_set_position_mirror((pal_stream_handle_t *)streamHandle,
+                                             (pal_position_mirror_t *)page);
+    if (ret)
+        sr_clbk_dat->sharedMemFds.release(dupFd);
+    return ret;
+}
+
 Return<int32_t> PAL::ipc_pal_stream_write(const uint64_t streamHandle,
                                           const hidl_vec<PalBuffer>& buff_hidl) {
     int32_t ret = -ENOMEM;
     struct pal_buffer buf = {0};
     uint32_t bufSize;
     const native_handle *allochandle = nullptr;
+    sp<SrvrClbk> sr_clbk_dat = nullptr;
+    if (buff_hidl.data()->flags & PAL_BUFF_FLAG_POSITION_MIRROR)
+        return attach_position_mirror(streamHandle, buff_hidl.data());
     bufSize = buff_hidl.data()->size;
     if (buff_hidl.data()->buffer.size() == bufSize)
         buf.buffer = (uint8_t *)calloc(1, bufSize);
@@ -619,8 +818,14 @@ Return<int32_t> PAL::ipc_pal_stream_write(const uint64_t streamHandle,
 
     allochandle = buff_hidl.data()->alloc_info.alloc_handle.handle();
 
-    buf.alloc_info.alloc_handle = dup(allochandle->data[0]);
-    add_input_and_dup_fd(streamHandle, allochandle->data[1], buf.alloc_info.alloc_handle);
+    sr_clbk_dat = find_session_clbk(streamHandle);
+    if (sr_clbk_dat == nullptr) {
+        ALOGE("%s: no session for handle %pK", __func__, streamHandle);
+        ret = -EINVAL;
+        goto exit;
+    }
+    buf.alloc_info.alloc_handle = sr_clbk_dat->sharedMemFds.acquire(allochandle->data[1],
+                                                                   allochandle->data[0]);
 
     ALOGV("%s: fd[input%d - dup%d]", __func__, allochandle->data[1], buf.alloc_info.alloc_handle);
     buf.alloc_info.alloc_size = buff_hidl.data()->alloc_info.alloc_size;
@@ -630,6 +835,9 @@ Return<int32_t> PAL::ipc_pal_stream_write(const uint64_t streamHandle,
         memcpy(buf.buffer, buff_hidl.data()->buffer.data(), bufSize);
     ALOGV("%s:%d sz %d", __func__,__LINE__,bufSize);
     ret = pal_stream_write((pal_stream_handle_t *)streamHandle, &buf);
+    /*only non tunnel streams hand the buffer back through a write done event*/
+    if (ret < 0 || sr_clbk_dat->session_attr.type != PAL_STREAM_NON_TUNNEL)
+        sr_clbk_dat->sharedMemFds.release(buf.alloc_info.alloc_handle);
 exit:
     if (buf.buffer)
         free(buf.buffer);
@@ -648,35 +856,69 @@ Return<void> PAL::ipc_pal_stream_read(const uint64_t streamHandle,
     hidl_vec<PalBuffer> outBuff_hidl;
     uint32_t bufSize;
     const native_handle *allochandle = nullptr;
+    sp<SrvrClbk> sr_clbk_dat = nullptr;
+    uint8_t *region = nullptr;
+    bool inPlace = false;
 
+    memset(&buf, 0, sizeof(buf));
     bufSize = inBuff_hidl.data()->size;
-    buf.buffer = (uint8_t *)calloc(1, bufSize);
+    inPlace = !!(inBuff_hidl.data()->flags & PAL_BUFF_FLAG_SHMEM_READ);
     buf.size = (size_t)bufSize;
     buf.metadata_size = inBuff_hidl.data()->metadataSz;
     buf.metadata = (uint8_t *)calloc(1, buf.metadata_size);
     if (!buf.metadata) {
         ALOGE("Not enough memory for buf.metadata");
+        ret = -ENOMEM;
         goto exit;
     }
 
 
     allochandle = inBuff_hidl.data()->alloc_info.alloc_handle.handle();
 
-    buf.alloc_info.alloc_handle = dup(allochandle->data[0]);
-    add_input_and_dup_fd(streamHandle, allochandle->data[1], buf.alloc_info.alloc_handle);
+    sr_clbk_dat = find_session_clbk(streamHandle);
+    if (sr_clbk_dat == nullptr) {
+        ALOGE("%s: no session for handle %pK", __func__, streamHandle);
+        ret = -EINVAL;
+        goto exit;
+    }
+    buf.alloc_info.alloc_handle = sr_clbk_dat->sharedMemFds.acquire(allochandle->data[1],
+                                                                   allochandle->data[0]);
     ALOGV("%s: fd[input%d - dup%d]", __func__, allochandle->data[1], buf.alloc_info.alloc_handle);
 
     buf.alloc_info.alloc_size = inBuff_hidl.data()->alloc_info.alloc_size;
     buf.alloc_info.offset = inBuff_hidl.data()->alloc_info.offset;
 
+    if (inPlace) {
+        /*read straight into the region the client registered, the reply only carries the size*/
+        if (buf.alloc_info.alloc_handle >= 0)
+            region = sr_clbk_dat->sharedMemFds.map(buf.alloc_info.alloc_handle,
+                                                   buf.alloc_info.alloc_size);
+        if (!region ||
+            (uint64_t)buf.alloc_info.offset + bufSize > buf.alloc_info.alloc_size) {
+            ALOGE("%s: invalid read region, offset %u size %u region size %u", __func__,
+                  buf.alloc_info.offset, bufSize, buf.alloc_info.alloc_size);
+            sr_clbk_dat->sharedMemFds.release(buf.alloc_info.alloc_handle);
+            ret = -EINVAL;
+            goto exit;
+        }
+        buf.buffer = region + buf.alloc_info.offset;
+    } else {
+        buf.buffer = (uint8_t *)calloc(1, bufSize);
+    }
+
     ret = pal_stream_read((pal_stream_handle_t *)streamHandle, &buf);
+    /*only non tunnel streams hand the buffer back through a read done event*/
+    if (ret < 0 || sr_clbk_dat->session_attr.type != PAL_STREAM_NON_TUNNEL)
+        sr_clbk_dat->sharedMemFds.release(buf.alloc_info.alloc_handle);
     if (ret > 0) {
         outBuff_hidl.resize(sizeof(struct pal_buffer));
         outBuff_hidl.data()->size = (uint32_t)buf.size;
         outBuff_hidl.data()->offset = (uint32_t)buf.offset;
-        outBuff_hidl.data()->buffer.resize(buf.size);
-        memcpy(outBuff_hidl.data()->buffer.data(), buf.buffer,
-               buf.size);
+        if (!inPlace) {
+            outBuff_hidl.data()->buffer.resize(buf.size);
+            memcpy(outBuff_hidl.data()->buffer.data(), buf.buffer,
+                   buf.size);
+        }
         if (buf.ts) {
           outBuff_hidl.data()->timeStamp.tvSec = buf.ts->tv_sec;
           outBuff_hidl.data()->timeStamp.tvNSec = buf.ts->tv_nsec;
@@ -687,9 +929,10 @@ Return<void> PAL::ipc_pal_stream_read(const uint64_t streamHandle,
                   buf.metadata, buf.metadata_size);
         }
     }
-    _hidl_cb(ret, outBuff_hidl);
 exit:
-    if (buf.buffer)
+    /*HIDL expects the callback on every path, errors reply with an empty buffer*/
+    _hidl_cb(ret, outBuff_hidl);
+    if (buf.buffer && !inPlace)
         free(buf.buffer);
     if (buf.metadata)
         free(buf.metadata);
@@ -728,9 +971,14 @@ Return<void> PAL::ipc_pal_stream_get_param(const uint64_t streamHandle,
                                          ipc_pal_stream_get_param_cb _hidl_cb)
 {
     int32_t ret = 0;
-    pal_param_payload *param_payload;
+    pal_param_payload *param_payload = NULL;
     hidl_vec<PalParamPayload> paramPayload;
+    /* no client buffer crosses the HIDL call, the stream allocates one */
     ret = pal_stream_get_param((pal_stream_handle_t *)streamHandle, paramId, &param_payload);
+    if (ret == 0 && !param_payload) {
+        ALOGE("No payload returned for param id %u", paramId);
+        ret = -EINVAL;
+    }
     if (ret == 0) {
         paramPayload.resize(sizeof(PalParamPayload));
         paramPayload.data()->payload.resize(param_payload->payload_size);
@@ -738,6 +986,7 @@ Return<void> PAL::ipc_pal_stream_get_param(const uint64_t streamHandle,
         memcpy(paramPayload.data()->payload.data(), param_payload->payload,
                param_payload->payload_size);
     }
+    free(param_payload);
     _hidl_cb(ret, paramPayload);
     return Void();
 }
@@ -965,6 +1214,64 @@ Return<void>PAL::ipc_pal_gef_rw_param(uint32_t paramId, const hidl_vec<uint8_t>
                               PalStreamType strm_type, uint8_t dir,
                               ipc_pal_gef_rw_param_cb _hidl_cb)
 {
+    int32_t ret = -EINVAL;
+    uint32_t flags = 0;
+    uint32_t count = 0;
+    uint32_t i = 0;
+    size_t offset = 0;
+    size_t size = param_payload.size();
+    const uint8_t *ops = param_payload.data();
+    const struct pal_batch_op *rec = nullptr;
+    pal_batch_t *batch = nullptr;
+    hidl_vec<uint8_t> statusRet;
+
+    /*only batches of control ops travel through here*/
+    if (paramId != PAL_BATCH_IPC_PARAM_ID)
+        goto exit;
+
+    if (size < 2 * sizeof(uint32_t)) {
+        ALOGE("%s: Invalid batch size %zu", __func__, size);
+        goto exit;
+    }
+    memcpy(&flags, ops, sizeof(uint32_t));
+    memcpy(&count, ops + sizeof(uint32_t), sizeof(uint32_t));
+    ops += 2 * sizeof(uint32_t);
+    size -= 2 * sizeof(uint32_t);
+
+    /*check every record fits before anything is applied*/
+    for (i = 0; i < count; i++) {
+        if (size - offset < sizeof(struct pal_batch_op))
+            break;
+        rec = (const struct pal_batch_op *)(ops + offset);
+        /*compared against the bytes left so a huge size cannot wrap*/
+        if (rec->size > size - offset - sizeof(struct pal_batch_op))
+            break;
+        if (PAL_BATCH_OP_SIZE(rec->size) > size - offset)
+            break;
+        offset += PAL_BATCH_OP_SIZE(rec->size);
+    }
+    if (i != count) {
+        ALOGE("%s: Invalid batch, op %u of %u exceeds %zu bytes", __func__,
+              i, count, size);
+        goto exit;
+    }
+
+    batch = pal_batch_begin(flags);
+    if (!batch) {
+        ret = -ENOMEM;
+        goto exit;
+    }
+    for (i = 0, offset = 0; i < count; i++) {
+        rec = (const struct pal_batch_op *)(ops + offset);
+        pal_batch_add(batch, rec->op, (pal_stream_handle_t *)rec->stream_handle,
+                      rec->arg, rec->data, rec->size);
+        offset += PAL_BATCH_OP_SIZE(rec->size);
+    }
+    statusRet.resize(count * sizeof(int32_t));
+    ret = pal_batch_commit(batch, (int32_t *)statusRet.data(), count);
+
+exit:
+    _hidl_cb(ret, statusRet);
     return Void();
 }
 
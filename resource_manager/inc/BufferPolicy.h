@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the
+ * disclaimer below) provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *     * Neither the name of Qualcomm Innovation Center, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+ * GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+ * HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef BUFFER_POLICY_H
+#define BUFFER_POLICY_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <expat.h>
+#include "PalDefs.h"
+
+/* clean sessions needed before an underrun-driven period bump is undone */
+#define BUFFER_POLICY_DECAY_SESSIONS 8
+
+typedef enum {
+    BUFFER_POWER_ANY,
+    BUFFER_POWER_SCREEN_ON,
+    BUFFER_POWER_SCREEN_OFF,
+    BUFFER_POWER_CHARGING,
+} buffer_power_state_t;
+
+/*
+ * One <buffer_policy> entry of resourcemanager.xml, e.g.
+ *   <buffer_policy stream_type="PAL_STREAM_DEEP_BUFFER"
+ *                  device="PAL_DEVICE_OUT_SPEAKER" power_state="screen_off"
+ *                  period_ms="40" period_count="4" max_period_count="8"/>
+ * device and power_state are optional and match anything when left out.
+ */
+struct buffer_policy_entry {
+    pal_stream_type_t type;
+    pal_device_id_t device;
+    buffer_power_state_t power;
+    uint32_t periodMs;
+    uint32_t periodCount;
+    uint32_t maxPeriodCount;
+};
+
+struct buffer_policy_adapt {
+    uint32_t extraCount;
+    uint32_t cleanSessions;
+};
+
+class BufferPolicy
+{
+public:
+    static std::shared_ptr<BufferPolicy> getInstance();
+    void addEntry(const XML_Char **attr);
+    void setScreenState(bool on);
+    void setChargingState(bool charging);
+    /*
+     * Adjusts the period size (bytes) and count of a stream. The size is
+     * only replaced when the client left it unset; the count follows the
+     * policy plus whatever underruns have added at runtime.
+     */
+    bool getBufConfig(pal_stream_type_t type, pal_device_id_t device,
+                      const struct pal_media_config *config, bool clientSized,
+                      size_t *bufSize, size_t *bufCount);
+    void reportUnderruns(pal_stream_type_t type, pal_device_id_t device,
+                         uint32_t count);
+    void reportCleanSession(pal_stream_type_t type, pal_device_id_t device);
+private:
+    BufferPolicy();
+    const struct buffer_policy_entry *findEntry_l(pal_stream_type_t type,
+                                                  pal_device_id_t device);
+    static std::shared_ptr<BufferPolicy> instance;
+    std::mutex mLock;
+    std::vector<struct buffer_policy_entry> mEntries;
+    std::map<std::pair<pal_stream_type_t, pal_device_id_t>,
+             struct buffer_policy_adapt> mAdapt;
+    bool mScreenOn;
+    bool mCharging;
+};
+
+#endif
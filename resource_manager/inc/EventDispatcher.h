@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the
+ * disclaimer below) provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *     * Neither the name of Qualcomm Innovation Center, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+ * GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+ * HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef EVENT_DISPATCHER_H
+#define EVENT_DISPATCHER_H
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+/* callbacks that may block at once before delivery to others stalls */
+#define EVENT_DISPATCH_WORKERS 4
+/* events queued per subscriber before dispatch waits for it to catch up */
+#define EVENT_DISPATCH_QUEUE_DEPTH 32
+
+typedef void (*event_dispatch_cb)(uint64_t hdl, uint32_t event_id, void *event_data,
+                                  uint32_t event_size);
+
+struct event_dispatch_stat {
+    int id;
+    uint64_t cookie;
+    uint64_t delivered;
+    uint64_t dropped;
+    uint64_t avgLatencyUs;
+    uint64_t maxLatencyUs;
+};
+
+/*
+ * Delivers mixer events to the session callbacks registered per pcm id.
+ *
+ * The id -> subscriber table is copied on update and published as a whole,
+ * so the event thread looks subscribers up without a lock. Each subscriber
+ * has its own bounded queue. Subscribers sharing a cookie (one session on
+ * several pcm ids) share a lane, which one worker at a time drains, so a
+ * session never sees its callbacks run concurrently. A callback that blocks
+ * only holds up its own lane and one of the workers. Events are never
+ * dropped while the subscriber is registered, a full queue makes the event
+ * thread wait for its callback instead.
+ */
+class EventDispatcher
+{
+public:
+    EventDispatcher();
+    ~EventDispatcher();
+    void start();
+    /* queued lanes are kept and delivered on the next start() */
+    void stop();
+    /* a new subscriber for an id replaces the previous one */
+    int subscribe(int id, event_dispatch_cb cb, uint64_t cookie);
+    /*
+     * Drops queued events and returns without waiting for a running
+     * callback, the caller may hold locks that callback takes.
+     */
+    int unsubscribe(int id, event_dispatch_cb cb);
+    /*
+     * Waits for a running callback of cookie to return. Called by the
+     * cookie owner before it goes away, without holding locks the callback
+     * takes. Returns at once when called from that callback.
+     */
+    void waitIdle(uint64_t cookie);
+    /* only called while started, waits while the subscriber queue is full */
+    int dispatch(int id, uint32_t eventId, const void *payload, uint32_t size);
+    void getStats(std::vector<struct event_dispatch_stat> &stats);
+private:
+    struct event {
+        uint32_t eventId;
+        std::vector<uint8_t> payload;
+        uint64_t queuedNs;
+    };
+    struct subscriber;
+    struct lane {
+        std::mutex lock;
+        /* signalled when a callback returns */
+        std::condition_variable idle;
+        /* signalled when an event leaves a subscriber queue */
+        std::condition_variable space;
+        /* subscribers with queued events, in the order they got them */
+        std::deque<std::shared_ptr<struct subscriber>> pending;
+        bool scheduled;
+        std::thread::id runner;
+    };
+    /* events and counters are guarded by the lane lock */
+    struct subscriber {
+        int id;
+        event_dispatch_cb cb;
+        uint64_t cookie;
+        std::shared_ptr<struct lane> lane;
+        std::deque<struct event> events;
+        bool active;
+        bool pending;
+        uint64_t delivered;
+        uint64_t dropped;
+        uint64_t totalLatencyNs;
+        uint64_t maxLatencyNs;
+    };
+    typedef std::map<int, std::shared_ptr<struct subscriber>> subscriber_table;
+
+    void workerLoop();
+    void drain(std::shared_ptr<struct lane> lane);
+    static void retire(std::shared_ptr<struct subscriber> sub);
+    static void logStats(const struct subscriber &sub);
+
+    std::shared_ptr<const subscriber_table> mTable;
+    std::map<uint64_t, std::weak_ptr<struct lane>> mLanes;
+    std::mutex mTableWriteLock;
+    std::mutex mRunLock;
+    std::condition_variable mRunCV;
+    std::deque<std::shared_ptr<struct lane>> mRunQueue;
+    std::vector<std::thread> mWorkers;
+    bool mExit;
+};
+
+#endif
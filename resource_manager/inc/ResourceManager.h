@@ -80,6 +80,7 @@
 #include <queue>
 #include <deque>
 #include <unordered_map>
+#include <set>
 #include "PalDefs.h"
 #include "ChargerListener.h"
 #include "SndCardMonitor.h"
@@ -87,6 +88,7 @@
 #include "ACDPlatformInfo.h"
 #include "ContextManager.h"
 #include "SignalHandler.h"
+#include "EventDispatcher.h"
 #include <fstream>
 
 typedef enum {
@@ -110,9 +112,12 @@ typedef enum {
 #define AUDIO_PARAMETER_KEY_UPD_DEDICATED_BE "upd_dedicated_be"
 #define AUDIO_PARAMETER_KEY_DUAL_MONO "dual_mono"
 #define AUDIO_PARAMETER_KEY_SIGNAL_HANDLER "signal_handler"
+#define AUDIO_PARAMETER_KEY_XRUN_RECOVERY "xrun_recovery"
 #define MAX_PCM_NAME_SIZE 50
 #define MAX_STREAM_INSTANCES (sizeof(uint64_t) << 3)
 #define MIN_USECASE_PRIORITY 0xFFFFFFFF
+/* upper bound of concurrent stream restores after SSR */
+#define SSR_RECOVERY_MAX_WORKERS 4
 #if LINUX_ENABLED
 #if defined(__LP64__)
 #define ADM_LIBRARY_PATH "/usr/lib64/libadm.so"
@@ -165,6 +170,7 @@ typedef enum {
     TAG_CONFIG_LPM,
     TAG_CONFIG_LPM_SUPPORTED_STREAM,
     TAG_CONFIG_LPM_SUPPORTED_STREAMS,
+    TAG_CONFIG_RAMP,
 } resource_xml_tags_t;
 
 typedef enum {
@@ -312,6 +318,12 @@ struct disable_lpm_info {
     std::vector<uint32_t> streams_;
 };
 
+/* ramp periods in us, used to bound waits for volume/mute ramps */
+struct ramp_period_info {
+    uint32_t volumeRampPeriod;
+    uint32_t muteRampPeriod;
+};
+
 struct tx_ecinfo {
     int tx_stream_type;
     std::vector<int> disabled_rx_streams;
@@ -392,6 +404,15 @@ class ContextManager;
 class StreamSensorPCMData;
 class StreamContextProxy;
 
+/* per-stream result of the last SSR recovery */
+struct ssr_recovery_stat {
+    Stream *stream;
+    pal_stream_type_t type;
+    uint32_t group;
+    int32_t status;
+    uint64_t recoveryTimeUs;
+};
+
 struct deviceIn {
     int deviceId;
     int max_channel;
@@ -447,6 +468,9 @@ private:
     int32_t streamDevDisconnect_l(std::vector <std::tuple<Stream *, uint32_t>> streamDevDisconnectList);
     int32_t streamDevConnect_l(std::vector <std::tuple<Stream *, struct pal_device *>> streamDevConnectList);
     void ssrHandlingLoop(std::shared_ptr<ResourceManager> rm);
+    void ssrRecoverStreams();
+    void ssrRecoverGroup(std::vector<Stream*> *group, uint32_t groupId);
+    static bool isSsrPriorityStream(pal_stream_type_t type);
     int updateECDeviceMap(std::shared_ptr<Device> rx_dev,
                         std::shared_ptr<Device> tx_dev,
                         Stream *tx_str, int count, bool is_txstop);
@@ -479,6 +503,8 @@ protected:
     std::list <StreamSensorPCMData*> active_streams_sensor_pcm_data;
     std::list <StreamContextProxy*> active_streams_context_proxy;
     std::vector <std::pair<std::shared_ptr<Device>, Stream*>> active_devices;
+    /* active_devices entries of capture devices, keyed on tx device id */
+    std::map<int, std::vector<std::pair<std::shared_ptr<Device>, Stream*>>> active_tx_devices;
     std::vector <std::shared_ptr<Device>> plugin_devices_;
     std::vector <pal_device_id_t> avail_devices_;
     std::map<Stream*, std::pair<uint32_t, bool>> mActiveStreamUserCounter;
@@ -538,10 +564,15 @@ protected:
     static std::map<std::string, int> handsetPosTable;
     static std::map<pal_device_id_t, std::vector<std::string>> deviceTempCtrlsMap;
     static std::vector<deviceIn> deviceInfo;
+    /* ec ref relations of deviceInfo, read only once init() built them */
+    static std::set<std::pair<int, int>> ecRefPairs;
+    static std::map<int, std::vector<int>> ecRefTxDevs;
+    static std::map<int, int> ecRefTxIndex;
     static std::vector<tx_ecinfo> txEcInfo;
     static struct vsid_info vsidInfo;
     static struct volume_set_param_info volumeSetParamInfo_;
     static struct disable_lpm_info disableLpmInfo_;
+    static struct ramp_period_info rampPeriodInfo_;
     static std::vector<struct pal_amp_db_and_gain_table> gainLvlMap;
     static SndCardMonitor *sndmon;
     static std::vector <uint32_t> lpi_vote_streams_;
@@ -550,6 +581,8 @@ protected:
     static std::mutex cvMutex;
     static std::queue<card_status_t> msgQ;
     static std::thread workerThread;
+    std::vector<struct ssr_recovery_stat> mSsrRecoveryStats;
+    std::mutex mSsrRecoveryStatsMutex;
     std::vector<std::pair<std::string, InstanceListNode_t>> STInstancesLists;
     uint64_t stream_instances[PAL_STREAM_MAX];
     uint64_t in_stream_instances[PAL_STREAM_MAX];
@@ -565,7 +598,7 @@ protected:
     static int wake_unlock_fd;
     static uint32_t wake_lock_cnt;
     static bool lpi_logging_;
-    std::map<int, std::pair<session_callback, uint64_t>> mixerEventCallbackMap;
+    EventDispatcher mixerEventDispatcher;
     static std::thread mixerEventTread;
     std::shared_ptr<CaptureProfile> SoundTriggerCaptureProfile;
     ResourceManager();
@@ -600,6 +633,8 @@ public:
     static bool isDualMonoEnabled;
     static bool isUHQAEnabled;
     static bool isSignalHandlerEnabled;
+    /* Default PAL_XRUN_RECOVERY_* bits of new pcm streams */
+    static uint32_t xrunRecoveryDefault;
     /* Variable to store which speaker side is being used for call audio.
      * Valid for Stereo case only
      */
@@ -652,6 +687,8 @@ public:
     int32_t getVsidInfo(struct vsid_info  *info);
     int32_t getVolumeSetParamInfo(struct volume_set_param_info *volinfo);
     int32_t getDisableLpmInfo(struct disable_lpm_info *lpminfo);
+    static uint32_t getVolumeRampPeriod() { return rampPeriodInfo_.volumeRampPeriod; }
+    static uint32_t getMuteRampPeriod() { return rampPeriodInfo_.muteRampPeriod; }
     int getMaxVoiceVol();
     void getChannelMap(uint8_t *channel_map, int channels);
     pal_audio_fmt_t getAudioFmt(uint32_t bitWidth);
@@ -672,6 +709,7 @@ public:
     int registerMixerEventCallback(const std::vector<int> &DevIds,
                                    session_callback callback,
                                    uint64_t cookie, bool is_register);
+    void waitMixerEventCallbacks(uint64_t cookie);
     int updateECDeviceMap_l(std::shared_ptr<Device> rx_dev,
                             std::shared_ptr<Device> tx_dev,
                             Stream *tx_str, int count, bool is_txstop);
@@ -789,6 +827,9 @@ public:
     int SwitchSoundTriggerDevices(bool connect_state, pal_device_id_t device_id);
     static void mixerEventWaitThreadLoop(std::shared_ptr<ResourceManager> rm);
     bool isCallbackRegistered() { return (mixerEventRegisterCount > 0); }
+    void getMixerEventStats(std::vector<struct event_dispatch_stat> &stats) {
+        mixerEventDispatcher.getStats(stats);
+    }
     int handleMixerEvent(struct mixer *mixer, char *mixer_str);
     int StopOtherDetectionStreams(void *st);
     int StartOtherDetectionStreams(void *st);
@@ -813,6 +854,8 @@ public:
         Stream *rx_str, std::shared_ptr<Device> rx_device);
     bool checkECRef(std::shared_ptr<Device> rx_dev,
                     std::shared_ptr<Device> tx_dev);
+    static void buildECRefIndex();
+    int getECRefTxIndex(int tx_dev_id);
     bool isExternalECSupported(std::shared_ptr<Device> tx_dev);
     bool isExternalECRefEnabled(int rx_dev_id);
     void disableInternalECRefs(Stream *s);
@@ -826,6 +869,7 @@ public:
     static void process_config_voice(struct xml_userdata *data, const XML_Char *tag_name);
     static void process_config_volume(struct xml_userdata *data, const XML_Char *tag_name);
     static void process_config_lpm(struct xml_userdata *data, const XML_Char *tag_name);
+    static void process_config_ramp(struct xml_userdata *data, const XML_Char *tag_name);
     static void process_lpi_vote_streams(struct xml_userdata *data, const XML_Char *tag_name);
     static void process_kvinfo(const XML_Char **attr, bool overwrite);
     static void process_voicemode_info(const XML_Char **attr);
@@ -850,6 +894,7 @@ public:
     static int setUpdDedicatedBeEnableParam(struct str_parms *parms,char *value, int len);
     static int setDualMonoEnableParam(struct str_parms *parms,char *value, int len);
     static int setSignalHandlerEnableParam(struct str_parms *parms,char *value, int len);
+    static int setXrunRecoveryParam(struct str_parms *parms,char *value, int len);
     static bool isLpiLoggingEnabled();
     static void processConfigParams(const XML_Char **attr);
     static bool isValidDevId(int deviceId);
@@ -893,6 +938,7 @@ public:
     int getPalValueFromGKV(pal_key_vector_t *gkv, int key);
     pal_speaker_rotation_type getCurrentRotationType();
     void ssrHandler(card_status_t state);
+    void getSsrRecoveryStats(std::vector<struct ssr_recovery_stat> &stats);
     int32_t getSidetoneMode(pal_device_id_t deviceId, pal_stream_type_t type,
                             sidetone_mode_t *mode);
     int getStreamInstanceID(Stream *str);
@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the
+ * disclaimer below) provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *     * Neither the name of Qualcomm Innovation Center, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+ * GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+ * HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define LOG_TAG "PAL: BufferPolicy"
+
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include "BufferPolicy.h"
+#include "PalCommon.h"
+
+std::shared_ptr<BufferPolicy> BufferPolicy::instance = nullptr;
+
+BufferPolicy::BufferPolicy()
+    : mScreenOn(true), mCharging(false)
+{
+}
+
+std::shared_ptr<BufferPolicy> BufferPolicy::getInstance()
+{
+    static std::once_flag once;
+
+    std::call_once(once, [] {
+        instance = std::shared_ptr<BufferPolicy>(new BufferPolicy());
+    });
+    return instance;
+}
+
+void BufferPolicy::addEntry(const XML_Char **attr)
+{
+    struct buffer_policy_entry entry = {};
+    bool typeFound = false;
+
+    entry.device = PAL_DEVICE_NONE;
+    entry.power = BUFFER_POWER_ANY;
+
+    for (int i = 0; attr[i] && attr[i + 1]; i += 2) {
+        if (!strcmp(attr[i], "stream_type")) {
+            auto it = usecaseIdLUT.find(attr[i + 1]);
+            if (it == usecaseIdLUT.end()) {
+                PAL_ERR(LOG_TAG, "unknown stream type %s", attr[i + 1]);
+                return;
+            }
+            entry.type = (pal_stream_type_t)it->second;
+            typeFound = true;
+        } else if (!strcmp(attr[i], "device")) {
+            auto it = deviceIdLUT.find(attr[i + 1]);
+            if (it == deviceIdLUT.end()) {
+                PAL_ERR(LOG_TAG, "unknown device %s", attr[i + 1]);
+                return;
+            }
+            entry.device = it->second;
+        } else if (!strcmp(attr[i], "power_state")) {
+            if (!strcmp(attr[i + 1], "screen_on")) {
+                entry.power = BUFFER_POWER_SCREEN_ON;
+            } else if (!strcmp(attr[i + 1], "screen_off")) {
+                entry.power = BUFFER_POWER_SCREEN_OFF;
+            } else if (!strcmp(attr[i + 1], "charging")) {
+                entry.power = BUFFER_POWER_CHARGING;
+            } else if (strcmp(attr[i + 1], "any")) {
+                PAL_ERR(LOG_TAG, "unknown power state %s", attr[i + 1]);
+                return;
+            }
+        } else if (!strcmp(attr[i], "period_ms")) {
+            entry.periodMs = atoi(attr[i + 1]);
+        } else if (!strcmp(attr[i], "period_count")) {
+            entry.periodCount = atoi(attr[i + 1]);
+        } else if (!strcmp(attr[i], "max_period_count")) {
+            entry.maxPeriodCount = atoi(attr[i + 1]);
+        }
+    }
+
+    if (!typeFound || (!entry.periodMs && !entry.periodCount)) {
+        PAL_ERR(LOG_TAG, "incomplete buffer policy entry, ignored");
+        return;
+    }
+    if (entry.maxPeriodCount < entry.periodCount)
+        entry.maxPeriodCount = entry.periodCount;
+
+    PAL_DBG(LOG_TAG, "stream %d device %d power %d: %u ms x %u (max %u)",
+            entry.type, entry.device, entry.power, entry.periodMs,
+            entry.periodCount, entry.maxPeriodCount);
+
+    std::lock_guard<std::mutex> lck(mLock);
+    mEntries.push_back(entry);
+}
+
+void BufferPolicy::setScreenState(bool on)
+{
+    std::lock_guard<std::mutex> lck(mLock);
+    mScreenOn = on;
+}
+
+void BufferPolicy::setChargingState(bool charging)
+{
+    std::lock_guard<std::mutex> lck(mLock);
+    mCharging = charging;
+}
+
+/* most specific entry wins: a device match outranks a power state match */
+const struct buffer_policy_entry *BufferPolicy::findEntry_l(pal_stream_type_t type,
+                                                            pal_device_id_t device)
+{
+    const struct buffer_policy_entry *best = nullptr;
+    int bestScore = -1;
+    int score = 0;
+
+    for (auto &entry : mEntries) {
+        if (entry.type != type)
+            continue;
+        if (entry.device != PAL_DEVICE_NONE && entry.device != device)
+            continue;
+        if ((entry.power == BUFFER_POWER_SCREEN_ON && !mScreenOn) ||
+            (entry.power == BUFFER_POWER_SCREEN_OFF && mScreenOn) ||
+            (entry.power == BUFFER_POWER_CHARGING && !mCharging))
+            continue;
+
+        score = (entry.device != PAL_DEVICE_NONE ? 2 : 0) +
+                (entry.power != BUFFER_POWER_ANY ? 1 : 0);
+        if (score > bestScore) {
+            best = &entry;
+            bestScore = score;
+        }
+    }
+
+    return best;
+}
+
+bool BufferPolicy::getBufConfig(pal_stream_type_t type, pal_device_id_t device,
+                                const struct pal_media_config *config, bool clientSized,
+                                size_t *bufSize, size_t *bufCount)
+{
+    const struct buffer_policy_entry *entry = nullptr;
+    uint32_t frameSize = 0;
+    uint32_t count = 0;
+
+    if (!config || !bufSize || !bufCount)
+        return false;
+
+    std::lock_guard<std::mutex> lck(mLock);
+    entry = findEntry_l(type, device);
+    if (!entry)
+        return false;
+
+    frameSize = (config->bit_width / 8) * config->ch_info.channels;
+    if (!clientSized && entry->periodMs && frameSize && config->sample_rate)
+        *bufSize = (size_t)config->sample_rate * entry->periodMs / 1000 * frameSize;
+
+    if (entry->periodCount) {
+        count = entry->periodCount;
+        auto it = mAdapt.find(std::make_pair(type, device));
+        if (it != mAdapt.end())
+            count += it->second.extraCount;
+        if (count > entry->maxPeriodCount)
+            count = entry->maxPeriodCount;
+        *bufCount = count;
+    }
+
+    PAL_VERBOSE(LOG_TAG, "stream %d device %d: %zu bytes x %zu", type, device,
+                *bufSize, *bufCount);
+    return true;
+}
+
+void BufferPolicy::reportUnderruns(pal_stream_type_t type, pal_device_id_t device,
+                                   uint32_t count)
+{
+    const struct buffer_policy_entry *entry = nullptr;
+
+    if (!count)
+        return;
+
+    std::lock_guard<std::mutex> lck(mLock);
+    entry = findEntry_l(type, device);
+    if (!entry || !entry->periodCount)
+        return;
+
+    struct buffer_policy_adapt &adapt = mAdapt[std::make_pair(type, device)];
+    adapt.cleanSessions = 0;
+    if (entry->periodCount + adapt.extraCount < entry->maxPeriodCount) {
+        adapt.extraCount++;
+        PAL_INFO(LOG_TAG, "stream %d device %d: %u underruns, period count now %u",
+                 type, device, count, entry->periodCount + adapt.extraCount);
+    }
+}
+
+void BufferPolicy::reportCleanSession(pal_stream_type_t type, pal_device_id_t device)
+{
+    std::lock_guard<std::mutex> lck(mLock);
+    auto it = mAdapt.find(std::make_pair(type, device));
+
+    if (it == mAdapt.end() || !it->second.extraCount)
+        return;
+
+    if (++it->second.cleanSessions >= BUFFER_POLICY_DECAY_SESSIONS) {
+        it->second.extraCount--;
+        it->second.cleanSessions = 0;
+        PAL_DBG(LOG_TAG, "stream %d device %d: period count bump decayed to %u",
+                type, device, it->second.extraCount);
+    }
+}
@@ -0,0 +1,360 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the
+ * disclaimer below) provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *     * Neither the name of Qualcomm Innovation Center, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+ * GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+ * HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define LOG_TAG "PAL: EventDispatcher"
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include "EventDispatcher.h"
+#include "PalCommon.h"
+
+static uint64_t monotonicNs()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+EventDispatcher::EventDispatcher()
+    : mTable(std::make_shared<const subscriber_table>()), mExit(true)
+{
+}
+
+EventDispatcher::~EventDispatcher()
+{
+    stop();
+}
+
+void EventDispatcher::start()
+{
+    std::lock_guard<std::mutex> lck(mRunLock);
+
+    if (!mExit)
+        return;
+
+    mExit = false;
+    for (int i = 0; i < EVENT_DISPATCH_WORKERS; i++)
+        mWorkers.push_back(std::thread(&EventDispatcher::workerLoop, this));
+}
+
+void EventDispatcher::stop()
+{
+    std::vector<std::thread> workers;
+
+    {
+        std::lock_guard<std::mutex> lck(mRunLock);
+
+        if (mExit)
+            return;
+        mExit = true;
+        workers.swap(mWorkers);
+    }
+    mRunCV.notify_all();
+
+    for (auto &worker : workers) {
+        if (worker.joinable())
+            worker.join();
+    }
+    PAL_DBG(LOG_TAG, "event workers stopped");
+}
+
+int EventDispatcher::subscribe(int id, event_dispatch_cb cb, uint64_t cookie)
+{
+    std::shared_ptr<struct subscriber> sub = nullptr;
+    std::shared_ptr<struct subscriber> old = nullptr;
+    std::shared_ptr<subscriber_table> table = nullptr;
+
+    if (!cb)
+        return -EINVAL;
+
+    sub = std::make_shared<struct subscriber>();
+    sub->id = id;
+    sub->cb = cb;
+    sub->cookie = cookie;
+    sub->active = true;
+    sub->pending = false;
+    sub->delivered = 0;
+    sub->dropped = 0;
+    sub->totalLatencyNs = 0;
+    sub->maxLatencyNs = 0;
+
+    {
+        std::lock_guard<std::mutex> lck(mTableWriteLock);
+
+        for (auto it = mLanes.begin(); it != mLanes.end();) {
+            if (it->second.expired())
+                it = mLanes.erase(it);
+            else
+                ++it;
+        }
+        sub->lane = mLanes[cookie].lock();
+        if (!sub->lane) {
+            sub->lane = std::make_shared<struct lane>();
+            sub->lane->scheduled = false;
+            mLanes[cookie] = sub->lane;
+        }
+
+        table = std::make_shared<subscriber_table>(*std::atomic_load(&mTable));
+        auto it = table->find(id);
+        if (it != table->end()) {
+            PAL_DBG(LOG_TAG, "callback exists for id %d, overwrite", id);
+            old = it->second;
+        }
+        (*table)[id] = sub;
+        std::atomic_store(&mTable, std::shared_ptr<const subscriber_table>(table));
+    }
+
+    if (old)
+        retire(old);
+
+    return 0;
+}
+
+int EventDispatcher::unsubscribe(int id, event_dispatch_cb cb)
+{
+    std::shared_ptr<struct subscriber> sub = nullptr;
+    std::shared_ptr<subscriber_table> table = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lck(mTableWriteLock);
+        auto cur = std::atomic_load(&mTable);
+        auto it = cur->find(id);
+
+        if (it == cur->end()) {
+            PAL_ERR(LOG_TAG, "No callback found for id %d", id);
+            return -ENOENT;
+        }
+        if (it->second->cb != cb) {
+            PAL_ERR(LOG_TAG, "No matching callback found for id %d", id);
+            return -EINVAL;
+        }
+        sub = it->second;
+
+        table = std::make_shared<subscriber_table>(*cur);
+        table->erase(id);
+        std::atomic_store(&mTable, std::shared_ptr<const subscriber_table>(table));
+    }
+
+    retire(sub);
+
+    return 0;
+}
+
+/*
+ * Stops delivery to a subscriber that is no longer in the table. Events
+ * still queued are for a session that is going away. A callback already
+ * running is left to return, see waitIdle().
+ */
+void EventDispatcher::retire(std::shared_ptr<struct subscriber> sub)
+{
+    std::shared_ptr<struct lane> lane = sub->lane;
+
+    {
+        std::lock_guard<std::mutex> lck(lane->lock);
+
+        sub->active = false;
+        sub->dropped += sub->events.size();
+        sub->events.clear();
+        logStats(*sub);
+    }
+    /* a dispatch waiting for room in the queue gives up */
+    lane->space.notify_all();
+}
+
+void EventDispatcher::waitIdle(uint64_t cookie)
+{
+    std::shared_ptr<struct lane> lane = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lck(mTableWriteLock);
+        auto it = mLanes.find(cookie);
+
+        if (it != mLanes.end())
+            lane = it->second.lock();
+    }
+    /* no lane left means no worker holds one for this cookie */
+    if (!lane)
+        return;
+
+    std::unique_lock<std::mutex> lck(lane->lock);
+    if (lane->runner == std::this_thread::get_id())
+        return;
+    lane->idle.wait(lck, [&lane] { return lane->runner == std::thread::id(); });
+}
+
+/* called on the mixer event thread, copies the payload and returns */
+int EventDispatcher::dispatch(int id, uint32_t eventId, const void *payload,
+                              uint32_t size)
+{
+    std::shared_ptr<const subscriber_table> table = std::atomic_load(&mTable);
+    std::shared_ptr<struct subscriber> sub = nullptr;
+    std::shared_ptr<struct lane> lane = nullptr;
+    struct event ev;
+    bool schedule = false;
+
+    auto it = table->find(id);
+    if (it == table->end())
+        return -ENOENT;
+    sub = it->second;
+    lane = sub->lane;
+
+    ev.eventId = eventId;
+    if (payload && size)
+        ev.payload.assign((const uint8_t *)payload, (const uint8_t *)payload + size);
+    ev.queuedNs = monotonicNs();
+
+    {
+        std::unique_lock<std::mutex> lck(lane->lock);
+
+        /* detection and SSR events must not be lost, wait for the callback */
+        if (sub->active && sub->events.size() >= EVENT_DISPATCH_QUEUE_DEPTH) {
+            PAL_ERR(LOG_TAG, "id %d not keeping up, event %u waits", id, eventId);
+            lane->space.wait(lck, [&sub] {
+                return !sub->active || sub->events.size() < EVENT_DISPATCH_QUEUE_DEPTH;
+            });
+        }
+        if (!sub->active)
+            return -ENOENT;
+        sub->events.push_back(std::move(ev));
+        if (!sub->pending) {
+            sub->pending = true;
+            lane->pending.push_back(sub);
+        }
+        if (!lane->scheduled) {
+            lane->scheduled = true;
+            schedule = true;
+        }
+    }
+
+    if (schedule) {
+        {
+            std::lock_guard<std::mutex> lck(mRunLock);
+            mRunQueue.push_back(lane);
+        }
+        mRunCV.notify_one();
+    }
+
+    return 0;
+}
+
+/* one event per subscriber in turn, so ids of a lane share the worker */
+void EventDispatcher::drain(std::shared_ptr<struct lane> lane)
+{
+    std::shared_ptr<struct subscriber> sub = nullptr;
+    struct event ev;
+    uint64_t latencyNs = 0;
+    std::unique_lock<std::mutex> lck(lane->lock);
+
+    while (!lane->pending.empty()) {
+        sub = lane->pending.front();
+        lane->pending.pop_front();
+        if (!sub->active || sub->events.empty()) {
+            sub->pending = false;
+            continue;
+        }
+
+        ev = std::move(sub->events.front());
+        sub->events.pop_front();
+        lane->space.notify_all();
+        latencyNs = monotonicNs() - ev.queuedNs;
+        sub->delivered++;
+        sub->totalLatencyNs += latencyNs;
+        if (latencyNs > sub->maxLatencyNs)
+            sub->maxLatencyNs = latencyNs;
+        lane->runner = std::this_thread::get_id();
+        lck.unlock();
+
+        sub->cb(sub->cookie, ev.eventId, ev.payload.data(), ev.payload.size());
+
+        lck.lock();
+        lane->runner = std::thread::id();
+        lane->idle.notify_all();
+        if (sub->active && !sub->events.empty())
+            lane->pending.push_back(sub);
+        else
+            sub->pending = false;
+    }
+    lane->scheduled = false;
+}
+
+void EventDispatcher::workerLoop()
+{
+    std::shared_ptr<struct lane> lane = nullptr;
+    std::unique_lock<std::mutex> lck(mRunLock);
+
+    while (1) {
+        mRunCV.wait(lck, [this] { return mExit || !mRunQueue.empty(); });
+        if (mExit)
+            break;
+
+        lane = mRunQueue.front();
+        mRunQueue.pop_front();
+        lck.unlock();
+        drain(lane);
+        lane = nullptr;
+        lck.lock();
+    }
+}
+
+void EventDispatcher::logStats(const struct subscriber &sub)
+{
+    PAL_DBG(LOG_TAG, "id %d: %llu delivered, %llu dropped, latency avg %llu us max %llu us",
+            sub.id, (unsigned long long)sub.delivered,
+            (unsigned long long)sub.dropped,
+            (unsigned long long)(sub.delivered ?
+                sub.totalLatencyNs / sub.delivered / 1000 : 0),
+            (unsigned long long)(sub.maxLatencyNs / 1000));
+}
+
+void EventDispatcher::getStats(std::vector<struct event_dispatch_stat> &stats)
+{
+    std::shared_ptr<const subscriber_table> table = std::atomic_load(&mTable);
+    struct event_dispatch_stat stat;
+
+    stats.clear();
+    for (auto &it : *table) {
+        std::lock_guard<std::mutex> lck(it.second->lane->lock);
+
+        stat.id = it.first;
+        stat.cookie = it.second->cookie;
+        stat.delivered = it.second->delivered;
+        stat.dropped = it.second->dropped;
+        stat.avgLatencyUs = it.second->delivered ?
+                it.second->totalLatencyNs / it.second->delivered / 1000 : 0;
+        stat.maxLatencyUs = it.second->maxLatencyNs / 1000;
+        stats.push_back(stat);
+    }
+}
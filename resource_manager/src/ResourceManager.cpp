@@ -77,6 +77,7 @@
 #include "gsl_intf.h"
 #include "Headphone.h"
 #include "PayloadBuilder.h"
+#include "SessionAlsaUtils.h"
 #include "Bluetooth.h"
 #include "SpeakerMic.h"
 #include "Speaker.h"
@@ -87,12 +88,15 @@
 #include "DisplayPort.h"
 #include "Handset.h"
 #include "SndCardMonitor.h"
+#include "BufferPolicy.h"
 #include "UltrasoundDevice.h"
 #include <agm/agm_api.h>
 #include <cutils/properties.h>
 #include <unistd.h>
 #include <dlfcn.h>
 #include <mutex>
+#include <atomic>
+#include <chrono>
 #include "kvh2xml.h"
 #include <sys/ioctl.h>
 #ifdef EC_REF_CAPTURE_ENABLED
@@ -483,6 +487,7 @@ bool ResourceManager::lpi_logging_ = false;
 bool ResourceManager::isUpdDedicatedBeEnabled = false;
 int ResourceManager::max_voice_vol = -1;     /* Variable to store max volume index for voice call */
 bool ResourceManager::isSignalHandlerEnabled = false;
+uint32_t ResourceManager::xrunRecoveryDefault = PAL_XRUN_RECOVERY_PREPARE;
 bool ResourceManager::a2dp_suspended = false;
 
 //TODO:Needs to define below APIs so that functionality won't break
@@ -500,10 +505,14 @@ void str_parms_destroy(struct str_parms *str_parms){return;}
 
 std::vector<uint32_t> ResourceManager::lpi_vote_streams_;
 std::vector<deviceIn> ResourceManager::deviceInfo;
+std::set<std::pair<int, int>> ResourceManager::ecRefPairs;
+std::map<int, std::vector<int>> ResourceManager::ecRefTxDevs;
+std::map<int, int> ResourceManager::ecRefTxIndex;
 std::vector<tx_ecinfo> ResourceManager::txEcInfo;
 struct vsid_info ResourceManager::vsidInfo;
 struct volume_set_param_info ResourceManager::volumeSetParamInfo_;
 struct disable_lpm_info ResourceManager::disableLpmInfo_;
+struct ramp_period_info ResourceManager::rampPeriodInfo_ = {VOLUME_RAMP_PERIOD, MUTE_RAMP_PERIOD};
 std::vector<struct pal_amp_db_and_gain_table> ResourceManager::gainLvlMap;
 std::map<std::pair<uint32_t, std::string>, std::string> ResourceManager::btCodecMap;
 std::map<int, std::string> ResourceManager::spkrTempCtrlsMap;
@@ -872,6 +881,9 @@ ResourceManager::~ResourceManager()
     listAllPcmExtEcTxFrontEnds.clear();
     devInfo.clear();
     deviceInfo.clear();
+    ecRefPairs.clear();
+    ecRefTxDevs.clear();
+    ecRefTxIndex.clear();
     txEcInfo.clear();
 
     STInstancesLists.clear();
@@ -1115,26 +1127,7 @@ void ResourceManager::ssrHandlingLoop(std::shared_ptr<ResourceManager> rm)
                 }
 
                 SoundTriggerCaptureProfile = GetCaptureProfileByPriority(nullptr);
-                for (auto str: rm->mActiveStreams) {
-                    lockValidStreamMutex();
-                    ret = increaseStreamUserCounter(str);
-                    unlockValidStreamMutex();
-                    if (0 != ret) {
-                        PAL_ERR(LOG_TAG, "Error incrementing the stream counter for the stream handle: %pK", str);
-                        continue;
-                    }
-                    ret = str->ssrUpHandler();
-                    if (0 != ret) {
-                        PAL_ERR(LOG_TAG, "Ssr up handling failed for %pK ret %d",
-                                          str, ret);
-                    }
-                    lockValidStreamMutex();
-                    ret = decreaseStreamUserCounter(str);
-                    unlockValidStreamMutex();
-                    if (0 != ret) {
-                        PAL_ERR(LOG_TAG, "Error decrementing the stream counter for the stream handle: %pK", str);
-                    }
-                }
+                ssrRecoverStreams();
                 prevState = state;
             } else {
                 PAL_ERR(LOG_TAG, "Invalid state. state %d", state);
@@ -1146,6 +1139,194 @@ void ResourceManager::ssrHandlingLoop(std::shared_ptr<ResourceManager> rm)
     PAL_INFO(LOG_TAG, "ssr Handling thread ended");
 }
 
+bool ResourceManager::isSsrPriorityStream(pal_stream_type_t type)
+{
+    return (type == PAL_STREAM_VOICE_CALL ||
+            type == PAL_STREAM_VOIP ||
+            type == PAL_STREAM_VOIP_RX ||
+            type == PAL_STREAM_VOIP_TX ||
+            type == PAL_STREAM_VOICE_CALL_RECORD ||
+            type == PAL_STREAM_VOICE_CALL_MUSIC);
+}
+
+/*
+ * Restores the streams of one group in order. Each stream is restored with
+ * mActiveStreamMutex held, as ssrUpHandler() expects; handlers drop it
+ * around start(), which is where restores of other groups overlap.
+ */
+void ResourceManager::ssrRecoverGroup(std::vector<Stream*> *group, uint32_t groupId)
+{
+    int32_t ret = 0;
+    struct ssr_recovery_stat stat;
+    std::chrono::steady_clock::time_point begin;
+
+    for (auto str: *group) {
+        stat.stream = str;
+        stat.group = groupId;
+        stat.type = PAL_STREAM_GENERIC;
+        str->getStreamType(&stat.type);
+
+        begin = std::chrono::steady_clock::now();
+        mActiveStreamMutex.lock();
+        stat.status = str->ssrUpHandler();
+        mActiveStreamMutex.unlock();
+        stat.recoveryTimeUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - begin).count();
+
+        if (0 != stat.status) {
+            PAL_ERR(LOG_TAG, "Ssr up handling failed for %pK ret %d",
+                              str, stat.status);
+        }
+        PAL_INFO(LOG_TAG, "stream %pK type %d group %u restored in %llu us",
+                 str, stat.type, groupId, (unsigned long long)stat.recoveryTimeUs);
+        {
+            std::lock_guard<std::mutex> lck(mSsrRecoveryStatsMutex);
+            mSsrRecoveryStats.push_back(stat);
+        }
+
+        lockValidStreamMutex();
+        ret = decreaseStreamUserCounter(str);
+        unlockValidStreamMutex();
+        if (0 != ret) {
+            PAL_ERR(LOG_TAG, "Error decrementing the stream counter for the stream handle: %pK", str);
+        }
+    }
+}
+
+/*
+ * Plans and runs stream recovery on SSR online. Streams that share a
+ * backend end up in the same group and are restored one after another;
+ * LPI streams (voice UI, ACD, sensor, context proxy) share the capture
+ * engine and form a single group. Groups carrying voice or VoIP streams
+ * are restored first, then the remaining groups, each pass on up to
+ * SSR_RECOVERY_MAX_WORKERS threads. Called with mActiveStreamMutex held.
+ */
+void ResourceManager::ssrRecoverStreams()
+{
+    int32_t ret = 0;
+    pal_stream_type_t type;
+    std::string beName;
+    std::vector<struct pal_device> palDevices;
+    std::vector<std::vector<Stream*>> groups;
+    std::map<std::string, size_t> beGroup;
+    std::vector<size_t> matched;
+    std::vector<size_t> passes[2];
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    size_t target = 0;
+    const std::string lpiKey = "lpi";
+
+    {
+        std::lock_guard<std::mutex> lck(mSsrRecoveryStatsMutex);
+        mSsrRecoveryStats.clear();
+    }
+
+    for (auto str: mActiveStreams) {
+        lockValidStreamMutex();
+        ret = increaseStreamUserCounter(str);
+        unlockValidStreamMutex();
+        if (0 != ret) {
+            PAL_ERR(LOG_TAG, "Error incrementing the stream counter for the stream handle: %pK", str);
+            continue;
+        }
+
+        type = PAL_STREAM_GENERIC;
+        str->getStreamType(&type);
+        matched.clear();
+        palDevices.clear();
+        if (type == PAL_STREAM_VOICE_UI || type == PAL_STREAM_ACD ||
+            type == PAL_STREAM_SENSOR_PCM_DATA || type == PAL_STREAM_CONTEXT_PROXY) {
+            if (beGroup.count(lpiKey))
+                matched.push_back(beGroup[lpiKey]);
+        } else {
+            str->getAssociatedPalDevices(palDevices);
+            for (auto &dev: palDevices) {
+                if (getBackendName(dev.id, beName) || !beGroup.count(beName))
+                    continue;
+                if (std::find(matched.begin(), matched.end(), beGroup[beName]) ==
+                        matched.end())
+                    matched.push_back(beGroup[beName]);
+            }
+        }
+
+        if (matched.empty()) {
+            target = groups.size();
+            groups.emplace_back();
+        } else {
+            /* the stream bridges several groups, fold them into one */
+            target = *std::min_element(matched.begin(), matched.end());
+            for (auto idx: matched) {
+                if (idx == target)
+                    continue;
+                groups[target].insert(groups[target].end(),
+                                      groups[idx].begin(), groups[idx].end());
+                groups[idx].clear();
+                for (auto &be: beGroup) {
+                    if (be.second == idx)
+                        be.second = target;
+                }
+            }
+        }
+        groups[target].push_back(str);
+
+        if (type == PAL_STREAM_VOICE_UI || type == PAL_STREAM_ACD ||
+            type == PAL_STREAM_SENSOR_PCM_DATA || type == PAL_STREAM_CONTEXT_PROXY) {
+            beGroup[lpiKey] = target;
+        } else {
+            for (auto &dev: palDevices) {
+                if (!getBackendName(dev.id, beName))
+                    beGroup[beName] = target;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < groups.size(); i++) {
+        if (groups[i].empty())
+            continue;
+        /* voice and VoIP streams go first within their group as well */
+        auto first = std::stable_partition(groups[i].begin(), groups[i].end(),
+                [](Stream *s) {
+                    pal_stream_type_t t = PAL_STREAM_GENERIC;
+                    s->getStreamType(&t);
+                    return isSsrPriorityStream(t);
+                });
+        passes[first == groups[i].begin() ? 1 : 0].push_back(i);
+    }
+
+    PAL_INFO(LOG_TAG, "restoring %zu priority and %zu other stream groups",
+             passes[0].size(), passes[1].size());
+
+    mActiveStreamMutex.unlock();
+    for (auto &pass: passes) {
+        std::atomic<size_t> next(0);
+        std::vector<std::thread> workers;
+        auto worker = [&]() {
+            size_t n;
+
+            while ((n = next++) < pass.size())
+                ssrRecoverGroup(&groups[pass[n]], pass[n]);
+        };
+
+        for (size_t i = 1; i < std::min(pass.size(), (size_t)SSR_RECOVERY_MAX_WORKERS); i++)
+            workers.emplace_back(worker);
+        worker();
+        for (auto &t: workers)
+            t.join();
+    }
+    mActiveStreamMutex.lock();
+
+    PAL_INFO(LOG_TAG, "ssr recovery of %zu streams took %lld us",
+             mSsrRecoveryStats.size(),
+             (long long)std::chrono::duration_cast<std::chrono::microseconds>(
+                     std::chrono::steady_clock::now() - begin).count());
+}
+
+void ResourceManager::getSsrRecoveryStats(std::vector<struct ssr_recovery_stat> &stats)
+{
+    std::lock_guard<std::mutex> lck(mSsrRecoveryStatsMutex);
+
+    stats = mSsrRecoveryStats;
+}
+
 int ResourceManager::initSndMonitor()
 {
     int ret = 0;
@@ -1343,6 +1524,9 @@ int ResourceManager::init()
     // Initialize Speaker Protection calibration mode
     struct pal_device dattr;
 
+    buildECRefIndex();
+    if (rm)
+        rm->mixerEventDispatcher.start();
     mixerEventTread = std::thread(mixerEventWaitThreadLoop, rm);
 
     //Initialize audio_charger_listener
@@ -3098,12 +3282,16 @@ int ResourceManager::registerDevice_l(std::shared_ptr<Device> d, Stream *s)
 {
     int ret = 0;
     PAL_DBG(LOG_TAG, "Enter.");
+    int deviceId = d->getSndDeviceId();
     auto iter = std::find(active_devices.begin(),
         active_devices.end(), std::make_pair(d, s));
-    if (iter == active_devices.end())
+    if (iter == active_devices.end()) {
         active_devices.push_back(std::make_pair(d, s));
-    else
+        if (deviceId > PAL_DEVICE_IN_MIN && deviceId < PAL_DEVICE_IN_MAX)
+            active_tx_devices[deviceId].push_back(std::make_pair(d, s));
+    } else {
         ret = -EINVAL;
+    }
     PAL_DBG(LOG_TAG, "Exit.");
     return ret;
 }
@@ -3299,11 +3487,20 @@ int ResourceManager::deregisterDevice_l(std::shared_ptr<Device> d, Stream *s)
     int ret = 0;
     PAL_VERBOSE(LOG_TAG, "Enter.");
 
+    int deviceId = d->getSndDeviceId();
     auto iter = std::find(active_devices.begin(),
         active_devices.end(), std::make_pair(d, s));
-    if (iter != active_devices.end())
+    if (iter != active_devices.end()) {
         active_devices.erase(iter);
-    else {
+        auto tx_iter = active_tx_devices.find(deviceId);
+        if (tx_iter != active_tx_devices.end()) {
+            auto &tx_list = tx_iter->second;
+            tx_list.erase(std::remove(tx_list.begin(), tx_list.end(),
+                std::make_pair(d, s)), tx_list.end());
+            if (tx_list.empty())
+                active_tx_devices.erase(tx_iter);
+        }
+    } else {
         ret = -ENOENT;
         PAL_ERR(LOG_TAG, "no device %d found in active device list ret %d",
                 d->getSndDeviceId(), ret);
@@ -4088,7 +4285,6 @@ int ResourceManager::registerMixerEventCallback(const std::vector<int> &DevIds,
                                                 uint64_t cookie,
                                                 bool is_register) {
     int status = 0;
-    std::map<int, std::pair<session_callback, uint64_t>>::iterator it;
 
     if (!callback || DevIds.size() <= 0) {
         PAL_ERR(LOG_TAG, "Invalid callback or pcm ids");
@@ -4102,42 +4298,36 @@ int ResourceManager::registerMixerEventCallback(const std::vector<int> &DevIds,
         return -EINVAL;
     }
 
-    if (is_register) {
-        for (int i = 0; i < DevIds.size(); i++) {
-            it = mixerEventCallbackMap.find(DevIds[i]);
-            if (it != mixerEventCallbackMap.end()) {
-                PAL_DBG(LOG_TAG, "callback exists for pcm id %d, overwrite",
-                    DevIds[i]);
-                mixerEventCallbackMap.erase(it);
-            }
-            mixerEventCallbackMap.insert(std::make_pair(DevIds[i],
-                std::make_pair(callback, cookie)));
-
-        }
+    if (is_register)
         mixerEventRegisterCount++;
+    else
+        mixerEventRegisterCount--;
+    mResourceManagerMutex.unlock();
+
+    /* the dispatcher takes its own locks, keep them out of this one */
+    if (is_register) {
+        for (int i = 0; i < DevIds.size(); i++)
+            mixerEventDispatcher.subscribe(DevIds[i], callback, cookie);
     } else {
         for (int i = 0; i < DevIds.size(); i++) {
-            it = mixerEventCallbackMap.find(DevIds[i]);
-            if (it != mixerEventCallbackMap.end()) {
-                PAL_DBG(LOG_TAG, "callback found for pcm id %d, remove",
-                    DevIds[i]);
-                if (callback == it->second.first) {
-                    mixerEventCallbackMap.erase(it);
-                } else {
-                    PAL_ERR(LOG_TAG, "No matching callback found for pcm id %d",
-                        DevIds[i]);
-                }
-            } else {
-                PAL_ERR(LOG_TAG, "No callback found for pcm id %d", DevIds[i]);
-            }
+            PAL_DBG(LOG_TAG, "remove callback for pcm id %d", DevIds[i]);
+            mixerEventDispatcher.unsubscribe(DevIds[i], callback);
         }
-        mixerEventRegisterCount--;
     }
 
-    mResourceManagerMutex.unlock();
     return status;
 }
 
+/*
+ * Deregistering does not wait for a callback that is already running, the
+ * caller may hold locks it takes. The cookie owner waits here before it is
+ * destroyed.
+ */
+void ResourceManager::waitMixerEventCallbacks(uint64_t cookie)
+{
+    mixerEventDispatcher.waitIdle(cookie);
+}
+
 void ResourceManager::mixerEventWaitThreadLoop(
     std::shared_ptr<ResourceManager> rm) {
     int ret = 0;
@@ -4185,8 +4375,6 @@ void ResourceManager::mixerEventWaitThreadLoop(
 int ResourceManager::handleMixerEvent(struct mixer *mixer, char *mixer_str) {
     int status = 0;
     int pcm_id = 0;
-    uint64_t cookie = 0;
-    session_callback session_cb = nullptr;
     std::string event_str(mixer_str);
     // TODO: hard code in common defs
     std::string pcm_prefix = "PCM";
@@ -4199,7 +4387,6 @@ int ResourceManager::handleMixerEvent(struct mixer *mixer, char *mixer_str) {
     char *buf = nullptr;
     unsigned int num_values;
     struct agm_event_cb_params *params = nullptr;
-    std::map<int, std::pair<session_callback, uint64_t>>::iterator it;
 
     PAL_DBG(LOG_TAG, "Enter");
     ctl = mixer_get_ctl_by_name(mixer, mixer_str);
@@ -4260,23 +4447,14 @@ int ResourceManager::handleMixerEvent(struct mixer *mixer, char *mixer_str) {
     length = suffix_idx - prefix_idx;
     pcm_id = std::stoi(event_str.substr(prefix_idx, length));
 
-    // acquire callback/cookie with pcm dev id
-    it = mixerEventCallbackMap.find(pcm_id);
-    if (it != mixerEventCallbackMap.end()) {
-        session_cb = it->second.first;
-        cookie = it->second.second;
-    }
-
-    if (!session_cb) {
-        status = -EINVAL;
+    // queue for the callback registered with pcm dev id
+    status = mixerEventDispatcher.dispatch(pcm_id, params->event_id,
+                 (void *)params->event_payload, params->event_payload_size);
+    if (status) {
         PAL_ERR(LOG_TAG, "Invalid session callback");
         goto exit;
     }
 
-    // callback
-    session_cb(cookie, params->event_id, (void *)params->event_payload,
-                 params->event_payload_size);
-
 exit:
     if (buf)
         free(buf);
@@ -4733,13 +4911,11 @@ std::vector<Stream*> ResourceManager::getConcurrentTxStream_l(
     Stream *rx_str,
     std::shared_ptr<Device> rx_device)
 {
-    int deviceId = 0;
     int status = 0;
     std::vector<Stream*> tx_stream_list;
     struct pal_stream_attributes tx_attr;
     struct pal_stream_attributes rx_attr;
-    std::shared_ptr<Device> tx_device = nullptr;
-    std::vector <std::shared_ptr<Device>> tx_device_list;
+    std::map<int, std::vector<int>>::iterator tx_dev_ids;
 
     // check stream direction
     status = rx_str->getStreamAttributes(&rx_attr);
@@ -4754,35 +4930,42 @@ std::vector<Stream*> ResourceManager::getConcurrentTxStream_l(
         goto exit;
     }
 
-    for (auto& tx_str: mActiveStreams) {
-        tx_device_list.clear();
-        tx_str->getStreamAttributes(&tx_attr);
-        if (tx_attr.type == PAL_STREAM_PROXY ||
-            tx_attr.type == PAL_STREAM_ULTRA_LOW_LATENCY ||
-            tx_attr.type == PAL_STREAM_GENERIC)
+    if (!rx_device)
+        goto exit;
+
+    /*
+     * Only capture devices that take rx_device as ec ref can be affected,
+     * so walk the streams registered on those instead of every active one.
+     */
+    tx_dev_ids = ecRefTxDevs.find(rx_device->getSndDeviceId());
+    if (tx_dev_ids == ecRefTxDevs.end())
+        goto exit;
+
+    for (auto tx_dev_id: tx_dev_ids->second) {
+        auto active_iter = active_tx_devices.find(tx_dev_id);
+        if (active_iter == active_tx_devices.end())
             continue;
-        if (tx_attr.direction == PAL_AUDIO_INPUT) {
+        for (auto& active: active_iter->second) {
+            Stream *tx_str = active.second;
+
+            if (std::find(tx_stream_list.begin(), tx_stream_list.end(),
+                    tx_str) != tx_stream_list.end() ||
+                !isStreamActive(tx_str, mActiveStreams))
+                continue;
+            tx_str->getStreamAttributes(&tx_attr);
+            if (tx_attr.type == PAL_STREAM_PROXY ||
+                tx_attr.type == PAL_STREAM_ULTRA_LOW_LATENCY ||
+                tx_attr.type == PAL_STREAM_GENERIC ||
+                tx_attr.direction != PAL_AUDIO_INPUT)
+                continue;
             if (!getEcRefStatus(tx_attr.type, rx_attr.type)) {
                 PAL_DBG(LOG_TAG, "No need to enable ec ref for rx %d tx %d",
                         rx_attr.type, tx_attr.type);
                 continue;
             }
-            tx_str->getAssociatedDevices(tx_device_list);
-            for (int i = 0; i < tx_device_list.size(); i++) {
-                if (!isDeviceActive_l(tx_device_list[i], tx_str))
-                    continue;
-                deviceId = tx_device_list[i]->getSndDeviceId();
-                if (deviceId > PAL_DEVICE_IN_MIN &&
-                    deviceId < PAL_DEVICE_IN_MAX)
-                    tx_device = tx_device_list[i];
-                else
-                    tx_device = nullptr;
-
-                if (checkECRef(rx_device, tx_device)) {
-                    tx_stream_list.push_back(tx_str);
-                    break;
-                }
-            }
+            PAL_DBG(LOG_TAG, "EC Ref: 1, rx dev: %d, tx dev: %d",
+                    rx_device->getSndDeviceId(), tx_dev_id);
+            tx_stream_list.push_back(tx_str);
         }
     }
 exit:
@@ -4802,6 +4985,34 @@ std::vector<Stream*> ResourceManager::getConcurrentTxStream(
     return tx_stream_list;
 }
 
+/*
+ * Built once by init() after the resource XML is parsed, before any stream
+ * exists, the lookups then only read it and need no lock.
+ */
+void ResourceManager::buildECRefIndex()
+{
+    ecRefPairs.clear();
+    ecRefTxDevs.clear();
+    ecRefTxIndex.clear();
+    for (int i = 0; i < deviceInfo.size(); i++) {
+        /* lookups used to stop at the first entry of a tx device */
+        ecRefTxIndex.insert({deviceInfo[i].deviceId, i});
+        for (auto rx_dev_id: deviceInfo[i].rx_dev_ids) {
+            if (ecRefPairs.insert({deviceInfo[i].deviceId, rx_dev_id}).second)
+                ecRefTxDevs[rx_dev_id].push_back(deviceInfo[i].deviceId);
+        }
+    }
+    PAL_DBG(LOG_TAG, "%zu ec ref pairs for %zu rx devices",
+            ecRefPairs.size(), ecRefTxDevs.size());
+}
+
+int ResourceManager::getECRefTxIndex(int tx_dev_id)
+{
+    auto iter = ecRefTxIndex.find(tx_dev_id);
+
+    return iter == ecRefTxIndex.end() ? -1 : iter->second;
+}
+
 bool ResourceManager::checkECRef(std::shared_ptr<Device> rx_dev,
                                  std::shared_ptr<Device> tx_dev)
 {
@@ -4815,18 +5026,7 @@ bool ResourceManager::checkECRef(std::shared_ptr<Device> rx_dev,
     rx_dev_id = rx_dev->getSndDeviceId();
     tx_dev_id = tx_dev->getSndDeviceId();
 
-    for (int i = 0; i < deviceInfo.size(); i++) {
-        if (tx_dev_id == deviceInfo[i].deviceId) {
-            for (int j = 0; j < deviceInfo[i].rx_dev_ids.size(); j++) {
-                if (rx_dev_id == deviceInfo[i].rx_dev_ids[j]) {
-                    result = true;
-                    break;
-                }
-            }
-        }
-        if (result)
-            break;
-    }
+    result = ecRefPairs.count({tx_dev_id, rx_dev_id}) != 0;
 
     PAL_DBG(LOG_TAG, "EC Ref: %d, rx dev: %d, tx dev: %d",
         result, rx_dev_id, tx_dev_id);
@@ -4863,13 +5063,8 @@ int ResourceManager::updateECDeviceMap(std::shared_ptr<Device> rx_dev,
     }
 
     tx_dev_id = tx_dev->getSndDeviceId();
-    for (i = 0; i < deviceInfo.size(); i++) {
-        if (tx_dev_id == deviceInfo[i].deviceId) {
-            break;
-        }
-    }
-
-    if (i == deviceInfo.size()) {
+    i = getECRefTxIndex(tx_dev_id);
+    if (i < 0) {
         PAL_ERR(LOG_TAG, "Tx device %d not found", tx_dev_id);
         return -EINVAL;
     }
@@ -5706,6 +5901,7 @@ void ResourceManager::deinit()
     card_status_t state = CARD_STATUS_NONE;
 
     mixerClosed = true;
+    SessionAlsaUtils::clearMixerControlCache();
     mixer_close(audio_virt_mixer);
     mixer_close(audio_hw_mixer);
     if (audio_route) {
@@ -5714,6 +5910,8 @@ void ResourceManager::deinit()
     if (mixerEventTread.joinable()) {
         mixerEventTread.join();
     }
+    if (rm)
+        rm->mixerEventDispatcher.stop();
     PAL_DBG(LOG_TAG, "Mixer event thread joined");
     if (sndmon)
         delete sndmon;
@@ -7198,6 +7396,7 @@ int ResourceManager::setConfigParams(struct str_parms *parms)
     ret = setUpdDedicatedBeEnableParam(parms, value, len);
     ret = setDualMonoEnableParam(parms, value, len);
     ret = setSignalHandlerEnableParam(parms, value, len);
+    ret = setXrunRecoveryParam(parms, value, len);
 
     /* Not checking return value as this is optional */
     setLpiLoggingParams(parms, value, len);
@@ -7340,6 +7539,40 @@ int ResourceManager::setSignalHandlerEnableParam(struct str_parms *parms,
     return ret;
 }
 
+/* value is a comma separated list of "prepare", "silence" and "notify" */
+int ResourceManager::setXrunRecoveryParam(struct str_parms *parms,
+                                 char *value, int len)
+{
+    int ret = -EINVAL;
+    char *tok = NULL;
+    char *savePtr = NULL;
+    uint32_t recovery = PAL_XRUN_RECOVERY_PREPARE;
+
+    if (!value || !parms)
+        return ret;
+
+    ret = str_parms_get_str(parms, AUDIO_PARAMETER_KEY_XRUN_RECOVERY,
+                                value, len);
+    if (ret >= 0) {
+        for (tok = strtok_r(value, ",", &savePtr); tok;
+             tok = strtok_r(NULL, ",", &savePtr)) {
+            if (!strcmp(tok, "silence"))
+                recovery |= PAL_XRUN_RECOVERY_SILENCE;
+            else if (!strcmp(tok, "notify"))
+                recovery |= PAL_XRUN_RECOVERY_NOTIFY;
+            else if (strcmp(tok, "prepare"))
+                PAL_ERR(LOG_TAG, "unknown xrun recovery %s", tok);
+        }
+        xrunRecoveryDefault = recovery;
+
+        str_parms_del(parms, AUDIO_PARAMETER_KEY_XRUN_RECOVERY);
+    }
+
+    PAL_INFO(LOG_TAG, "xrun recovery is=%x", xrunRecoveryDefault);
+
+    return ret;
+}
+
 int ResourceManager::setNativeAudioParams(struct str_parms *parms,
                                           char *value, int len)
 {
@@ -8373,6 +8606,10 @@ int ResourceManager::setParameter(uint32_t param_id, void *param_payload,
             pal_param_charger_state *charger_state =
                 (pal_param_charger_state *)param_payload;
 
+            if (payload_size == sizeof(pal_param_charger_state))
+                BufferPolicy::getInstance()->setChargingState(
+                        charger_state->is_charger_online);
+
             if (!isChargeConcurrencyEnabled) goto exit;
 
             if (payload_size != sizeof(pal_param_charger_state)) {
@@ -9036,6 +9273,8 @@ int ResourceManager::rwParameterACDB(uint32_t paramId, void *paramPayload,
 
             status = s->rwACDBParam(palDeviceId, palStreamType, sampleRate,
                 instanceId, paramPayload, isParamWrite);
+            if (!status && isParamWrite)
+                CalibrationCache::getInstance()->invalidate();
 
             delete s;
         }
@@ -9065,6 +9304,7 @@ int ResourceManager::handleScreenStatusChange(pal_param_screen_state_t screen_st
             PAL_VERBOSE(LOG_TAG, "Screen State printout");
         }
         screen_state_ = screen_state.screen_state;
+        BufferPolicy::getInstance()->setScreenState(screen_state_);
         /* update
          * for (typename std::vector<StreamSoundTrigger*>::iterator iter = active_streams_st.begin();
          *    iter != active_streams_st.end(); iter++) {
@@ -10100,6 +10340,26 @@ void ResourceManager::process_config_lpm(struct xml_userdata *data, const XML_Ch
     }
 }
 
+void ResourceManager::process_config_ramp(struct xml_userdata *data, const XML_Char *tag_name)
+{
+    if (data->offs <= 0 || data->resourcexml_parsed)
+        return;
+
+    data->data_buf[data->offs] = '\0';
+    if (data->tag == TAG_CONFIG_RAMP) {
+        if (strcmp(tag_name, "volume_ramp_period_ms") == 0) {
+            rampPeriodInfo_.volumeRampPeriod = atoi(data->data_buf) * 1000;
+            PAL_DBG(LOG_TAG, "volume ramp period %u us", rampPeriodInfo_.volumeRampPeriod);
+        } else if (strcmp(tag_name, "mute_ramp_period_ms") == 0) {
+            rampPeriodInfo_.muteRampPeriod = atoi(data->data_buf) * 1000;
+            PAL_DBG(LOG_TAG, "mute ramp period %u us", rampPeriodInfo_.muteRampPeriod);
+        }
+    }
+    if (!strcmp(tag_name, "config_ramp")) {
+        data->tag = TAG_RESOURCE_MANAGER_INFO;
+    }
+}
+
 void ResourceManager::process_config_voice(struct xml_userdata *data, const XML_Char *tag_name)
 {
     if(data->voice_info_parsed)
@@ -10625,6 +10885,9 @@ void ResourceManager::startTag(void *userdata, const XML_Char *tag_name,
     } else if(strcmp(tag_name, "device_temp_ctrl") == 0) {
         processDeviceTempCtrls(attr, XML_GetSpecifiedAttributeCount(data->parser));
         return;
+    } else if (strcmp(tag_name, "buffer_policy") == 0) {
+        BufferPolicy::getInstance()->addEntry(attr);
+        return;
     }
 
     if (data->card_parsed)
@@ -10687,6 +10950,8 @@ void ResourceManager::startTag(void *userdata, const XML_Char *tag_name,
         data->tag = TAG_CONFIG_LPM_SUPPORTED_STREAMS;
     } else if (!strcmp(tag_name, "lpm_supported_stream")) {
         data->tag = TAG_CONFIG_LPM_SUPPORTED_STREAM;
+    } else if (!strcmp(tag_name, "config_ramp")) {
+        data->tag = TAG_CONFIG_RAMP;
     }
 
     if (!strcmp(tag_name, "card"))
@@ -10747,6 +11012,7 @@ void ResourceManager::endTag(void *userdata, const XML_Char *tag_name)
     process_lpi_vote_streams(data, tag_name);
     process_config_volume(data, tag_name);
     process_config_lpm(data, tag_name);
+    process_config_ramp(data, tag_name);
 
     if (data->card_parsed)
         return;
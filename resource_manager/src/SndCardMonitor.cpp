@@ -38,7 +38,15 @@
 #include "PalCommon.h"
 #include "SndCardMonitor.h"
 
+#ifdef PAL_SIM_BACKEND
+#include "PalSimBackend.h"
+/* simulated node is a fifo: every state change is one byte to consume */
+#define SNDCARD_PATH pal_sim_get_card_state_node()
+#define SNDCARD_POLL_EVENT POLLIN
+#else
 #define SNDCARD_PATH "/sys/kernel/snd_card/card_state"
+#define SNDCARD_POLL_EVENT POLLPRI
+#endif
 #define MAX_SLEEP_RETRY 100
 
 static int fd = -1;
@@ -71,17 +79,19 @@ void SndCardMonitor::monitorThreadLoop()
 
     while(1) {
         memset(buf , 0 ,sizeof(buf));
+#ifndef PAL_SIM_BACKEND
         read(fd, buf, 10);
         lseek(fd,0L,SEEK_SET);
+#endif
 
         poll_fds.fd = fd;
-        poll_fds.events = POLLERR | POLLPRI;
+        poll_fds.events = POLLERR | SNDCARD_POLL_EVENT;
         poll_fds.revents = 0;
 
         PAL_INFO(LOG_TAG, "waiting sys_notify event\n");
         if (( rv = poll( &poll_fds, 1, -1)) < 0 ) {
              PAL_ERR(LOG_TAG, "snd sysfs node poll error\n");
-        } else if ((poll_fds.revents & POLLPRI)) {
+        } else if ((poll_fds.revents & SNDCARD_POLL_EVENT)) {
             lseek(poll_fds.fd,0L,SEEK_SET);
             read(poll_fds.fd, buf, 1);
             sscanf(buf , "%d", &card_status);
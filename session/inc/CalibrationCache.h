@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the
+ * disclaimer below) provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *     * Neither the name of Qualcomm Innovation Center, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+ * GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+ * HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CALIBRATION_CACHE_H
+#define CALIBRATION_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#define CAL_CACHE_MAX_ENTRIES 64
+#define CAL_CACHE_MAX_BYTES   (64 * 1024)
+#define CAL_CACHE_HASH_OFFSET 0xcbf29ce484222325ULL
+#define CAL_CACHE_HASH_PRIME  0x100000001b3ULL
+
+/*
+ * Identity of a prebuilt calibration payload. graphKey describes the graph
+ * the payload is applied to (stream type, FE and backend ids), ckv holds the
+ * calibration key vector and miid the module instance it targets (0 when
+ * the payload is applied to the whole graph, e.g. setCalibration). The param
+ * fields describe the client ACDB parameter a setParamTagACDB payload is
+ * packed from; such payloads do not depend on ACDB content and survive
+ * invalidate(). Keys order on the hash and size of the parameter, the cache
+ * compares the bytes on a hit. paramData is only valid during a lookup.
+ */
+struct calCacheKey {
+    std::vector<std::pair<int, int>> graphKey;
+    std::vector<std::pair<int, int>> ckv;
+    uint32_t miid;
+    uint64_t paramHash;
+    uint32_t paramSize;
+    const uint8_t *paramData;
+
+    calCacheKey() : miid(0), paramHash(0), paramSize(0), paramData(nullptr) {}
+    void setParam(const uint8_t *data, uint32_t size);
+    bool operator<(const calCacheKey &rhs) const;
+    bool operator==(const calCacheKey &rhs) const;
+};
+
+struct calCacheStats {
+    uint64_t hits;          /**< payload reused without rebuilding */
+    uint64_t misses;        /**< payload built and inserted */
+    uint64_t skippedWrites; /**< kernel pushes avoided for unchanged CKV */
+    uint64_t evictions;
+    uint64_t invalidations;
+};
+
+typedef std::function<int(uint8_t **payload, size_t *size)> calPayloadBuilder;
+
+class CalibrationCache
+{
+protected:
+    struct calCacheEntry {
+        std::shared_ptr<std::vector<uint8_t>> payload;
+        std::list<calCacheKey>::iterator lruPos;
+        size_t bytes;
+        /* client parameter the payload was packed from, to confirm a hit */
+        std::vector<uint8_t> param;
+    };
+    std::mutex cacheMutex;
+    std::map<calCacheKey, calCacheEntry> cache;
+    std::list<calCacheKey> lruList;
+    size_t totalBytes;
+    size_t maxEntries;
+    size_t maxBytes;
+    uint32_t generation;
+    struct calCacheStats stats;
+    CalibrationCache();
+    void evictLocked();
+public:
+    static std::shared_ptr<CalibrationCache> getInstance();
+    /*
+     * Returns the prebuilt payload for key, calling build() only when no
+     * entry exists. The generation current at lookup time is returned so
+     * callers can detect an ACDB write that happened in between.
+     */
+    std::shared_ptr<std::vector<uint8_t>> getPayload(const calCacheKey &key,
+            calPayloadBuilder build, uint32_t *gen);
+    /* drops payloads built from ACDB content, returns the new generation */
+    uint32_t invalidate();
+    uint32_t getGeneration();
+    void setLimits(size_t entries, size_t bytes);
+    void noteSkippedWrite();
+    void getStats(struct calCacheStats *out);
+    ~CalibrationCache();
+};
+
+#endif //CALIBRATION_CACHE_H
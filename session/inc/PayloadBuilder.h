@@ -38,6 +38,7 @@
 #include "gsl_intf.h"
 #include "kvh2xml.h"
 #include "PalCommon.h"
+#include <atomic>
 #include <vector>
 #include <set>
 #include <algorithm>
@@ -52,6 +53,8 @@
 #define PAL_ALIGN_8BYTE(x) (((x) + 7) & (~7))
 #define PAL_PADDING_8BYTE_ALIGN(x)  ((((x) + 7) & 7) ^ 7)
 
+#define PAYLOAD_SCRATCH_DEFAULT_SIZE 4096
+
 #define MSM_MI2S_SD0 (1 << 0)
 #define MSM_MI2S_SD1 (1 << 1)
 #define MSM_MI2S_SD2 (1 << 2)
@@ -173,6 +176,18 @@ struct user_xml_data{
     bool is_parsing_devices;
     bool is_parsing_devicepps;
 };
+struct payloadScratchChunk {
+    uint8_t *base;
+    size_t size;
+    size_t used;
+};
+
+struct payloadAllocStats {
+    uint32_t heapAllocs;     /**< calloc/chunk allocations since scope start */
+    uint32_t payloads;       /**< payloads handed out since scope start */
+    size_t scratchBytes;     /**< bytes served from the scratch arena */
+};
+
 class SessionGsl;
 
 class PayloadBuilder
@@ -182,8 +197,35 @@ protected:
    static std::vector<allKVs> all_streampps;
    static std::vector<allKVs> all_devices;
    static std::vector<allKVs> all_devicepps;
+   /*
+    * Scratch arena backing payload* outputs while a payload scope is open.
+    * Chunks are kept across scopes so a repeated open/start/switch builds
+    * all of its payloads without touching the heap.
+    */
+   std::vector<struct payloadScratchChunk> scratchChunks;
+   uint32_t scratchDepth;
+   struct payloadAllocStats allocStats;
+   static thread_local PayloadBuilder *scratchOwner;
+   PayloadBuilder *prevScratchOwner;
+   /* process wide counts, never reset */
+   static std::atomic<uint32_t> totalHeapAllocs;
+   static std::atomic<uint32_t> totalPayloads;
+   uint8_t *allocPayload(size_t size);
+   bool isScratchPayload(const uint8_t *payload);
+   void compactScratch();
 
 public:
+    int beginPayloadScope(size_t sizeHint = PAYLOAD_SCRATCH_DEFAULT_SIZE);
+    void endPayloadScope();
+    void freePayload(uint8_t *payload);
+    static void releasePayload(uint8_t *payload);
+    void getAllocStats(struct payloadAllocStats *stats);
+    static void getTotalAllocStats(struct payloadAllocStats *stats);
+    /*
+     * Builder owned by the calling thread for helpers that have no session
+     * builder at hand; its arena persists across calls on that thread.
+     */
+    static PayloadBuilder *getThreadBuilder();
     void payloadUsbAudioConfig(uint8_t** payload, size_t* size,
                            uint32_t miid,
                            struct usbAudioConfig *data);
@@ -199,6 +241,8 @@ public:
     void payloadMultichVolumemConfig(uint8_t** payload, size_t* size,
                            uint32_t miid,
                            struct pal_volume_data * data);
+    int updateVolumePayload(uint8_t *payload, size_t size, uint32_t miid,
+            struct pal_volume_data* voldata, bool multiCh);
     int payloadCustomParam(uint8_t **alsaPayload, size_t *size,
                             uint32_t *customayload, uint32_t customPayloadSize,
                             uint32_t moduleInstanceId, uint32_t dspParamId);
@@ -296,4 +340,14 @@ public:
     PayloadBuilder();
     ~PayloadBuilder();
 };
+
+/* RAII helper opening a payload scope on a builder for one operation */
+class PayloadScope
+{
+    PayloadBuilder *builder;
+public:
+    explicit PayloadScope(PayloadBuilder *b, size_t sizeHint = PAYLOAD_SCRATCH_DEFAULT_SIZE)
+        : builder(b) { if (builder) builder->beginPayloadScope(sizeHint); }
+    ~PayloadScope() { if (builder) builder->endPayloadScope(); }
+};
 #endif //SESSION_H
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the
+ * disclaimer below) provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *     * Neither the name of Qualcomm Innovation Center, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+ * GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+ * HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SECOND_STAGE_SCHEDULER_H
+#define SECOND_STAGE_SCHEDULER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "PalRingBuffer.h"
+
+/* second stage detections processed at once across all streams */
+#define ST_SS_MAX_WORKERS 4
+/* wait between ring buffer checks while lab data is still arriving */
+#define ST_SS_DATA_POLL_MS 2
+
+/*
+ * Keyword data of one first stage detection, read once from the lab ring
+ * buffer and shared by all second stage engines of the stream. Each engine
+ * reserves the range it needs before processing starts; the window covers
+ * the union. Whichever engine runs short of data pulls the next available
+ * chunk from the ring buffer, bytes below the filled mark never change and
+ * are handed out without copying. The storage is kept across Reset so a
+ * window sized up front serves every detection without allocating.
+ */
+class KeywordWindow {
+public:
+    KeywordWindow(size_t capacity = 0);
+    ~KeywordWindow();
+    /* only valid once every engine is done with the previous detection */
+    void Reset();
+    /* fails with -EBUSY once data was read for the current detection */
+    int32_t Reserve(PalRingBufferReader *reader, uint32_t start, uint32_t end);
+    /* each accepted Reserve is paired with a Done, the last releases the reader */
+    void Done();
+    /* offsets are ring buffer positions, returns nullptr with status set on failure */
+    const uint8_t *Wait(uint32_t offset, uint32_t size, int32_t *status);
+    void Cancel();
+    bool IsCancelled();
+    uint64_t GetElapsedMs();
+
+private:
+    int32_t Fill(uint32_t filled);
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    PalRingBufferReader *reader_;
+    uint8_t *data_;
+    size_t capacity_;
+    uint32_t users_;
+    uint32_t start_;
+    uint32_t end_;
+    uint32_t filled_;
+    bool advanced_;
+    bool filling_;
+    bool cancelled_;
+    int32_t status_;
+    std::chrono::time_point<std::chrono::steady_clock> created_;
+};
+
+/*
+ * Job slot owned by the submitter and linked into the queue in place, so
+ * submitting a detection does not allocate. The slot must stay valid until
+ * run has returned; submitting it again while queued is a no-op.
+ */
+struct SecondStageTask {
+    void (*run)(void *arg);
+    void *arg;
+    SecondStageTask *next;
+    bool queued;
+};
+
+/* bounded pool running second stage detections of all streams */
+class SecondStageScheduler {
+public:
+    static std::shared_ptr<SecondStageScheduler> GetInstance();
+    ~SecondStageScheduler();
+    void Submit(SecondStageTask *task);
+
+private:
+    SecondStageScheduler();
+    void WorkerLoop();
+
+    static std::shared_ptr<SecondStageScheduler> scheduler_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    SecondStageTask *head_;
+    SecondStageTask *tail_;
+    size_t pending_;
+    std::vector<std::thread> workers_;
+    bool exit_;
+};
+
+#endif // SECOND_STAGE_SCHEDULER_H
@@ -45,6 +45,7 @@
 #include <errno.h>
 #include "PalCommon.h"
 #include "Device.h"
+#include "CalibrationCache.h"
 
 
 
@@ -72,6 +73,7 @@ typedef enum {
 } pmQosVote;
 
 #define EVENT_ID_SOFT_PAUSE_PAUSE_COMPLETE 0x0800103F
+#define CUSTOM_PAYLOAD_MIN_SIZE 512
 
 class Stream;
 class ResourceManager;
@@ -87,6 +89,7 @@ protected:
     std::vector<std::pair<int32_t, std::string>> txAifBackEnds;
     void *customPayload;
     size_t customPayloadSize;
+    size_t customPayloadCapacity = 0;
     int updateCustomPayload(void *payload, size_t size);
     int freeCustomPayload(uint8_t **payload, size_t *payloadSize);
     uint32_t eventId;
@@ -99,6 +102,26 @@ protected:
     static int extECRefCnt;
     static std::mutex extECMutex;
     bool frontEndIdAllocated = false;
+    calCacheKey appliedCalKey;
+    uint32_t appliedCalGeneration = 0;
+    bool isCalApplied = false;
+    /* last setParamTagACDB payload written and the generation it left */
+    std::shared_ptr<std::vector<uint8_t>> appliedAcdbPayload;
+    uint32_t appliedAcdbGeneration = 0;
+    bool isCalUnchanged(const calCacheKey &key);
+    void markCalApplied(const calCacheKey &key, uint32_t generation);
+    void resetCalState();
+    void getCalGraphKey(pal_stream_type_t type, const std::vector<int> &feIds,
+            std::vector<std::pair<int, int>> &graphKey);
+    uint32_t volMiid = 0;
+    int volMiidDevice = -1;
+    bool isVolMiidValid = false;
+    uint8_t *volParamData = NULL;
+    size_t volParamSize = 0;
+    void cacheVolumeMiid(int device, uint32_t miid);
+    int setVolumeParam(PayloadBuilder *builder, int device, uint32_t miid,
+            struct pal_volume_data *vdata, bool multiCh);
+    void resetVolumeCache();
 public:
     bool isMixerEventCbRegd;
     bool isPauseRegistrationDone;
@@ -133,6 +156,8 @@ public:
     virtual int writeBufferInit(Stream *s __unused, size_t noOfBuf __unused, size_t bufSize __unused, int flag __unused) {return 0;};
     virtual int read(Stream *s __unused, int tag __unused, struct pal_buffer *buf __unused, int * size __unused) {return 0;};
     virtual int write(Stream *s __unused, int tag __unused, struct pal_buffer *buf __unused, int * size __unused, int flag __unused) {return 0;};
+    virtual int readBuffers(Stream *s __unused, struct pal_buffer *bufs __unused, uint32_t count __unused, uint32_t *queued __unused) {return -EINVAL;};
+    virtual int writeBuffers(Stream *s __unused, struct pal_buffer *bufs __unused, uint32_t count __unused, uint32_t *queued __unused) {return -EINVAL;};
     virtual int getParameters(Stream *s __unused, int tagId __unused, uint32_t param_id __unused, void **payload __unused) {return 0;};
     virtual int setParameters(Stream *s __unused, int tagId __unused, uint32_t param_id __unused, void *payload __unused) {return 0;};
     virtual int registerCallBack(session_callback cb __unused, uint64_t cookie __unused) {return 0;};
@@ -73,6 +73,8 @@ private:
     std::vector <std::pair<int, int>> ckv;
     std::vector <std::pair<int, int>> tkv;
     int getAgmCodecId(pal_audio_fmt_t fmt);
+    int fillAgmBuffer(struct pal_buffer *buf, struct agm_buff *agm_buffer, bool isWrite);
+    int queueBuffers(struct pal_buffer *bufs, uint32_t count, bool isWrite, uint32_t *queued);
     struct agm_session_config *sess_config;
     struct agm_media_config *in_media_cfg, *out_media_cfg;
     struct agm_buffer_config in_buff_cfg {0,0,0}, out_buff_cfg = in_buff_cfg;
@@ -95,6 +97,8 @@ public:
     int getParameters(Stream *s, int tagId, uint32_t param_id, void **payload);
     int read(Stream *s, int tag, struct pal_buffer *buf, int * size) override;
     int write(Stream *s, int tag, struct pal_buffer *buf, int * size, int flag) override;
+    int readBuffers(Stream *s, struct pal_buffer *bufs, uint32_t count, uint32_t *queued) override;
+    int writeBuffers(Stream *s, struct pal_buffer *bufs, uint32_t count, uint32_t *queued) override;
     int setECRef(Stream *s __unused, std::shared_ptr<Device> rx_dev __unused, bool is_enable __unused) {return 0;};
     int registerCallBack(session_callback cb, uint64_t cookie);
     int drain(pal_drain_type_t type);
@@ -115,6 +119,8 @@ public:
     uint64_t cbCookie;
     int32_t sessionId;
     Stream *streamHandle;
+    /* stream flags cached at open, read on every buffer and event */
+    uint32_t streamFlags;
 };
 
 #endif //SESSION_AGM_H
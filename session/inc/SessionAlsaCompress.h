@@ -111,6 +111,7 @@ private:
     uint64_t cbCookie;
     pal_audio_fmt_t audio_fmt;
     int fileWrite(Stream *s, int tag, struct pal_buffer *buf, int * size, int flag);
+    void publishDspTime();
     std::vector <std::pair<int, int>> ckv;
     std::vector <std::pair<int, int>> tkv;
     bool isGaplessFmt = false;
@@ -39,6 +39,7 @@
 #include <tinyalsa/asoundlib.h>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 
 #define PARAM_ID_DETECTION_ENGINE_CONFIG_VOICE_WAKEUP 0x08001049
 #define PARAM_ID_VOICE_WAKEUP_BUFFERING_CONFIG 0x08001044
@@ -71,6 +72,21 @@ private:
     uint32_t svaMiid;
     static std::mutex pcmLpmRefCntMtx;
     static int pcmLpmRefCnt;
+    /* CLOCK_MONOTONIC time of the last completed non-mmap transfer */
+    uint64_t mLastXferNs = 0;
+    void markXfer();
+    int recoverXrun(Stream *s, bool playback, uint32_t sampleRate);
+    void publishPosition(Stream *s, bool playback, unsigned int bytes);
+    /* mmap position mirror publisher, runs between start and stop */
+    uint64_t mMmapPeriodNs = 0;
+    std::thread mMmapPosThread;
+    std::mutex mMmapPosMutex;
+    std::condition_variable mMmapPosCv;
+    bool mMmapPosExit = true;
+    void setMmapPeriod(const struct pcm_config *config);
+    void startMmapPositionPublisher(Stream *s);
+    void stopMmapPositionPublisher();
+    void mmapPositionLoop(Stream *s);
 public:
 
     SessionAlsaPcm(std::shared_ptr<ResourceManager> Rm);
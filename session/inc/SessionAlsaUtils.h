@@ -77,6 +77,13 @@ enum BeCtrlsIndex {
     BE_MAX_NUM_MIXER_CONTROLS,
 };
 
+/* per module result of a batched setParam submission */
+struct paramBatchStatus {
+    uint32_t miid;
+    uint32_t paramId;
+    int status;
+};
+
 
 class SessionAlsaUtils
 {
@@ -87,6 +94,9 @@ private:
     static struct mixer_ctl *getBeMixerControl(struct mixer *am, std::string beName,
         uint32_t idx);
     static struct mixer_ctl *getStaticMixerControl(struct mixer *am, std::string name);
+    static struct mixer_ctl *getSetParamMixerControl(struct mixer *mixer, int device);
+    static std::map<std::pair<struct mixer *, int>, struct mixer_ctl *> setParamCtlCache;
+    static std::mutex setParamCtlMutex;
 public:
     ~SessionAlsaUtils();
     static bool isRxDevice(uint32_t devId);
@@ -117,6 +127,10 @@ public:
                        uint8_t *payload);
     static int setMixerParameter(struct mixer *mixer, int device,
                                  void *payload, int size);
+    static int setMixerParameterBatch(struct mixer *mixer, int device,
+                                 void *payload, int size,
+                                 std::vector<struct paramBatchStatus> *moduleStatus = nullptr);
+    static void clearMixerControlCache();
     static int setStreamMetadataType(struct mixer *mixer, int device, const char *val);
     static int registerMixerEvent(struct mixer *mixer, int device, const char *intf_name, int tag_id, void *payload, int payload_size);
     static int registerMixerEvent(struct mixer *mixer, int device, void *payload, int payload_size);
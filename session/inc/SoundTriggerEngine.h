@@ -93,6 +93,7 @@ struct detection_event_info
 
 class SoundModelConfig;
 class SoundTriggerPlatformInfo;
+class KeywordWindow;
 
 class SoundTriggerEngine {
 public:
@@ -118,6 +119,9 @@ public:
     virtual void GetUpdatedBufConfig(uint32_t *hist_buffer_duration,
                                     uint32_t *pre_roll_duration) = 0;
     virtual void SetDetected(bool detected) = 0;
+    /* keyword data shared by the second stage engines of a detection */
+    virtual void SetKeywordWindow(
+        std::shared_ptr<KeywordWindow> window __unused) {}
     virtual int32_t GetParameters(uint32_t param_id, void **payload) = 0;
     virtual int32_t ConnectSessionDevice(
         Stream* stream_handle,
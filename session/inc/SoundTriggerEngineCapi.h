@@ -36,6 +36,7 @@
 
 #include "SoundTriggerEngine.h"
 #include "PalRingBuffer.h"
+#include "SecondStageScheduler.h"
 
 class Stream;
 class SecondStageConfig;
@@ -58,6 +59,7 @@ class SoundTriggerEngineCapi : public SoundTriggerEngine {
         uint8_t *conf_levels,
         uint32_t num_conf_levels) override;
     void SetDetected(bool detected) override;
+    void SetKeywordWindow(std::shared_ptr<KeywordWindow> window) override;
 
     int32_t GetParameters(uint32_t param_id __unused, void **payload __unused) {
         return 0;
@@ -97,9 +99,11 @@ class SoundTriggerEngineCapi : public SoundTriggerEngine {
  private:
     int32_t StartSoundEngine();
     int32_t StopSoundEngine();
-    int32_t StartKeywordDetection();
-    int32_t StartUserVerification();
-    static void BufferThreadLoop(SoundTriggerEngineCapi *capi_engine);
+    int32_t StartKeywordDetection(std::shared_ptr<KeywordWindow> window);
+    int32_t StartUserVerification(std::shared_ptr<KeywordWindow> window);
+    int32_t ReserveWindow(std::shared_ptr<KeywordWindow> window);
+    void CancelDetection();
+    static void ProcessDetection(void *arg);
 
     std::string lib_name_;
     capi_v2_t *capi_handle_;
@@ -112,7 +116,13 @@ class SoundTriggerEngineCapi : public SoundTriggerEngine {
     bool keyword_detected_;
     int32_t confidence_threshold_;
     uint32_t buffer_size_;
+    uint32_t first_buffer_size_;
     std::shared_ptr<SecondStageConfig> ss_cfg_;
+    std::shared_ptr<KeywordWindow> window_;
+    /* used when the stream did not share a window, kept across detections */
+    std::shared_ptr<KeywordWindow> own_window_;
+    SecondStageTask task_;
+    bool job_pending_;
     /*
      * externally to allow engine to know where
      * it can stop and start processing
@@ -131,6 +141,12 @@ class SoundTriggerEngineCapi : public SoundTriggerEngine {
     int32_t detection_state_;
     stage2_uv_wrapper_scratch_param_t in_model_buffer_param_;
     stage2_uv_wrapper_scratch_param_t scratch_param_;
+    /* per detection capi buffers, reused to keep allocation off that path */
+    capi_v2_stream_data_t stream_input_;
+    capi_v2_buf_t stream_buf_;
+    sva_result_t kw_result_;
+    stage2_uv_wrapper_result uv_result_;
+    stage2_uv_wrapper_stage1_uv_score_t uv_score_;
 };
 #endif  // SOUNDTRIGGERENGINECAPI_H
 
@@ -35,6 +35,7 @@
 
 #include "SoundTriggerEngine.h"
 #include "SoundTriggerUtils.h"
+#include "SoundModelCache.h"
 #include "StreamSoundTrigger.h"
 #include "PalRingBuffer.h"
 #include "PayloadBuilder.h"
@@ -146,6 +147,7 @@ class SoundTriggerEngineGsl : public SoundTriggerEngine {
              listen_model_type *out_model);
     int32_t DeleteFromMergedModel(char **keyphrases, uint32_t num_keyphrases,
              listen_model_type *in_model, listen_model_type *out_model);
+    std::vector<SoundModelRef> GetModelRefs(Stream *exclude);
     int32_t ConstructAPMPayload(uint32_t param_id, uint8_t** payload,
                                 uint8_t* data, uint32_t data_size);
     int32_t ProcessStartRecognition(Stream *s);
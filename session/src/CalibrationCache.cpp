@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the
+ * disclaimer below) provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *     * Neither the name of Qualcomm Innovation Center, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+ * GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+ * HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define LOG_TAG "PAL: CalibrationCache"
+
+#include "CalibrationCache.h"
+#include "PalCommon.h"
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+
+/* FNV-1a over 64 bit words, cheaper than packing the payload again */
+void calCacheKey::setParam(const uint8_t *data, uint32_t size)
+{
+    uint64_t hash = CAL_CACHE_HASH_OFFSET ^ size;
+    uint64_t word = 0;
+    uint32_t i = 0;
+
+    for (; i + sizeof(word) <= size; i += sizeof(word)) {
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * CAL_CACHE_HASH_PRIME;
+    }
+    for (; i < size; i++)
+        hash = (hash ^ data[i]) * CAL_CACHE_HASH_PRIME;
+
+    paramHash = hash;
+    paramSize = size;
+    paramData = data;
+}
+
+bool calCacheKey::operator<(const calCacheKey &rhs) const
+{
+    if (miid != rhs.miid)
+        return miid < rhs.miid;
+    if (paramSize != rhs.paramSize)
+        return paramSize < rhs.paramSize;
+    if (paramHash != rhs.paramHash)
+        return paramHash < rhs.paramHash;
+    if (graphKey != rhs.graphKey)
+        return graphKey < rhs.graphKey;
+    return ckv < rhs.ckv;
+}
+
+bool calCacheKey::operator==(const calCacheKey &rhs) const
+{
+    return (miid == rhs.miid) && (paramSize == rhs.paramSize) &&
+           (paramHash == rhs.paramHash) && (graphKey == rhs.graphKey) &&
+           (ckv == rhs.ckv);
+}
+
+CalibrationCache::CalibrationCache()
+{
+    totalBytes = 0;
+    maxEntries = CAL_CACHE_MAX_ENTRIES;
+    maxBytes = CAL_CACHE_MAX_BYTES;
+    generation = 0;
+    memset(&stats, 0, sizeof(stats));
+}
+
+CalibrationCache::~CalibrationCache()
+{
+    cache.clear();
+    lruList.clear();
+}
+
+std::shared_ptr<CalibrationCache> CalibrationCache::getInstance()
+{
+    static std::shared_ptr<CalibrationCache> instance(new CalibrationCache());
+    return instance;
+}
+
+void CalibrationCache::evictLocked()
+{
+    while (!lruList.empty() &&
+           (cache.size() > maxEntries || totalBytes > maxBytes)) {
+        auto it = cache.find(lruList.back());
+        if (it != cache.end()) {
+            totalBytes -= it->second.bytes;
+            cache.erase(it);
+        }
+        lruList.pop_back();
+        stats.evictions++;
+    }
+}
+
+std::shared_ptr<std::vector<uint8_t>> CalibrationCache::getPayload(
+        const calCacheKey &key, calPayloadBuilder build, uint32_t *gen)
+{
+    std::shared_ptr<std::vector<uint8_t>> payload = nullptr;
+    uint8_t *data = nullptr;
+    size_t size = 0;
+    uint32_t buildGen = 0;
+    size_t bytes = 0;
+    int status = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        auto it = cache.find(key);
+        /* same hash but another parameter is a miss, the entry is replaced */
+        if (it != cache.end() && key.paramSize &&
+            memcmp(it->second.param.data(), key.paramData, key.paramSize))
+            it = cache.end();
+        if (it != cache.end()) {
+            lruList.splice(lruList.begin(), lruList, it->second.lruPos);
+            stats.hits++;
+            if (gen)
+                *gen = generation;
+            return it->second.payload;
+        }
+        buildGen = generation;
+    }
+
+    /* build outside the lock, builders may query the graph through AGM */
+    status = build(&data, &size);
+    if (status || !data || !size) {
+        PAL_ERR(LOG_TAG, "failed to build calibration payload, status %d", status);
+        if (data)
+            free(data);
+        return nullptr;
+    }
+    payload = std::make_shared<std::vector<uint8_t>>(data, data + size);
+    free(data);
+
+    /* the client parameter kept in the key is charged to the entry too */
+    bytes = size + key.paramSize;
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    stats.misses++;
+    if (gen)
+        *gen = buildGen;
+    /* an ACDB write raced with the build, hand out the payload uncached */
+    if (buildGen != generation || bytes > maxBytes)
+        return payload;
+
+    auto it = cache.find(key);
+    if (it != cache.end()) {
+        if (!key.paramSize ||
+            !memcmp(it->second.param.data(), key.paramData, key.paramSize))
+            return it->second.payload;
+        totalBytes -= it->second.bytes;
+        lruList.erase(it->second.lruPos);
+        cache.erase(it);
+    }
+
+    /* stored keys must not point at the caller's parameter */
+    lruList.push_front(key);
+    lruList.front().paramData = nullptr;
+    calCacheEntry &entry = cache[lruList.front()];
+    entry.payload = payload;
+    entry.lruPos = lruList.begin();
+    entry.bytes = bytes;
+    if (key.paramSize)
+        entry.param.assign(key.paramData, key.paramData + key.paramSize);
+    totalBytes += bytes;
+    evictLocked();
+    PAL_VERBOSE(LOG_TAG, "cached payload size %zu, entries %zu, bytes %zu",
+                size, cache.size(), totalBytes);
+    return payload;
+}
+
+uint32_t CalibrationCache::invalidate()
+{
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    for (auto it = cache.begin(); it != cache.end();) {
+        if (it->first.paramSize) {
+            it++;
+            continue;
+        }
+        totalBytes -= it->second.bytes;
+        lruList.erase(it->second.lruPos);
+        it = cache.erase(it);
+    }
+    generation++;
+    stats.invalidations++;
+    PAL_DBG(LOG_TAG, "calibration cache invalidated, generation %u", generation);
+    return generation;
+}
+
+uint32_t CalibrationCache::getGeneration()
+{
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    return generation;
+}
+
+void CalibrationCache::setLimits(size_t entries, size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    maxEntries = entries;
+    maxBytes = bytes;
+    evictLocked();
+}
+
+void CalibrationCache::noteSkippedWrite()
+{
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    stats.skippedWrites++;
+}
+
+void CalibrationCache::getStats(struct calCacheStats *out)
+{
+    if (!out)
+        return;
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    *out = stats;
+}
@@ -170,6 +170,9 @@ std::vector<allKVs> PayloadBuilder::all_streams;
 std::vector<allKVs> PayloadBuilder::all_streampps;
 std::vector<allKVs> PayloadBuilder::all_devices;
 std::vector<allKVs> PayloadBuilder::all_devicepps;
+thread_local PayloadBuilder *PayloadBuilder::scratchOwner = nullptr;
+std::atomic<uint32_t> PayloadBuilder::totalHeapAllocs(0);
+std::atomic<uint32_t> PayloadBuilder::totalPayloads(0);
 
 template <typename T>
 void PayloadBuilder::populateChannelMap(T pcmChannel, uint8_t numChannel)
@@ -236,7 +239,7 @@ void PayloadBuilder::payloadUsbAudioConfig(uint8_t** payload, size_t* size,
     if (payloadSize % 8 != 0)
         payloadSize = payloadSize + (8 - payloadSize % 8);
 
-    payloadInfo = new uint8_t[payloadSize]();
+    payloadInfo = allocPayload(payloadSize);
     if (!payloadInfo) {
         PAL_ERR(LOG_TAG, "payloadInfo new failed %s", strerror(errno));
         return;
@@ -276,7 +279,7 @@ void PayloadBuilder::payloadDpAudioConfig(uint8_t** payload, size_t* size,
     if (payloadSize % 8 != 0)
         payloadSize = payloadSize + (8 - payloadSize % 8);
 
-    payloadInfo = (uint8_t*) calloc(1, payloadSize);
+    payloadInfo = allocPayload(payloadSize);
     if (!payloadInfo) {
         PAL_ERR(LOG_TAG, "payloadInfo malloc failed %s", strerror(errno));
         return;
@@ -303,15 +306,9 @@ void PayloadBuilder::payloadDpAudioConfig(uint8_t** payload, size_t* size,
 }
 
 #define PLAYBACK_VOLUME_MAX 0x2000
-void PayloadBuilder::payloadVolumeConfig(uint8_t** payload, size_t* size,
-        uint32_t miid, struct pal_volume_data* voldata)
+static long volumeToMasterGain(struct pal_volume_data* voldata)
 {
-    struct apm_module_param_data_t* header = nullptr;
-    volume_ctrl_master_gain_t *volConf = nullptr;
     float voldB = 0.0f;
-    long vol = 0;
-    uint8_t* payloadInfo = NULL;
-    size_t payloadSize = 0, padBytes = 0;
 
     if (voldata->no_of_volpair == 1) {
         voldB = (voldata->volume_pair[0].vol);
@@ -321,11 +318,39 @@ void PayloadBuilder::payloadVolumeConfig(uint8_t** payload, size_t* size,
                   (voldata->volume_pair[1].vol));
     }
     PAL_VERBOSE(LOG_TAG,"volume sent:%f \n",voldB);
-    vol = (long)(voldB * (PLAYBACK_VOLUME_MAX*1.0));
+    return (long)(voldB * (PLAYBACK_VOLUME_MAX*1.0));
+}
+
+static void volumeToMultichGain(struct pal_volume_data* voldata,
+        volume_ctrl_multichannel_gain_t *volConf)
+{
+    const uint32_t PLAYBACK_MULTI_VOLUME_GAIN = 1 << 28;
+
+    /*
+     * Only L/R channel setting is supported. No need to convert channel_mask to channel_map.
+     * If other channel types support, the conversion is needed.
+     */
+    for (uint32_t i = 0; i < voldata->no_of_volpair; i++) {
+        volConf->gain_data[i].channel_mask_lsb = (1 << voldata->volume_pair[i].channel_mask);
+        volConf->gain_data[i].channel_mask_msb = 0;
+        volConf->gain_data[i].gain = (uint32_t)((voldata->volume_pair[i].vol) * (PLAYBACK_MULTI_VOLUME_GAIN * 1.0));
+    }
+}
+
+void PayloadBuilder::payloadVolumeConfig(uint8_t** payload, size_t* size,
+        uint32_t miid, struct pal_volume_data* voldata)
+{
+    struct apm_module_param_data_t* header = nullptr;
+    volume_ctrl_master_gain_t *volConf = nullptr;
+    long vol = 0;
+    uint8_t* payloadInfo = NULL;
+    size_t payloadSize = 0, padBytes = 0;
+
+    vol = volumeToMasterGain(voldata);
     payloadSize = sizeof(struct apm_module_param_data_t) +
                   sizeof(struct volume_ctrl_master_gain_t);
     padBytes = PAL_PADDING_8BYTE_ALIGN(payloadSize);
-    payloadInfo = new uint8_t[payloadSize + padBytes]();
+    payloadInfo = allocPayload(payloadSize + padBytes);
     if (!payloadInfo) {
         PAL_ERR(LOG_TAG, "payloadInfo malloc failed %s", strerror(errno));
         return;
@@ -348,7 +373,6 @@ void PayloadBuilder::payloadVolumeConfig(uint8_t** payload, size_t* size,
 void PayloadBuilder::payloadMultichVolumemConfig(uint8_t** payload, size_t* size,
         uint32_t miid, struct pal_volume_data* voldata)
 {
-     const uint32_t PLAYBACK_MULTI_VOLUME_GAIN = 1 << 28;
      struct apm_module_param_data_t* header = nullptr;
      volume_ctrl_multichannel_gain_t *volConf = nullptr;
      int numChannels;
@@ -360,7 +384,7 @@ void PayloadBuilder::payloadMultichVolumemConfig(uint8_t** payload, size_t* size
                    sizeof(struct volume_ctrl_multichannel_gain_t) +
                    numChannels * sizeof(volume_ctrl_channels_gain_config_t);
      padBytes = PAL_PADDING_8BYTE_ALIGN(payloadSize);
-     payloadInfo = (uint8_t*) calloc(1, payloadSize + padBytes);
+     payloadInfo = allocPayload(payloadSize + padBytes);
      if (!payloadInfo) {
          PAL_ERR(LOG_TAG, "payloadInfo malloc failed %s", strerror(errno));
          return;
@@ -373,15 +397,7 @@ void PayloadBuilder::payloadMultichVolumemConfig(uint8_t** payload, size_t* size
      volConf = (volume_ctrl_multichannel_gain_t *) (payloadInfo + sizeof(struct apm_module_param_data_t));
      volConf->num_config = numChannels;
      PAL_DBG(LOG_TAG, "num_config %d", numChannels);
-     /*
-      * Only L/R channel setting is supported. No need to convert channel_mask to channel_map.
-      * If other channel types support, the conversion is needed.
-      */
-     for (uint32_t i = 0; i < numChannels; i++) {
-          volConf->gain_data[i].channel_mask_lsb = (1 << voldata->volume_pair[i].channel_mask);
-          volConf->gain_data[i].channel_mask_msb = 0;
-          volConf->gain_data[i].gain = (uint32_t)((voldata->volume_pair[i].vol) * (PLAYBACK_MULTI_VOLUME_GAIN * 1.0));
-     }
+     volumeToMultichGain(voldata, volConf);
      PAL_DBG(LOG_TAG, "header params IID:%x param_id:%x error_code:%d param_size:%d",
                    header->module_instance_id, header->param_id,
                    header->error_code, header->param_size);
@@ -390,6 +406,41 @@ void PayloadBuilder::payloadMultichVolumemConfig(uint8_t** payload, size_t* size
      PAL_DBG(LOG_TAG, "payload %pK size %zu", *payload, *size);
 }
 
+/*
+ * Rewrites the gain of a volume payload previously built by
+ * payloadVolumeConfig/payloadMultichVolumemConfig, so a cached payload can
+ * be resent without rebuilding it. Returns -EINVAL if the payload does not
+ * match the module or layout required for voldata; caller rebuilds then.
+ */
+int PayloadBuilder::updateVolumePayload(uint8_t *payload, size_t size, uint32_t miid,
+        struct pal_volume_data* voldata, bool multiCh)
+{
+    struct apm_module_param_data_t* header = (struct apm_module_param_data_t*)payload;
+    volume_ctrl_master_gain_t *masterConf = nullptr;
+    volume_ctrl_multichannel_gain_t *multichConf = nullptr;
+
+    if (!payload || !voldata || size < sizeof(struct apm_module_param_data_t) ||
+        header->module_instance_id != miid)
+        return -EINVAL;
+
+    if (multiCh) {
+        if (header->param_id != PARAM_ID_VOL_CTRL_MULTICHANNEL_GAIN)
+            return -EINVAL;
+        multichConf = (volume_ctrl_multichannel_gain_t *)(payload +
+                       sizeof(struct apm_module_param_data_t));
+        if (multichConf->num_config != voldata->no_of_volpair)
+            return -EINVAL;
+        volumeToMultichGain(voldata, multichConf);
+    } else {
+        if (header->param_id != PARAM_ID_VOL_CTRL_MASTER_GAIN)
+            return -EINVAL;
+        masterConf = (volume_ctrl_master_gain_t *)(payload +
+                      sizeof(struct apm_module_param_data_t));
+        masterConf->master_gain = volumeToMasterGain(voldata);
+    }
+    return 0;
+}
+
 void PayloadBuilder::payloadMFCConfig(uint8_t** payload, size_t* size,
         uint32_t miid, struct sessionToPayloadParam* data)
 {
@@ -410,7 +461,7 @@ void PayloadBuilder::payloadMFCConfig(uint8_t** payload, size_t* size,
                   sizeof(uint16_t)*numChannels;
     padBytes = PAL_PADDING_8BYTE_ALIGN(payloadSize);
 
-    payloadInfo = (uint8_t*) calloc(1, payloadSize + padBytes);
+    payloadInfo = allocPayload(payloadSize + padBytes);
     if (!payloadInfo) {
         PAL_ERR(LOG_TAG, "payloadInfo malloc failed %s", strerror(errno));
         return;
@@ -469,7 +520,7 @@ int PayloadBuilder::payloadPopSuppressorConfig(uint8_t** payload, size_t* size,
                   sizeof(struct param_id_pop_suppressor_mute_config_t);
     padBytes = PAL_PADDING_8BYTE_ALIGN(payloadSize);
 
-    payloadInfo = (uint8_t*) calloc(1, payloadSize + padBytes);
+    payloadInfo = allocPayload(payloadSize + padBytes);
     if (!payloadInfo) {
         PAL_ERR(LOG_TAG, "payloadInfo malloc failed %s", strerror(errno));
         status = -ENOMEM;
@@ -498,12 +549,173 @@ exit:
 
 PayloadBuilder::PayloadBuilder()
 {
-
+    scratchDepth = 0;
+    prevScratchOwner = nullptr;
+    memset(&allocStats, 0, sizeof(allocStats));
 }
 
 PayloadBuilder::~PayloadBuilder()
 {
+    if (scratchOwner == this)
+        scratchOwner = prevScratchOwner;
+    for (auto &chunk : scratchChunks)
+        free(chunk.base);
+    scratchChunks.clear();
+}
+
+int PayloadBuilder::beginPayloadScope(size_t sizeHint)
+{
+    struct payloadScratchChunk chunk;
+
+    if (scratchDepth++ > 0)
+        return 0;
+
+    memset(&allocStats, 0, sizeof(allocStats));
+    if (scratchChunks.empty()) {
+        chunk.size = PAL_ALIGN_8BYTE(sizeHint);
+        chunk.base = (uint8_t *)calloc(1, chunk.size);
+        if (!chunk.base) {
+            PAL_ERR(LOG_TAG, "scratch alloc failed, falling back to heap payloads");
+            scratchDepth--;
+            return -ENOMEM;
+        }
+        chunk.used = 0;
+        scratchChunks.push_back(chunk);
+        allocStats.heapAllocs++;
+        totalHeapAllocs++;
+    }
+    prevScratchOwner = scratchOwner;
+    scratchOwner = this;
+    return 0;
+}
+
+void PayloadBuilder::endPayloadScope()
+{
+    if (scratchDepth == 0 || --scratchDepth > 0)
+        return;
+
+    PAL_DBG(LOG_TAG, "payloads %u heap allocs %u scratch bytes %zu",
+            allocStats.payloads, allocStats.heapAllocs, allocStats.scratchBytes);
+    compactScratch();
+    if (scratchOwner == this)
+        scratchOwner = prevScratchOwner;
+    prevScratchOwner = nullptr;
+}
+
+/*
+ * Fold the chunks grown during the last scope into a single block sized
+ * for the whole operation, so the next scope is served from one chunk.
+ */
+void PayloadBuilder::compactScratch()
+{
+    struct payloadScratchChunk chunk;
+    size_t total = 0;
+
+    if (scratchChunks.size() > 1) {
+        for (auto &c : scratchChunks) {
+            total += c.size;
+            free(c.base);
+        }
+        scratchChunks.clear();
+        chunk.base = (uint8_t *)calloc(1, total);
+        totalHeapAllocs++;
+        if (chunk.base) {
+            chunk.size = total;
+            chunk.used = 0;
+            scratchChunks.push_back(chunk);
+        }
+        return;
+    }
 
+    for (auto &c : scratchChunks)
+        c.used = 0;
+}
+
+uint8_t *PayloadBuilder::allocPayload(size_t size)
+{
+    struct payloadScratchChunk chunk;
+    uint8_t *payload = nullptr;
+    size_t alignedSize = PAL_ALIGN_8BYTE(size);
+
+    allocStats.payloads++;
+    totalPayloads++;
+    if (scratchDepth == 0 || alignedSize == 0) {
+        allocStats.heapAllocs++;
+        totalHeapAllocs++;
+        return (uint8_t *)calloc(1, size);
+    }
+
+    if (scratchChunks.empty() ||
+        scratchChunks.back().size - scratchChunks.back().used < alignedSize) {
+        chunk.size = std::max(alignedSize,
+                (size_t)(scratchChunks.empty() ? PAYLOAD_SCRATCH_DEFAULT_SIZE :
+                                                  scratchChunks.back().size * 2));
+        chunk.base = (uint8_t *)calloc(1, chunk.size);
+        if (!chunk.base)
+            return nullptr;
+        chunk.used = 0;
+        scratchChunks.push_back(chunk);
+        allocStats.heapAllocs++;
+        totalHeapAllocs++;
+    }
+
+    payload = scratchChunks.back().base + scratchChunks.back().used;
+    memset(payload, 0, alignedSize);
+    scratchChunks.back().used += alignedSize;
+    allocStats.scratchBytes += alignedSize;
+    return payload;
+}
+
+bool PayloadBuilder::isScratchPayload(const uint8_t *payload)
+{
+    for (auto &c : scratchChunks) {
+        if (payload >= c.base && payload < c.base + c.size)
+            return true;
+    }
+    return false;
+}
+
+void PayloadBuilder::freePayload(uint8_t *payload)
+{
+    if (!payload || isScratchPayload(payload))
+        return;
+    free(payload);
+}
+
+/*
+ * Release a payload* output when the owning builder is not at hand, e.g.
+ * from Session helpers. Scratch memory of the scope open on this thread
+ * is reclaimed at endPayloadScope() instead.
+ */
+void PayloadBuilder::releasePayload(uint8_t *payload)
+{
+    for (PayloadBuilder *owner = scratchOwner; owner; owner = owner->prevScratchOwner) {
+        if (owner->isScratchPayload(payload))
+            return;
+    }
+    free(payload);
+}
+
+void PayloadBuilder::getAllocStats(struct payloadAllocStats *stats)
+{
+    if (stats)
+        *stats = allocStats;
+}
+
+void PayloadBuilder::getTotalAllocStats(struct payloadAllocStats *stats)
+{
+    if (!stats)
+        return;
+    stats->heapAllocs = totalHeapAllocs.load();
+    stats->payloads = totalPayloads.load();
+    stats->scratchBytes = 0;
+}
+
+PayloadBuilder *PayloadBuilder::getThreadBuilder()
+{
+    static thread_local PayloadBuilder threadBuilder;
+
+    return &threadBuilder;
 }
 
 uint16_t numOfBitsSet(uint32_t lines)
@@ -1354,7 +1566,7 @@ int PayloadBuilder::payloadCustomParam(uint8_t **alsaPayload, size_t *size,
     if (paramId) {
         alsaPayloadSize = PAL_ALIGN_8BYTE(sizeof(struct apm_module_param_data_t)
                                             + customPayloadSize);
-        payloadInfo = (uint8_t *)calloc(1, (size_t)alsaPayloadSize);
+        payloadInfo = allocPayload((size_t)alsaPayloadSize);
         if (!payloadInfo) {
             PAL_ERR(LOG_TAG, "failed to allocate memory.");
             return -ENOMEM;
@@ -1374,7 +1586,7 @@ int PayloadBuilder::payloadCustomParam(uint8_t **alsaPayload, size_t *size,
         *alsaPayload = payloadInfo;
     } else {
         // make sure memory is big enough to handle padding
-        uint8_t *repackedData = (uint8_t *)calloc(1, customPayloadSize * 2);
+        uint8_t *repackedData = allocPayload(customPayloadSize * 2);
         if (!repackedData) {
             PAL_ERR(LOG_TAG, "failed to allocate memory of 0x%x bytes",
                         customPayloadSize * 2);
@@ -1430,7 +1642,7 @@ int PayloadBuilder::payloadSVAConfig(uint8_t **payload, size_t *size,
 
     payloadSize = PAL_ALIGN_8BYTE(
         sizeof(struct apm_module_param_data_t) + config_size);
-    payloadInfo = (uint8_t *)calloc(1, payloadSize);
+    payloadInfo = allocPayload(payloadSize);
     if (!payloadInfo) {
         PAL_ERR(LOG_TAG, "failed to allocate memory.");
         return -ENOMEM;
@@ -1462,7 +1674,7 @@ void PayloadBuilder::payloadQuery(uint8_t **payload, size_t *size,
     payloadSize = sizeof(struct apm_module_param_data_t) + querySize;
     padBytes = PAL_PADDING_8BYTE_ALIGN(payloadSize);
 
-    payloadInfo = new uint8_t[payloadSize + padBytes]();
+    payloadInfo = allocPayload(payloadSize + padBytes);
     if (!payloadInfo) {
         PAL_ERR(LOG_TAG, "payloadInfo malloc failed %s", strerror(errno));
         return;
@@ -1538,7 +1750,7 @@ void PayloadBuilder::payloadDOAInfo(uint8_t **payload, size_t *size, uint32_t mo
                   sizeof(struct ffv_doa_tracking_monitor_t);
     padBytes = PAL_PADDING_8BYTE_ALIGN(payloadSize);
 
-    payloadInfo = new uint8_t[payloadSize + padBytes]();
+    payloadInfo = allocPayload(payloadSize + padBytes);
     if (!payloadInfo) {
         PAL_ERR(LOG_TAG, "payloadInfo malloc failed %s", strerror(errno));
         return;
@@ -1573,7 +1785,7 @@ void PayloadBuilder::payloadTWSConfig(uint8_t** payload, size_t* size,
     }
     payloadSize = PAL_ALIGN_8BYTE(sizeof(struct apm_module_param_data_t)
                                         + customPayloadSize);
-    payloadInfo = (uint8_t *)calloc(1, (size_t)payloadSize);
+    payloadInfo = allocPayload((size_t)payloadSize);
     if (!payloadInfo) {
         PAL_ERR(LOG_TAG, "failed to allocate memory.");
         return;
@@ -1623,7 +1835,7 @@ void PayloadBuilder::payloadNRECConfig(uint8_t** payload, size_t* size,
 
     payloadSize = PAL_ALIGN_8BYTE(sizeof(struct apm_module_param_data_t)
                                         + customPayloadSize);
-    payloadInfo = (uint8_t *)calloc(1, (size_t)payloadSize);
+    payloadInfo = allocPayload((size_t)payloadSize);
     if (!payloadInfo) {
         PAL_ERR(LOG_TAG, "failed to allocate memory.");
         return;
@@ -1664,7 +1876,7 @@ void PayloadBuilder::payloadLC3Config(uint8_t** payload, size_t* size,
 
     payloadSize = PAL_ALIGN_8BYTE(sizeof(struct apm_module_param_data_t)
                                         + customPayloadSize);
-    payloadInfo = (uint8_t *)calloc(1, (size_t)payloadSize);
+    payloadInfo = allocPayload((size_t)payloadSize);
     if (!payloadInfo) {
         PAL_ERR(LOG_TAG, "failed to allocate memory.");
         return;
@@ -1713,7 +1925,7 @@ void PayloadBuilder::payloadRATConfig(uint8_t** payload, size_t* size,
                   sizeof(uint16_t)*numChannel;
     padBytes = PAL_PADDING_8BYTE_ALIGN(payloadSize);
 
-    payloadInfo = (uint8_t*) calloc(1, payloadSize + padBytes);
+    payloadInfo = allocPayload(payloadSize + padBytes);
     if (!payloadInfo) {
         PAL_ERR(LOG_TAG, "payloadInfo malloc failed %s", strerror(errno));
         return;
@@ -1775,7 +1987,7 @@ void PayloadBuilder::payloadPcmCnvConfig(uint8_t** payload, size_t* size,
                   sizeof(uint8_t)*numChannels;
     padBytes = PAL_PADDING_8BYTE_ALIGN(payloadSize);
 
-    payloadInfo = new uint8_t[payloadSize + padBytes]();
+    payloadInfo = allocPayload(payloadSize + padBytes);
     if (!payloadInfo) {
         PAL_ERR(LOG_TAG, "payloadInfo malloc failed %s", strerror(errno));
         return;
@@ -1821,7 +2033,7 @@ void PayloadBuilder::payloadPcmCnvConfig(uint8_t** payload, size_t* size,
         mediaFmtPayload->alignment       = PCM_MSB_ALIGNED;
     } else {
         PAL_ERR(LOG_TAG, "invalid bit width %d", data->bit_width);
-        delete[] payloadInfo;
+        freePayload(payloadInfo);
         *size = 0;
         *payload = NULL;
         return;
@@ -1859,7 +2071,7 @@ void PayloadBuilder::payloadCopPackConfig(uint8_t** payload, size_t* size,
                   sizeof(uint16_t)*numChannel;
     padBytes = PAL_PADDING_8BYTE_ALIGN(payloadSize);
 
-    payloadInfo = new uint8_t[payloadSize + padBytes]();
+    payloadInfo = allocPayload(payloadSize + padBytes);
     if (!payloadInfo) {
         PAL_ERR(LOG_TAG, "payloadInfo alloc failed %s", strerror(errno));
         return;
@@ -1903,7 +2115,7 @@ void PayloadBuilder::payloadScramblingConfig(uint8_t** payload, size_t* size,
                   sizeof(struct param_id_cop_pack_enable_scrambling_t);
     padBytes = PAL_PADDING_8BYTE_ALIGN(payloadSize);
 
-    payloadInfo = new uint8_t[payloadSize + padBytes]();
+    payloadInfo = allocPayload(payloadSize + padBytes);
     if (!payloadInfo) {
         PAL_ERR(LOG_TAG, "payloadInfo alloc failed %s", strerror(errno));
         return;
@@ -1951,7 +2163,7 @@ void PayloadBuilder::payloadCopV2PackConfig(uint8_t** payload, size_t* size,
                   sizeof(struct cop_v2_stream_info_map_t) * bleCfg->enc_cfg.stream_map_size;
     padBytes = PAL_PADDING_8BYTE_ALIGN(payloadSize);
 
-    payloadInfo = new uint8_t[payloadSize + padBytes]();
+    payloadInfo = allocPayload(payloadSize + padBytes);
     if (!payloadInfo) {
         PAL_ERR(LOG_TAG, "payloadInfo alloc failed %s", strerror(errno));
         return;
@@ -2018,7 +2230,7 @@ void PayloadBuilder::payloadCopV2DepackConfig(uint8_t** payload, size_t* size,
 
     padBytes = PAL_PADDING_8BYTE_ALIGN(payloadSize);
 
-    payloadInfo = new uint8_t[payloadSize + padBytes]();
+    payloadInfo = allocPayload(payloadSize + padBytes);
     if (!payloadInfo) {
         PAL_ERR(LOG_TAG, "payloadInfo alloc failed %s", strerror(errno));
         return;
@@ -2998,26 +3210,22 @@ int PayloadBuilder::populateCalKeyVector(Stream *s, std::vector <std::pair<int,i
 
     long voldB = 0;
     float vol = 0;
-    struct pal_volume_data *voldata = NULL;
-    voldata = (struct pal_volume_data *)calloc(1, (sizeof(uint32_t) +
-                      (sizeof(struct pal_channel_vol_kv) * (0xFFFF))));
-    if (!voldata) {
-        status = -ENOMEM;
-        goto exit;
-    }
+    /* only the first two pairs are used to pick the volume level */
+    struct pal_channel_vol_kv volPairs[2];
+    uint32_t noOfVolPairs = 0;
 
-    status = s->getVolumeData(voldata);
+    status = s->getVolumePairs(volPairs, 2, &noOfVolPairs);
     if (0 != status) {
         PAL_ERR(LOG_TAG,"getVolumeData Failed \n");
-        goto error_1;
+        goto exit;
     }
 
-    if (voldata->no_of_volpair == 1) {
-        vol = (voldata->volume_pair[0].vol);
+    if (noOfVolPairs == 1) {
+        vol = (volPairs[0].vol);
     } else {
-        vol = (voldata->volume_pair[0].vol + voldata->volume_pair[1].vol)/2;
-        PAL_VERBOSE(LOG_TAG,"volume sent left:%f , right: %f \n",(voldata->volume_pair[0].vol),
-                  (voldata->volume_pair[1].vol));
+        vol = (volPairs[0].vol + volPairs[1].vol)/2;
+        PAL_VERBOSE(LOG_TAG,"volume sent left:%f , right: %f \n",(volPairs[0].vol),
+                  (volPairs[1].vol));
     }
 
     /*scaling the volume by PLAYBACK_VOLUME_MAX factor*/
@@ -3162,8 +3370,6 @@ int PayloadBuilder::populateCalKeyVector(Stream *s, std::vector <std::pair<int,i
     }
 
     PAL_VERBOSE(LOG_TAG,"exit status- %d", status);
-error_1:
-    free(voldata);
 exit:
     return status;
 }
@@ -3411,7 +3617,7 @@ void PayloadBuilder::payloadSPConfig(uint8_t** payload, size_t* size, uint32_t m
                               sizeof(vi_r0t0_cfg_t) * data->num_speakers;
 
                 padBytes = PAL_PADDING_8BYTE_ALIGN(payloadSize);
-                payloadInfo = (uint8_t*) calloc(1, payloadSize + padBytes);
+                payloadInfo = allocPayload(payloadSize + padBytes);
                 if (!payloadInfo) {
                     PAL_ERR(LOG_TAG, "payloadInfo malloc failed %s", strerror(errno));
                     return;
@@ -3444,7 +3650,7 @@ void PayloadBuilder::payloadSPConfig(uint8_t** payload, size_t* size, uint32_t m
                               sizeof(uint32_t) * data->num_speakers;
 
                 padBytes = PAL_PADDING_8BYTE_ALIGN(payloadSize);
-                payloadInfo = (uint8_t*) calloc(1, payloadSize + padBytes);
+                payloadInfo = allocPayload(payloadSize + padBytes);
                 if (!payloadInfo) {
                     PAL_ERR(LOG_TAG, "payloadInfo malloc failed %s", strerror(errno));
                     return;
@@ -3485,7 +3691,7 @@ void PayloadBuilder::payloadSPConfig(uint8_t** payload, size_t* size, uint32_t m
 
                 padBytes = PAL_PADDING_8BYTE_ALIGN(payloadSize);
 
-                payloadInfo = (uint8_t*) calloc(1, payloadSize + padBytes);
+                payloadInfo = allocPayload(payloadSize + padBytes);
                 if (!payloadInfo) {
                     PAL_ERR(LOG_TAG, "payloadInfo malloc failed %s", strerror(errno));
                     return;
@@ -3515,7 +3721,7 @@ void PayloadBuilder::payloadSPConfig(uint8_t** payload, size_t* size, uint32_t m
 
                 padBytes = PAL_PADDING_8BYTE_ALIGN(payloadSize);
 
-                payloadInfo = (uint8_t*) calloc(1, payloadSize + padBytes);
+                payloadInfo = allocPayload(payloadSize + padBytes);
                 if (!payloadInfo) {
                     PAL_ERR(LOG_TAG, "payloadInfo malloc failed %s", strerror(errno));
                     return;
@@ -3539,7 +3745,7 @@ void PayloadBuilder::payloadSPConfig(uint8_t** payload, size_t* size, uint32_t m
 
                 padBytes = PAL_PADDING_8BYTE_ALIGN(payloadSize);
 
-                payloadInfo = (uint8_t*) calloc(1, payloadSize + padBytes);
+                payloadInfo = allocPayload(payloadSize + padBytes);
                 if (!payloadInfo) {
                     PAL_ERR(LOG_TAG, "payloadInfo malloc failed %s", strerror(errno));
                     return;
@@ -3567,7 +3773,7 @@ void PayloadBuilder::payloadSPConfig(uint8_t** payload, size_t* size, uint32_t m
                                     sizeof(vi_th_ftm_cfg_t) * data->num_ch;
 
                 padBytes = PAL_PADDING_8BYTE_ALIGN(payloadSize);
-                payloadInfo = (uint8_t*) calloc(1, payloadSize + padBytes);
+                payloadInfo = allocPayload(payloadSize + padBytes);
                 if (!payloadInfo) {
                     PAL_ERR(LOG_TAG, "payloadInfo malloc failed %s", strerror(errno));
                     return;
@@ -3596,7 +3802,7 @@ void PayloadBuilder::payloadSPConfig(uint8_t** payload, size_t* size, uint32_t m
                                     sizeof(param_id_sp_th_vi_ftm_params_t) +
                                     sizeof(vi_th_ftm_params_t) * data->num_ch;
                 padBytes = PAL_PADDING_8BYTE_ALIGN(payloadSize);
-                payloadInfo = (uint8_t*) calloc(1, payloadSize + padBytes);
+                payloadInfo = allocPayload(payloadSize + padBytes);
                 if (!payloadInfo) {
                     PAL_ERR(LOG_TAG, "payloadInfo malloc failed %s", strerror(errno));
                     return;
@@ -3612,7 +3818,7 @@ void PayloadBuilder::payloadSPConfig(uint8_t** payload, size_t* size, uint32_t m
                                     sizeof(param_id_sp_ex_vi_ftm_params_t) +
                                     sizeof(vi_ex_ftm_params_t) * data->num_ch;
                 padBytes = PAL_PADDING_8BYTE_ALIGN(payloadSize);
-                payloadInfo = (uint8_t*) calloc(1, payloadSize + padBytes);
+                payloadInfo = allocPayload(payloadSize + padBytes);
                 if (!payloadInfo) {
                     PAL_ERR(LOG_TAG, "payloadInfo malloc failed %s", strerror(errno));
                     return;
@@ -3632,7 +3838,7 @@ void PayloadBuilder::payloadSPConfig(uint8_t** payload, size_t* size, uint32_t m
                                     sizeof(uint32_t);
                 padBytes = PAL_PADDING_8BYTE_ALIGN(payloadSize);
 
-                payloadInfo = (uint8_t*) calloc(1, payloadSize + padBytes);
+                payloadInfo = allocPayload(payloadSize + padBytes);
                 if (!payloadInfo) {
                     PAL_ERR(LOG_TAG, "payloadInfo malloc failed %s", strerror(errno));
                     return;
@@ -3659,7 +3865,7 @@ void PayloadBuilder::payloadSPConfig(uint8_t** payload, size_t* size, uint32_t m
                                     (sizeof(cps_reg_wr_values_t) * data->num_spkr);
                 padBytes = PAL_PADDING_8BYTE_ALIGN(payloadSize);
 
-                payloadInfo = (uint8_t*) calloc(1, payloadSize + padBytes);
+                payloadInfo = allocPayload(payloadSize + padBytes);
                 if (!payloadInfo) {
                     PAL_ERR(LOG_TAG, "payloadInfo malloc failed %s", strerror(errno));
                     return;
@@ -3680,7 +3886,7 @@ void PayloadBuilder::payloadSPConfig(uint8_t** payload, size_t* size, uint32_t m
                                 sizeof(param_id_sp_vi_ch_enable_t) +
                                 (sizeof(int32_t) * data->num_ch);
                 padBytes = PAL_PADDING_8BYTE_ALIGN(payloadSize);
-                payloadInfo = (uint8_t*) calloc(1, payloadSize + padBytes);
+                payloadInfo = allocPayload(payloadSize + padBytes);
                 if (!payloadInfo) {
                     PAL_ERR(LOG_TAG, "payloadInfo malloc failed %s",
                                                             strerror(errno));
@@ -3703,7 +3909,7 @@ void PayloadBuilder::payloadSPConfig(uint8_t** payload, size_t* size, uint32_t m
                                 sizeof(param_id_sp_rx_ch_enable_t) +
                                 (sizeof(int32_t) * data->num_ch);
                 padBytes = PAL_PADDING_8BYTE_ALIGN(payloadSize);
-                payloadInfo = (uint8_t*) calloc(1, payloadSize + padBytes);
+                payloadInfo = allocPayload(payloadSize + padBytes);
                 if (!payloadInfo) {
                     PAL_ERR(LOG_TAG, "payloadInfo malloc failed %s",
                                                             strerror(errno));
@@ -0,0 +1,304 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the
+ * disclaimer below) provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *     * Neither the name of Qualcomm Innovation Center, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+ * GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+ * HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define LOG_TAG "PAL: SecondStageScheduler"
+
+#include <errno.h>
+#include <algorithm>
+#include "PalCommon.h"
+#include "SecondStageScheduler.h"
+
+std::shared_ptr<SecondStageScheduler> SecondStageScheduler::scheduler_ = nullptr;
+
+KeywordWindow::KeywordWindow(size_t capacity) :
+    reader_(nullptr),
+    data_(nullptr),
+    capacity_(0),
+    users_(0),
+    start_(0),
+    end_(0),
+    filled_(0),
+    advanced_(false),
+    filling_(false),
+    cancelled_(false),
+    status_(0)
+{
+    created_ = std::chrono::steady_clock::now();
+    if (capacity) {
+        data_ = (uint8_t *)calloc(1, capacity);
+        if (data_)
+            capacity_ = capacity;
+    }
+}
+
+KeywordWindow::~KeywordWindow()
+{
+    if (data_)
+        free(data_);
+    if (reader_ && users_)
+        reader_->updateState(READER_DISABLED);
+}
+
+void KeywordWindow::Reset()
+{
+    std::lock_guard<std::mutex> lck(mutex_);
+
+    reader_ = nullptr;
+    users_ = 0;
+    start_ = 0;
+    end_ = 0;
+    filled_ = 0;
+    advanced_ = false;
+    filling_ = false;
+    cancelled_ = false;
+    status_ = 0;
+    created_ = std::chrono::steady_clock::now();
+}
+
+int32_t KeywordWindow::Reserve(PalRingBufferReader *reader, uint32_t start,
+                               uint32_t end)
+{
+    std::lock_guard<std::mutex> lck(mutex_);
+
+    if (filled_ || filling_) {
+        PAL_ERR(LOG_TAG, "window already in use, ignore %u - %u", start, end);
+        return -EBUSY;
+    }
+
+    users_++;
+    /* only the first reader is consumed, the others stay disabled */
+    if (!reader_) {
+        reader_ = reader;
+        reader_->updateState(READER_ENABLED);
+        start_ = start;
+        end_ = end;
+    } else {
+        start_ = std::min(start_, start);
+        end_ = std::max(end_, end);
+    }
+    PAL_DBG(LOG_TAG, "window start %u end %u", start_, end_);
+    return 0;
+}
+
+void KeywordWindow::Done()
+{
+    std::lock_guard<std::mutex> lck(mutex_);
+
+    if (!users_)
+        return;
+    if (--users_ == 0 && reader_)
+        reader_->updateState(READER_DISABLED);
+}
+
+/* runs without the window lock, only the filler touches data past filled_ */
+int32_t KeywordWindow::Fill(uint32_t filled)
+{
+    if (!reader_->isEnabled())
+        return -EINVAL;
+
+    if (!advanced_ && start_ > 0) {
+        if (reader_->getUnreadSize() < start_)
+            return 0;
+        if (!reader_->advanceReadOffset(start_))
+            return 0;
+        advanced_ = true;
+    }
+
+    if (!reader_->getUnreadSize())
+        return 0;
+
+    return reader_->read(data_ + filled, end_ - start_ - filled);
+}
+
+const uint8_t *KeywordWindow::Wait(uint32_t offset, uint32_t size,
+                                   int32_t *status)
+{
+    int32_t read_size = 0;
+    std::unique_lock<std::mutex> lck(mutex_);
+
+    if (!reader_ || offset < start_ || offset + size > end_) {
+        PAL_ERR(LOG_TAG, "%u - %u outside of window %u - %u",
+                offset, offset + size, start_, end_);
+        *status = -EINVAL;
+        return nullptr;
+    }
+
+    if (capacity_ < end_ - start_ && !filling_ && !status_) {
+        PAL_DBG(LOG_TAG, "grow window from %zu to %u bytes", capacity_,
+                end_ - start_);
+        if (data_)
+            free(data_);
+        capacity_ = 0;
+        data_ = (uint8_t *)calloc(1, end_ - start_);
+        if (!data_) {
+            PAL_ERR(LOG_TAG, "failed to allocate window of %u bytes",
+                    end_ - start_);
+            status_ = -ENOMEM;
+        } else {
+            capacity_ = end_ - start_;
+        }
+    }
+
+    while (!cancelled_ && !status_ && filled_ < offset + size - start_) {
+        if (filling_) {
+            cv_.wait(lck);
+            continue;
+        }
+        filling_ = true;
+        lck.unlock();
+        read_size = Fill(filled_);
+        lck.lock();
+        filling_ = false;
+        if (read_size < 0) {
+            PAL_ERR(LOG_TAG, "Failed to read from buffer, status %d", read_size);
+            status_ = read_size;
+        } else {
+            filled_ += read_size;
+        }
+        cv_.notify_all();
+        if (read_size == 0)
+            cv_.wait_for(lck, std::chrono::milliseconds(ST_SS_DATA_POLL_MS));
+    }
+
+    if (cancelled_) {
+        *status = -ECANCELED;
+        return nullptr;
+    }
+    if (status_) {
+        *status = status_;
+        return nullptr;
+    }
+
+    *status = 0;
+    return data_ + offset - start_;
+}
+
+void KeywordWindow::Cancel()
+{
+    std::lock_guard<std::mutex> lck(mutex_);
+
+    cancelled_ = true;
+    cv_.notify_all();
+}
+
+bool KeywordWindow::IsCancelled()
+{
+    std::lock_guard<std::mutex> lck(mutex_);
+
+    return cancelled_;
+}
+
+uint64_t KeywordWindow::GetElapsedMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - created_).count();
+}
+
+SecondStageScheduler::SecondStageScheduler() :
+    head_(nullptr),
+    tail_(nullptr),
+    pending_(0),
+    exit_(false)
+{
+    for (int i = 0; i < ST_SS_MAX_WORKERS; i++)
+        workers_.push_back(std::thread(&SecondStageScheduler::WorkerLoop, this));
+}
+
+SecondStageScheduler::~SecondStageScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lck(mutex_);
+        exit_ = true;
+    }
+    cv_.notify_all();
+
+    for (auto &worker : workers_) {
+        if (worker.joinable())
+            worker.join();
+    }
+}
+
+std::shared_ptr<SecondStageScheduler> SecondStageScheduler::GetInstance()
+{
+    static std::once_flag once;
+
+    std::call_once(once, [] {
+        scheduler_ = std::shared_ptr<SecondStageScheduler>(
+            new SecondStageScheduler());
+    });
+    return scheduler_;
+}
+
+void SecondStageScheduler::Submit(SecondStageTask *task)
+{
+    {
+        std::lock_guard<std::mutex> lck(mutex_);
+        if (task->queued)
+            return;
+        task->queued = true;
+        task->next = nullptr;
+        if (tail_)
+            tail_->next = task;
+        else
+            head_ = task;
+        tail_ = task;
+        pending_++;
+        PAL_VERBOSE(LOG_TAG, "%zu jobs pending", pending_);
+    }
+    cv_.notify_one();
+}
+
+void SecondStageScheduler::WorkerLoop()
+{
+    SecondStageTask *task = nullptr;
+    std::unique_lock<std::mutex> lck(mutex_);
+
+    while (1) {
+        cv_.wait(lck, [this] { return exit_ || head_; });
+        if (exit_)
+            break;
+
+        task = head_;
+        head_ = task->next;
+        if (!head_)
+            tail_ = nullptr;
+        pending_--;
+        /* the owner may queue the slot again as soon as it starts running */
+        task->next = nullptr;
+        task->queued = false;
+        lck.unlock();
+        task->run(task->arg);
+        lck.lock();
+    }
+}
@@ -59,7 +59,7 @@ Session::Session()
 
 Session::~Session()
 {
-
+    resetVolumeCache();
 }
 
 void Session::setPmQosMixerCtl(pmQosVote vote)
@@ -285,8 +285,6 @@ int Session::rwACDBParameters(void *payload, uint32_t sampleRate,
                                 bool isParamWrite)
 {
     int status = 0;
-    uint8_t *payloadData = NULL;
-    size_t payloadSize = 0;
     int device = 0;
     uint32_t miid = 0;
     char const *control = "setParamTagACDB";
@@ -296,6 +294,9 @@ int Session::rwACDBParameters(void *payload, uint32_t sampleRate,
     PayloadBuilder builder;
     pal_param_payload *paramPayload = nullptr;
     agm_acdb_param *effectACDBPayload = nullptr;
+    pal_key_value_pair_t *kvs = nullptr;
+    calCacheKey calKey;
+    std::shared_ptr<std::vector<uint8_t>> acdbPayload = nullptr;
     paramPayload = (pal_param_payload *)payload;
     if (!paramPayload)
         return -EINVAL;
@@ -337,28 +338,140 @@ int Session::rwACDBParameters(void *payload, uint32_t sampleRate,
     effectCustomPayload =
         (pal_effect_custom_payload_t *)(effectACDBPayload->blob);
 
-    status = builder.payloadACDBParam(&payloadData, &payloadSize,
-                            (uint8_t *)effectACDBPayload,
-                            miid, sampleRate);
-    if (!payloadData) {
+    /* the packed payload only depends on the client parameter and miid */
+    calKey.miid = miid;
+    calKey.graphKey.push_back(std::make_pair((int)effectACDBPayload->isTKV,
+                                             (int)sampleRate));
+    kvs = (pal_key_value_pair_t *)effectACDBPayload->blob;
+    for (int k = 0; k < effectACDBPayload->num_kvs; k++)
+        calKey.ckv.push_back(std::make_pair((int)kvs[k].key, (int)kvs[k].value));
+    calKey.setParam((uint8_t *)effectACDBPayload,
+                    sizeof(struct agm_acdb_param) + effectACDBPayload->blob_size);
+
+    acdbPayload = CalibrationCache::getInstance()->getPayload(calKey,
+            [&](uint8_t **data, size_t *size) -> int {
+                return builder.payloadACDBParam(data, size,
+                        (uint8_t *)effectACDBPayload, miid, sampleRate);
+            }, nullptr);
+    if (!acdbPayload) {
         PAL_ERR(LOG_TAG, "failed to create payload data.");
+        status = -EINVAL;
         goto exit;
     }
 
    if (isParamWrite) {
-        status = mixer_ctl_set_array(ctl, payloadData, payloadSize);
+        /* the cache hands out the same payload for the same parameter */
+        if (acdbPayload == appliedAcdbPayload &&
+            appliedAcdbGeneration == CalibrationCache::getInstance()->getGeneration()) {
+            PAL_DBG(LOG_TAG, "ACDB parameter unchanged, skip write");
+            CalibrationCache::getInstance()->noteSkippedWrite();
+            goto exit;
+        }
+        status = mixer_ctl_set_array(ctl, acdbPayload->data(), acdbPayload->size());
         if (0 != status) {
             PAL_ERR(LOG_TAG, "Set custom config failed, status = %d", status);
             goto exit;
         }
+        /* ACDB content changed, prebuilt calibration payloads are stale */
+        appliedAcdbGeneration = CalibrationCache::getInstance()->invalidate();
+        appliedAcdbPayload = acdbPayload;
     }
 
 exit:
-    free(payloadData);
     PAL_ERR(LOG_TAG, "Exit. status %d", status);
     return status;
 }
 
+bool Session::isCalUnchanged(const calCacheKey &key)
+{
+    if (!isCalApplied)
+        return false;
+
+    return (appliedCalGeneration == CalibrationCache::getInstance()->getGeneration()) &&
+           (appliedCalKey == key);
+}
+
+void Session::markCalApplied(const calCacheKey &key, uint32_t generation)
+{
+    appliedCalKey = key;
+    appliedCalGeneration = generation;
+    isCalApplied = true;
+}
+
+void Session::resetCalState()
+{
+    isCalApplied = false;
+    appliedCalKey.ckv.clear();
+    appliedCalKey.graphKey.clear();
+    appliedAcdbPayload = nullptr;
+}
+
+void Session::getCalGraphKey(pal_stream_type_t type, const std::vector<int> &feIds,
+        std::vector<std::pair<int, int>> &graphKey)
+{
+    graphKey.clear();
+    graphKey.push_back(std::make_pair((int)type, feIds.size() ? feIds.at(0) : -1));
+    for (auto &be : rxAifBackEnds)
+        graphKey.push_back(std::make_pair((int)PAL_AUDIO_OUTPUT, be.first));
+    for (auto &be : txAifBackEnds)
+        graphKey.push_back(std::make_pair((int)PAL_AUDIO_INPUT, be.first));
+}
+
+void Session::cacheVolumeMiid(int device, uint32_t miid)
+{
+    volMiid = miid;
+    volMiidDevice = device;
+    isVolMiidValid = true;
+}
+
+/*
+ * Sends a volume set param, patching the payload kept from the previous
+ * call in place when the module and layout still match.
+ */
+int Session::setVolumeParam(PayloadBuilder *builder, int device, uint32_t miid,
+        struct pal_volume_data *vdata, bool multiCh)
+{
+    uint8_t *payload = NULL;
+    size_t payloadSize = 0;
+
+    if (!volParamData ||
+        builder->updateVolumePayload(volParamData, volParamSize, miid, vdata, multiCh)) {
+        if (multiCh)
+            builder->payloadMultichVolumemConfig(&payload, &payloadSize, miid, vdata);
+        else
+            builder->payloadVolumeConfig(&payload, &payloadSize, miid, vdata);
+        if (!payload || !payloadSize)
+            return -ENOMEM;
+
+        /* keep a heap copy, the builder may hand out scoped scratch memory */
+        if (payloadSize > volParamSize || !volParamData) {
+            free(volParamData);
+            volParamData = (uint8_t *)malloc(payloadSize);
+            if (!volParamData) {
+                volParamSize = 0;
+                PayloadBuilder::releasePayload(payload);
+                return -ENOMEM;
+            }
+        }
+        memcpy(volParamData, payload, payloadSize);
+        volParamSize = payloadSize;
+        PayloadBuilder::releasePayload(payload);
+    }
+
+    return SessionAlsaUtils::setMixerParameter(mixer, device, volParamData, volParamSize);
+}
+
+void Session::resetVolumeCache()
+{
+    isVolMiidValid = false;
+    volMiidDevice = -1;
+    if (volParamData) {
+        free(volParamData);
+        volParamData = NULL;
+    }
+    volParamSize = 0;
+}
+
 int Session::rwACDBParamTunnel(void *payload, pal_device_id_t palDeviceId,
                         pal_stream_type_t palStreamType, uint32_t sampleRate,
                         uint32_t instanceId, bool isParamWrite, Stream * s)
@@ -388,15 +501,25 @@ exit:
 
 int Session::updateCustomPayload(void *payload, size_t size)
 {
-    if (!customPayloadSize || !customPayload) {
-        customPayload = calloc(1, size);
-    } else {
-        customPayload = realloc(customPayload, customPayloadSize + size);
-    }
+    size_t capacity = 0;
+    void *newPayload = nullptr;
 
     if (!customPayload) {
-        PAL_ERR(LOG_TAG, "failed to allocate memory for custom payload");
-        return -ENOMEM;
+        customPayloadSize = 0;
+        customPayloadCapacity = 0;
+    }
+
+    /* grow geometrically so a multi-module start reallocates rarely */
+    if (customPayloadSize + size > customPayloadCapacity) {
+        capacity = std::max(customPayloadSize + size,
+                            std::max(customPayloadCapacity * 2, (size_t)CUSTOM_PAYLOAD_MIN_SIZE));
+        newPayload = realloc(customPayload, capacity);
+        if (!newPayload) {
+            PAL_ERR(LOG_TAG, "failed to allocate memory for custom payload");
+            return -ENOMEM;
+        }
+        customPayload = newPayload;
+        customPayloadCapacity = capacity;
     }
 
     memcpy((uint8_t *)customPayload + customPayloadSize, payload, size);
@@ -417,7 +540,7 @@ int Session::getCustomPayload(uint8_t **payload, size_t *payloadSize)
 int Session::freeCustomPayload(uint8_t **payload, size_t *payloadSize)
 {
     if (*payload) {
-        free(*payload);
+        PayloadBuilder::releasePayload(*payload);
         *payload = NULL;
         *payloadSize = 0;
     }
@@ -430,6 +553,7 @@ int Session::freeCustomPayload()
         free(customPayload);
         customPayload = NULL;
         customPayloadSize = 0;
+        customPayloadCapacity = 0;
     }
     return 0;
 }
@@ -518,7 +642,7 @@ int Session::handleDeviceRotation(Stream *s, pal_speaker_rotation_type rotation_
 
                 if (alsaPayloadSize) {
                     status = updateCustomPayload(alsaParamData, alsaPayloadSize);
-                    delete alsaParamData;
+                    PayloadBuilder::releasePayload(alsaParamData);
                     if (0 != status) {
                         PAL_ERR(LOG_TAG, "updateCustomPayload Failed\n");
                         return status;
@@ -628,7 +752,8 @@ int Session::configureMFC(const std::shared_ptr<ResourceManager>& rm, struct pal
     size_t payloadSize = 0;
     struct pal_media_config codecConfig;
     struct sessionToPayloadParam mfcData;
-    PayloadBuilder* builder = new PayloadBuilder();
+    PayloadBuilder* builder = PayloadBuilder::getThreadBuilder();
+    PayloadScope scope(builder);
     uint32_t miid = 0;
     bool devicePPMFCSet =  true;
 
@@ -757,10 +882,6 @@ int Session::configureMFC(const std::shared_ptr<ResourceManager>& rm, struct pal
     }
 
 exit:
-    if (builder) {
-        delete builder;
-        builder = NULL;
-    }
     return status;
 }
 
@@ -44,7 +44,6 @@
 void eventCallback(uint32_t session_id, struct agm_event_cb_params *event_params __unused,
                   void *client_data)
 {
-    struct pal_stream_attributes sAttr;
     SessionAgm *sessAgm = NULL;
     uint32_t event_id = 0;
     void *event_data = NULL;
@@ -65,7 +64,6 @@ void eventCallback(uint32_t session_id, struct agm_event_cb_params *event_params
     }
 
     PAL_VERBOSE(LOG_TAG, "event_callback session id %d event id %d", session_id, event_params->event_id);
-    sessAgm->streamHandle->getStreamAttributes(&sAttr);
 
     if (event_params->event_id == AGM_EVENT_READ_DONE ||
         event_params->event_id == AGM_EVENT_WRITE_DONE) {
@@ -94,7 +92,7 @@ void eventCallback(uint32_t session_id, struct agm_event_cb_params *event_params
         rw_done_payload->buff.alloc_info.offset =
                                       agm_rw_done_payload->buff.alloc_info.offset;
 
-        if (sAttr.flags & PAL_STREAM_FLAG_TIMESTAMP) {
+        if (sessAgm->streamFlags & PAL_STREAM_FLAG_TIMESTAMP) {
             rw_done_payload->buff.ts = (struct timespec *)calloc(1, sizeof(struct timespec));
 
             if(!rw_done_payload->buff.ts){
@@ -234,6 +232,7 @@ SessionAgm::SessionAgm(std::shared_ptr<ResourceManager> Rm)
     this->cbCookie = 0;
     playback_started = false;
     playback_paused = false;
+    streamFlags = 0;
 }
 
 SessionAgm::~SessionAgm()
@@ -255,6 +254,7 @@ int SessionAgm::open(Stream * strm)
         goto exit;
     }
 
+    streamFlags = sAttr.flags;
     ioMode = sAttr.flags & PAL_STREAM_FLAG_NON_BLOCKING_MASK;
     if (!ioMode) {
         PAL_ERR(LOG_TAG, "IO mode 0x%x not supported", ioMode);
@@ -454,14 +454,39 @@ int SessionAgm::stop(Stream * s __unused)
     return status;
 }
 
-int SessionAgm::read(Stream *s, int tag __unused, struct pal_buffer *buf, int *size )
+int SessionAgm::fillAgmBuffer(struct pal_buffer *buf, struct agm_buff *agm_buffer,
+                              bool isWrite)
+{
+    agm_buffer->size = buf->size;
+    agm_buffer->metadata_size = buf->metadata_size;
+    agm_buffer->metadata = buf->metadata;
+    if (buf->ts && (streamFlags & PAL_STREAM_FLAG_TIMESTAMP)) {
+       agm_buffer->flags = AGM_BUFF_FLAG_TS_VALID;
+       if (ULONG_MAX/MICRO_SECS_PER_SEC > buf->ts->tv_sec) {
+           agm_buffer->timestamp =
+               buf->ts->tv_sec * MICRO_SECS_PER_SEC +  (buf->ts->tv_nsec/1000);
+       } else {
+           PAL_ERR(LOG_TAG, "timestamp tv_sec overflown %lu", buf->ts->tv_sec);
+           return -EINVAL;
+       }
+    }
+    if (isWrite && (buf->flags & PAL_STREAM_FLAG_EOF))
+       agm_buffer->flags |= AGM_BUFF_FLAG_EOF;
+    agm_buffer->addr = buf->buffer;
+    if (streamFlags & PAL_STREAM_FLAG_EXTERN_MEM) {
+        agm_buffer->alloc_info.alloc_handle = buf->alloc_info.alloc_handle;
+        agm_buffer->alloc_info.alloc_size = buf->alloc_info.alloc_size;
+        agm_buffer->alloc_info.offset = buf->alloc_info.offset;
+    }
+    return 0;
+}
+
+int SessionAgm::read(Stream *s __unused, int tag __unused, struct pal_buffer *buf, int *size )
 {
     uint32_t bytes_read = 0;
     int status;
     struct agm_buff agm_buffer = {0, 0, 0, NULL, 0, NULL, {0, 0, 0}};
-    struct pal_stream_attributes sAttr;
 
-    s->getStreamAttributes(&sAttr);
     if (!buf) {
         PAL_VERBOSE(LOG_TAG, "buf: %pK, size: %zu",
                     buf, (buf ? buf->size : 0));
@@ -471,25 +496,9 @@ int SessionAgm::read(Stream *s, int tag __unused, struct pal_buffer *buf, int *s
         PAL_ERR(LOG_TAG, "NULL pointer access,agmSessHandle is invalid");
         return -EINVAL;
     }
-    agm_buffer.size = buf->size;
-    agm_buffer.metadata_size = buf->metadata_size;
-    agm_buffer.metadata = buf->metadata;
-    if (buf->ts && (sAttr.flags & PAL_STREAM_FLAG_TIMESTAMP)) {
-       agm_buffer.flags = AGM_BUFF_FLAG_TS_VALID;
-       if (ULONG_MAX/MICRO_SECS_PER_SEC > buf->ts->tv_sec) {
-           agm_buffer.timestamp =
-               buf->ts->tv_sec * MICRO_SECS_PER_SEC +  (buf->ts->tv_nsec/1000);
-       } else {
-           PAL_ERR(LOG_TAG, "timestamp tv_sec overflown %lu", buf->ts->tv_sec);
-           return -EINVAL;
-       }
-    }
-    agm_buffer.addr = buf->buffer;
-    if (sAttr.flags & PAL_STREAM_FLAG_EXTERN_MEM) {
-        agm_buffer.alloc_info.alloc_handle = buf->alloc_info.alloc_handle;
-        agm_buffer.alloc_info.alloc_size = buf->alloc_info.alloc_size;
-        agm_buffer.alloc_info.offset = buf->alloc_info.offset;
-    }
+    status = fillAgmBuffer(buf, &agm_buffer, false);
+    if (status)
+        return status;
 
     status = agm_session_read_with_metadata(agmSessHandle, &agm_buffer, &bytes_read);
 
@@ -518,14 +527,12 @@ int SessionAgm::fileWrite(Stream *s __unused, int tag __unused, struct pal_buffe
     return 0;
 }
 
-int SessionAgm::write(Stream *s, int tag __unused, struct pal_buffer *buf, int * size, int flag __unused)
+int SessionAgm::write(Stream *s __unused, int tag __unused, struct pal_buffer *buf, int * size, int flag __unused)
 {
     size_t bytes_written = 0;
     int status;
     struct agm_buff agm_buffer = {0, 0, 0, NULL, 0, NULL, {0, 0, 0}};
-    struct pal_stream_attributes sAttr;
 
-    s->getStreamAttributes(&sAttr);
     if (!buf) {
         PAL_VERBOSE(LOG_TAG, "buf: %pK, size: %zu",
                     buf, (buf ? buf->size : 0));
@@ -535,27 +542,9 @@ int SessionAgm::write(Stream *s, int tag __unused, struct pal_buffer *buf, int *
         PAL_ERR(LOG_TAG, "NULL pointer access,agmSessHandle is invalid");
         return -EINVAL;
     }
-    agm_buffer.size = buf->size;
-    agm_buffer.metadata_size = buf->metadata_size;
-    agm_buffer.metadata = buf->metadata;
-    if (buf->ts && (sAttr.flags & PAL_STREAM_FLAG_TIMESTAMP)) {
-       agm_buffer.flags = AGM_BUFF_FLAG_TS_VALID;
-       if (ULONG_MAX/MICRO_SECS_PER_SEC > buf->ts->tv_sec) {
-           agm_buffer.timestamp =
-               buf->ts->tv_sec * MICRO_SECS_PER_SEC +  (buf->ts->tv_nsec/1000);
-       } else {
-           PAL_ERR(LOG_TAG, "timestamp tv_sec overflown %lu", buf->ts->tv_sec);
-           return -EINVAL;
-       }
-    }
-    if (buf->flags & PAL_STREAM_FLAG_EOF)
-       agm_buffer.flags |= AGM_BUFF_FLAG_EOF;
-    agm_buffer.addr = buf->buffer;
-    if (sAttr.flags & PAL_STREAM_FLAG_EXTERN_MEM) {
-        agm_buffer.alloc_info.alloc_handle = buf->alloc_info.alloc_handle;
-        agm_buffer.alloc_info.alloc_size = buf->alloc_info.alloc_size;
-        agm_buffer.alloc_info.offset = buf->alloc_info.offset;
-    }
+    status = fillAgmBuffer(buf, &agm_buffer, true);
+    if (status)
+        return status;
 
     status = agm_session_write_with_metadata(agmSessHandle, &agm_buffer, &bytes_written);
 
@@ -567,6 +556,71 @@ int SessionAgm::write(Stream *s, int tag __unused, struct pal_buffer *buf, int *
     return status;
 }
 
+/*
+ * Queues the buffers to AGM back to back, each one is returned through its
+ * own read done/write ready event. Stops at the first buffer AGM rejects,
+ * queued tells how many made it.
+ */
+int SessionAgm::queueBuffers(struct pal_buffer *bufs, uint32_t count,
+                             bool isWrite, uint32_t *queued)
+{
+    int status = 0;
+    uint32_t i = 0;
+    size_t bytes_written = 0;
+    uint32_t bytes_read = 0;
+    struct agm_buff agm_buffer;
+
+    *queued = 0;
+    if (!bufs || !count) {
+        PAL_ERR(LOG_TAG, "Invalid buffers %pK count %u", bufs, count);
+        return -EINVAL;
+    }
+    if (!agmSessHandle) {
+        PAL_ERR(LOG_TAG, "NULL pointer access,agmSessHandle is invalid");
+        return -EINVAL;
+    }
+    /* the stream checked for a client callback */
+    if (!(streamFlags & PAL_STREAM_FLAG_EXTERN_MEM)) {
+        PAL_ERR(LOG_TAG, "queued %s needs extern mem, flags 0x%x",
+                isWrite ? "write" : "read", streamFlags);
+        return -EINVAL;
+    }
+
+    for (i = 0; i < count; i++) {
+        memset(&agm_buffer, 0, sizeof(agm_buffer));
+        status = fillAgmBuffer(&bufs[i], &agm_buffer, isWrite);
+        if (status)
+            break;
+        if (isWrite)
+            status = agm_session_write_with_metadata(agmSessHandle, &agm_buffer,
+                                                     &bytes_written);
+        else
+            status = agm_session_read_with_metadata(agmSessHandle, &agm_buffer,
+                                                    &bytes_read);
+        if (status) {
+            PAL_ERR(LOG_TAG, "%s of buffer %u failed, status %d",
+                    isWrite ? "write" : "read", i, status);
+            break;
+        }
+    }
+    *queued = i;
+    PAL_VERBOSE(LOG_TAG, "queued %u of %u buffers", i, count);
+
+    return i ? 0 : status;
+}
+
+int SessionAgm::writeBuffers(Stream *s __unused, struct pal_buffer *bufs,
+                             uint32_t count, uint32_t *queued)
+{
+    return queueBuffers(bufs, count, true, queued);
+}
+
+int SessionAgm::readBuffers(Stream *s __unused, struct pal_buffer *bufs,
+                            uint32_t count, uint32_t *queued)
+{
+    return queueBuffers(bufs, count, false, queued);
+}
+
 int SessionAgm::setParameters(Stream *s __unused, int tagId __unused, uint32_t param_id, void *payload)
 {
     int32_t status = 0;
@@ -611,6 +611,9 @@ void SessionAlsaCompress::offloadThreadLoop(SessionAlsaCompress* compressObj)
                     PAL_VERBOSE(LOG_TAG, "calling compress_wait");
                     ret = compress_wait(compressObj->compress, -1);
                     PAL_VERBOSE(LOG_TAG, "out of compress_wait, ret %d", ret);
+                    /* a fragment was consumed, a period boundary for the mirror */
+                    if (!ret)
+                        compressObj->publishDspTime();
                     event_id = PAL_STREAM_CBK_EVENT_WRITE_READY;
                 }
             } else if (msg && msg->cmd == OFFLOAD_CMD_DRAIN) {
@@ -693,6 +696,8 @@ SessionAlsaCompress::SessionAlsaCompress(std::shared_ptr<ResourceManager> Rm)
 
 SessionAlsaCompress::~SessionAlsaCompress()
 {
+    if (cbCookie)
+        rm->waitMixerEventCallbacks(cbCookie);
     delete builder;
 }
 
@@ -801,6 +806,8 @@ int SessionAlsaCompress::disconnectSessionDevice(Stream* streamHandle, pal_strea
     std::vector<std::pair<int32_t, std::string>> txAifBackEndsToDisconnect;
     int32_t status = 0;
 
+    resetCalState();
+    resetVolumeCache();
     deviceList.push_back(deviceToDisconnect);
     rm->getBackEndNames(deviceList, rxAifBackEndsToDisconnect,
             txAifBackEndsToDisconnect);
@@ -879,6 +886,8 @@ int SessionAlsaCompress::connectSessionDevice(Stream* streamHandle, pal_stream_t
     std::vector<std::pair<int32_t, std::string>> txAifBackEndsToConnect;
     int32_t status = 0;
 
+    resetCalState();
+    resetVolumeCache();
     deviceList.push_back(deviceToConnect);
     rm->getBackEndNames(deviceList, rxAifBackEndsToConnect,
             txAifBackEndsToConnect);
@@ -1059,12 +1068,10 @@ int SessionAlsaCompress::setConfig(Stream * s, configType type, int tag)
     const char *setCalibrationControl = "setCalibration";
     const char *setBEControl = "control";
     struct mixer_ctl *ctl;
-    struct agm_cal_config *calConfig;
     std::ostringstream beCntrlName;
     std::ostringstream tagCntrlName;
     std::ostringstream calCntrlName;
     int tkv_size = 0;
-    int ckv_size = 0;
 
     PAL_DBG(LOG_TAG, "Enter");
     status = s->getStreamAttributes(&sAttr);
@@ -1137,6 +1144,11 @@ int SessionAlsaCompress::setConfig(Stream * s, configType type, int tag)
             break;
             //todo calibration
         case CALIBRATION:
+        {
+            calCacheKey calKey;
+            uint32_t calGen = 0;
+            std::shared_ptr<std::vector<uint8_t>> calPayload = nullptr;
+
             ckv.clear();
             status = builder->populateCalKeyVector(s, ckv, tag);
             if (0 != status) {
@@ -1148,13 +1160,30 @@ int SessionAlsaCompress::setConfig(Stream * s, configType type, int tag)
                 goto exit;
             }
 
-            calConfig = (struct agm_cal_config*)malloc (sizeof(struct agm_cal_config) +
-                            (ckv.size() * sizeof(agm_key_value)));
-            if (!calConfig) {
+            calKey.ckv = ckv;
+            getCalGraphKey(sAttr.type, compressDevIds, calKey.graphKey);
+            if (isCalUnchanged(calKey)) {
+                PAL_DBG(LOG_TAG, "calibration unchanged for tag 0x%x, skip", tag);
+                CalibrationCache::getInstance()->noteSkippedWrite();
+                ckv.clear();
+                break;
+            }
+
+            calPayload = CalibrationCache::getInstance()->getPayload(calKey,
+                    [this](uint8_t **payload, size_t *size) -> int {
+                        size_t calSize = sizeof(struct agm_cal_config) +
+                                         (ckv.size() * sizeof(agm_key_value));
+                        *payload = (uint8_t *)calloc(1, calSize);
+                        if (!*payload)
+                            return -ENOMEM;
+                        *size = calSize;
+                        return SessionAlsaUtils::getCalMetadata(ckv,
+                                (struct agm_cal_config *)*payload);
+                    }, &calGen);
+            if (!calPayload) {
                 status = -EINVAL;
                 goto exit;
             }
-            status = SessionAlsaUtils::getCalMetadata(ckv, calConfig);
             //TODO: how to get the id '0'
             calCntrlName<<stream<<compressDevIds.at(0)<<" "<<setCalibrationControl;
             ctl = mixer_get_ctl_by_name(mixer, calCntrlName.str().data());
@@ -1163,17 +1192,17 @@ int SessionAlsaCompress::setConfig(Stream * s, configType type, int tag)
                 return -ENOENT;
             }
             PAL_VERBOSE(LOG_TAG, "mixer control: %s\n", calCntrlName.str().data());
-            ckv_size = ckv.size()*sizeof(struct agm_key_value);
             //TODO make struct mixer and struct pcm as class private variables.
-            status = mixer_ctl_set_array(ctl, calConfig, sizeof(struct agm_cal_config) + ckv_size);
+            status = mixer_ctl_set_array(ctl, calPayload->data(), calPayload->size());
             if (status != 0) {
                 PAL_ERR(LOG_TAG, "failed to set the tag calibration %d", status);
+            } else {
+                markCalApplied(calKey, calGen);
             }
             ctl = NULL;
-            if (calConfig)
-                free(calConfig);
             ckv.clear();
             break;
+        }
         default:
             PAL_ERR(LOG_TAG, "invalid type ");
             status = -EINVAL;
@@ -1245,6 +1274,7 @@ int SessionAlsaCompress::start(Stream * s)
     uint8_t* payload = NULL;
     size_t payloadSize = 0;
     struct sessionToPayloadParam streamData;
+    PayloadScope payloadScope(builder);
     memset(&streamData, 0, sizeof(struct sessionToPayloadParam));
 
     PAL_DBG(LOG_TAG, "Enter");
@@ -1551,6 +1581,8 @@ int SessionAlsaCompress::close(Stream * s)
 
     PAL_DBG(LOG_TAG, "Enter");
 
+    resetCalState();
+    resetVolumeCache();
     s->getStreamAttributes(&sAttr);
     status = s->getAssociatedDevices(associatedDevices);
     if (status != 0) {
@@ -1738,11 +1770,28 @@ int SessionAlsaCompress::write(Stream *s __unused, int tag __unused, struct pal_
         playback_started = true;
     }
 
+    /* a blocking write returns at a fragment boundary */
+    if (!non_blocking && bytes_written > 0)
+        publishDspTime();
+
     if (size)
         *size = bytes_written;
     return 0;
 }
 
+/* compressed data has no frame count, the mirror gets the DSP time */
+void SessionAlsaCompress::publishDspTime()
+{
+    struct pal_session_time stime;
+
+    if (!streamHandle || !streamHandle->isPositionMirrored())
+        return;
+
+    memset(&stime, 0, sizeof(stime));
+    if (!getTimestamp(&stime))
+        streamHandle->publishSessionTime(&stime);
+}
+
 int SessionAlsaCompress::readBufferInit(Stream *s __unused, size_t noOfBuf __unused, size_t bufSize __unused, int flag __unused)
 {
     return 0;
@@ -1935,7 +1984,11 @@ int SessionAlsaCompress::setParameters(Stream *s __unused, int tagId, uint32_t p
             pal_param_payload *param_payload = (pal_param_payload *)payload;
             pal_volume_data *vdata = (struct pal_volume_data *)param_payload->payload;
             status = streamHandle->getStreamAttributes(&sAttr);
-            if (sAttr.direction == PAL_AUDIO_OUTPUT) {
+            /* volume module stays the same until the graph is reconfigured */
+            if (sAttr.direction == PAL_AUDIO_OUTPUT && isVolMiidValid) {
+                device = volMiidDevice;
+                miid = volMiid;
+            } else if (sAttr.direction == PAL_AUDIO_OUTPUT) {
                 device = compressDevIds.at(0);
                 status = SessionAlsaUtils::getModuleInstanceId(mixer, device,
                         rxAifBackEnds[0].second.data(), TAG_STREAM_VOLUME, &miid);
@@ -1949,19 +2002,11 @@ int SessionAlsaCompress::setParameters(Stream *s __unused, int tagId, uint32_t p
                        sAttr.direction, status);
                 goto exit;
             }
+            cacheVolumeMiid(device, miid);
 
-            if (vdata->no_of_volpair == 2 && sAttr.out_media_config.ch_info.channels == 2) {
-                builder->payloadMultichVolumemConfig(&alsaParamData, &alsaPayloadSize, miid, vdata);
-            } else {
-                builder->payloadVolumeConfig(&alsaParamData, &alsaPayloadSize, miid, vdata);
-            }
-
-            if (alsaPayloadSize) {
-                status = SessionAlsaUtils::setMixerParameter(mixer, device,
-                                               alsaParamData, alsaPayloadSize);
-                PAL_INFO(LOG_TAG, "mixer set volume config status=%d\n", status);
-                freeCustomPayload(&alsaParamData, &alsaPayloadSize);
-            }
+            status = setVolumeParam(builder, device, miid, vdata,
+                    (vdata->no_of_volpair == 2 && sAttr.out_media_config.ch_info.channels == 2));
+            PAL_INFO(LOG_TAG, "mixer set volume config status=%d\n", status);
             break;
         }
         default:
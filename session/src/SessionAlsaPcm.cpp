@@ -79,6 +79,7 @@
 #include "apm_api.h"
 #include "us_detect_api.h"
 #include <sys/ioctl.h>
+#include <time.h>
 
 std::mutex SessionAlsaPcm::pcmLpmRefCntMtx;
 int SessionAlsaPcm::pcmLpmRefCnt = 0;
@@ -88,6 +89,8 @@ int SessionAlsaPcm::pcmLpmRefCnt = 0;
 #define SESSION_ALSA_MMAP_PERIOD_COUNT_MIN 64
 #define SESSION_ALSA_MMAP_PERIOD_COUNT_MAX 2048
 #define SESSION_ALSA_MMAP_PERIOD_COUNT_DEFAULT (SESSION_ALSA_MMAP_PERIOD_COUNT_MAX)
+/* how often an mmap stream without a position mirror checks for one */
+#define SESSION_ALSA_MMAP_MIRROR_IDLE_MS 20
 
 SessionAlsaPcm::SessionAlsaPcm(std::shared_ptr<ResourceManager> Rm)
 {
@@ -103,10 +106,15 @@ SessionAlsaPcm::SessionAlsaPcm(std::shared_ptr<ResourceManager> Rm)
    mState = SESSION_IDLE;
    ecRefDevId = PAL_DEVICE_OUT_MIN;
    streamHandle = NULL;
+   sessionCb = NULL;
+   cbCookie = 0;
 }
 
 SessionAlsaPcm::~SessionAlsaPcm()
 {
+   stopMmapPositionPublisher();
+   if (cbCookie)
+       rm->waitMixerEventCallbacks(cbCookie);
    delete builder;
 
 }
@@ -445,7 +453,6 @@ int SessionAlsaPcm::setConfig(Stream * s, configType type, int tag)
     int status = 0;
     uint32_t tagsent;
     struct agm_tag_config *tagConfig = nullptr;
-    struct agm_cal_config *calConfig = nullptr;
     const char *setParamTagControl = "setParamTag";
     const char *stream = "PCM";
     const char *setCalibrationControl = "setCalibration";
@@ -456,7 +463,6 @@ int SessionAlsaPcm::setConfig(Stream * s, configType type, int tag)
     std::ostringstream beCntrlName;
     pal_stream_attributes sAttr;
     int tag_config_size = 0;
-    int cal_config_size = 0;
 
     status = s->getStreamAttributes(&sAttr);
     if (status != 0) {
@@ -547,6 +553,13 @@ int SessionAlsaPcm::setConfig(Stream * s, configType type, int tag)
             tkv.clear();
             break;
         case CALIBRATION:
+        {
+            calCacheKey calKey;
+            uint32_t calGen = 0;
+            std::shared_ptr<std::vector<uint8_t>> calPayload = nullptr;
+            std::vector<int> &feIds = (PAL_STREAM_LOOPBACK == sAttr.type) ?
+                                      pcmDevRxIds : pcmDevIds;
+
             ckv.clear();
             status = builder->populateCalKeyVector(s, ckv, tag);
             if (0 != status) {
@@ -559,23 +572,33 @@ int SessionAlsaPcm::setConfig(Stream * s, configType type, int tag)
                 goto exit;
             }
 
-            cal_config_size = sizeof(struct agm_cal_config) +
-                              (ckv.size() * sizeof(agm_key_value));
-            calConfig = (struct agm_cal_config*)malloc(cal_config_size);
+            calKey.ckv = ckv;
+            getCalGraphKey(sAttr.type, feIds, calKey.graphKey);
+            if (isCalUnchanged(calKey)) {
+                PAL_DBG(LOG_TAG, "calibration unchanged for tag 0x%x, skip", tag);
+                CalibrationCache::getInstance()->noteSkippedWrite();
+                ckv.clear();
+                break;
+            }
 
-            if (!calConfig) {
+            calPayload = CalibrationCache::getInstance()->getPayload(calKey,
+                    [this](uint8_t **payload, size_t *size) -> int {
+                        size_t calSize = sizeof(struct agm_cal_config) +
+                                         (ckv.size() * sizeof(agm_key_value));
+                        *payload = (uint8_t *)calloc(1, calSize);
+                        if (!*payload)
+                            return -ENOMEM;
+                        *size = calSize;
+                        return SessionAlsaUtils::getCalMetadata(ckv,
+                                (struct agm_cal_config *)*payload);
+                    }, &calGen);
+            if (!calPayload) {
                 status = -EINVAL;
                 goto exit;
             }
 
-            status = SessionAlsaUtils::getCalMetadata(ckv, calConfig);
-            if (PAL_STREAM_LOOPBACK == sAttr.type) {
-                if (pcmDevRxIds.size() > 0)
-                    calCntrlName << stream << pcmDevRxIds.at(0) << " " << setCalibrationControl;
-            } else {
-                if (pcmDevIds.size() > 0)
-                    calCntrlName << stream << pcmDevIds.at(0) << " " << setCalibrationControl;
-            }
+            if (feIds.size() > 0)
+                calCntrlName << stream << feIds.at(0) << " " << setCalibrationControl;
 
             if (calCntrlName.str().length() == 0) {
                 status = -EINVAL;
@@ -589,13 +612,15 @@ int SessionAlsaPcm::setConfig(Stream * s, configType type, int tag)
                 goto exit;
             }
 
-            status = mixer_ctl_set_array(ctl, calConfig, cal_config_size);
+            status = mixer_ctl_set_array(ctl, calPayload->data(), calPayload->size());
             if (status != 0) {
                 PAL_ERR(LOG_TAG, "failed to set the tag calibration %d", status);
                 goto exit;
             }
+            markCalApplied(calKey, calGen);
             ckv.clear();
             break;
+        }
         default:
             PAL_ERR(LOG_TAG, "invalid type %d", type);
             status = -EINVAL;
@@ -605,8 +630,6 @@ int SessionAlsaPcm::setConfig(Stream * s, configType type, int tag)
 exit:
     if (tagConfig)
         free(tagConfig);
-    if (calConfig)
-        free(calConfig);
 
     PAL_DBG(LOG_TAG, "exit status: %d ", status);
     return status;
@@ -814,6 +837,7 @@ int SessionAlsaPcm::start(Stream * s)
     struct volume_set_param_info vol_set_param_info;
     uint16_t volSize = 0;
     uint8_t *volPayload = nullptr;
+    PayloadScope payloadScope(builder);
 
     PAL_DBG(LOG_TAG, "Enter");
 
@@ -862,10 +886,12 @@ int SessionAlsaPcm::start(Stream * s)
                     config.silence_threshold = 0;
                     config.silence_size = 0;
                     config.avail_min = config.period_size;
+                    setMmapPeriod(&config);
                     pcm = pcm_open(rm->getVirtualSndCard(), pcmDevIds.at(0),
-                        PCM_IN |PCM_MMAP| PCM_NOIRQ, &config);
+                        PCM_IN | PCM_MMAP | PCM_NOIRQ | PCM_MONOTONIC, &config);
                 } else {
-                    pcm = pcm_open(rm->getVirtualSndCard(), pcmDevIds.at(0), PCM_IN, &config);
+                    pcm = pcm_open(rm->getVirtualSndCard(), pcmDevIds.at(0),
+                        PCM_IN | PCM_NORESTART | PCM_MONOTONIC, &config);
                 }
 
                 if (!pcm) {
@@ -892,10 +918,12 @@ int SessionAlsaPcm::start(Stream * s)
                     config.silence_threshold = 0;
                     config.silence_size = 0;
                     config.avail_min = config.period_size;
+                    setMmapPeriod(&config);
                     pcm = pcm_open(rm->getVirtualSndCard(), pcmDevIds.at(0),
-                        PCM_OUT |PCM_MMAP| PCM_NOIRQ, &config);
+                        PCM_OUT | PCM_MMAP | PCM_NOIRQ | PCM_MONOTONIC, &config);
                 } else {
-                    pcm = pcm_open(rm->getVirtualSndCard(), pcmDevIds.at(0), PCM_OUT, &config);
+                    pcm = pcm_open(rm->getVirtualSndCard(), pcmDevIds.at(0),
+                        PCM_OUT | PCM_NORESTART | PCM_MONOTONIC, &config);
                 }
 
                 if (!pcm) {
@@ -1103,13 +1131,7 @@ int SessionAlsaPcm::start(Stream * s)
                 }
 
 set_mixer:
-                status = SessionAlsaUtils::setMixerParameter(mixer, pcmDevIds.at(0),
-                                                             customPayload, customPayloadSize);
-                freeCustomPayload();
-                if (status != 0) {
-                    PAL_ERR(LOG_TAG, "setMixerParameter failed");
-                    goto exit;
-                }
+                /* RAT render config goes out in the same setParam as the MFC config */
                 if (sAttr.type == PAL_STREAM_VOICE_CALL_RECORD) {
                     status = SessionAlsaUtils::getModuleInstanceId(mixer, pcmDevIds.at(0),
                                                                 "ZERO", RAT_RENDER, &miid);
@@ -1143,13 +1165,15 @@ set_mixer:
                             goto exit;
                         }
                     }
-                    status = SessionAlsaUtils::setMixerParameter(mixer, pcmDevIds.at(0),
-                                                                 customPayload, customPayloadSize);
-                    freeCustomPayload();
-                    if (status != 0) {
-                        PAL_ERR(LOG_TAG, "setMixerParameter failed for RAT render");
-                        goto exit;
-                    }
+                }
+                status = SessionAlsaUtils::setMixerParameterBatch(mixer, pcmDevIds.at(0),
+                                                             customPayload, customPayloadSize);
+                freeCustomPayload();
+                if (status != 0) {
+                    PAL_ERR(LOG_TAG, "setMixerParameter failed");
+                    goto exit;
+                }
+                if (sAttr.type == PAL_STREAM_VOICE_CALL_RECORD) {
                     switch (sAttr.info.voice_rec_info.record_direction) {
                         case INCALL_RECORD_VOICE_UPLINK:
                             tagId = INCALL_RECORD_UPLINK;
@@ -1217,6 +1241,8 @@ set_mixer:
                 if (status) {
                     status = errno;
                     PAL_ERR(LOG_TAG, "pcm_start failed %d", status);
+                } else if (SessionAlsaUtils::isMmapUsecase(sAttr)) {
+                    startMmapPositionPublisher(s);
                 }
             }
             break;
@@ -1248,7 +1274,7 @@ set_mixer:
                         status = -EINVAL;
                         goto exit;
                     }
-                    status = SessionAlsaUtils::setMixerParameter(mixer, pcmDevIds.at(0),
+                    status = SessionAlsaUtils::setMixerParameterBatch(mixer, pcmDevIds.at(0),
                                                      customPayload, customPayloadSize);
                     freeCustomPayload();
                     if (status != 0) {
@@ -1279,6 +1305,8 @@ pcm_start:
                 if (status) {
                     status = errno;
                     PAL_ERR(LOG_TAG, "pcm_start failed %d", status);
+                } else if (SessionAlsaUtils::isMmapUsecase(sAttr)) {
+                    startMmapPositionPublisher(s);
                 }
             }
 
@@ -1339,7 +1367,7 @@ pcm_start:
                         status = -EINVAL;
                         goto exit;
                     }
-                    status = SessionAlsaUtils::setMixerParameter(mixer, pcmDevRxIds.at(0),
+                    status = SessionAlsaUtils::setMixerParameterBatch(mixer, pcmDevRxIds.at(0),
                                                              customPayload, customPayloadSize);
                     freeCustomPayload();
                     if (status != 0) {
@@ -1422,6 +1450,8 @@ int SessionAlsaPcm::stop(Stream * s)
         PAL_ERR(LOG_TAG, "stream get attributes failed");
         return status;
     }
+    mLastXferNs = 0;
+    stopMmapPositionPublisher();
     switch (sAttr.direction) {
         case PAL_AUDIO_INPUT:
             if (pcm && isActive()) {
@@ -1563,6 +1593,8 @@ int SessionAlsaPcm::close(Stream * s)
         PAL_DBG(LOG_TAG, "Session not opened or already closed");
         goto exit;
     }
+    resetCalState();
+    resetVolumeCache();
 
     status = s->getStreamAttributes(&sAttr);
     if (status != 0) {
@@ -1759,6 +1791,8 @@ int SessionAlsaPcm::disconnectSessionDevice(Stream *streamHandle,
     std::vector<std::pair<int32_t, std::string>> txAifBackEndsToDisconnect;
     int32_t status = 0;
 
+    resetCalState();
+    resetVolumeCache();
     deviceList.push_back(deviceToDisconnect);
     rm->getBackEndNames(deviceList, rxAifBackEndsToDisconnect,
             txAifBackEndsToDisconnect);
@@ -1843,6 +1877,8 @@ int SessionAlsaPcm::connectSessionDevice(Stream* streamHandle, pal_stream_type_t
     std::vector<std::pair<int32_t, std::string>> txAifBackEndsToConnect;
     int32_t status = 0;
 
+    resetCalState();
+    resetVolumeCache();
     deviceList.push_back(deviceToConnect);
     rm->getBackEndNames(deviceList, rxAifBackEndsToConnect,
             txAifBackEndsToConnect);
@@ -1920,6 +1956,13 @@ int SessionAlsaPcm::read(Stream *s, int tag __unused, struct pal_buffer *buf, in
             releaseAdmFocus(s);
         } else {
             status =  pcm_read(pcm, data,  pcmReadSize);
+            if (status == -EPIPE) {
+                status = recoverXrun(s, false, sAttr.in_media_config.sample_rate);
+                if (!status)
+                    status = pcm_read(pcm, data, pcmReadSize);
+            }
+            if (!status)
+                markXfer();
         }
 
         if ((0 != status) || (pcmReadSize == 0)) {
@@ -1928,6 +1971,7 @@ int SessionAlsaPcm::read(Stream *s, int tag __unused, struct pal_buffer *buf, in
         }
 
         bytesRead += pcmReadSize;
+        publishPosition(s, false, pcmReadSize);
     }
 
     *size = bytesRead;
@@ -1983,6 +2027,13 @@ int SessionAlsaPcm::write(Stream *s, int tag, struct pal_buffer *buf, int * size
             releaseAdmFocus(s);
         } else {
             status =  pcm_write(pcm, data,  sizeWritten);
+            if (status == -EPIPE) {
+                status = recoverXrun(s, true, sAttr.out_media_config.sample_rate);
+                if (!status)
+                    status = pcm_write(pcm, data, sizeWritten);
+            }
+            if (!status)
+                markXfer();
         }
 
         if (0 != status) {
@@ -1990,6 +2041,7 @@ int SessionAlsaPcm::write(Stream *s, int tag, struct pal_buffer *buf, int * size
             goto exit;
         }
         bytesWritten += sizeWritten;
+        publishPosition(s, true, sizeWritten);
         __builtin_sub_overflow(bytesRemaining, sizeWritten, &bytesRemaining);
     }
     offset = bytesWritten + buf->offset;
@@ -2020,18 +2072,155 @@ int SessionAlsaPcm::write(Stream *s, int tag, struct pal_buffer *buf, int * size
         }
     } else {
         status =  pcm_write(pcm, data,  sizeWritten);
+        if (status == -EPIPE) {
+            status = recoverXrun(s, true, sAttr.out_media_config.sample_rate);
+            if (!status)
+                status = pcm_write(pcm, data, sizeWritten);
+        }
         if (status != 0) {
             PAL_ERR(LOG_TAG, "Error! pcm_write failed");
             goto exit;
         }
+        markXfer();
     }
     bytesWritten += sizeWritten;
+    publishPosition(s, true, sizeWritten);
     *size = bytesWritten;
 exit:
     PAL_VERBOSE(LOG_TAG, "exit status: %d", status);
     return status;
 }
 
+void SessionAlsaPcm::markXfer()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    mLastXferNs = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void SessionAlsaPcm::setMmapPeriod(const struct pcm_config *config)
+{
+    mMmapPeriodNs = config->rate ?
+            (uint64_t)config->period_size * 1000000000ULL / config->rate : 0;
+}
+
+/*
+ * mmap data never goes through read/write, so nothing in PAL sees its
+ * period boundaries. This thread reads the hardware pointer once a period
+ * while the stream has a position mirror.
+ */
+void SessionAlsaPcm::startMmapPositionPublisher(Stream *s)
+{
+    if (!mMmapPeriodNs || mMmapPosThread.joinable())
+        return;
+
+    mMmapPosExit = false;
+    mMmapPosThread = std::thread(&SessionAlsaPcm::mmapPositionLoop, this, s);
+}
+
+void SessionAlsaPcm::stopMmapPositionPublisher()
+{
+    if (!mMmapPosThread.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lck(mMmapPosMutex);
+        mMmapPosExit = true;
+    }
+    mMmapPosCv.notify_all();
+    mMmapPosThread.join();
+}
+
+void SessionAlsaPcm::mmapPositionLoop(Stream *s)
+{
+    std::unique_lock<std::mutex> lck(mMmapPosMutex);
+    auto period = std::chrono::nanoseconds(mMmapPeriodNs);
+    auto next = std::chrono::steady_clock::now();
+    unsigned int hwPtr = 0;
+    struct timespec ts;
+
+    while (!mMmapPosExit) {
+        if (s->isPositionMirrored()) {
+            next += period;
+        } else {
+            /* no mirror yet, look again later without waking every period */
+            next = std::chrono::steady_clock::now() +
+                   std::chrono::milliseconds(SESSION_ALSA_MMAP_MIRROR_IDLE_MS);
+        }
+        if (mMmapPosCv.wait_until(lck, next, [this] { return mMmapPosExit; }))
+            break;
+        if (!s->isPositionMirrored())
+            continue;
+        if (!pcm_mmap_get_hw_ptr(pcm, &hwPtr, &ts))
+            s->publishHwPosition(hwPtr, &ts);
+    }
+}
+
+/* period boundary, refresh the position mirror of the stream if it has one */
+void SessionAlsaPcm::publishPosition(Stream *s, bool playback, unsigned int bytes)
+{
+    unsigned int avail = 0;
+    struct timespec ts = {0, 0};
+    bool hwValid = false;
+
+    if (!bytes || !s->isPositionMirrored())
+        return;
+
+    hwValid = !pcm_get_htimestamp(pcm, &avail, &ts);
+    s->publishPosition(pcm_bytes_to_frames(pcm, bytes), playback, avail,
+                       pcm_get_buffer_size(pcm), hwValid ? &ts : NULL);
+}
+
+/*
+ * pcm_write/pcm_read returned -EPIPE on a pcm opened with PCM_NORESTART.
+ * The ring was full after the last transfer, so anything beyond one ring
+ * since then was lost. Accounts the xrun against the stream and re-arms
+ * the pcm so that the caller can retry the transfer.
+ */
+int SessionAlsaPcm::recoverXrun(Stream *s, bool playback, uint32_t sampleRate)
+{
+    int status = 0;
+    struct timespec ts;
+    uint64_t nowNs = 0;
+    uint64_t elapsedFrames = 0;
+    uint64_t bufferFrames = 0;
+    uint64_t framesLost = 0;
+    size_t silenceSize = 0;
+    void *silence = NULL;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    nowNs = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    if (mLastXferNs && nowNs > mLastXferNs && sampleRate) {
+        elapsedFrames = (nowNs - mLastXferNs) / 1000 * sampleRate / 1000000;
+        bufferFrames = pcm_get_buffer_size(pcm);
+        if (elapsedFrames > bufferFrames)
+            framesLost = elapsedFrames - bufferFrames;
+    }
+    mLastXferNs = 0;
+    s->recordXrun(playback, framesLost);
+
+    status = pcm_prepare(pcm);
+    if (status) {
+        PAL_ERR(LOG_TAG, "pcm prepare after xrun failed %d", status);
+        return status;
+    }
+
+    /* give the restarted ring a period of headroom before real data */
+    if (playback && (s->getXrunRecovery() & PAL_XRUN_RECOVERY_SILENCE)) {
+        silenceSize = out_buf_size;
+        silence = calloc(1, silenceSize);
+        if (!silence)
+            return -ENOMEM;
+        status = pcm_write(pcm, silence, silenceSize);
+        free(silence);
+        if (status)
+            PAL_ERR(LOG_TAG, "silence write after xrun failed %d", status);
+    }
+
+    return status;
+}
+
 int SessionAlsaPcm::readBufferInit(Stream * /*streamHandle*/, size_t /*noOfBuf*/, size_t /*bufSize*/,
                                    int /*flag*/)
 {
@@ -2094,22 +2283,9 @@ int SessionAlsaPcm::setParameters(Stream *streamHandle, int tagId, uint32_t para
             paramSize = PAL_ALIGN_8BYTE(header->param_size +
                 sizeof(struct apm_module_param_data_t));
             if (mState == SESSION_IDLE) {
-                if (!customPayloadSize) {
-                    customPayload = (uint8_t *)calloc(1, paramSize);
-                } else {
-                    customPayload = (uint8_t *)realloc(customPayload,
-                        customPayloadSize + paramSize);
-                }
-                if (!customPayload) {
-                    status = -ENOMEM;
-                    PAL_ERR(LOG_TAG, "failed to allocate memory for custom payload");
+                status = updateCustomPayload(paramData, paramSize);
+                if (status)
                     goto exit;
-                }
-
-                ar_mem_cpy((uint8_t *)customPayload + customPayloadSize, paramSize,
-                    paramData, paramSize);
-                customPayloadSize += paramSize;
-                PAL_INFO(LOG_TAG, "customPayloadSize = %zu", customPayloadSize);
             } else {
                 if (pcmDevIds.size() > 0) {
                     status = SessionAlsaUtils::setMixerParameter(mixer,
@@ -2248,7 +2424,11 @@ int SessionAlsaPcm::setParameters(Stream *streamHandle, int tagId, uint32_t para
             pal_param_payload *param_payload = (pal_param_payload *)payload;
             pal_volume_data *vdata = (struct pal_volume_data *)param_payload->payload;
             status = streamHandle->getStreamAttributes(&sAttr);
-            if (sAttr.direction == PAL_AUDIO_OUTPUT) {
+            /* volume module stays the same until the graph is reconfigured */
+            if (isVolMiidValid) {
+                device = volMiidDevice;
+                miid = volMiid;
+            } else if (sAttr.direction == PAL_AUDIO_OUTPUT) {
                 status = SessionAlsaUtils::getModuleInstanceId(mixer, device,
                         rxAifBackEnds[0].second.data(), TAG_STREAM_VOLUME, &miid);
             } else if (sAttr.direction == PAL_AUDIO_INPUT) {
@@ -2278,19 +2458,11 @@ int SessionAlsaPcm::setParameters(Stream *streamHandle, int tagId, uint32_t para
                 status = 0;
                 goto exit;
             }
+            cacheVolumeMiid(device, miid);
 
-            if (vdata->no_of_volpair == 2 && sAttr.out_media_config.ch_info.channels == 2) {
-                builder->payloadMultichVolumemConfig(&paramData, &paramSize, miid, vdata);
-            } else {
-                builder->payloadVolumeConfig(&paramData, &paramSize, miid, vdata);
-            }
-
-            if (paramSize) {
-                status = SessionAlsaUtils::setMixerParameter(mixer, device,
-                                               paramData, paramSize);
-                PAL_INFO(LOG_TAG, "mixer set volume config status=%d\n", status);
-                freeCustomPayload(&paramData, &paramSize);
-            }
+            status = setVolumeParam(builder, device, miid, vdata,
+                    (vdata->no_of_volpair == 2 && sAttr.out_media_config.ch_info.channels == 2));
+            PAL_INFO(LOG_TAG, "mixer set volume config status=%d\n", status);
             return 0;
 
         }
@@ -2310,7 +2482,7 @@ int SessionAlsaPcm::setParameters(Stream *streamHandle, int tagId, uint32_t para
 
 exit:
     if (paramData)
-        free(paramData);
+        builder->freePayload(paramData);
 
     PAL_DBG(LOG_TAG, "Exit. status %d", status);
     return status;
@@ -2624,7 +2796,8 @@ int SessionAlsaPcm::getParameters(Stream *s __unused, int tagId, uint32_t param_
 
 exit:
     if (payloadSize) {
-        delete [] payloadData;
+        /* DOA comes from this builder, the version query from the engine's */
+        PayloadBuilder::releasePayload(payloadData);
         payloadData = NULL;
         payloadSize = 0;
     }
@@ -2836,6 +3009,7 @@ int SessionAlsaPcm::createMmapBuffer(Stream *s, int32_t min_size_frames,
         }
 
         this->adjustMmapPeriodCount(&config, min_size_frames);
+        setMmapPeriod(&config);
 
         PAL_DBG(LOG_TAG, "Opening PCM device card_id(%d) device_id(%d), channels %d",
                 rm->getVirtualSndCard(), pcmDevIds.at(0), config.channels);
@@ -3006,6 +3180,8 @@ void SessionAlsaPcm::retryOpenWithoutEC(Stream *s, unsigned int pcm_flags, struc
      }
      position->time_nanoseconds = ts.tv_sec*1000000000LL + ts.tv_nsec
              /*+ out->mmap_time_offset_nanos*/;
+     /* mmap data bypasses read/write, each position query refreshes the mirror */
+     s->publishHwPosition((uint32_t)position->position_frames, &ts);
      PAL_DBG(LOG_TAG, "Exit status: %d", status);
      return status;
  }
@@ -3078,7 +3254,8 @@ int SessionAlsaPcm::openGraph(Stream *s) {
         config.silence_threshold = 0;
 
         if (pcmDevIds.size() > 0) {
-            pcm = pcm_open(rm->getVirtualSndCard(), pcmDevIds.at(0), PCM_IN, &config);
+            pcm = pcm_open(rm->getVirtualSndCard(), pcmDevIds.at(0),
+                           PCM_IN | PCM_NORESTART | PCM_MONOTONIC, &config);
         } else {
             PAL_ERR(LOG_TAG, "frontendIDs is not available.");
             status = -EINVAL;
@@ -79,6 +79,9 @@ static const char *beCtrlNames[] = {
     " grp config",
 };
 
+std::map<std::pair<struct mixer *, int>, struct mixer_ctl *> SessionAlsaUtils::setParamCtlCache;
+std::mutex SessionAlsaUtils::setParamCtlMutex;
+
 struct agmMetaData {
     uint8_t *buf;
     uint32_t size;
@@ -376,7 +379,7 @@ int SessionAlsaUtils::open(Stream * streamHandle, std::shared_ptr<ResourceManage
         }
     }
 
-    builder = new PayloadBuilder();
+    builder = PayloadBuilder::getThreadBuilder();
     // get streamKV
     if ((status = builder->populateStreamKV(streamHandle, streamKV)) != 0) {
         PAL_ERR(LOG_TAG, "get stream KV failed %d", status);
@@ -546,10 +549,6 @@ freeStreamMetaData:
     if (streamMetaData.buf)
         free(streamMetaData.buf);
 exit:
-    if(builder) {
-       delete builder;
-       builder = NULL;
-    }
     PAL_DBG(LOG_TAG, "Exit, status %d", status);
     return status;
 }
@@ -710,11 +709,7 @@ int SessionAlsaUtils::rwACDBTunnel(Stream * streamHandle, std::shared_ptr<Resour
         goto exit;
     }
 
-    builder = new PayloadBuilder();
-    if (!builder) {
-        PAL_ERR(LOG_TAG, "Payload builder creation failed \n");
-        goto exit;
-    }
+    builder = PayloadBuilder::getThreadBuilder();
 
     // get streamKV
     if ((status = builder->populateStreamKVTunnel(streamHandle, acdbGKV, instanceId)) != 0) {
@@ -810,10 +805,6 @@ freePaylodData:
 exit:
     acdbGKV.clear();
     acdbGKVSet.clear();
-    if(builder) {
-       delete builder;
-       builder = NULL;
-    }
 
     PAL_DBG(LOG_TAG,"Exit, status %d", status);
 
@@ -997,7 +988,7 @@ int SessionAlsaUtils::getTimestamp(struct mixer *mixer, const std::vector<int> &
         return -ENOENT;
     }
 
-    PayloadBuilder* builder = new PayloadBuilder();
+    PayloadBuilder* builder = PayloadBuilder::getThreadBuilder();
     builder->payloadTimestamp(payload, &payloadSize, spr_miid);
     if (!payload) {
         PAL_ERR(LOG_TAG, "Timestamp payload formation failed");
@@ -1025,10 +1016,6 @@ int SessionAlsaUtils::getTimestamp(struct mixer *mixer, const std::vector<int> &
     stime->timestamp.value_msw = spr_session_time->timestamp.value_msw;
     //flags from Spf are igonred
 exit:
-    if(builder) {
-       delete builder;
-       builder = NULL;
-    }
     return status;
 }
 
@@ -1175,27 +1162,31 @@ int SessionAlsaUtils::getTagsWithModuleInfo(struct mixer *mixer, int device, con
     return ret;
 }
 
-int SessionAlsaUtils::setMixerParameter(struct mixer *mixer, int device,
-                                        void *payload, int size)
+struct mixer_ctl *SessionAlsaUtils::getSetParamMixerControl(struct mixer *mixer,
+                                                            int device)
 {
     char *pcmDeviceName = NULL;
     char const *control = "setParam";
     char *mixer_str;
-    struct mixer_ctl *ctl;
-    int ctl_len = 0,ret = 0;
+    struct mixer_ctl *ctl = NULL;
+    int ctl_len = 0;
     std::shared_ptr<ResourceManager> rm = ResourceManager::getInstance();
+    std::lock_guard<std::mutex> lock(setParamCtlMutex);
+
+    auto it = setParamCtlCache.find(std::make_pair(mixer, device));
+    if (it != setParamCtlCache.end())
+        return it->second;
 
     pcmDeviceName = rm->getDeviceNameFromID(device);
     if(!pcmDeviceName){
         PAL_ERR(LOG_TAG, "Device name from id %d not found", device);
-        return -EINVAL;
+        return NULL;
     }
 
-    PAL_DBG(LOG_TAG, "- mixer -%s-\n", pcmDeviceName);
     ctl_len = strlen(pcmDeviceName) + 1 + strlen(control) + 1;
     mixer_str = (char *)calloc(1, ctl_len);
     if (!mixer_str) {
-        return -ENOMEM;
+        return NULL;
     }
     snprintf(mixer_str, ctl_len, "%s %s", pcmDeviceName, control);
 
@@ -1203,13 +1194,96 @@ int SessionAlsaUtils::setMixerParameter(struct mixer *mixer, int device,
     ctl = mixer_get_ctl_by_name(mixer, mixer_str);
     if (!ctl) {
         PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", mixer_str);
-        free(mixer_str);
-        return ENOENT;
+    } else {
+        setParamCtlCache[std::make_pair(mixer, device)] = ctl;
     }
+
+    free(mixer_str);
+    return ctl;
+}
+
+void SessionAlsaUtils::clearMixerControlCache()
+{
+    std::lock_guard<std::mutex> lock(setParamCtlMutex);
+
+    setParamCtlCache.clear();
+}
+
+int SessionAlsaUtils::setMixerParameter(struct mixer *mixer, int device,
+                                        void *payload, int size)
+{
+    struct mixer_ctl *ctl;
+    int ret = 0;
+
+    ctl = getSetParamMixerControl(mixer, device);
+    if (!ctl)
+        return ENOENT;
+
     ret = mixer_ctl_set_array(ctl, payload, size);
 
     PAL_DBG(LOG_TAG, "ret = %d, cnt = %d\n", ret, size);
-    free(mixer_str);
+    return ret;
+}
+
+/*
+ * Submits a payload made of several packed apm_module_param_data_t entries
+ * with a single setParam call. If the combined write fails, each entry is
+ * resent on its own so the failing module(s) can be reported.
+ */
+int SessionAlsaUtils::setMixerParameterBatch(struct mixer *mixer, int device,
+                                             void *payload, int size,
+                                             std::vector<struct paramBatchStatus> *moduleStatus)
+{
+    struct mixer_ctl *ctl;
+    apm_module_param_data_t *header;
+    uint8_t *entry = (uint8_t *)payload;
+    size_t offset = 0, entrySize = 0;
+    struct paramBatchStatus entryStatus;
+    int ret = 0, entryRet = 0, numEntries = 0;
+
+    if (!payload || size <= 0) {
+        PAL_ERR(LOG_TAG, "Invalid batch payload");
+        return -EINVAL;
+    }
+
+    ctl = getSetParamMixerControl(mixer, device);
+    if (!ctl)
+        return ENOENT;
+
+    ret = mixer_ctl_set_array(ctl, payload, size);
+    PAL_DBG(LOG_TAG, "batch ret = %d, cnt = %d\n", ret, size);
+    if (!ret && !moduleStatus)
+        return ret;
+
+    while (offset + sizeof(apm_module_param_data_t) <= (size_t)size) {
+        header = (apm_module_param_data_t *)(entry + offset);
+        entrySize = sizeof(apm_module_param_data_t) + header->param_size;
+        entrySize += PAL_PADDING_8BYTE_ALIGN(entrySize);
+        if (offset + entrySize > (size_t)size)
+            entrySize = size - offset;
+
+        entryRet = ret;
+        if (ret) {
+            entryRet = mixer_ctl_set_array(ctl, entry + offset, entrySize);
+            if (entryRet) {
+                PAL_ERR(LOG_TAG, "miid 0x%x param 0x%x failed %d",
+                        header->module_instance_id, header->param_id, entryRet);
+            }
+        }
+        if (moduleStatus) {
+            entryStatus.miid = header->module_instance_id;
+            entryStatus.paramId = header->param_id;
+            entryStatus.status = entryRet;
+            moduleStatus->push_back(entryStatus);
+        }
+        offset += entrySize;
+        numEntries++;
+    }
+
+    if (ret && numEntries <= 1) {
+        PAL_ERR(LOG_TAG, "setParam failed %d, cnt = %d", ret, size);
+    }
+
     return ret;
 }
 
@@ -1438,7 +1512,7 @@ int SessionAlsaUtils::open(Stream * streamHandle, std::shared_ptr<ResourceManage
         return status;
     }
 
-    PayloadBuilder* builder = new PayloadBuilder();
+    PayloadBuilder* builder = PayloadBuilder::getThreadBuilder();
 
     status = rmHandle->getVirtualAudioMixer(&mixerHandle);
     // get keyvalue pair info
@@ -1689,10 +1763,6 @@ freeRxMetaData:
     free(deviceRxMetaData.buf);
     free(streamRxMetaData.buf);
 exit:
-    if(builder) {
-       delete builder;
-       builder = NULL;
-    }
     return status;
 }
 
@@ -1713,7 +1783,7 @@ int SessionAlsaUtils::openDev(std::shared_ptr<ResourceManager> rmHandle,
     uint32_t devicePropId[] = {0x08000010, 2, 0x2, 0x5};
     struct pal_device_info devinfo = {};
 
-    PayloadBuilder* builder = new PayloadBuilder();
+    PayloadBuilder* builder = PayloadBuilder::getThreadBuilder();
 
     status = rmHandle->getVirtualAudioMixer(&mixerHandle);
     if (0 != status) {
@@ -1778,7 +1848,6 @@ freeMetaData:
     if (deviceMetaData.buf)
         free(deviceMetaData.buf);
 
-    delete builder;
     return status;
 }
 
@@ -2147,7 +2216,8 @@ int SessionAlsaUtils::connectSessionDevice(Session* sess, Stream* streamHandle,
     int sub = 1;
     uint32_t miid;
     struct sessionToPayloadParam streamData = {};
-    PayloadBuilder* builder = new PayloadBuilder();
+    PayloadBuilder* builder = PayloadBuilder::getThreadBuilder();
+    PayloadScope scope(builder);
     std::shared_ptr<ResourceManager> rm = ResourceManager::getInstance();
 
     status = rmHandle->getVirtualAudioMixer(&mixerHandle);
@@ -2268,10 +2338,6 @@ int SessionAlsaUtils::connectSessionDevice(Session* sess, Stream* streamHandle,
     status = mixer_ctl_set_enum_by_string(connectCtrl, aifBackEndsToConnect[0].second.data());
 
 exit:
-    if(builder) {
-       delete builder;
-       builder = NULL;
-    }
     return status;
 }
 
@@ -2383,7 +2449,7 @@ int SessionAlsaUtils::setupSessionDevice(Stream* streamHandle, pal_stream_type_t
     struct mixer_ctl *feCtrl = nullptr;
     struct mixer_ctl *feMdCtrl = nullptr;
     struct mixer_ctl *aifMdCtrl = nullptr;
-    PayloadBuilder* builder = new PayloadBuilder();
+    PayloadBuilder* builder = PayloadBuilder::getThreadBuilder();
     struct mixer *mixerHandle = nullptr;
     uint32_t devicePropId[] = {0x08000010, 2, 0x2, 0x5};
     uint32_t streamDevicePropId[] = {0x08000010, 1, 0x3}; /** gsl_subgraph_platform_driver_props.xml */
@@ -2580,10 +2646,6 @@ freeMetaData:
     free(deviceMetaData.buf);
 
 exit:
-    if(builder) {
-       delete builder;
-       builder = NULL;
-    }
     return status;
 }
 
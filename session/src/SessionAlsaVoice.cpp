@@ -275,7 +275,7 @@ int SessionAlsaVoice::setSessionParameters(Stream *s, int dir)
         }
     }
 
-    status = SessionAlsaUtils::setMixerParameter(mixer, pcmId,
+    status = SessionAlsaUtils::setMixerParameterBatch(mixer, pcmId,
             customPayload, customPayloadSize);
 
     if (status != 0) {
@@ -657,7 +657,6 @@ int SessionAlsaVoice::start(Stream * s)
     struct pal_stream_attributes sAttr;
     int32_t status = 0;
     std::shared_ptr<Device> rxDevice = nullptr;
-    pal_param_payload *palPayload = NULL;
     int txDevId = PAL_DEVICE_NONE;
     uint8_t* payload = NULL;
     size_t payloadSize = 0;
@@ -764,14 +763,16 @@ int SessionAlsaVoice::start(Stream * s)
     /*call to apply volume*/
     setConfig(s, CALIBRATION, TAG_STREAM_VOLUME, RX_HOSTLESS);
 
-    /*set tty mode*/
+    /*set tty mode, sent along with the Rx MFC config below*/
     if (ttyMode) {
-        palPayload = (pal_param_payload *)calloc(1,
-                                 sizeof(pal_param_payload) + sizeof(ttyMode));
-        if(palPayload != NULL){
-            palPayload->payload_size = sizeof(ttyMode);
-            *(palPayload->payload) = ttyMode;
-            setParameters(s, TTY_MODE, PAL_PARAM_ID_TTY_MODE, palPayload);
+        payloadSetTTYMode(&payload, &payloadSize, ttyMode);
+        if (payload && payloadSize) {
+            status = updateCustomPayload(payload, payloadSize);
+            freeCustomPayload(&payload, &payloadSize);
+            if (status != 0) {
+                PAL_ERR(LOG_TAG, "updateCustomPayload for tty mode failed %d", status);
+                goto err_pcm_open;
+            }
         }
     }
 
@@ -782,7 +783,7 @@ int SessionAlsaVoice::start(Stream * s)
         PAL_ERR(LOG_TAG,"Exit Configuring Rx mfc failed with status %d", status);
         return status;
     }
-    status = SessionAlsaUtils::setMixerParameter(mixer, pcmDevRxIds.at(0),
+    status = SessionAlsaUtils::setMixerParameterBatch(mixer, pcmDevRxIds.at(0),
                                                  customPayload, customPayloadSize);
     freeCustomPayload();
     if (status != 0) {
@@ -853,9 +854,6 @@ exit:
     freeCustomPayload();
     if (payload)
         free(payload);
-    if (palPayload) {
-        free(palPayload);
-    }
     if (volume)
         free(volume);
     if (status)
@@ -1416,29 +1414,24 @@ int SessionAlsaVoice::payloadCalKeys(Stream * s, uint8_t **payload, size_t *size
     vcpm_ckv_pair_t cal_key_pair[NUM_OF_CAL_KEYS];
     float volume = 0.0;
     int vol;
-    struct pal_volume_data *voldata = NULL;
+    struct pal_channel_vol_kv volPair;
+    uint32_t noOfVolPairs = 0;
 
-    voldata = (struct pal_volume_data *)calloc(1, (sizeof(uint32_t) +
-                      (sizeof(struct pal_channel_vol_kv) * (0xFFFF))));
-    if (!voldata) {
-        status = -ENOMEM;
-        goto exit;
-    }
-    status = s->getVolumeData(voldata);
+    status = s->getVolumePairs(&volPair, 1, &noOfVolPairs);
     if(0 != status) {
         PAL_ERR(LOG_TAG,"getVolumeData Failed");
         goto exit;
     }
 
-    PAL_VERBOSE(LOG_TAG,"volume sent:%f", (voldata->volume_pair[0].vol));
-    volume = (voldata->volume_pair[0].vol);
+    PAL_VERBOSE(LOG_TAG,"volume sent:%f", (volPair.vol));
+    volume = (volPair.vol);
 
     payloadSize = sizeof(apm_module_param_data_t) +
                   sizeof(vcpm_param_cal_keys_payload_t) +
                   sizeof(vcpm_ckv_pair_t)*NUM_OF_CAL_KEYS;
     padBytes = PAL_PADDING_8BYTE_ALIGN(payloadSize);
 
-    payloadInfo = new uint8_t[payloadSize + padBytes]();
+    payloadInfo = (uint8_t *)calloc(1, payloadSize + padBytes);
     if (!payloadInfo) {
         PAL_ERR(LOG_TAG, "payloadInfo malloc failed %s", strerror(errno));
         return -EINVAL;
@@ -1491,9 +1484,6 @@ int SessionAlsaVoice::payloadCalKeys(Stream * s, uint8_t **payload, size_t *size
             volume_boost, hd_voice);
 
 exit:
-    if (voldata) {
-        free(voldata);
-    }
     return status;
 }
 
@@ -1509,7 +1499,7 @@ int SessionAlsaVoice::payloadSetTTYMode(uint8_t **payload, size_t *size, uint32_
                   sizeof(tty_payload);
     padBytes = PAL_PADDING_8BYTE_ALIGN(payloadSize);
 
-    payloadInfo = new uint8_t[payloadSize + padBytes]();
+    payloadInfo = (uint8_t *)calloc(1, payloadSize + padBytes);
     if (!payloadInfo) {
         PAL_ERR(LOG_TAG, "payloadInfo malloc failed %s", strerror(errno));
         return -EINVAL;
@@ -36,6 +36,7 @@
 #include <cutils/trace.h>
 #include <dlfcn.h>
 
+#include "SecondStageScheduler.h"
 #include "StreamSoundTrigger.h"
 #include "Stream.h"
 #include "SoundTriggerPlatformInfo.h"
@@ -43,95 +44,77 @@
 ST_DBG_DECLARE(static int keyword_detection_cnt = 0);
 ST_DBG_DECLARE(static int user_verification_cnt = 0);
 
-void SoundTriggerEngineCapi::BufferThreadLoop(
-    SoundTriggerEngineCapi *capi_engine)
+void SoundTriggerEngineCapi::ProcessDetection(void *arg)
 {
+    SoundTriggerEngineCapi *capi_engine = (SoundTriggerEngineCapi *)arg;
     StreamSoundTrigger *s = nullptr;
+    std::shared_ptr<KeywordWindow> window = nullptr;
     int32_t status = 0;
     int32_t detection_state = ENGINE_IDLE;
 
     PAL_DBG(LOG_TAG, "Enter");
-    if (!capi_engine) {
-        PAL_ERR(LOG_TAG, "Invalid sound trigger capi engine");
-        return;
-    }
-
     std::unique_lock<std::mutex> lck(capi_engine->event_mutex_);
-    while (!capi_engine->exit_thread_) {
-        PAL_VERBOSE(LOG_TAG, "waiting on cond, processing started  = %d",
-                    capi_engine->processing_started_);
-        // Wait for keyword buffer data from DSP
-        if (!capi_engine->processing_started_)
-            capi_engine->cv_.wait(lck);
-        PAL_VERBOSE(LOG_TAG, "done waiting on cond, exit buffering = %d",
-                    capi_engine->exit_buffering_);
-
-        if (capi_engine->exit_thread_) {
-            break;
-        }
+    window = std::atomic_load(&capi_engine->window_);
 
-        /*
-         * If 1st stage buffering overflows before 2nd stage starts processing,
-         * the below functions need to be called to reset the 1st stage session
-         * for the next detection. We might be able to check states of the engine
-         * to avoid this buffering flag.
-         */
-        if (capi_engine->exit_buffering_) {
-            continue;  // skip over processing if we want to exit already
-        }
+    /*
+     * Detection may have been stopped while this job was queued, in which
+     * case there is nothing to process.
+     */
+    if (!capi_engine->processing_started_ || capi_engine->exit_buffering_ ||
+        !window) {
+        PAL_DBG(LOG_TAG, "processing not started, skip");
+        goto exit;
+    }
 
-        if (capi_engine->processing_started_) {
-            s = dynamic_cast<StreamSoundTrigger *>(capi_engine->stream_handle_);
-            capi_engine->bytes_processed_ = 0;
-            if (capi_engine->detection_type_ ==
-                ST_SM_TYPE_KEYWORD_DETECTION) {
-                status = capi_engine->StartKeywordDetection();
-                /*
-                 * StreamSoundTrigger may call stop recognition to second stage
-                 * engines when one of the second stage engine reject detection.
-                 * So check processing_started_ before notify stream in case
-                 * stream has already stopped recognition.
-                 */
-                if (capi_engine->processing_started_) {
-                    if (status)
-                        detection_state = KEYWORD_DETECTION_REJECT;
-                    else
-                        detection_state = capi_engine->detection_state_;
-                    lck.unlock();
-                    s->SetEngineDetectionState(detection_state);
-                    lck.lock();
-                }
-            } else if (capi_engine->detection_type_ ==
-                ST_SM_TYPE_USER_VERIFICATION) {
-                status = capi_engine->StartUserVerification();
-                /*
-                 * StreamSoundTrigger may call stop recognition to second stage
-                 * engines when one of the second stage engine reject detection.
-                 * So check processing_started_ before notify stream in case
-                 * stream has already stopped recognition.
-                 */
-                if (capi_engine->processing_started_) {
-                    if (status)
-                        detection_state = USER_VERIFICATION_REJECT;
-                    else
-                        detection_state = capi_engine->detection_state_;
-                    lck.unlock();
-                    s->SetEngineDetectionState(detection_state);
-                    lck.lock();
-                }
-            }
-            capi_engine->detection_state_ = ENGINE_IDLE;
-            capi_engine->keyword_detected_ = false;
-            capi_engine->processing_started_ = false;
-        }
+    s = dynamic_cast<StreamSoundTrigger *>(capi_engine->stream_handle_);
+    capi_engine->bytes_processed_ = 0;
+    if (capi_engine->detection_type_ == ST_SM_TYPE_KEYWORD_DETECTION) {
+        status = capi_engine->StartKeywordDetection(window);
+        detection_state = status ? KEYWORD_DETECTION_REJECT :
+            capi_engine->detection_state_;
+    } else if (capi_engine->detection_type_ == ST_SM_TYPE_USER_VERIFICATION) {
+        status = capi_engine->StartUserVerification(window);
+        detection_state = status ? USER_VERIFICATION_REJECT :
+            capi_engine->detection_state_;
+    }
+
+    /*
+     * StreamSoundTrigger may call stop recognition to second stage
+     * engines when one of the second stage engine reject detection.
+     * So check processing_started_ before notify stream in case
+     * stream has already stopped recognition. An engine cancelled by
+     * another engine's rejection leaves the notification to that one.
+     */
+    if (capi_engine->processing_started_ && status != -ECANCELED) {
+        /* no need for the other engines to finish once one rejects */
+        if (detection_state == KEYWORD_DETECTION_REJECT ||
+            detection_state == USER_VERIFICATION_REJECT)
+            window->Cancel();
+        PAL_INFO(LOG_TAG, "detection state %d, %llums after first stage",
+            detection_state, (unsigned long long)window->GetElapsedMs());
+        lck.unlock();
+        s->SetEngineDetectionState(detection_state);
+        lck.lock();
     }
+    capi_engine->detection_state_ = ENGINE_IDLE;
+    capi_engine->keyword_detected_ = false;
+    capi_engine->processing_started_ = false;
+    /* a new detection may have brought its own window meanwhile */
+    if (std::atomic_compare_exchange_strong(&capi_engine->window_, &window,
+            std::shared_ptr<KeywordWindow>(nullptr)))
+        window->Done();
+
+exit:
+    capi_engine->job_pending_ = false;
+    capi_engine->cv_.notify_all();
     PAL_DBG(LOG_TAG, "Exit");
 }
 
-int32_t SoundTriggerEngineCapi::StartKeywordDetection()
+int32_t SoundTriggerEngineCapi::StartKeywordDetection(
+    std::shared_ptr<KeywordWindow> window)
 {
     int32_t status = 0;
-    char *process_input_buff = nullptr;
+    const uint8_t *process_input_buff = nullptr;
     capi_v2_err_t rc = CAPI_V2_EOK;
     capi_v2_stream_data_t *stream_input = nullptr;
     sva_result_t *result_cfg_ptr = nullptr;
@@ -139,9 +122,7 @@ int32_t SoundTriggerEngineCapi::StartKeywordDetection()
     size_t start_idx = 0;
     size_t end_idx = 0;
     capi_v2_buf_t capi_result;
-    bool buffer_advanced = false;
-    size_t lab_buffer_size = 0;
-    bool first_buffer_processed = false;
+    uint32_t chunk_size = first_buffer_size_;
     FILE *keyword_detection_fd = nullptr;
     ChronoSteadyClock_t process_start;
     ChronoSteadyClock_t process_end;
@@ -151,37 +132,7 @@ int32_t SoundTriggerEngineCapi::StartKeywordDetection()
     uint64_t total_capi_process_duration = 0;
     uint64_t total_capi_get_param_duration = 0;
 
-    PAL_DBG(LOG_TAG, "Enter");
-    if (!reader_) {
-        status = -EINVAL;
-        PAL_ERR(LOG_TAG, "Invalid ring buffer reader");
-        goto exit;
-    }
-
-    reader_->getIndices(&buffer_start_, &buffer_end_);
-    if (buffer_start_ >= buffer_end_) {
-        status = -EINVAL;
-        PAL_ERR(LOG_TAG, "Invalid keyword indices");
-        goto exit;
-    }
-
-    // calculate start and end index including tolerance
-    if (buffer_start_ > UsToBytes(kw_start_tolerance_)) {
-        buffer_start_ -= UsToBytes(kw_start_tolerance_);
-    } else {
-        buffer_start_ = 0;
-    }
-
-    lab_buffer_size = buffer_size_;
-    buffer_size_ = buffer_end_ - buffer_start_;
-    /*
-     * As per requirement in PDK, input buffer size for
-     * second stage should be in multiple of 10 ms(10000us).
-     */
-    buffer_size_ -= buffer_size_ % (UsToBytes(10000));
-
-    buffer_end_ += UsToBytes(kw_end_tolerance_ + data_after_kw_end_);
-    PAL_DBG(LOG_TAG, "buffer_start_: %u, buffer_end_: %u",
+    PAL_DBG(LOG_TAG, "Enter, buffer_start_: %u, buffer_end_: %u",
         buffer_start_, buffer_end_);
     if (st_info_->GetEnableDebugDumps()) {
         ST_DBG_FILE_OPEN_WR(keyword_detection_fd, ST_DEBUG_DUMP_LOCATION,
@@ -192,72 +143,27 @@ int32_t SoundTriggerEngineCapi::StartKeywordDetection()
     }
 
     memset(&capi_result, 0, sizeof(capi_result));
-    process_input_buff = (char*)calloc(1, buffer_size_);
-    if (!process_input_buff) {
-        status = -ENOMEM;
-        PAL_ERR(LOG_TAG, "failed to allocate process input buff, status %d",
-                status);
-        goto exit;
-    }
-
-    stream_input = (capi_v2_stream_data_t *)
-                   calloc(1, sizeof(capi_v2_stream_data_t));
-    if (!stream_input) {
-        status = -ENOMEM;
-        PAL_ERR(LOG_TAG, "failed to allocate stream input, status %d", status);
-        goto exit;
-    }
-
-    stream_input->buf_ptr = (capi_v2_buf_t*)calloc(1, sizeof(capi_v2_buf_t));
-    if (!stream_input->buf_ptr) {
-        status = -ENOMEM;
-        PAL_ERR(LOG_TAG, "failed to allocate stream_input->buf_ptr, status %d",
-                status);
-        goto exit;
-    }
-
-    result_cfg_ptr = (sva_result_t*)calloc(1, sizeof(sva_result_t));
-    if (!result_cfg_ptr) {
-        status = -ENOMEM;
-        PAL_ERR(LOG_TAG, "failed to allocate result cfg ptr status %d", status);
-        goto exit;
-    }
+    /* buffers set up at start recognition, nothing is allocated here */
+    stream_input = &stream_input_;
+    result_cfg_ptr = &kw_result_;
+    memset(result_cfg_ptr, 0, sizeof(sva_result_t));
 
     process_start = std::chrono::steady_clock::now();
     while (!exit_buffering_ &&
         (bytes_processed_ < buffer_end_ - buffer_start_)) {
-        /* Original code had some time of wait will need to revisit*/
-        /* need to take into consideration the start and end buffer*/
-        if (!reader_->isEnabled()) {
-            status = -EINVAL;
-            goto exit;
-        }
-
-        /* advance the offset to ensure we are reading at the right place */
-        if (!buffer_advanced && buffer_start_ > 0) {
-            if (reader_->advanceReadOffset(buffer_start_)) {
-                buffer_advanced = true;
-            } else {
-                continue;
-            }
-        }
-
-        if (reader_->getUnreadSize() < buffer_size_)
-            continue;
-
-        read_size = reader_->read((void*)process_input_buff, buffer_size_);
-        if (read_size == 0) {
-            continue;
-        } else if (read_size < 0) {
-            status = read_size;
-            PAL_ERR(LOG_TAG, "Failed to read from buffer, status %d", status);
+        /* blocks until the keyword data reaches this chunk */
+        process_input_buff = window->Wait(buffer_start_ + bytes_processed_,
+            chunk_size, &status);
+        if (!process_input_buff) {
+            PAL_DBG(LOG_TAG, "No keyword data to process, status %d", status);
             goto exit;
         }
+        read_size = chunk_size;
 
         PAL_INFO(LOG_TAG, "Processed: %u, start: %u, end: %u",
                  bytes_processed_, buffer_start_, buffer_end_);
         stream_input->bufs_num = 1;
-        stream_input->buf_ptr->max_data_len = buffer_size_;
+        stream_input->buf_ptr->max_data_len = chunk_size;
         stream_input->buf_ptr->actual_data_len = read_size;
         stream_input->buf_ptr->data_ptr = (int8_t *)process_input_buff;
 
@@ -318,10 +224,7 @@ int32_t SoundTriggerEngineCapi::StartKeywordDetection()
         det_conf_score_ = result_cfg_ptr->best_confidence;
         PAL_INFO(LOG_TAG, "KW second stage conf level %d", det_conf_score_);
 
-        if (!first_buffer_processed) {
-            buffer_size_ = lab_buffer_size;
-            first_buffer_processed = true;
-        }
+        chunk_size = buffer_size_;
     }
 
 exit:
@@ -349,28 +252,16 @@ exit:
         ST_DBG_FILE_CLOSE(keyword_detection_fd);
     }
 
-    if (reader_)
-        reader_->updateState(READER_DISABLED);
-
-    if (process_input_buff)
-        free(process_input_buff);
-    if (stream_input) {
-        if (stream_input->buf_ptr)
-            free(stream_input->buf_ptr);
-        free(stream_input);
-    }
-    if (result_cfg_ptr)
-        free(result_cfg_ptr);
-
     PAL_DBG(LOG_TAG, "Exit, status %d", status);
 
     return status;
 }
 
-int32_t SoundTriggerEngineCapi::StartUserVerification()
+int32_t SoundTriggerEngineCapi::StartUserVerification(
+    std::shared_ptr<KeywordWindow> window)
 {
     int32_t status = 0;
-    char *process_input_buff = nullptr;
+    const uint8_t *process_input_buff = nullptr;
     capi_v2_err_t rc = CAPI_V2_EOK;
     capi_v2_stream_data_t *stream_input = nullptr;
     capi_v2_buf_t capi_uv_ptr;
@@ -378,7 +269,6 @@ int32_t SoundTriggerEngineCapi::StartUserVerification()
     stage2_uv_wrapper_stage1_uv_score_t *uv_cfg_ptr = nullptr;
     int32_t read_size = 0;
     capi_v2_buf_t capi_result;
-    bool buffer_advanced = false;
     StreamSoundTrigger *str = nullptr;
     struct detection_event_info *info = nullptr;
     FILE *user_verification_fd = nullptr;
@@ -390,30 +280,8 @@ int32_t SoundTriggerEngineCapi::StartUserVerification()
     uint64_t total_capi_process_duration = 0;
     uint64_t total_capi_get_param_duration = 0;
 
-    PAL_DBG(LOG_TAG, "Enter");
-    if (!reader_) {
-        status = -EINVAL;
-        PAL_ERR(LOG_TAG, "Invalid ring buffer reader");
-        goto exit;
-    }
-
-    reader_->getIndices(&buffer_start_, &buffer_end_);
-    if (buffer_start_ >= buffer_end_) {
-        status = -EINVAL;
-        PAL_ERR(LOG_TAG, "Invalid keyword indices");
-        goto exit;
-    }
-
-    // calculate start and end index including tolerance
-    if (buffer_start_ > UsToBytes(data_before_kw_start_)) {
-        buffer_start_ -= UsToBytes(data_before_kw_start_);
-    } else {
-        buffer_start_ = 0;
-    }
-
-    buffer_end_ += UsToBytes(kw_end_tolerance_);
-    buffer_size_ = buffer_end_ - buffer_start_;
-
+    PAL_DBG(LOG_TAG, "Enter, buffer_start_: %u, buffer_end_: %u",
+        buffer_start_, buffer_end_);
     if (st_info_->GetEnableDebugDumps()) {
         ST_DBG_FILE_OPEN_WR(user_verification_fd, ST_DEBUG_DUMP_LOCATION,
             "user_verification", "bin", user_verification_cnt);
@@ -425,43 +293,12 @@ int32_t SoundTriggerEngineCapi::StartUserVerification()
     memset(&capi_uv_ptr, 0, sizeof(capi_uv_ptr));
     memset(&capi_result, 0, sizeof(capi_result));
 
-    process_input_buff = (char*)calloc(1, buffer_size_);
-    if (!process_input_buff) {
-        PAL_ERR(LOG_TAG, "failed to allocate process input buff");
-        status = -ENOMEM;
-        goto exit;
-    }
-
-    stream_input = (capi_v2_stream_data_t *)
-                   calloc(1, sizeof(capi_v2_stream_data_t));
-    if (!stream_input) {
-        PAL_ERR(LOG_TAG, "failed to allocate stream input");
-        status = -ENOMEM;
-        goto exit;
-    }
-
-    stream_input->buf_ptr = (capi_v2_buf_t*)calloc(1, sizeof(capi_v2_buf_t));
-    if (!stream_input->buf_ptr) {
-        PAL_ERR(LOG_TAG, "failed to allocate buf ptr");
-        status = -ENOMEM;
-        goto exit;
-    }
-
-    result_cfg_ptr = (stage2_uv_wrapper_result*)
-                     calloc(1, sizeof(stage2_uv_wrapper_result));
-    if (!result_cfg_ptr) {
-        PAL_ERR(LOG_TAG, "failed to allocate result cfg ptr");
-        status = -ENOMEM;
-        goto exit;
-    }
-
-    uv_cfg_ptr = (stage2_uv_wrapper_stage1_uv_score_t *)
-                 calloc(1, sizeof(stage2_uv_wrapper_stage1_uv_score_t));
-    if (!uv_cfg_ptr) {
-        PAL_ERR(LOG_TAG, "failed to allocate uv cfg ptr");
-        status = -ENOMEM;
-        goto exit;
-    }
+    /* buffers set up at start recognition, nothing is allocated here */
+    stream_input = &stream_input_;
+    result_cfg_ptr = &uv_result_;
+    memset(result_cfg_ptr, 0, sizeof(stage2_uv_wrapper_result));
+    uv_cfg_ptr = &uv_score_;
+    memset(uv_cfg_ptr, 0, sizeof(stage2_uv_wrapper_stage1_uv_score_t));
 
     str = dynamic_cast<StreamSoundTrigger *>(stream_handle_);
     if (str->GetModelType() == ST_MODULE_TYPE_GMM) {
@@ -490,42 +327,18 @@ int32_t SoundTriggerEngineCapi::StartUserVerification()
         }
     }
 
-    if (kw_end_timestamp_ > 0)
-        buffer_end_ = UsToBytes(kw_end_timestamp_);
-
-    if (kw_start_timestamp_ > 0)
-        buffer_start_ = UsToBytes(kw_start_timestamp_);
-
     process_start = std::chrono::steady_clock::now();
     while (!exit_buffering_ &&
         (bytes_processed_ < buffer_end_ - buffer_start_)) {
-        /* Original code had some time of wait will need to revisit*/
-        /* need to take into consideration the start and end buffer*/
-        if (!reader_->isEnabled()) {
-            status = -EINVAL;
+        /* blocks until the keyword data reaches this chunk */
+        process_input_buff = window->Wait(buffer_start_ + bytes_processed_,
+            buffer_size_, &status);
+        if (!process_input_buff) {
+            PAL_DBG(LOG_TAG, "No keyword data to process, status %d", status);
             goto exit;
         }
+        read_size = buffer_size_;
 
-        /* advance the offset to ensure we are reading at the right place */
-        if (!buffer_advanced && buffer_start_ > 0) {
-            if (reader_->advanceReadOffset(buffer_start_)) {
-                buffer_advanced = true;
-            } else {
-                continue;
-            }
-        }
-
-        if (reader_->getUnreadSize() < buffer_size_)
-            continue;
-
-        read_size = reader_->read((void*)process_input_buff, buffer_size_);
-        if (read_size == 0) {
-            continue;
-        } else if (read_size < 0) {
-            status = read_size;
-            PAL_ERR(LOG_TAG, "Failed to read from buffer, status %d", status);
-            goto exit;
-        }
         PAL_INFO(LOG_TAG, "Processed: %u, start: %u, end: %u",
                  bytes_processed_, buffer_start_, buffer_end_);
         stream_input->bufs_num = 1;
@@ -612,21 +425,6 @@ exit:
                 status);
     }
 
-    if (reader_)
-        reader_->updateState(READER_DISABLED);
-
-    if (process_input_buff)
-        free(process_input_buff);
-    if (stream_input) {
-        if (stream_input->buf_ptr)
-            free(stream_input->buf_ptr);
-        free(stream_input);
-    }
-    if (result_cfg_ptr)
-        free(result_cfg_ptr);
-    if (uv_cfg_ptr)
-        free(uv_cfg_ptr);
-
     PAL_DBG(LOG_TAG, "Exit, status %d", status);
 
     return status;
@@ -662,8 +460,21 @@ SoundTriggerEngineCapi::SoundTriggerEngineCapi(
     confidence_score_ = 0;
     keyword_detected_ = false;
     det_conf_score_ = 0;
+    first_buffer_size_ = 0;
+    job_pending_ = false;
+    window_ = nullptr;
+    own_window_ = nullptr;
+    task_.run = ProcessDetection;
+    task_.arg = this;
+    task_.next = nullptr;
+    task_.queued = false;
     memset(&in_model_buffer_param_, 0, sizeof(in_model_buffer_param_));
     memset(&scratch_param_, 0, sizeof(scratch_param_));
+    memset(&stream_input_, 0, sizeof(stream_input_));
+    memset(&stream_buf_, 0, sizeof(stream_buf_));
+    memset(&kw_result_, 0, sizeof(kw_result_));
+    memset(&uv_result_, 0, sizeof(uv_result_));
+    memset(&uv_score_, 0, sizeof(uv_score_));
 
     st_info_ = SoundTriggerPlatformInfo::GetInstance();
     if (!st_info_) {
@@ -740,20 +551,10 @@ SoundTriggerEngineCapi::~SoundTriggerEngineCapi()
 {
     PAL_DBG(LOG_TAG, "Enter");
     /*
-     * join thread if it is not joined, sometimes
+     * wait for a queued or running detection job, sometimes
      * stop/unload may fail before deconstruction.
      */
-    if (buffer_thread_handler_.joinable()) {
-        processing_started_ = false;
-        std::unique_lock<std::mutex> lck(event_mutex_);
-        exit_thread_ = true;
-        exit_buffering_ = true;
-        cv_.notify_one();
-        lck.unlock();
-        buffer_thread_handler_.join();
-        lck.lock();
-        PAL_INFO(LOG_TAG, "Thread joined");
-    }
+    StopSoundEngine();
     if (buffer_) {
         delete buffer_;
     }
@@ -782,6 +583,11 @@ int32_t SoundTriggerEngineCapi::StartSoundEngine()
     capi_v2_buf_t capi_buf;
 
     PAL_DBG(LOG_TAG, "Enter");
+    /* reused by every detection until recognition stops */
+    memset(&stream_input_, 0, sizeof(stream_input_));
+    memset(&stream_buf_, 0, sizeof(stream_buf_));
+    stream_input_.buf_ptr = &stream_buf_;
+
     if (detection_type_ == ST_SM_TYPE_KEYWORD_DETECTION) {
         sva_threshold_config_t *threshold_cfg = nullptr;
         threshold_cfg = (sva_threshold_config_t*)
@@ -870,17 +676,10 @@ int32_t SoundTriggerEngineCapi::StopSoundEngine()
     int32_t status = 0;
 
     PAL_DBG(LOG_TAG, "Enter");
+    CancelDetection();
     {
-        processing_started_ = false;
-        std::lock_guard<std::mutex> lck(event_mutex_);
-        exit_thread_ = true;
-        exit_buffering_ = true;
-
-        cv_.notify_one();
-    }
-    if (buffer_thread_handler_.joinable()) {
-        PAL_DBG(LOG_TAG, "Thread joined");
-        buffer_thread_handler_.join();
+        std::unique_lock<std::mutex> lck(event_mutex_);
+        cv_.wait(lck, [this] { return !job_pending_; });
     }
     PAL_DBG(LOG_TAG, "Exit, status %d", status);
 
@@ -941,15 +740,6 @@ int32_t SoundTriggerEngineCapi::LoadSoundModel(Stream *s __unused,
         goto exit;
     }
 
-    buffer_thread_handler_ =
-        std::thread(SoundTriggerEngineCapi::BufferThreadLoop, this);
-
-    if (!buffer_thread_handler_.joinable()) {
-        status = -EINVAL;
-        PAL_ERR(LOG_TAG, "failed to create buffer thread = %d", status);
-        goto exit;
-    }
-
     if (detection_type_ == ST_SM_TYPE_USER_VERIFICATION) {
         PAL_VERBOSE(LOG_TAG, "Issuing capi_get STAGE2_UV_WRAPPER_ID_INMODEL_BUFFER_SIZE");
 
@@ -1069,9 +859,8 @@ int32_t SoundTriggerEngineCapi::RestartRecognition(Stream *s __unused)
 
     PAL_DBG(LOG_TAG, "Enter");
     std::lock_guard<std::mutex> lck(mutex_);
-    processing_started_ = false;
+    CancelDetection();
     {
-        exit_buffering_ = true;
         std::lock_guard<std::mutex> event_lck(event_mutex_);
     }
     if (reader_) {
@@ -1093,9 +882,8 @@ int32_t SoundTriggerEngineCapi::StopRecognition(Stream *s __unused)
 
     PAL_DBG(LOG_TAG, "Enter");
     std::lock_guard<std::mutex> lck(mutex_);
-    processing_started_ = false;
+    CancelDetection();
     {
-        exit_buffering_ = true;
         std::lock_guard<std::mutex> event_lck(event_mutex_);
     }
     if (reader_) {
@@ -1133,17 +921,143 @@ int32_t SoundTriggerEngineCapi::UpdateConfLevels(
     return status;
 }
 
+/* called with event_mutex_ held */
+int32_t SoundTriggerEngineCapi::ReserveWindow(
+    std::shared_ptr<KeywordWindow> window)
+{
+    int32_t status = 0;
+    uint32_t total_size = 0;
+    uint32_t reserve_end = 0;
+
+    if (!reader_) {
+        PAL_ERR(LOG_TAG, "Invalid ring buffer reader");
+        return -EINVAL;
+    }
+
+    reader_->getIndices(&buffer_start_, &buffer_end_);
+    if (buffer_start_ >= buffer_end_) {
+        PAL_ERR(LOG_TAG, "Invalid keyword indices");
+        return -EINVAL;
+    }
+
+    // calculate start and end index including tolerance
+    if (detection_type_ == ST_SM_TYPE_KEYWORD_DETECTION) {
+        if (buffer_start_ > UsToBytes(kw_start_tolerance_)) {
+            buffer_start_ -= UsToBytes(kw_start_tolerance_);
+        } else {
+            buffer_start_ = 0;
+        }
+
+        first_buffer_size_ = buffer_end_ - buffer_start_;
+        /*
+         * As per requirement in PDK, input buffer size for
+         * second stage should be in multiple of 10 ms(10000us).
+         */
+        first_buffer_size_ -= first_buffer_size_ % (UsToBytes(10000));
+        if (!first_buffer_size_)
+            first_buffer_size_ = buffer_size_;
+
+        buffer_end_ += UsToBytes(kw_end_tolerance_ + data_after_kw_end_);
+    } else {
+        if (buffer_start_ > UsToBytes(data_before_kw_start_)) {
+            buffer_start_ -= UsToBytes(data_before_kw_start_);
+        } else {
+            buffer_start_ = 0;
+        }
+
+        buffer_end_ += UsToBytes(kw_end_tolerance_);
+        buffer_size_ = buffer_end_ - buffer_start_;
+        first_buffer_size_ = buffer_size_;
+
+        if (kw_end_timestamp_ > 0)
+            buffer_end_ = UsToBytes(kw_end_timestamp_);
+
+        if (kw_start_timestamp_ > 0)
+            buffer_start_ = UsToBytes(kw_start_timestamp_);
+    }
+
+    /* the last buffer handed to the algo may run past buffer_end_ */
+    total_size = buffer_end_ - buffer_start_;
+    reserve_end = buffer_start_ + first_buffer_size_;
+    if (total_size > first_buffer_size_)
+        reserve_end += (total_size - first_buffer_size_ + buffer_size_ - 1) /
+            buffer_size_ * buffer_size_;
+
+    PAL_DBG(LOG_TAG, "buffer_start_: %u, buffer_end_: %u, reserve end: %u",
+        buffer_start_, buffer_end_, reserve_end);
+    /* only an accepted reservation is held in window_ and paired with Done */
+    status = window->Reserve(reader_, buffer_start_, reserve_end);
+    if (status)
+        return status;
+    window = std::atomic_exchange(&window_, window);
+    if (window)
+        window->Done();
+
+    return 0;
+}
+
+void SoundTriggerEngineCapi::SetKeywordWindow(
+    std::shared_ptr<KeywordWindow> window)
+{
+    std::lock_guard<std::mutex> lck(event_mutex_);
+
+    if (processing_started_) {
+        PAL_VERBOSE(LOG_TAG, "processing already started");
+        return;
+    }
+
+    if (ReserveWindow(window))
+        CancelDetection();
+}
+
+/*
+ * Stops processing at the next buffer boundary without waiting for it,
+ * callers needing the job idle take event_mutex_ afterwards.
+ */
+void SoundTriggerEngineCapi::CancelDetection()
+{
+    std::shared_ptr<KeywordWindow> window = nullptr;
+
+    processing_started_ = false;
+    exit_buffering_ = true;
+    window = std::atomic_exchange(&window_,
+        std::shared_ptr<KeywordWindow>(nullptr));
+    if (window) {
+        window->Cancel();
+        window->Done();
+    }
+}
+
 void SoundTriggerEngineCapi::SetDetected(bool detected)
 {
     PAL_DBG(LOG_TAG, "SetDetected %d", detected);
+    if (!detected) {
+        CancelDetection();
+        std::lock_guard<std::mutex> lck(event_mutex_);
+        return;
+    }
+
     std::lock_guard<std::mutex> lck(event_mutex_);
-    if (detected != processing_started_) {
-        if (detected)
-            reader_->updateState(READER_ENABLED);
-        processing_started_ = detected;
-        exit_buffering_ = !processing_started_;
+    if (!processing_started_) {
+        /* stream did not set up a shared window, read on our own */
+        if (!std::atomic_load(&window_)) {
+            /* reuse the storage unless the last job still holds it */
+            if (own_window_ && own_window_.use_count() == 1)
+                own_window_->Reset();
+            else
+                own_window_ = std::make_shared<KeywordWindow>();
+            if (ReserveWindow(own_window_)) {
+                PAL_ERR(LOG_TAG, "No keyword window, skip detection");
+                return;
+            }
+        }
+        processing_started_ = true;
+        exit_buffering_ = false;
+        if (!job_pending_) {
+            job_pending_ = true;
+            SecondStageScheduler::GetInstance()->Submit(&task_);
+        }
         PAL_INFO(LOG_TAG, "setting processing started %d", detected);
-        cv_.notify_one();
     } else {
         PAL_VERBOSE(LOG_TAG, "processing started unchanged");
     }
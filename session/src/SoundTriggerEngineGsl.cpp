@@ -952,6 +952,8 @@ SoundTriggerEngineGsl::SoundTriggerEngineGsl(
 
 SoundTriggerEngineGsl::~SoundTriggerEngineGsl() {
     PAL_INFO(LOG_TAG, "Enter");
+    /* StopRecognition does not wait for a detection callback still running */
+    ResourceManager::getInstance()->waitMixerEventCallbacks((uint64_t)this);
     if (buffer_thread_handler_.joinable()) {
         exit_buffering_ = true;
         std::unique_lock<std::mutex> lck(mutex_);
@@ -994,6 +996,7 @@ int32_t SoundTriggerEngineGsl::QuerySoundModel(SoundModelInfo *sm_info,
     listen_status_enum sml_ret = kSucess;
     uint32_t status = 0;
     std::shared_ptr<SoundModelLib>sml = SoundModelLib::GetInstance();
+    std::shared_ptr<SoundModelCache> sm_cache = SoundModelCache::GetInstance();
 
     PAL_VERBOSE(LOG_TAG, "Enter: sound model size %d", data_size);
 
@@ -1002,6 +1005,11 @@ int32_t SoundTriggerEngineGsl::QuerySoundModel(SoundModelInfo *sm_info,
         return -ENOSYS;
     }
 
+    if (sm_cache->GetHeader(data, data_size, sm_info)) {
+        PAL_VERBOSE(LOG_TAG, "header info found in cache");
+        return 0;
+    }
+
     model.data = data;
     model.size = data_size;
 
@@ -1048,6 +1056,7 @@ int32_t SoundTriggerEngineGsl::QuerySoundModel(SoundModelInfo *sm_info,
         status = -EINVAL;
         goto cleanup_1;
     }
+    sm_cache->PutHeader(data, data_size, sm_info);
     PAL_VERBOSE(LOG_TAG, "exit");
     return 0;
 
@@ -1134,6 +1143,7 @@ int32_t SoundTriggerEngineGsl::AddSoundModel(Stream *s, uint8_t *data,
     listen_model_type **in_models = nullptr;
     listen_model_type out_model = {};
     SoundModelInfo *sm_info;
+    std::vector<SoundModelRef> model_set;
 
     PAL_VERBOSE(LOG_TAG, "Enter");
     if (st->GetSoundModelInfo()->GetModelData()) {
@@ -1199,6 +1209,16 @@ int32_t SoundTriggerEngineGsl::AddSoundModel(Stream *s, uint8_t *data,
         }
     }
 
+    /* Same set of models merged before, reuse that result */
+    model_set = GetModelRefs(s);
+    model_set.push_back(SoundModelRef{data, data_size});
+    if (SoundModelCache::GetInstance()->GetMerged(model_set, eng_sm_info_)) {
+        PAL_INFO(LOG_TAG, "Reuse cached merged model, size %d",
+            eng_sm_info_->GetModelSize());
+        sm_merged_ = true;
+        return 0;
+    }
+
     /* Merge this stream model with remaining streams models */
     num_models = 2;
     SoundModelInfo::AllocArrayPtrs((char***)&in_models, num_models,
@@ -1245,8 +1265,10 @@ int32_t SoundTriggerEngineGsl::AddSoundModel(Stream *s, uint8_t *data,
         eng_sm_info_->GetModelSize(), out_model.size);
     *eng_sm_info_ = *sm_info;
     sm_merged_ = true;
+    SoundModelCache::GetInstance()->PutMerged(model_set, eng_sm_info_);
 
     delete sm_info;
+    free(out_model.data);
     PAL_DBG(LOG_TAG, "Exit: status %d", status);
     return 0;
 cleanup:
@@ -1351,6 +1373,7 @@ int32_t SoundTriggerEngineGsl::DeleteSoundModel(Stream *s) {
     listen_model_type in_model = {};
     listen_model_type out_model = {};
     SoundModelInfo *sm_info = nullptr;
+    std::vector<SoundModelRef> model_set;
 
     PAL_VERBOSE(LOG_TAG, "Enter");
     if (!st->GetSoundModelInfo()->GetModelData()) {
@@ -1397,6 +1420,15 @@ int32_t SoundTriggerEngineGsl::DeleteSoundModel(Stream *s) {
         return 0;
     }
 
+    /* Remaining models were merged before, reuse that result */
+    model_set = GetModelRefs(s);
+    if (SoundModelCache::GetInstance()->GetMerged(model_set, eng_sm_info_)) {
+        PAL_INFO(LOG_TAG, "Reuse cached merged model, size %d",
+            eng_sm_info_->GetModelSize());
+        sm_merged_ = true;
+        return 0;
+    }
+
     /*
      * Delete this stream model with already existing merged model due to other
      * streams models.
@@ -1423,8 +1455,10 @@ int32_t SoundTriggerEngineGsl::DeleteSoundModel(Stream *s) {
     /* Update existing merged model info with new merged model */
     status = QuerySoundModel(sm_info, out_model.data,
                                out_model.size);
-    if (status)
+    if (status) {
+        delete sm_info;
         goto cleanup;
+    }
 
     if (out_model.size > eng_sm_info_->GetModelSize()) {
         PAL_ERR(LOG_TAG, "Unexpected, merged model sz %d > current sz %d",
@@ -1439,7 +1473,10 @@ int32_t SoundTriggerEngineGsl::DeleteSoundModel(Stream *s) {
 
     *eng_sm_info_ = *sm_info;
     sm_merged_ = true;
+    SoundModelCache::GetInstance()->PutMerged(model_set, eng_sm_info_);
 
+    delete sm_info;
+    free(out_model.data);
     return 0;
 
 cleanup:
@@ -1449,6 +1486,25 @@ cleanup:
     return status;
 }
 
+/* stream models loaded on this engine */
+std::vector<SoundModelRef> SoundTriggerEngineGsl::GetModelRefs(Stream *exclude) {
+
+    std::vector<SoundModelRef> models;
+    StreamSoundTrigger *sst = nullptr;
+
+    for (int i = 0; i < eng_streams_.size(); i++) {
+        sst = dynamic_cast<StreamSoundTrigger *>(eng_streams_[i]);
+        if (eng_streams_[i] == exclude || !sst || !sst->GetSoundModelInfo() ||
+            !sst->GetSoundModelInfo()->GetModelData())
+            continue;
+        models.push_back(SoundModelRef{
+            sst->GetSoundModelInfo()->GetModelData(),
+            sst->GetSoundModelInfo()->GetModelSize()});
+    }
+
+    return models;
+}
+
 int32_t SoundTriggerEngineGsl::UpdateEngineModel(Stream *s, uint8_t *data,
                                                  uint32_t data_size, bool add) {
 
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the
+ * disclaimer below) provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *     * Neither the name of Qualcomm Innovation Center, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+ * GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+ * HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PAL_SIM_BACKEND_H
+#define PAL_SIM_BACKEND_H
+
+/*
+ * Simulated tinyalsa/tinycompress/audio_route/AGM backend.
+ *
+ * Built into libpal instead of the real libraries when configured with
+ * --with-sim-backend. Only the kernel and DSP facing libraries are
+ * replaced: the build still needs the ar_osal, spf, acdb and AGM headers
+ * and libar_osal/libspf, which configure checks for, and pal_init still
+ * parses card-defs.xml, the resourcemanager and mixer path XMLs and
+ * usecaseKvManager.xml from their usual /vendor/etc or /etc locations. None
+ * of these ship with the tree; a host without the XMLs fails pal_init, and
+ * PalSimTest and pal_benchmark then skip their PAL API cases.
+ *
+ * The entry points below let a harness drive the simulated card; all of
+ * them are also controllable through environment variables so unmodified
+ * clients (PalTest, benchmarks) can use it:
+ *
+ *   PAL_SIM_CLOCK            "realtime" (default) or "virtual"
+ *   PAL_SIM_PERIOD_US        fixed period duration, overrides rate pacing
+ *   PAL_SIM_CARD_NAME        name reported for the hw card
+ *   PAL_SIM_CARD_STATE_NODE  path of the simulated card state node
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    /* devices consume/produce data at wall clock pace */
+    PAL_SIM_CLOCK_REALTIME = 0,
+    /*
+     * devices share a simulated clock that jumps forward whenever a
+     * transfer has to wait, so nothing sleeps and timing is reproducible
+     */
+    PAL_SIM_CLOCK_VIRTUAL,
+} pal_sim_clock_mode_t;
+
+struct pal_sim_stats {
+    uint64_t pcm_opens;
+    uint64_t pcm_writes;
+    uint64_t pcm_reads;
+    uint64_t pcm_frames_written;
+    uint64_t pcm_frames_read;
+    uint64_t pcm_xruns;
+    uint64_t compress_writes;
+    uint64_t compress_bytes_written;
+    uint64_t mixer_set_calls;
+    uint64_t mixer_set_bytes;
+    uint64_t mixer_get_calls;
+    uint64_t route_updates;
+    /* non tunnel buffers returned, and time sessions starved between them */
+    uint64_t agm_buffers_done;
+    uint64_t agm_idle_ns;
+};
+
+void pal_sim_set_clock_mode(pal_sim_clock_mode_t mode);
+pal_sim_clock_mode_t pal_sim_get_clock_mode(void);
+
+/* 0 restores pacing derived from the configured sample rate */
+void pal_sim_set_period_us(uint32_t period_us);
+uint32_t pal_sim_get_period_us(void);
+
+/* Monotonic time of the simulated devices in ns, virtual clock aware */
+uint64_t pal_sim_get_time_ns(void);
+
+/* 0: offline, 1: online. Delivered through the card state node */
+int pal_sim_set_card_state(int state);
+int pal_sim_get_card_state(void);
+const char *pal_sim_get_card_state_node(void);
+
+/* Extends the table returned by "<fe> getTaggedInfo" on every FE */
+int pal_sim_add_tagged_module(uint32_t tag_id, uint32_t module_id);
+
+/* Raises "<name>" as a mixer event on the virtual card */
+int pal_sim_inject_mixer_event(const char *ctl_name, const void *payload,
+                               size_t size);
+
+void pal_sim_get_stats(struct pal_sim_stats *stats);
+void pal_sim_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PAL_SIM_BACKEND_H */
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the
+ * disclaimer below) provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *     * Neither the name of Qualcomm Innovation Center, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+ * GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+ * HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SIM_BACKEND_H
+#define SIM_BACKEND_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <stdint.h>
+#include "PalSimBackend.h"
+
+#define SIM_NS_PER_SEC 1000000000ULL
+#define SIM_DEFAULT_PERIOD_US 20000
+
+struct sim_counters {
+    std::atomic<uint64_t> pcm_opens{0};
+    std::atomic<uint64_t> pcm_writes{0};
+    std::atomic<uint64_t> pcm_reads{0};
+    std::atomic<uint64_t> pcm_frames_written{0};
+    std::atomic<uint64_t> pcm_frames_read{0};
+    std::atomic<uint64_t> pcm_xruns{0};
+    std::atomic<uint64_t> compress_writes{0};
+    std::atomic<uint64_t> compress_bytes_written{0};
+    std::atomic<uint64_t> mixer_set_calls{0};
+    std::atomic<uint64_t> mixer_set_bytes{0};
+    std::atomic<uint64_t> mixer_get_calls{0};
+    std::atomic<uint64_t> route_updates{0};
+    std::atomic<uint64_t> agm_buffers_done{0};
+    std::atomic<uint64_t> agm_idle_ns{0};
+};
+
+/*
+ * Device position of one simulated pcm/compress stream. Units are frames
+ * for pcm and bytes for compress; the position advances a whole period at
+ * a time like a DMA would. Callers serialize access with the device lock.
+ */
+class SimStreamClock {
+public:
+    SimStreamClock();
+    void configure(uint64_t unitsPerSec, uint32_t periodUnits);
+    void start();
+    void pause();
+    void resume();
+    void stop();
+    bool isRunning() const { return running; }
+    /* units consumed/produced by the device since start */
+    uint64_t position();
+    /* simulated time at which position() reaches target */
+    uint64_t deadlineFor(uint64_t target);
+
+private:
+    uint64_t periodNs();
+    uint64_t unitsPerSec;
+    uint32_t periodUnits;
+    uint64_t startNs;
+    uint64_t basePos;
+    bool running;
+};
+
+/*
+ * Blocking transfers wait with the device lock dropped. The gate counts
+ * them so that close can abort them and free the device only once the
+ * last one has left it.
+ */
+class SimDeviceGate {
+public:
+    SimDeviceGate() : waiters(0), closing(false) {}
+    bool isClosing() const { return closing; }
+    /*
+     * Called with the device lock held; drops it around sim_wait_until()
+     * and retakes it. Returns false when the wait was aborted or the device
+     * is being closed, the caller must then return without touching it.
+     */
+    bool wait(std::unique_lock<std::mutex> &lock, uint64_t deadline,
+              const std::atomic<bool> *abort);
+    /* called by close with the device lock held */
+    void close(std::unique_lock<std::mutex> &lock, std::atomic<bool> *abort);
+
+private:
+    std::condition_variable cv;
+    uint32_t waiters;
+    bool closing;
+};
+
+sim_counters &sim_get_counters();
+/* current simulated time, wall clock or virtual depending on the mode */
+uint64_t sim_now_ns();
+/*
+ * Waits until the simulated time reaches deadline. Returns early with
+ * false once abort becomes true.
+ */
+bool sim_wait_until(uint64_t deadline, const std::atomic<bool> *abort);
+
+#endif /* SIM_BACKEND_H */
@@ -0,0 +1,415 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the
+ * disclaimer below) provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *     * Neither the name of Qualcomm Innovation Center, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+ * GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+ * HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define LOG_TAG "PAL: SimAgm"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <agm/agm_api.h>
+#include "PalCommon.h"
+#include "SimBackend.h"
+
+/*
+ * The tunnel path goes through the simulated pcm/compress/mixer, only the
+ * non-tunnel sessions (SessionAgm) need the AGM session API. Each of them
+ * owns a worker that plays the DSP: queued buffers are consumed in order at
+ * the media rate of the session, and every one of them is returned through a
+ * read/write done event. Time the worker spends with an empty queue while
+ * started is accounted as idle.
+ */
+
+#define SIM_AGM_DEFAULT_BYTES_PER_SEC (48000 * 2 * 2)
+
+enum sim_agm_op {
+    SIM_AGM_OP_WRITE,
+    SIM_AGM_OP_READ,
+    SIM_AGM_OP_EOS,
+};
+
+struct sim_agm_request {
+    enum sim_agm_op op;
+    struct agm_buff buf;
+};
+
+struct sim_agm_session {
+    uint32_t sessionId;
+    agm_event_cb cb;
+    void *clientData;
+    uint64_t writeBytesPerSec;
+    uint64_t readBytesPerSec;
+    std::mutex lock;
+    std::condition_variable cv;
+    std::deque<struct sim_agm_request> requests;
+    std::thread worker;
+    std::atomic<bool> stopped;
+    bool started;
+};
+
+static std::mutex simAgmLock;
+static std::map<uint32_t, struct sim_agm_session *> simAgmSessions;
+
+static struct sim_agm_session *sim_agm_get(uint64_t handle)
+{
+    return (struct sim_agm_session *)handle;
+}
+
+static uint64_t sim_agm_bytes_per_sec(struct agm_media_config *cfg)
+{
+    uint32_t sampleBytes = 2;
+
+    if (!cfg || !cfg->rate || !cfg->channels)
+        return SIM_AGM_DEFAULT_BYTES_PER_SEC;
+
+    switch (cfg->format) {
+    case AGM_FORMAT_PCM_S16_LE:
+        sampleBytes = 2;
+        break;
+    case AGM_FORMAT_PCM_S24_3LE:
+        sampleBytes = 3;
+        break;
+    case AGM_FORMAT_PCM_S24_LE:
+    case AGM_FORMAT_PCM_S32_LE:
+        sampleBytes = 4;
+        break;
+    default:
+        /* encoded data, pace it as 16 bit pcm of the same rate */
+        break;
+    }
+    return (uint64_t)cfg->rate * cfg->channels * sampleBytes;
+}
+
+static void sim_agm_notify(struct sim_agm_session *session, uint32_t eventId,
+                           struct sim_agm_request *req)
+{
+    struct agm_event_cb_params *params = NULL;
+    struct agm_event_read_write_done_payload *done = NULL;
+    size_t size = sizeof(*params);
+    agm_event_cb cb = NULL;
+    void *clientData = NULL;
+
+    {
+        std::lock_guard<std::mutex> lck(session->lock);
+        cb = session->cb;
+        clientData = session->clientData;
+    }
+    if (!cb)
+        return;
+
+    if (req->op != SIM_AGM_OP_EOS)
+        size += sizeof(*done);
+    params = (struct agm_event_cb_params *)calloc(1, size);
+    if (!params) {
+        PAL_ERR(LOG_TAG, "no memory for event %u", eventId);
+        return;
+    }
+    params->event_id = eventId;
+    if (req->op != SIM_AGM_OP_EOS) {
+        params->event_payload_size = sizeof(*done);
+        done = (struct agm_event_read_write_done_payload *)params->event_payload;
+        done->status = 0;
+        done->buff = req->buf;
+    }
+    cb(session->sessionId, params, clientData);
+    free(params);
+}
+
+static void sim_agm_worker(struct sim_agm_session *session)
+{
+    struct sim_agm_request req;
+    uint64_t bytesPerSec = 0;
+    uint64_t readyNs = sim_now_ns();
+    uint64_t now = 0;
+    uint32_t eventId = 0;
+    std::unique_lock<std::mutex> lck(session->lock);
+
+    while (!session->stopped) {
+        if (session->requests.empty()) {
+            session->cv.wait(lck, [session] {
+                return session->stopped || !session->requests.empty();
+            });
+            continue;
+        }
+        req = session->requests.front();
+        session->requests.pop_front();
+        bytesPerSec = (req.op == SIM_AGM_OP_READ) ?
+                      session->readBytesPerSec : session->writeBytesPerSec;
+        lck.unlock();
+
+        /* the DSP was starved if the buffer showed up after it was done */
+        now = sim_now_ns();
+        if (now > readyNs) {
+            sim_get_counters().agm_idle_ns += now - readyNs;
+            readyNs = now;
+        }
+        if (req.op != SIM_AGM_OP_EOS) {
+            readyNs += req.buf.size * SIM_NS_PER_SEC / bytesPerSec;
+            if (sim_wait_until(readyNs, &session->stopped)) {
+                eventId = (req.op == SIM_AGM_OP_READ) ?
+                          AGM_EVENT_READ_DONE : AGM_EVENT_WRITE_DONE;
+                sim_get_counters().agm_buffers_done++;
+                sim_agm_notify(session, eventId, &req);
+            }
+        } else {
+            sim_agm_notify(session, AGM_EVENT_EOS_RENDERED, &req);
+        }
+        lck.lock();
+    }
+}
+
+static int sim_agm_queue(uint64_t handle, enum sim_agm_op op,
+                         struct agm_buff *buf)
+{
+    struct sim_agm_session *session = sim_agm_get(handle);
+    struct sim_agm_request req;
+
+    if (!session)
+        return -EINVAL;
+
+    memset(&req, 0, sizeof(req));
+    req.op = op;
+    if (buf)
+        req.buf = *buf;
+
+    std::lock_guard<std::mutex> lck(session->lock);
+    if (!session->started)
+        return -EIO;
+    session->requests.push_back(req);
+    session->cv.notify_one();
+    return 0;
+}
+
+int agm_register_service_crash_callback(agm_service_crash_cb cb __unused,
+                                        uint64_t cookie __unused)
+{
+    return 0;
+}
+
+int agm_dump(struct agm_dump_info *dump_info __unused)
+{
+    return 0;
+}
+
+int agm_session_register_cb(uint32_t session_id, agm_event_cb cb,
+                            enum event_type evt_type,
+                            void *client_data)
+{
+    std::lock_guard<std::mutex> lck(simAgmLock);
+    auto it = simAgmSessions.find(session_id);
+
+    /* tunnel sessions register too, their events come from the mixer */
+    if (it == simAgmSessions.end() || evt_type != AGM_EVENT_DATA_PATH)
+        return 0;
+
+    std::lock_guard<std::mutex> sessLck(it->second->lock);
+    it->second->cb = cb;
+    it->second->clientData = client_data;
+    return 0;
+}
+
+int agm_session_open(uint32_t session_id, enum agm_session_mode sess_mode,
+                     uint64_t *handle)
+{
+    struct sim_agm_session *session = NULL;
+
+    if (sess_mode != AGM_SESSION_NON_TUNNEL || !handle) {
+        PAL_ERR(LOG_TAG, "session %u mode %d not simulated", session_id, sess_mode);
+        return -ENOSYS;
+    }
+
+    std::lock_guard<std::mutex> lck(simAgmLock);
+    if (simAgmSessions.count(session_id)) {
+        PAL_ERR(LOG_TAG, "session %u already open", session_id);
+        return -EBUSY;
+    }
+    session = new sim_agm_session();
+    session->sessionId = session_id;
+    session->cb = NULL;
+    session->clientData = NULL;
+    session->writeBytesPerSec = SIM_AGM_DEFAULT_BYTES_PER_SEC;
+    session->readBytesPerSec = SIM_AGM_DEFAULT_BYTES_PER_SEC;
+    session->stopped = true;
+    session->started = false;
+    simAgmSessions[session_id] = session;
+    *handle = (uint64_t)session;
+    return 0;
+}
+
+int agm_session_stop(uint64_t hndl)
+{
+    struct sim_agm_session *session = sim_agm_get(hndl);
+
+    if (!session)
+        return -EINVAL;
+
+    {
+        std::lock_guard<std::mutex> lck(session->lock);
+        session->started = false;
+        session->stopped = true;
+        session->requests.clear();
+        session->cv.notify_all();
+    }
+    if (session->worker.joinable())
+        session->worker.join();
+    return 0;
+}
+
+int agm_session_close(uint64_t hndl)
+{
+    struct sim_agm_session *session = sim_agm_get(hndl);
+
+    if (!session)
+        return 0;
+
+    agm_session_stop(hndl);
+    {
+        std::lock_guard<std::mutex> lck(simAgmLock);
+        simAgmSessions.erase(session->sessionId);
+    }
+    delete session;
+    return 0;
+}
+
+int agm_session_set_metadata(uint32_t session_id __unused,
+                             uint32_t size __unused,
+                             uint8_t *metadata __unused)
+{
+    return 0;
+}
+
+int agm_session_set_non_tunnel_mode_config(uint64_t hndl,
+        struct agm_session_config *session_config __unused,
+        struct agm_media_config *in_media_config,
+        struct agm_media_config *out_media_config,
+        struct agm_buffer_config *in_buffer_config __unused,
+        struct agm_buffer_config *out_buffer_config __unused)
+{
+    struct sim_agm_session *session = sim_agm_get(hndl);
+
+    if (!session)
+        return -EINVAL;
+
+    std::lock_guard<std::mutex> lck(session->lock);
+    session->writeBytesPerSec = sim_agm_bytes_per_sec(in_media_config);
+    session->readBytesPerSec = sim_agm_bytes_per_sec(out_media_config);
+    return 0;
+}
+
+int agm_session_prepare(uint64_t hndl)
+{
+    return sim_agm_get(hndl) ? 0 : -EINVAL;
+}
+
+int agm_session_start(uint64_t hndl)
+{
+    struct sim_agm_session *session = sim_agm_get(hndl);
+
+    if (!session)
+        return -EINVAL;
+
+    std::lock_guard<std::mutex> lck(session->lock);
+    if (session->started)
+        return 0;
+    session->stopped = false;
+    session->started = true;
+    session->worker = std::thread(sim_agm_worker, session);
+    return 0;
+}
+
+int agm_session_flush(uint64_t hndl)
+{
+    struct sim_agm_session *session = sim_agm_get(hndl);
+
+    if (!session)
+        return -EINVAL;
+
+    std::lock_guard<std::mutex> lck(session->lock);
+    session->requests.clear();
+    return 0;
+}
+
+int agm_session_suspend(uint64_t hndl)
+{
+    return sim_agm_get(hndl) ? 0 : -EINVAL;
+}
+
+int agm_session_eos(uint64_t hndl)
+{
+    return sim_agm_queue(hndl, SIM_AGM_OP_EOS, NULL);
+}
+
+int agm_session_read_with_metadata(uint64_t handle, struct agm_buff *buf,
+                                   uint32_t *captured_size)
+{
+    int status = 0;
+
+    if (!buf)
+        return -EINVAL;
+    status = sim_agm_queue(handle, SIM_AGM_OP_READ, buf);
+    if (!status && captured_size)
+        *captured_size = buf->size;
+    return status;
+}
+
+int agm_session_write_with_metadata(uint64_t handle, struct agm_buff *buf,
+                                    size_t *consumed_size)
+{
+    int status = 0;
+
+    if (!buf)
+        return -EINVAL;
+    status = sim_agm_queue(handle, SIM_AGM_OP_WRITE, buf);
+    if (!status && consumed_size)
+        *consumed_size = buf->size;
+    return status;
+}
+
+int agm_session_set_params(uint32_t session_id __unused,
+                           void *payload __unused, size_t size __unused)
+{
+    return 0;
+}
+
+int agm_session_aif_get_tag_module_info(uint32_t session_id __unused,
+                                        uint32_t aif_id __unused,
+                                        void *payload __unused,
+                                        size_t *size __unused)
+{
+    return -ENOSYS;
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the
+ * disclaimer below) provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *     * Neither the name of Qualcomm Innovation Center, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+ * GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+ * HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define LOG_TAG "PAL: SimAudioRoute"
+
+#include <errno.h>
+#include <mutex>
+#include <set>
+#include <string>
+#include <audio_route/audio_route.h>
+#include "PalCommon.h"
+#include "SimBackend.h"
+
+/*
+ * Mixer paths are not parsed, only tracked: the simulated hw card has no
+ * codec controls for them to act on.
+ */
+struct audio_route {
+    unsigned int card;
+    std::mutex lock;
+    std::set<std::string> activePaths;
+};
+
+struct audio_route *audio_route_init(unsigned int card, const char *xml_path)
+{
+    struct audio_route *ar = new struct audio_route();
+
+    ar->card = card;
+    PAL_DBG(LOG_TAG, "card %u, ignoring mixer paths %s", card,
+            xml_path ? xml_path : "(null)");
+    return ar;
+}
+
+void audio_route_free(struct audio_route *ar)
+{
+    delete ar;
+}
+
+int audio_route_apply_path(struct audio_route *ar, const char *name)
+{
+    if (!ar || !name)
+        return -EINVAL;
+
+    std::lock_guard<std::mutex> lock(ar->lock);
+    ar->activePaths.insert(name);
+    return 0;
+}
+
+int audio_route_reset_path(struct audio_route *ar, const char *name)
+{
+    if (!ar || !name)
+        return -EINVAL;
+
+    std::lock_guard<std::mutex> lock(ar->lock);
+    ar->activePaths.erase(name);
+    return 0;
+}
+
+int audio_route_update_mixer(struct audio_route *ar)
+{
+    if (!ar)
+        return -EINVAL;
+
+    sim_get_counters().route_updates++;
+    return 0;
+}
+
+int audio_route_apply_and_update_path(struct audio_route *ar, const char *name)
+{
+    int ret = audio_route_apply_path(ar, name);
+
+    if (ret)
+        return ret;
+
+    PAL_DBG(LOG_TAG, "apply %s", name);
+    return audio_route_update_mixer(ar);
+}
+
+int audio_route_reset_and_update_path(struct audio_route *ar, const char *name)
+{
+    int ret = audio_route_reset_path(ar, name);
+
+    if (ret)
+        return ret;
+
+    PAL_DBG(LOG_TAG, "reset %s", name);
+    return audio_route_update_mixer(ar);
+}
+
+void audio_route_reset(struct audio_route *ar)
+{
+    if (!ar)
+        return;
+
+    std::lock_guard<std::mutex> lock(ar->lock);
+    ar->activePaths.clear();
+}
@@ -0,0 +1,367 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the
+ * disclaimer below) provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *     * Neither the name of Qualcomm Innovation Center, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+ * GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+ * HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define LOG_TAG "PAL: SimBackend"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "PalCommon.h"
+#include "SimBackend.h"
+
+#define SIM_CARD_STATE_NODE_DEFAULT "/tmp/pal_sim_card_state"
+#define SIM_WAIT_SLICE_NS 5000000ULL
+
+static std::once_flag simConfigOnce;
+static std::atomic<int> simClockMode(PAL_SIM_CLOCK_REALTIME);
+static std::atomic<uint32_t> simPeriodUs(0);
+static std::atomic<uint64_t> simVirtualNs(0);
+
+static std::mutex simCardStateMutex;
+static int simCardState = 1;
+static int simCardStateFd = -1;
+static char simCardStateNode[256];
+
+static void sim_load_config()
+{
+    std::call_once(simConfigOnce, [] {
+        const char *env = getenv("PAL_SIM_CLOCK");
+
+        if (env && !strcmp(env, "virtual"))
+            simClockMode = PAL_SIM_CLOCK_VIRTUAL;
+
+        env = getenv("PAL_SIM_PERIOD_US");
+        if (env)
+            simPeriodUs = (uint32_t)strtoul(env, NULL, 0);
+
+        PAL_INFO(LOG_TAG, "clock mode %d, period override %u us",
+                 simClockMode.load(), simPeriodUs.load());
+    });
+}
+
+sim_counters &sim_get_counters()
+{
+    static sim_counters counters;
+
+    return counters;
+}
+
+static uint64_t sim_monotonic_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * SIM_NS_PER_SEC + ts.tv_nsec;
+}
+
+uint64_t sim_now_ns()
+{
+    sim_load_config();
+    if (simClockMode == PAL_SIM_CLOCK_VIRTUAL)
+        return simVirtualNs.load();
+
+    return sim_monotonic_ns();
+}
+
+bool sim_wait_until(uint64_t deadline, const std::atomic<bool> *abort)
+{
+    uint64_t now = 0;
+    uint64_t cur = 0;
+    struct timespec ts;
+
+    if (simClockMode == PAL_SIM_CLOCK_VIRTUAL) {
+        cur = simVirtualNs.load();
+        while (cur < deadline &&
+               !simVirtualNs.compare_exchange_weak(cur, deadline));
+        return !(abort && abort->load());
+    }
+
+    /* sleep in slices so that stop/close from another thread is honoured */
+    while ((now = sim_monotonic_ns()) < deadline) {
+        if (abort && abort->load())
+            return false;
+        now = (deadline - now > SIM_WAIT_SLICE_NS) ?
+              now + SIM_WAIT_SLICE_NS : deadline;
+        ts.tv_sec = now / SIM_NS_PER_SEC;
+        ts.tv_nsec = now % SIM_NS_PER_SEC;
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    }
+    return !(abort && abort->load());
+}
+
+bool SimDeviceGate::wait(std::unique_lock<std::mutex> &lock, uint64_t deadline,
+                         const std::atomic<bool> *abort)
+{
+    bool done = false;
+
+    waiters++;
+    lock.unlock();
+    done = sim_wait_until(deadline, abort);
+    lock.lock();
+    if (--waiters == 0 && closing)
+        cv.notify_all();
+
+    return done && !closing;
+}
+
+void SimDeviceGate::close(std::unique_lock<std::mutex> &lock,
+                          std::atomic<bool> *abort)
+{
+    closing = true;
+    abort->store(true);
+    cv.wait(lock, [this] { return waiters == 0; });
+}
+
+SimStreamClock::SimStreamClock()
+    : unitsPerSec(48000), periodUnits(960), startNs(0), basePos(0),
+      running(false)
+{
+}
+
+void SimStreamClock::configure(uint64_t rate, uint32_t period)
+{
+    unitsPerSec = rate ? rate : 1;
+    periodUnits = period ? period : 1;
+}
+
+uint64_t SimStreamClock::periodNs()
+{
+    uint32_t overrideUs = simPeriodUs.load();
+
+    if (overrideUs)
+        return (uint64_t)overrideUs * 1000;
+
+    return (uint64_t)periodUnits * SIM_NS_PER_SEC / unitsPerSec;
+}
+
+void SimStreamClock::start()
+{
+    basePos = 0;
+    startNs = sim_now_ns();
+    running = true;
+}
+
+void SimStreamClock::pause()
+{
+    if (!running)
+        return;
+    basePos = position();
+    running = false;
+}
+
+void SimStreamClock::resume()
+{
+    if (running)
+        return;
+    startNs = sim_now_ns();
+    running = true;
+}
+
+void SimStreamClock::stop()
+{
+    running = false;
+    basePos = 0;
+}
+
+uint64_t SimStreamClock::position()
+{
+    uint64_t now = 0;
+    uint64_t pNs = periodNs();
+
+    if (!running)
+        return basePos;
+
+    now = sim_now_ns();
+    if (now <= startNs || !pNs)
+        return basePos;
+
+    return basePos + ((now - startNs) / pNs) * periodUnits;
+}
+
+uint64_t SimStreamClock::deadlineFor(uint64_t target)
+{
+    uint64_t periods = 0;
+
+    if (!running || target <= basePos)
+        return sim_now_ns();
+
+    periods = (target - basePos + periodUnits - 1) / periodUnits;
+    return startNs + periods * periodNs();
+}
+
+static int sim_card_state_open_l()
+{
+    const char *env = NULL;
+    struct stat st;
+
+    if (simCardStateFd >= 0)
+        return 0;
+
+    env = getenv("PAL_SIM_CARD_STATE_NODE");
+    snprintf(simCardStateNode, sizeof(simCardStateNode), "%s",
+             env ? env : SIM_CARD_STATE_NODE_DEFAULT);
+
+    if (stat(simCardStateNode, &st) == 0 && !S_ISFIFO(st.st_mode))
+        unlink(simCardStateNode);
+    if (mkfifo(simCardStateNode, 0660) && errno != EEXIST) {
+        PAL_ERR(LOG_TAG, "mkfifo %s failed, %s", simCardStateNode,
+                strerror(errno));
+        return -errno;
+    }
+
+    /* keep the fifo open so state changes queue up for the monitor */
+    simCardStateFd = open(simCardStateNode, O_RDWR | O_NONBLOCK);
+    if (simCardStateFd < 0) {
+        PAL_ERR(LOG_TAG, "open %s failed, %s", simCardStateNode,
+                strerror(errno));
+        return -errno;
+    }
+
+    return 0;
+}
+
+const char *pal_sim_get_card_state_node(void)
+{
+    std::lock_guard<std::mutex> lock(simCardStateMutex);
+
+    sim_card_state_open_l();
+    return simCardStateNode;
+}
+
+int pal_sim_set_card_state(int state)
+{
+    int ret = 0;
+    char buf[2] = {0};
+
+    if (state != 0 && state != 1)
+        return -EINVAL;
+
+    std::lock_guard<std::mutex> lock(simCardStateMutex);
+    ret = sim_card_state_open_l();
+    if (ret)
+        return ret;
+
+    simCardState = state;
+    buf[0] = state ? '1' : '0';
+    if (write(simCardStateFd, buf, 1) != 1)
+        return -errno;
+
+    PAL_INFO(LOG_TAG, "card state %d", state);
+    return 0;
+}
+
+int pal_sim_get_card_state(void)
+{
+    std::lock_guard<std::mutex> lock(simCardStateMutex);
+
+    return simCardState;
+}
+
+void pal_sim_set_clock_mode(pal_sim_clock_mode_t mode)
+{
+    sim_load_config();
+    simClockMode = mode;
+}
+
+pal_sim_clock_mode_t pal_sim_get_clock_mode(void)
+{
+    sim_load_config();
+    return (pal_sim_clock_mode_t)simClockMode.load();
+}
+
+void pal_sim_set_period_us(uint32_t period_us)
+{
+    sim_load_config();
+    simPeriodUs = period_us;
+}
+
+uint32_t pal_sim_get_period_us(void)
+{
+    sim_load_config();
+    return simPeriodUs;
+}
+
+uint64_t pal_sim_get_time_ns(void)
+{
+    return sim_now_ns();
+}
+
+void pal_sim_get_stats(struct pal_sim_stats *stats)
+{
+    sim_counters &c = sim_get_counters();
+
+    if (!stats)
+        return;
+
+    stats->pcm_opens = c.pcm_opens;
+    stats->pcm_writes = c.pcm_writes;
+    stats->pcm_reads = c.pcm_reads;
+    stats->pcm_frames_written = c.pcm_frames_written;
+    stats->pcm_frames_read = c.pcm_frames_read;
+    stats->pcm_xruns = c.pcm_xruns;
+    stats->compress_writes = c.compress_writes;
+    stats->compress_bytes_written = c.compress_bytes_written;
+    stats->mixer_set_calls = c.mixer_set_calls;
+    stats->mixer_set_bytes = c.mixer_set_bytes;
+    stats->mixer_get_calls = c.mixer_get_calls;
+    stats->route_updates = c.route_updates;
+    stats->agm_buffers_done = c.agm_buffers_done;
+    stats->agm_idle_ns = c.agm_idle_ns;
+}
+
+void pal_sim_reset_stats(void)
+{
+    sim_counters &c = sim_get_counters();
+
+    c.pcm_opens = 0;
+    c.pcm_writes = 0;
+    c.pcm_reads = 0;
+    c.pcm_frames_written = 0;
+    c.pcm_frames_read = 0;
+    c.pcm_xruns = 0;
+    c.compress_writes = 0;
+    c.compress_bytes_written = 0;
+    c.mixer_set_calls = 0;
+    c.mixer_set_bytes = 0;
+    c.mixer_get_calls = 0;
+    c.route_updates = 0;
+    c.agm_buffers_done = 0;
+    c.agm_idle_ns = 0;
+}
@@ -0,0 +1,372 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the
+ * disclaimer below) provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *     * Neither the name of Qualcomm Innovation Center, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+ * GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+ * HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define LOG_TAG "PAL: SimCompress"
+
+#include <errno.h>
+#include <mutex>
+#include <string.h>
+#include <string>
+#include <sound/compress_params.h>
+#include <tinycompress/tinycompress.h>
+#include "PalCommon.h"
+#include "SimBackend.h"
+
+/* bitrate assumed when the codec does not report one */
+#define SIM_COMPRESS_DEFAULT_BITRATE 320000
+
+/*
+ * Compressed data is consumed at the codec bit rate, one fragment per
+ * period. Drain returns once everything written has been consumed; the
+ * partial drain used for gapless is treated the same way.
+ */
+struct compress {
+    unsigned int card;
+    unsigned int device;
+    unsigned int flags;
+    bool ready;
+    bool nonblock;
+    std::string error;
+    std::mutex lock;
+    SimStreamClock clock;
+    uint32_t fragmentSize;
+    uint64_t bufferBytes;
+    /* bytes written or read by the application since start */
+    uint64_t appPos;
+    std::atomic<bool> stopped;
+    SimDeviceGate gate;
+};
+
+static bool sim_compress_is_capture(const struct compress *compress)
+{
+    return !!(compress->flags & COMPRESS_IN);
+}
+
+static void sim_compress_configure(struct compress *compress,
+                                   const struct snd_codec *codec)
+{
+    uint64_t bytesPerSec = SIM_COMPRESS_DEFAULT_BITRATE / 8;
+
+    if (codec && codec->bit_rate)
+        bytesPerSec = codec->bit_rate / 8;
+
+    compress->clock.configure(bytesPerSec, compress->fragmentSize);
+}
+
+struct compress *compress_open(unsigned int card, unsigned int device,
+                               unsigned int flags, struct compr_config *config)
+{
+    struct compress *compress = new struct compress();
+
+    compress->card = card;
+    compress->device = device;
+    compress->flags = flags;
+    compress->ready = false;
+    compress->nonblock = false;
+    compress->appPos = 0;
+    compress->stopped = false;
+
+    if (!config || !config->fragment_size || !config->fragments) {
+        compress->error = "invalid compress config";
+        goto exit;
+    }
+
+    if (!pal_sim_get_card_state()) {
+        compress->error = "sound card offline";
+        goto exit;
+    }
+
+    compress->fragmentSize = config->fragment_size;
+    compress->bufferBytes = (uint64_t)config->fragment_size * config->fragments;
+    sim_compress_configure(compress, config->codec);
+    compress->ready = true;
+
+    PAL_DBG(LOG_TAG, "compress C%uD%u fragment %u x %u", card, device,
+            config->fragment_size, config->fragments);
+exit:
+    return compress;
+}
+
+void compress_close(struct compress *compress)
+{
+    if (!compress)
+        return;
+
+    {
+        /* wake blocked transfers and wait for them to leave before freeing */
+        std::unique_lock<std::mutex> lock(compress->lock);
+        compress->gate.close(lock, &compress->stopped);
+    }
+    delete compress;
+}
+
+int is_compress_ready(struct compress *compress)
+{
+    return compress && compress->ready;
+}
+
+const char *compress_get_error(struct compress *compress)
+{
+    return compress ? compress->error.c_str() : "";
+}
+
+void compress_nonblock(struct compress *compress, int nonblock)
+{
+    if (compress)
+        compress->nonblock = !!nonblock;
+}
+
+int compress_set_codec_params(struct compress *compress, struct snd_codec *codec)
+{
+    if (!compress || !compress->ready || !codec)
+        return -EINVAL;
+
+    std::lock_guard<std::mutex> lock(compress->lock);
+    sim_compress_configure(compress, codec);
+    return 0;
+}
+
+int compress_set_gapless_metadata(struct compress *compress,
+                                  struct compr_gapless_mdata *mdata)
+{
+    if (!compress || !compress->ready || !mdata)
+        return -EINVAL;
+
+    return 0;
+}
+
+int compress_get_hpointer(struct compress *compress, unsigned int *avail,
+                          struct timespec *tstamp)
+{
+    uint64_t now = 0;
+    uint64_t pos = 0;
+
+    if (!compress || !compress->ready || !avail || !tstamp)
+        return -EINVAL;
+
+    std::lock_guard<std::mutex> lock(compress->lock);
+    now = sim_now_ns();
+    pos = compress->clock.position();
+    *avail = compress->bufferBytes -
+             (compress->appPos > pos ? compress->appPos - pos : 0);
+    tstamp->tv_sec = now / SIM_NS_PER_SEC;
+    tstamp->tv_nsec = now % SIM_NS_PER_SEC;
+    return 0;
+}
+
+int compress_start(struct compress *compress)
+{
+    if (!compress || !compress->ready)
+        return -EINVAL;
+    if (!pal_sim_get_card_state())
+        return -ENETRESET;
+
+    std::lock_guard<std::mutex> lock(compress->lock);
+    if (compress->gate.isClosing())
+        return -EBADFD;
+    compress->stopped = false;
+    if (!compress->clock.isRunning())
+        compress->clock.start();
+    return 0;
+}
+
+int compress_stop(struct compress *compress)
+{
+    if (!compress || !compress->ready)
+        return -EINVAL;
+
+    compress->stopped = true;
+    std::lock_guard<std::mutex> lock(compress->lock);
+    compress->clock.stop();
+    compress->appPos = 0;
+    return 0;
+}
+
+int compress_pause(struct compress *compress)
+{
+    if (!compress || !compress->ready)
+        return -EINVAL;
+
+    std::lock_guard<std::mutex> lock(compress->lock);
+    compress->clock.pause();
+    return 0;
+}
+
+int compress_resume(struct compress *compress)
+{
+    if (!compress || !compress->ready)
+        return -EINVAL;
+
+    std::lock_guard<std::mutex> lock(compress->lock);
+    compress->clock.resume();
+    return 0;
+}
+
+/* blocks until at least one fragment of space (or data) is available */
+int compress_wait(struct compress *compress, int timeout_ms)
+{
+    uint64_t deadline = 0;
+    uint64_t limit = 0;
+    uint64_t target = 0;
+
+    if (!compress || !compress->ready)
+        return -EINVAL;
+    if (!pal_sim_get_card_state())
+        return -ENETRESET;
+
+    std::unique_lock<std::mutex> lock(compress->lock);
+    if (!compress->clock.isRunning())
+        return 0;
+
+    if (sim_compress_is_capture(compress))
+        target = compress->appPos + compress->fragmentSize;
+    else if (compress->appPos + compress->fragmentSize > compress->bufferBytes)
+        target = compress->appPos + compress->fragmentSize -
+                 compress->bufferBytes;
+    if (compress->clock.position() >= target)
+        return 0;
+
+    deadline = compress->clock.deadlineFor(target);
+    if (timeout_ms >= 0) {
+        limit = sim_now_ns() + (uint64_t)timeout_ms * 1000000ULL;
+        if (deadline > limit) {
+            if (!compress->gate.wait(lock, limit, &compress->stopped) &&
+                compress->gate.isClosing())
+                return -EBADFD;
+            return -ETIME;
+        }
+    }
+    if (!compress->gate.wait(lock, deadline, &compress->stopped))
+        return -EBADFD;
+
+    return 0;
+}
+
+int compress_write(struct compress *compress, const void *buf, unsigned int size)
+{
+    uint64_t pos = 0;
+    uint64_t avail = 0;
+    uint64_t deadline = 0;
+
+    if (!compress || !compress->ready || !buf || sim_compress_is_capture(compress))
+        return -EINVAL;
+    if (!pal_sim_get_card_state())
+        return -ENETRESET;
+
+    std::unique_lock<std::mutex> lock(compress->lock);
+    if (compress->gate.isClosing())
+        return -EBADFD;
+    compress->stopped = false;
+    if (!compress->clock.isRunning() &&
+        compress->appPos + size > compress->bufferBytes)
+        compress->clock.start();
+
+    pos = compress->clock.position();
+    if (pos > compress->appPos)
+        pos = compress->appPos;
+    avail = compress->bufferBytes - (compress->appPos - pos);
+
+    if (avail < size) {
+        if (compress->nonblock) {
+            size = avail;
+        } else {
+            deadline = compress->clock.deadlineFor(compress->appPos + size -
+                                                   compress->bufferBytes);
+            if (!compress->gate.wait(lock, deadline, &compress->stopped))
+                return -EBADFD;
+        }
+    }
+
+    compress->appPos += size;
+    sim_get_counters().compress_writes++;
+    sim_get_counters().compress_bytes_written += size;
+    return size;
+}
+
+int compress_read(struct compress *compress, void *buf, unsigned int size)
+{
+    uint64_t deadline = 0;
+
+    if (!compress || !compress->ready || !buf || !sim_compress_is_capture(compress))
+        return -EINVAL;
+    if (!pal_sim_get_card_state())
+        return -ENETRESET;
+
+    std::unique_lock<std::mutex> lock(compress->lock);
+    if (compress->gate.isClosing())
+        return -EBADFD;
+    compress->stopped = false;
+    if (!compress->clock.isRunning())
+        compress->clock.start();
+
+    deadline = compress->clock.deadlineFor(compress->appPos + size);
+    if (!compress->gate.wait(lock, deadline, &compress->stopped))
+        return -EBADFD;
+
+    memset(buf, 0, size);
+    compress->appPos += size;
+    return size;
+}
+
+int compress_drain(struct compress *compress)
+{
+    uint64_t deadline = 0;
+
+    if (!compress || !compress->ready)
+        return -EINVAL;
+    if (!pal_sim_get_card_state())
+        return -ENETRESET;
+
+    std::unique_lock<std::mutex> lock(compress->lock);
+    if (!compress->clock.isRunning())
+        compress->clock.start();
+    deadline = compress->clock.deadlineFor(compress->appPos);
+    if (!compress->gate.wait(lock, deadline, &compress->stopped))
+        return -EBADFD;
+
+    return 0;
+}
+
+int compress_partial_drain(struct compress *compress)
+{
+    return compress_drain(compress);
+}
+
+int compress_next_track(struct compress *compress)
+{
+    if (!compress || !compress->ready)
+        return -EINVAL;
+
+    return 0;
+}
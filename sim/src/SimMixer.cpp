@@ -0,0 +1,465 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the
+ * disclaimer below) provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *     * Neither the name of Qualcomm Innovation Center, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+ * GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+ * HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define LOG_TAG "PAL: SimMixer"
+
+#include <condition_variable>
+#include <deque>
+#include <errno.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <tinyalsa/asoundlib.h>
+#include <sound/asound.h>
+#include "kvh2xml.h"
+#include "PalCommon.h"
+#include "SimBackend.h"
+
+#define SIM_HW_CARD 0
+#define SIM_VIRT_CARD_BASE 100
+#define SIM_HW_CARD_NAME_DEFAULT "waipio-mtp-snd-card"
+#define SIM_MODULE_ID_BASE 0x07001000
+#define SIM_MIID_BASE 0x4000
+#define SIM_MIID_PER_FE 64
+
+/*
+ * Controls are created on first lookup: AGM exposes a dynamic namespace
+ * ("PCM100 metadata", "<BE> rate ch fmt", ...) and the real hw card has
+ * far more controls than the simulation cares about. Values written are
+ * kept so that get after set round-trips like AGM's getParam does.
+ */
+struct mixer_ctl {
+    struct mixer *mixer;
+    std::string name;
+    std::vector<uint8_t> data;
+    std::vector<int> values;
+    std::string enumValue;
+};
+
+struct mixer {
+    unsigned int card;
+    bool isVirtual;
+    std::string name;
+    mutable std::mutex lock;
+    std::map<std::string, std::unique_ptr<mixer_ctl>> ctls;
+    std::vector<mixer_ctl *> ctlList;
+    int refs;
+    /* bumped on close so blocked mixer_wait_event callers return */
+    uint32_t generation;
+    bool subscribed;
+    std::condition_variable eventCv;
+    std::deque<std::string> events;
+};
+
+static std::mutex simCardsMutex;
+static std::map<unsigned int, std::unique_ptr<struct mixer>> simCards;
+
+static std::mutex simTagMutex;
+static std::vector<std::pair<uint32_t, uint32_t>> simExtraTags;
+
+/* tags PAL looks up through getTaggedInfo on a typical graph */
+static const uint32_t simDefaultTags[] = {
+    TAG_STREAM_MFC_SR,
+    TAG_DEVICE_MFC_SR,
+    TAG_DEVICE_PP_MFC,
+    PER_STREAM_PER_DEVICE_MFC,
+    TAG_STREAM_VOLUME,
+    TAG_PAUSE,
+    TAG_MUTE,
+    TAG_ECNS,
+    DEVICE_HW_ENDPOINT_RX,
+    DEVICE_HW_ENDPOINT_TX,
+    RAT_RENDER,
+    STREAM_SPR,
+    MODULE_GAPLESS,
+};
+
+static bool sim_has_suffix(const std::string &name, const char *suffix)
+{
+    size_t len = strlen(suffix);
+
+    return name.size() >= len &&
+           !name.compare(name.size() - len, len, suffix);
+}
+
+static int sim_fe_id(const std::string &name)
+{
+    size_t pos = name.find_first_of("0123456789");
+
+    if (pos == std::string::npos)
+        return 0;
+
+    return atoi(name.c_str() + pos);
+}
+
+/*
+ * Layout matches struct gsl_tag_module_info: num_tags followed by
+ * {tag_id, num_modules, {module_id, module_iid}} entries.
+ */
+static void sim_fill_tagged_info(struct mixer_ctl *ctl)
+{
+    std::vector<uint32_t> words;
+    std::vector<uint32_t> tags(simDefaultTags,
+        simDefaultTags + sizeof(simDefaultTags) / sizeof(simDefaultTags[0]));
+    std::vector<uint32_t> modules(tags.size(), 0);
+    uint32_t feBase = SIM_MIID_BASE + sim_fe_id(ctl->name) * SIM_MIID_PER_FE;
+
+    for (size_t i = 0; i < tags.size(); i++)
+        modules[i] = SIM_MODULE_ID_BASE + i;
+
+    {
+        std::lock_guard<std::mutex> lock(simTagMutex);
+        for (auto &t : simExtraTags) {
+            tags.push_back(t.first);
+            modules.push_back(t.second);
+        }
+    }
+
+    words.push_back(tags.size());
+    for (size_t i = 0; i < tags.size(); i++) {
+        words.push_back(tags[i]);
+        words.push_back(1);
+        words.push_back(modules[i]);
+        words.push_back(feBase + (i % SIM_MIID_PER_FE));
+    }
+
+    ctl->data.resize(words.size() * sizeof(uint32_t));
+    memcpy(ctl->data.data(), words.data(), ctl->data.size());
+}
+
+static bool sim_card_offline(struct mixer *mixer)
+{
+    return mixer->isVirtual && !pal_sim_get_card_state();
+}
+
+struct mixer *mixer_open(unsigned int card)
+{
+    const char *env = NULL;
+    struct mixer *mixer = NULL;
+
+    if (card != SIM_HW_CARD && card < SIM_VIRT_CARD_BASE)
+        return NULL;
+
+    std::lock_guard<std::mutex> lock(simCardsMutex);
+    auto it = simCards.find(card);
+    if (it == simCards.end()) {
+        mixer = new struct mixer();
+        mixer->card = card;
+        mixer->isVirtual = (card != SIM_HW_CARD);
+        if (mixer->isVirtual) {
+            mixer->name = "sim-virtual-snd-card";
+        } else {
+            env = getenv("PAL_SIM_CARD_NAME");
+            mixer->name = env ? env : SIM_HW_CARD_NAME_DEFAULT;
+        }
+        mixer->refs = 0;
+        mixer->generation = 0;
+        mixer->subscribed = false;
+        simCards[card].reset(mixer);
+    } else {
+        mixer = it->second.get();
+    }
+
+    /* cards live for the whole process so stale handles stay valid */
+    std::lock_guard<std::mutex> mlock(mixer->lock);
+    mixer->refs++;
+    PAL_DBG(LOG_TAG, "card %u (%s) opened, refs %d", card,
+            mixer->name.c_str(), mixer->refs);
+    return mixer;
+}
+
+void mixer_close(struct mixer *mixer)
+{
+    if (!mixer)
+        return;
+
+    std::lock_guard<std::mutex> lock(mixer->lock);
+    if (mixer->refs > 0)
+        mixer->refs--;
+    mixer->generation++;
+    mixer->eventCv.notify_all();
+}
+
+const char *mixer_get_name(const struct mixer *mixer)
+{
+    return mixer ? mixer->name.c_str() : NULL;
+}
+
+unsigned int mixer_get_num_ctls(const struct mixer *mixer)
+{
+    if (!mixer)
+        return 0;
+
+    std::lock_guard<std::mutex> lock(mixer->lock);
+    return mixer->ctlList.size();
+}
+
+struct mixer_ctl *mixer_get_ctl(struct mixer *mixer, unsigned int id)
+{
+    if (!mixer)
+        return NULL;
+
+    std::lock_guard<std::mutex> lock(mixer->lock);
+    if (id >= mixer->ctlList.size())
+        return NULL;
+
+    return mixer->ctlList[id];
+}
+
+struct mixer_ctl *mixer_get_ctl_by_name(struct mixer *mixer, const char *name)
+{
+    struct mixer_ctl *ctl = NULL;
+
+    if (!mixer || !name)
+        return NULL;
+
+    std::lock_guard<std::mutex> lock(mixer->lock);
+    auto it = mixer->ctls.find(name);
+    if (it != mixer->ctls.end())
+        return it->second.get();
+
+    ctl = new struct mixer_ctl();
+    ctl->mixer = mixer;
+    ctl->name = name;
+    mixer->ctls[ctl->name].reset(ctl);
+    mixer->ctlList.push_back(ctl);
+    return ctl;
+}
+
+const char *mixer_ctl_get_name(const struct mixer_ctl *ctl)
+{
+    return ctl ? ctl->name.c_str() : NULL;
+}
+
+void mixer_ctl_update(struct mixer_ctl *ctl __unused)
+{
+}
+
+unsigned int mixer_ctl_get_num_values(const struct mixer_ctl *ctl)
+{
+    if (!ctl)
+        return 0;
+
+    std::lock_guard<std::mutex> lock(ctl->mixer->lock);
+    if (!ctl->data.empty())
+        return ctl->data.size();
+
+    return ctl->values.empty() ? 1 : ctl->values.size();
+}
+
+int mixer_ctl_get_value(const struct mixer_ctl *ctl, unsigned int id)
+{
+    if (!ctl)
+        return -EINVAL;
+
+    sim_get_counters().mixer_get_calls++;
+    std::lock_guard<std::mutex> lock(ctl->mixer->lock);
+    if (id >= ctl->values.size())
+        return 0;
+
+    return ctl->values[id];
+}
+
+int mixer_ctl_set_value(struct mixer_ctl *ctl, unsigned int id, int value)
+{
+    if (!ctl)
+        return -EINVAL;
+
+    sim_get_counters().mixer_set_calls++;
+    std::lock_guard<std::mutex> lock(ctl->mixer->lock);
+    if (sim_card_offline(ctl->mixer))
+        return -ENETRESET;
+
+    if (id >= ctl->values.size())
+        ctl->values.resize(id + 1, 0);
+    ctl->values[id] = value;
+    return 0;
+}
+
+int mixer_ctl_set_array(struct mixer_ctl *ctl, const void *array, size_t count)
+{
+    if (!ctl || (!array && count))
+        return -EINVAL;
+
+    sim_get_counters().mixer_set_calls++;
+    sim_get_counters().mixer_set_bytes += count;
+    std::lock_guard<std::mutex> lock(ctl->mixer->lock);
+    if (sim_card_offline(ctl->mixer))
+        return -ENETRESET;
+
+    ctl->data.assign((const uint8_t *)array, (const uint8_t *)array + count);
+    return 0;
+}
+
+int mixer_ctl_get_array(const struct mixer_ctl *ctl, void *array, size_t count)
+{
+    struct mixer_ctl *mctl = (struct mixer_ctl *)ctl;
+    size_t len = 0;
+
+    if (!ctl || (!array && count))
+        return -EINVAL;
+
+    sim_get_counters().mixer_get_calls++;
+    std::lock_guard<std::mutex> lock(ctl->mixer->lock);
+    if (sim_card_offline(ctl->mixer))
+        return -ENETRESET;
+
+    if (sim_has_suffix(ctl->name, " getTaggedInfo"))
+        sim_fill_tagged_info(mctl);
+
+    len = ctl->data.size() < count ? ctl->data.size() : count;
+    memcpy(array, ctl->data.data(), len);
+    memset((uint8_t *)array + len, 0, count - len);
+    return 0;
+}
+
+int mixer_ctl_set_enum_by_string(struct mixer_ctl *ctl, const char *string)
+{
+    if (!ctl || !string)
+        return -EINVAL;
+
+    sim_get_counters().mixer_set_calls++;
+    std::lock_guard<std::mutex> lock(ctl->mixer->lock);
+    if (sim_card_offline(ctl->mixer))
+        return -ENETRESET;
+
+    ctl->enumValue = string;
+    return 0;
+}
+
+int mixer_subscribe_events(struct mixer *mixer, int subscribe)
+{
+    if (!mixer)
+        return -EINVAL;
+
+    std::lock_guard<std::mutex> lock(mixer->lock);
+    mixer->subscribed = !!subscribe;
+    if (!mixer->subscribed)
+        mixer->events.clear();
+    return 0;
+}
+
+int mixer_wait_event(struct mixer *mixer, int timeout)
+{
+    uint32_t generation = 0;
+    auto ready = [&] {
+        return !mixer->events.empty() || mixer->generation != generation;
+    };
+
+    if (!mixer)
+        return -EINVAL;
+
+    std::unique_lock<std::mutex> lock(mixer->lock);
+    generation = mixer->generation;
+    if (timeout < 0)
+        mixer->eventCv.wait(lock, ready);
+    else if (!mixer->eventCv.wait_for(lock,
+                 std::chrono::milliseconds(timeout), ready))
+        return 0;
+
+    if (mixer->events.empty())
+        return -ENODEV;
+
+    return 1;
+}
+
+int mixer_read_event(struct mixer *mixer, struct ctl_event *ev)
+{
+    if (!mixer || !ev)
+        return -EINVAL;
+
+    std::lock_guard<std::mutex> lock(mixer->lock);
+    if (mixer->events.empty())
+        return -EAGAIN;
+
+    memset(ev, 0, sizeof(*ev));
+    ev->type = SNDRV_CTL_EVENT_ELEM;
+    ev->data.elem.mask = SNDRV_CTL_EVENT_MASK_VALUE;
+    snprintf((char *)ev->data.elem.id.name, sizeof(ev->data.elem.id.name),
+             "%s", mixer->events.front().c_str());
+    mixer->events.pop_front();
+    return sizeof(*ev);
+}
+
+int pal_sim_add_tagged_module(uint32_t tag_id, uint32_t module_id)
+{
+    std::lock_guard<std::mutex> lock(simTagMutex);
+
+    if (simExtraTags.size() + sizeof(simDefaultTags) / sizeof(simDefaultTags[0])
+            >= SIM_MIID_PER_FE)
+        return -ENOSPC;
+
+    simExtraTags.push_back(std::make_pair(tag_id, module_id));
+    return 0;
+}
+
+int pal_sim_inject_mixer_event(const char *ctl_name, const void *payload,
+                               size_t size)
+{
+    struct mixer *mixer = NULL;
+    struct mixer_ctl *ctl = NULL;
+
+    if (!ctl_name)
+        return -EINVAL;
+
+    {
+        std::lock_guard<std::mutex> lock(simCardsMutex);
+        for (auto &card : simCards) {
+            if (card.second->isVirtual) {
+                mixer = card.second.get();
+                break;
+            }
+        }
+    }
+    if (!mixer)
+        return -ENODEV;
+
+    ctl = mixer_get_ctl_by_name(mixer, ctl_name);
+    if (!ctl)
+        return -ENOMEM;
+
+    std::lock_guard<std::mutex> lock(mixer->lock);
+    if (!mixer->subscribed)
+        return -EPERM;
+
+    ctl->data.assign((const uint8_t *)payload,
+                     (const uint8_t *)payload + (payload ? size : 0));
+    mixer->events.push_back(ctl->name);
+    mixer->eventCv.notify_all();
+    return 0;
+}
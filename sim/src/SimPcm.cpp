@@ -0,0 +1,432 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the
+ * disclaimer below) provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *     * Neither the name of Qualcomm Innovation Center, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+ * GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+ * HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define LOG_TAG "PAL: SimPcm"
+
+#include <errno.h>
+#include <mutex>
+#include <stdarg.h>
+#include <string.h>
+#include <string>
+#include <time.h>
+#include <vector>
+#include <tinyalsa/asoundlib.h>
+#include "PalCommon.h"
+#include "SimBackend.h"
+
+/*
+ * A pcm device is a ring of period_size * period_count frames drained
+ * (playback) or filled (capture) by SimStreamClock. Writes block while the
+ * ring is full and reads while it is empty, so callers see the same
+ * back-pressure as with a DSP. Captured data is silence. As with tinyalsa,
+ * an xrun restarts the ring unless the pcm was opened with PCM_NORESTART,
+ * in which case -EPIPE is returned and the next transfer starts afresh.
+ */
+struct pcm {
+    unsigned int card;
+    unsigned int device;
+    unsigned int flags;
+    struct pcm_config config;
+    bool ready;
+    std::string error;
+    std::mutex lock;
+    SimStreamClock clock;
+    uint64_t bufferFrames;
+    uint64_t startThreshold;
+    /* frames written or read by the application since start */
+    uint64_t appPos;
+    std::atomic<bool> stopped;
+    SimDeviceGate gate;
+    std::vector<uint8_t> mmapBuf;
+};
+
+static bool sim_pcm_is_capture(const struct pcm *pcm)
+{
+    return !!(pcm->flags & PCM_IN);
+}
+
+/*
+ * As with tinyalsa, stamps are CLOCK_REALTIME unless the pcm was opened
+ * with PCM_MONOTONIC. now is on the monotonic (or virtual) sim clock.
+ */
+static void sim_pcm_tstamp(const struct pcm *pcm, uint64_t now,
+                           struct timespec *tstamp)
+{
+    struct timespec mono, real;
+
+    if (!(pcm->flags & PCM_MONOTONIC)) {
+        clock_gettime(CLOCK_MONOTONIC, &mono);
+        clock_gettime(CLOCK_REALTIME, &real);
+        now += ((int64_t)real.tv_sec - mono.tv_sec) * (int64_t)SIM_NS_PER_SEC +
+               (real.tv_nsec - mono.tv_nsec);
+    }
+    tstamp->tv_sec = now / SIM_NS_PER_SEC;
+    tstamp->tv_nsec = now % SIM_NS_PER_SEC;
+}
+
+unsigned int pcm_format_to_bits(enum pcm_format format)
+{
+    switch (format) {
+    case PCM_FORMAT_S32_LE:
+    case PCM_FORMAT_S24_LE:
+        return 32;
+    case PCM_FORMAT_S24_3LE:
+        return 24;
+    case PCM_FORMAT_S8:
+        return 8;
+    case PCM_FORMAT_S16_LE:
+    default:
+        return 16;
+    }
+}
+
+unsigned int pcm_frames_to_bytes(const struct pcm *pcm, unsigned int frames)
+{
+    if (!pcm)
+        return 0;
+
+    return frames * pcm->config.channels *
+           (pcm_format_to_bits(pcm->config.format) >> 3);
+}
+
+unsigned int pcm_bytes_to_frames(const struct pcm *pcm, unsigned int bytes)
+{
+    unsigned int frameSize = 0;
+
+    if (!pcm)
+        return 0;
+
+    frameSize = pcm_frames_to_bytes(pcm, 1);
+    return frameSize ? bytes / frameSize : 0;
+}
+
+struct pcm *pcm_open(unsigned int card, unsigned int device,
+                     unsigned int flags, const struct pcm_config *config)
+{
+    struct pcm *pcm = new struct pcm();
+
+    pcm->card = card;
+    pcm->device = device;
+    pcm->flags = flags;
+    pcm->ready = false;
+    pcm->appPos = 0;
+    pcm->stopped = false;
+
+    if (!config || !config->rate || !config->channels ||
+        !config->period_size || !config->period_count) {
+        pcm->error = "invalid pcm config";
+        goto exit;
+    }
+
+    if (!pal_sim_get_card_state()) {
+        pcm->error = "sound card offline";
+        goto exit;
+    }
+
+    pcm->config = *config;
+    pcm->bufferFrames = (uint64_t)config->period_size * config->period_count;
+    pcm->startThreshold = config->start_threshold ?
+                          config->start_threshold : pcm->bufferFrames;
+    if (pcm->startThreshold > pcm->bufferFrames)
+        pcm->startThreshold = pcm->bufferFrames;
+    pcm->clock.configure(config->rate, config->period_size);
+    if (flags & PCM_MMAP)
+        pcm->mmapBuf.resize(pcm_frames_to_bytes(pcm, pcm->bufferFrames));
+    pcm->ready = true;
+    sim_get_counters().pcm_opens++;
+
+    PAL_DBG(LOG_TAG, "pcm C%uD%u%c rate %u ch %u period %u x %u", card,
+            device, sim_pcm_is_capture(pcm) ? 'c' : 'p', config->rate,
+            config->channels, config->period_size, config->period_count);
+exit:
+    return pcm;
+}
+
+int pcm_close(struct pcm *pcm)
+{
+    if (!pcm)
+        return -EINVAL;
+
+    {
+        /* wake blocked transfers and wait for them to leave before freeing */
+        std::unique_lock<std::mutex> lock(pcm->lock);
+        pcm->gate.close(lock, &pcm->stopped);
+    }
+    delete pcm;
+    return 0;
+}
+
+int pcm_is_ready(const struct pcm *pcm)
+{
+    return pcm && pcm->ready;
+}
+
+const char *pcm_get_error(const struct pcm *pcm)
+{
+    return pcm ? pcm->error.c_str() : "";
+}
+
+unsigned int pcm_get_buffer_size(const struct pcm *pcm)
+{
+    return pcm ? pcm->bufferFrames : 0;
+}
+
+int pcm_get_poll_fd(struct pcm *pcm __unused)
+{
+    return -1;
+}
+
+int pcm_prepare(struct pcm *pcm)
+{
+    if (!pcm || !pcm->ready)
+        return -EINVAL;
+
+    std::lock_guard<std::mutex> lock(pcm->lock);
+    pcm->clock.stop();
+    pcm->appPos = 0;
+    return 0;
+}
+
+int pcm_start(struct pcm *pcm)
+{
+    if (!pcm || !pcm->ready)
+        return -EINVAL;
+    if (!pal_sim_get_card_state())
+        return -ENETRESET;
+
+    std::lock_guard<std::mutex> lock(pcm->lock);
+    if (pcm->gate.isClosing())
+        return -EBADFD;
+    pcm->stopped = false;
+    if (!pcm->clock.isRunning())
+        pcm->clock.start();
+    return 0;
+}
+
+int pcm_stop(struct pcm *pcm)
+{
+    if (!pcm || !pcm->ready)
+        return -EINVAL;
+
+    pcm->stopped = true;
+    std::lock_guard<std::mutex> lock(pcm->lock);
+    pcm->clock.stop();
+    pcm->appPos = 0;
+    return 0;
+}
+
+int pcm_write(struct pcm *pcm, const void *data, unsigned int count)
+{
+    uint64_t frames = 0;
+    uint64_t hwPos = 0;
+    uint64_t deadline = 0;
+
+    if (!pcm || !pcm->ready || !data || sim_pcm_is_capture(pcm))
+        return -EINVAL;
+    if (!pal_sim_get_card_state())
+        return -ENETRESET;
+
+    frames = pcm_bytes_to_frames(pcm, count);
+    std::unique_lock<std::mutex> lock(pcm->lock);
+    if (pcm->gate.isClosing())
+        return -EBADFD;
+    pcm->stopped = false;
+
+    /* a write that does not fit before start kicks off the device */
+    if (!pcm->clock.isRunning() && pcm->appPos + frames > pcm->bufferFrames)
+        pcm->clock.start();
+
+    if (pcm->clock.isRunning()) {
+        hwPos = pcm->clock.position();
+        if (hwPos > pcm->appPos) {
+            sim_get_counters().pcm_xruns++;
+            PAL_DBG(LOG_TAG, "underrun on device %u", pcm->device);
+            if (pcm->flags & PCM_NORESTART) {
+                pcm->clock.stop();
+                pcm->appPos = 0;
+                return -EPIPE;
+            }
+            pcm->clock.start();
+            pcm->appPos = 0;
+            hwPos = 0;
+        }
+        if (pcm->appPos + frames > hwPos + pcm->bufferFrames) {
+            deadline = pcm->clock.deadlineFor(pcm->appPos + frames -
+                                              pcm->bufferFrames);
+            if (!pcm->gate.wait(lock, deadline, &pcm->stopped))
+                return -EBADFD;
+        }
+    }
+
+    pcm->appPos += frames;
+    if (!pcm->clock.isRunning() && pcm->appPos >= pcm->startThreshold)
+        pcm->clock.start();
+
+    sim_get_counters().pcm_writes++;
+    sim_get_counters().pcm_frames_written += frames;
+    return 0;
+}
+
+int pcm_read(struct pcm *pcm, void *data, unsigned int count)
+{
+    uint64_t frames = 0;
+    uint64_t hwPos = 0;
+    uint64_t deadline = 0;
+
+    if (!pcm || !pcm->ready || !data || !sim_pcm_is_capture(pcm))
+        return -EINVAL;
+    if (!pal_sim_get_card_state())
+        return -ENETRESET;
+
+    frames = pcm_bytes_to_frames(pcm, count);
+    std::unique_lock<std::mutex> lock(pcm->lock);
+    if (pcm->gate.isClosing())
+        return -EBADFD;
+    pcm->stopped = false;
+    if (!pcm->clock.isRunning())
+        pcm->clock.start();
+
+    hwPos = pcm->clock.position();
+    if (hwPos > pcm->appPos + pcm->bufferFrames) {
+        sim_get_counters().pcm_xruns++;
+        PAL_DBG(LOG_TAG, "overrun on device %u", pcm->device);
+        if (pcm->flags & PCM_NORESTART) {
+            pcm->clock.stop();
+            pcm->appPos = 0;
+            return -EPIPE;
+        }
+        pcm->appPos = hwPos;
+    }
+
+    deadline = pcm->clock.deadlineFor(pcm->appPos + frames);
+    if (!pcm->gate.wait(lock, deadline, &pcm->stopped))
+        return -EBADFD;
+
+    memset(data, 0, count);
+    pcm->appPos += frames;
+    sim_get_counters().pcm_reads++;
+    sim_get_counters().pcm_frames_read += frames;
+    return 0;
+}
+
+int pcm_mmap_write(struct pcm *pcm, const void *data, unsigned int count)
+{
+    return pcm_write(pcm, data, count);
+}
+
+int pcm_mmap_read(struct pcm *pcm, void *data, unsigned int count)
+{
+    return pcm_read(pcm, data, count);
+}
+
+int pcm_mmap_begin(struct pcm *pcm, void **areas, unsigned int *offset,
+                   unsigned int *frames)
+{
+    uint64_t off = 0;
+
+    if (!pcm || !pcm->ready || pcm->mmapBuf.empty() || !areas || !offset ||
+        !frames)
+        return -EINVAL;
+
+    std::lock_guard<std::mutex> lock(pcm->lock);
+    off = pcm->appPos % pcm->bufferFrames;
+    *areas = pcm->mmapBuf.data();
+    *offset = off;
+    if (*frames > pcm->bufferFrames - off)
+        *frames = pcm->bufferFrames - off;
+    return 0;
+}
+
+int pcm_mmap_commit(struct pcm *pcm, unsigned int offset __unused,
+                    unsigned int frames)
+{
+    if (!pcm || !pcm->ready)
+        return -EINVAL;
+
+    std::lock_guard<std::mutex> lock(pcm->lock);
+    pcm->appPos += frames;
+    if (!pcm->clock.isRunning())
+        pcm->clock.start();
+    return frames;
+}
+
+int pcm_mmap_get_hw_ptr(struct pcm *pcm, unsigned int *hw_ptr,
+                        struct timespec *tstamp)
+{
+    uint64_t now = 0;
+
+    if (!pcm || !pcm->ready || !hw_ptr || !tstamp)
+        return -EINVAL;
+
+    std::lock_guard<std::mutex> lock(pcm->lock);
+    now = sim_now_ns();
+    *hw_ptr = (unsigned int)pcm->clock.position();
+    sim_pcm_tstamp(pcm, now, tstamp);
+    return 0;
+}
+
+int pcm_get_htimestamp(struct pcm *pcm, unsigned int *avail,
+                       struct timespec *tstamp)
+{
+    uint64_t now = 0;
+    uint64_t hwPos = 0;
+    uint64_t queued = 0;
+
+    if (!pcm || !pcm->ready || !avail || !tstamp)
+        return -EINVAL;
+
+    std::lock_guard<std::mutex> lock(pcm->lock);
+    if (!pcm->clock.isRunning())
+        return -EINVAL;
+
+    now = sim_now_ns();
+    hwPos = pcm->clock.position();
+    if (sim_pcm_is_capture(pcm)) {
+        *avail = hwPos > pcm->appPos ? (unsigned int)(hwPos - pcm->appPos) : 0;
+    } else {
+        queued = pcm->appPos > hwPos ? pcm->appPos - hwPos : 0;
+        *avail = queued < pcm->bufferFrames ?
+                 (unsigned int)(pcm->bufferFrames - queued) : 0;
+    }
+    sim_pcm_tstamp(pcm, now, tstamp);
+    return 0;
+}
+
+int pcm_ioctl(struct pcm *pcm, int request __unused, ...)
+{
+    if (!pcm || !pcm->ready)
+        return -EINVAL;
+
+    return 0;
+}
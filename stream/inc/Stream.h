@@ -39,6 +39,7 @@
 #include <math.h>
 #include <memory>
 #include <mutex>
+#include <atomic>
 #include <exception>
 #include <semaphore.h>
 #include <errno.h>
@@ -122,15 +123,22 @@ typedef enum {
  */
 #define SSR_RECOVERY 10000
 
+/* While the card is unavailable, buffers handed to the stream are consumed
+ * by a virtual sink paced on CLOCK_MONOTONIC. A client that stalls longer
+ * than this is not allowed to catch up in a burst.
+ */
+#define VIRTUAL_SINK_MAX_LAG_US (100*1000)
+
 /* Soft pause has to wait for ramp period to ensure volume stepping finishes.
  * This period of time was previously consumed in elite before acknowleging
  * pause completion. But it's not the case in Gecko.
- * FIXME: load the ramp period config from acdb.
+ * Default upper bound of the wait, can be overridden by config_ramp in
+ * the resource manager xml.
  */
 #define VOLUME_RAMP_PERIOD (100*1000)
 
 /*
- * The sleep is required for mute to ramp down.
+ * Default wait for mute to ramp down, can be overridden by config_ramp.
  */
 #define MUTE_RAMP_PERIOD (30*1000)
 
@@ -163,11 +171,44 @@ protected:
     stream_state_t currentState;
     stream_state_t cachedState;
     uint32_t mInstanceID = 0;
-    static std::condition_variable pauseCV;
-    static std::mutex pauseMutex;
+    std::mutex mRampMutex;
+    std::condition_variable mRampCV;
+    uint32_t mRampDoneCount = 0;
     bool mutexLockedbyRm = false;
+    uint32_t mVolumeDataPairs = 0;
+    std::vector<uint8_t> mVolumeParamBuf;
     sem_t mInUse;
+    /* virtual sink and session timeline, guarded by mTimelineMutex */
+    std::mutex mTimelineMutex;
+    uint64_t mVSinkDeadlineNs = 0;
+    uint64_t mVSinkBaseUs = 0;
+    uint64_t mVSinkRenderedUs = 0;
+    uint64_t mTimelineOffsetUs = 0;
+    uint64_t mLastSessionTimeUs = 0;
+    /* buffer policy bookkeeping, see BufferPolicy */
+    bool mBufSizeFromClient = false;
+    std::atomic<uint32_t> mPolicyUnderruns{0};
+    /* xrun accounting, guarded by mXrunMutex */
+    std::mutex mXrunMutex;
+    pal_param_xrun_stats_t mXrunStats = {};
+    uint32_t mXrunRecovery = PAL_XRUN_RECOVERY_PREPARE;
+    bool mXrunNotifyPending = false;
+    /* position mirror, guarded by mMirrorMutex */
+    std::mutex mMirrorMutex;
+    pal_position_mirror_t *mPosMirror = nullptr;
+    std::unique_ptr<pal_position_mirror_t> mOwnedPosMirror;
+    uint64_t mMirrorFrames = 0;
+    void initPositionMirror_l();
     int connectToDefaultDevice(Stream* streamHandle, uint32_t dir);
+    pal_device_id_t getPolicyDevice_l(bool input);
+    void endBufferPolicySession();
+    uint64_t consumeVirtualSink(uint32_t bytes, uint32_t frameSize, uint32_t sampleRate);
+    void leaveVirtualSink();
+    void resetTimeline();
+    static void waitVirtualSink(uint64_t deadlineNs);
+    void notifyXrun();
+    int32_t getXrunStats(pal_param_payload **payload);
+    int32_t setXrunRecovery(pal_param_payload *payload);
 public:
     virtual ~Stream() {};
     struct pal_volume_data* mVolumeData = NULL;
@@ -209,6 +250,9 @@ public:
     virtual int32_t createMmapBuffer(int32_t min_size_frames __unused,
                                    struct pal_mmap_buffer *info __unused) {return -EINVAL;}
     virtual int32_t GetMmapPosition(struct pal_mmap_position *position __unused) {return -EINVAL;}
+    /* queued submission, returns the number of buffers queued */
+    virtual int32_t readBuffers(struct pal_buffer *bufs __unused, uint32_t count __unused) {return -EINVAL;}
+    virtual int32_t writeBuffers(struct pal_buffer *bufs __unused, uint32_t count __unused) {return -EINVAL;}
     virtual int32_t getTagsWithModuleInfo(size_t *size __unused, uint8_t *payload __unused) {return -EINVAL;};
     int32_t getStreamAttributes(struct pal_stream_attributes *sattr);
     int32_t getModifiers(struct modifier_kv *modifiers,uint32_t *noOfModifiers);
@@ -227,10 +271,29 @@ public:
     int32_t getAssociatedSession(Session** session);
     int32_t setBufInfo(pal_buffer_config *in_buffer_config,
                        pal_buffer_config *out_buffer_config);
+    /* sessions call getBufInfo from stream ops, with mStreamMutex held */
     int32_t getBufInfo(size_t *in_buf_size, size_t *in_buf_count,
                        size_t *out_buf_size, size_t *out_buf_count);
+    int32_t getBufferSize(size_t *in_buf_size, size_t *in_buf_count,
+                          size_t *out_buf_size, size_t *out_buf_count);
     int32_t getMaxMetadataSz(size_t *in_max_metadata_sz, size_t *out_max_metadata_sz);
+    void reportUnderruns(uint32_t count);
+    void recordXrun(bool underrun, uint64_t framesLost);
+    uint32_t getXrunRecovery();
+    int32_t getPositionMirror(const pal_position_mirror_t **mirror);
+    int32_t setPositionMirror(pal_position_mirror_t *mirror);
+    bool isPositionMirrored();
+    /* called by the session at every period boundary */
+    void publishPosition(uint32_t frames, bool playback, uint32_t avail,
+                         uint32_t bufferFrames, const struct timespec *hwTs);
+    void publishSessionTime(const struct pal_session_time *stime);
+    /* for mmap streams, whose data never passes through PAL */
+    void publishHwPosition(uint64_t hwFrames, const struct timespec *hwTs);
     int32_t getVolumeData(struct pal_volume_data *vData);
+    int32_t getVolumePairs(struct pal_channel_vol_kv *pairs, uint32_t maxPairs,
+                           uint32_t *noOfPairs);
+    int32_t cacheVolumeData(struct pal_volume_data *volume);
+    pal_param_payload *getVolumeParamPayload();
     void setGainLevel(int level) { mGainLevel = level; };
     int getGainLevel() { return mGainLevel; };
     /* static so that this method can be accessed wihtout object */
@@ -268,6 +331,9 @@ public:
     virtual int32_t HandleConcurrentStream(bool active) { return 0; }
     virtual int32_t DisconnectDevice(pal_device_id_t device_id) { return 0; }
     virtual int32_t ConnectDevice(pal_device_id_t device_id) { return 0; }
+    uint32_t armRampWait();
+    bool waitForRamp(uint32_t armedCount, uint32_t timeoutUs, bool eventDriven);
+    void notifyRampDone();
     static void handleSoftPauseCallBack(uint64_t hdl, uint32_t event_id, void *data,
                                                            uint32_t event_size);
     static void handleStreamException(struct pal_stream_attributes *attributes,
@@ -315,6 +381,8 @@ public:
    int32_t addRemoveEffect(pal_audio_effect_t effect __unused, bool enable __unused) {return 0;};
    int32_t read(struct pal_buffer *buf) override;
    int32_t write(struct pal_buffer *buf) override;
+   int32_t readBuffers(struct pal_buffer *bufs, uint32_t count) override;
+   int32_t writeBuffers(struct pal_buffer *bufs, uint32_t count) override;
    int32_t registerCallBack(pal_stream_callback cb, uint64_t cookie) override;
    int32_t getCallBack(pal_stream_callback *cb) override;
    int32_t getParameters(uint32_t param_id, void **payload) override;
@@ -329,6 +397,7 @@ public:
 private:
    /*This notifies that the system went through/is in a ssr*/
    bool ssrInNTMode;
+   bool isQueueable();
 };
 
 #endif//STREAM_H_
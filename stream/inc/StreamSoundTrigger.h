@@ -96,6 +96,7 @@ enum {
 
 class ResourceManager;
 class SoundModelInfo;
+class KeywordWindow;
 
 class StreamSoundTrigger : public Stream {
  public:
@@ -589,6 +590,7 @@ class StreamSoundTrigger : public Stream {
     std::shared_ptr<CaptureProfile> cap_prof_;
     uint32_t conf_levels_intf_version_;
     std::vector<PalRingBufferReader *> reader_list_;
+    std::shared_ptr<KeywordWindow> kw_window_;
     st_confidence_levels_info *st_conf_levels_;
     st_confidence_levels_info_v2 *st_conf_levels_v2_;
     bool capture_requested_;
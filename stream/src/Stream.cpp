@@ -63,6 +63,8 @@
 
 #define LOG_TAG "PAL: Stream"
 #include <semaphore.h>
+#include <time.h>
+#include <new>
 #include "Stream.h"
 #include "StreamPCM.h"
 #include "StreamInCall.h"
@@ -77,11 +79,10 @@
 #include "ResourceManager.h"
 #include "Device.h"
 #include "USBAudio.h"
+#include "BufferPolicy.h"
 
 std::shared_ptr<ResourceManager> Stream::rm = nullptr;
 std::mutex Stream::mBaseStreamMutex;
-std::mutex Stream::pauseMutex;
-std::condition_variable Stream::pauseCV;
 
 
 void Stream::handleSoftPauseCallBack(uint64_t hdl, uint32_t event_id,
@@ -92,10 +93,52 @@ void Stream::handleSoftPauseCallBack(uint64_t hdl, uint32_t event_id,
 
     if (event_id == EVENT_ID_SOFT_PAUSE_PAUSE_COMPLETE) {
         PAL_DBG(LOG_TAG, "Pause done");
-        pauseCV.notify_all();
+        if (hdl)
+            reinterpret_cast<Stream *>(hdl)->notifyRampDone();
     }
 }
 
+/*
+ * Ramp completion: a caller snapshots the completion count with
+ * armRampWait() before issuing the ramp (pause/mute) and then blocks in
+ * waitForRamp() until the DSP completion event bumps the count or the
+ * ramp period elapses. Arming first means an event that arrives before
+ * the wait starts is not lost.
+ */
+uint32_t Stream::armRampWait()
+{
+    std::lock_guard<std::mutex> lock(mRampMutex);
+
+    return mRampDoneCount;
+}
+
+bool Stream::waitForRamp(uint32_t armedCount, uint32_t timeoutUs, bool eventDriven)
+{
+    std::unique_lock<std::mutex> lock(mRampMutex);
+    bool done = false;
+
+    if (!eventDriven) {
+        lock.unlock();
+        usleep(timeoutUs);
+        return false;
+    }
+
+    done = mRampCV.wait_for(lock, std::chrono::microseconds(timeoutUs),
+            [&] { return mRampDoneCount != armedCount; });
+    if (!done)
+        PAL_INFO(LOG_TAG, "ramp completion not received in %u us", timeoutUs);
+
+    return done;
+}
+
+void Stream::notifyRampDone()
+{
+    std::lock_guard<std::mutex> lock(mRampMutex);
+
+    mRampDoneCount++;
+    mRampCV.notify_all();
+}
+
 Stream* Stream::create(struct pal_stream_attributes *sAttr, struct pal_device *dAttr,
     uint32_t noOfDevices, struct modifier_kv *modifiers, uint32_t noOfModifiers)
 {
@@ -616,6 +659,78 @@ exit:
     return status;
 }
 
+int32_t Stream::getVolumePairs(struct pal_channel_vol_kv *pairs, uint32_t maxPairs,
+                               uint32_t *noOfPairs)
+{
+    uint32_t count = 0;
+
+    if (!pairs || !noOfPairs || !maxPairs)
+        return -EINVAL;
+
+    if (!mVolumeData || mVolumeData->no_of_volpair == 0) {
+        PAL_ERR(LOG_TAG, "volume has not been set");
+        return -EINVAL;
+    }
+
+    count = std::min(mVolumeData->no_of_volpair, maxPairs);
+    memcpy(pairs, mVolumeData->volume_pair, sizeof(struct pal_channel_vol_kv) * count);
+    *noOfPairs = mVolumeData->no_of_volpair;
+    return 0;
+}
+
+/*
+ * Caches the given volume in mVolumeData. The existing buffer is reused
+ * when it can hold the new pair count, so repeated volume updates from
+ * the same stream do not go back to the heap.
+ */
+int32_t Stream::cacheVolumeData(struct pal_volume_data *volume)
+{
+    size_t volSize = 0;
+
+    if (!volume || (volume->no_of_volpair == 0))
+        return -EINVAL;
+
+    volSize = sizeof(uint32_t) +
+              (sizeof(struct pal_channel_vol_kv) * (volume->no_of_volpair));
+    if (!mVolumeData || (mVolumeDataPairs < volume->no_of_volpair)) {
+        if (mVolumeData)
+            free(mVolumeData);
+        mVolumeData = (struct pal_volume_data *)calloc(1, volSize);
+        if (!mVolumeData) {
+            mVolumeDataPairs = 0;
+            PAL_ERR(LOG_TAG, "failed to calloc for volume data");
+            return -ENOMEM;
+        }
+        mVolumeDataPairs = volume->no_of_volpair;
+    }
+    ar_mem_cpy(mVolumeData, volSize, volume, volSize);
+    return 0;
+}
+
+/*
+ * Returns the cached volume wrapped in a pal_param_payload, as expected by
+ * PAL_PARAM_ID_VOLUME_USING_SET_PARAM. The backing buffer is owned by the
+ * stream and only grows.
+ */
+pal_param_payload *Stream::getVolumeParamPayload()
+{
+    pal_param_payload *pld = NULL;
+    size_t volSize = 0;
+
+    if (!mVolumeData)
+        return NULL;
+
+    volSize = sizeof(uint32_t) +
+              (sizeof(struct pal_channel_vol_kv) * (mVolumeData->no_of_volpair));
+    if (mVolumeParamBuf.size() < sizeof(pal_param_payload) + volSize)
+        mVolumeParamBuf.resize(sizeof(pal_param_payload) + volSize);
+
+    pld = (pal_param_payload *)mVolumeParamBuf.data();
+    pld->payload_size = sizeof(struct pal_volume_data);
+    memcpy(pld->payload, mVolumeData, volSize);
+    return pld;
+}
+
 int32_t Stream::setBufInfo(pal_buffer_config *in_buffer_cfg,
                            pal_buffer_config *out_buffer_cfg)
 {
@@ -637,6 +752,7 @@ int32_t Stream::setBufInfo(pal_buffer_config *in_buffer_cfg,
          outBufCount = 0;
          outBufSize = 0;
     } else {
+        mBufSizeFromClient = true;
         if (in_buffer_cfg) {
             PAL_DBG(LOG_TAG, "In Buffer size %zu, In Buffer count %zu metadata sz %zu",
                     in_buffer_cfg->buf_size, in_buffer_cfg->buf_count, in_buffer_cfg->max_metadata_size);
@@ -737,10 +853,27 @@ int32_t Stream::getMaxMetadataSz(size_t *in_max_metdata_sz, size_t *out_max_meta
     return status;
 }
 
+/*
+ * first associated device in the given direction, used as buffer policy key,
+ * mStreamMutex held
+ */
+pal_device_id_t Stream::getPolicyDevice_l(bool input)
+{
+    for (auto &dev : mDevices) {
+        if (input ? rm->isInputDevId(dev->getSndDeviceId()) :
+                    rm->isOutputDevId(dev->getSndDeviceId()))
+            return (pal_device_id_t)dev->getSndDeviceId();
+    }
+
+    return PAL_DEVICE_NONE;
+}
+
 int32_t Stream::getBufInfo(size_t *in_buf_size, size_t *in_buf_count,
                            size_t *out_buf_size, size_t *out_buf_count)
 {
     int32_t status = 0;
+    size_t size = 0;
+    size_t count = 0;
 
     if (in_buf_size)
         *in_buf_size = inBufSize;
@@ -751,6 +884,38 @@ int32_t Stream::getBufInfo(size_t *in_buf_size, size_t *in_buf_count,
     if (out_buf_count)
         *out_buf_count = outBufCount;
 
+    /*
+     * mmap and extern memory streams own their buffer layout, as does
+     * sound trigger, whose engine reads it from the detection thread
+     * without mStreamMutex
+     */
+    if (mStreamAttr && mStreamAttr->type != PAL_STREAM_VOICE_UI &&
+        !(mStreamAttr->flags & (PAL_STREAM_FLAG_MMAP |
+            PAL_STREAM_FLAG_MMAP_NO_IRQ | PAL_STREAM_FLAG_EXTERN_MEM))) {
+        if (in_buf_size && in_buf_count &&
+            mStreamAttr->direction != PAL_AUDIO_OUTPUT) {
+            size = inBufSize;
+            count = inBufCount;
+            if (BufferPolicy::getInstance()->getBufConfig(mStreamAttr->type,
+                    getPolicyDevice_l(true), &mStreamAttr->in_media_config,
+                    mBufSizeFromClient, &size, &count)) {
+                *in_buf_size = size;
+                *in_buf_count = count;
+            }
+        }
+        if (out_buf_size && out_buf_count &&
+            mStreamAttr->direction != PAL_AUDIO_INPUT) {
+            size = outBufSize;
+            count = outBufCount;
+            if (BufferPolicy::getInstance()->getBufConfig(mStreamAttr->type,
+                    getPolicyDevice_l(false), &mStreamAttr->out_media_config,
+                    mBufSizeFromClient, &size, &count)) {
+                *out_buf_size = size;
+                *out_buf_count = count;
+            }
+        }
+    }
+
     if (in_buf_size && in_buf_count)
         PAL_DBG(LOG_TAG, "In Buffer size %zu, In Buffer count %zu",
                 *in_buf_size, *in_buf_count);
@@ -762,6 +927,34 @@ int32_t Stream::getBufInfo(size_t *in_buf_size, size_t *in_buf_count,
     return status;
 }
 
+/* pal_stream_get_buffer_size, runs outside of any stream op */
+int32_t Stream::getBufferSize(size_t *in_buf_size, size_t *in_buf_count,
+                              size_t *out_buf_size, size_t *out_buf_count)
+{
+    std::lock_guard<std::mutex> lck(mStreamMutex);
+
+    return getBufInfo(in_buf_size, in_buf_count, out_buf_size, out_buf_count);
+}
+
+/* from the session write, with mStreamMutex held */
+void Stream::reportUnderruns(uint32_t count)
+{
+    if (!mStreamAttr || !count)
+        return;
+
+    mPolicyUnderruns += count;
+    BufferPolicy::getInstance()->reportUnderruns(mStreamAttr->type,
+            getPolicyDevice_l(mStreamAttr->direction == PAL_AUDIO_INPUT), count);
+}
+
+/* called on stop, a run without underruns lets the policy back off */
+void Stream::endBufferPolicySession()
+{
+    if (!mPolicyUnderruns.exchange(0) && mStreamAttr)
+        BufferPolicy::getInstance()->reportCleanSession(mStreamAttr->type,
+                getPolicyDevice_l(mStreamAttr->direction == PAL_AUDIO_INPUT));
+}
+
 bool Stream::isStreamAudioOutFmtSupported(pal_audio_fmt_t format)
 {
     switch (format) {
@@ -793,14 +986,367 @@ bool Stream::isStreamAudioOutFmtSupported(pal_audio_fmt_t format)
     }
 }
 
+static uint64_t monotonicNs()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void setTimeUs(struct pal_time_us *t, uint64_t us)
+{
+    t->value_lsw = (uint32_t)us;
+    t->value_msw = (uint32_t)(us >> 32);
+}
+
+static uint64_t getTimeUs(const struct pal_time_us *t)
+{
+    return ((uint64_t)t->value_msw << 32) | t->value_lsw;
+}
+
+/*
+ * Accounts a buffer dropped while the card is unavailable and returns the
+ * CLOCK_MONOTONIC deadline the caller should wait for, after releasing
+ * mStreamMutex. One buffer of headroom is allowed, so the wait is only
+ * for the part of the previous buffer that has not "played" yet.
+ */
+uint64_t Stream::consumeVirtualSink(uint32_t bytes, uint32_t frameSize, uint32_t sampleRate)
+{
+    uint64_t now = monotonicNs();
+    uint64_t durationNs = (uint64_t)bytes * 1000000000ULL / frameSize / sampleRate;
+    uint64_t waitNs = 0;
+    std::lock_guard<std::mutex> lck(mTimelineMutex);
+
+    if (!mVSinkDeadlineNs) {
+        mVSinkBaseUs = mLastSessionTimeUs;
+        mVSinkRenderedUs = 0;
+        mVSinkDeadlineNs = now;
+        PAL_DBG(LOG_TAG, "virtual sink engaged at %llu us",
+                (unsigned long long)mVSinkBaseUs);
+    } else if (mVSinkDeadlineNs + VIRTUAL_SINK_MAX_LAG_US * 1000ULL < now) {
+        mVSinkDeadlineNs = now;
+    }
+
+    waitNs = mVSinkDeadlineNs;
+    mVSinkDeadlineNs += durationNs;
+    mVSinkRenderedUs += durationNs / 1000;
+
+    return waitNs;
+}
+
+void Stream::waitVirtualSink(uint64_t deadlineNs)
+{
+    struct timespec ts;
+
+    if (deadlineNs <= monotonicNs())
+        return;
+
+    ts.tv_sec = deadlineNs / 1000000000ULL;
+    ts.tv_nsec = deadlineNs % 1000000000ULL;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+}
+
+/* time the virtual sink has played out so far, caller holds mTimelineMutex */
+static uint64_t virtualSinkPlayedUs(uint64_t deadlineNs, uint64_t renderedUs)
+{
+    uint64_t now = monotonicNs();
+    uint64_t aheadUs = deadlineNs > now ? (deadlineNs - now) / 1000 : 0;
+
+    return renderedUs > aheadUs ? renderedUs - aheadUs : 0;
+}
+
+/*
+ * Called on the first buffer that reaches the recovered session. The new
+ * session counts from zero, so the time played by the virtual sink is
+ * carried over as an offset on the reported session time.
+ */
+void Stream::leaveVirtualSink()
+{
+    std::lock_guard<std::mutex> lck(mTimelineMutex);
+
+    if (!mVSinkDeadlineNs)
+        return;
+
+    mTimelineOffsetUs = mVSinkBaseUs +
+            virtualSinkPlayedUs(mVSinkDeadlineNs, mVSinkRenderedUs);
+    mVSinkDeadlineNs = 0;
+    PAL_DBG(LOG_TAG, "virtual sink released, timeline offset %llu us",
+            (unsigned long long)mTimelineOffsetUs);
+}
+
+/* client stop, the next session timeline starts from zero */
+void Stream::resetTimeline()
+{
+    std::lock_guard<std::mutex> lck(mTimelineMutex);
+
+    mVSinkDeadlineNs = 0;
+    mTimelineOffsetUs = 0;
+    mLastSessionTimeUs = 0;
+}
+
+/* called by the session when a pcm transfer hits an xrun */
+void Stream::recordXrun(bool underrun, uint64_t framesLost)
+{
+    {
+        std::lock_guard<std::mutex> lck(mXrunMutex);
+
+        if (underrun)
+            mXrunStats.underruns++;
+        else
+            mXrunStats.overruns++;
+        mXrunStats.frames_lost += framesLost;
+        mXrunStats.last_xrun_time_us = monotonicNs() / 1000;
+        if (mXrunRecovery & PAL_XRUN_RECOVERY_NOTIFY)
+            mXrunNotifyPending = true;
+    }
+
+    PAL_INFO(LOG_TAG, "%s on stream %pK, %llu frames lost",
+             underrun ? "underrun" : "overrun", this,
+             (unsigned long long)framesLost);
+    /* the buffer policy only sizes playback periods */
+    if (underrun)
+        reportUnderruns(1);
+}
+
+uint32_t Stream::getXrunRecovery()
+{
+    std::lock_guard<std::mutex> lck(mXrunMutex);
+
+    return mXrunRecovery;
+}
+
+/* raises a pending xrun event, must be called without mStreamMutex held */
+void Stream::notifyXrun()
+{
+    pal_param_xrun_stats_t stats;
+
+    mXrunMutex.lock();
+    if (!mXrunNotifyPending) {
+        mXrunMutex.unlock();
+        return;
+    }
+    mXrunNotifyPending = false;
+    stats = mXrunStats;
+    mXrunMutex.unlock();
+
+    if (streamCb)
+        streamCb(reinterpret_cast<pal_stream_handle_t *>(this),
+                 PAL_STREAM_CBK_EVENT_XRUN, (uint32_t *)&stats,
+                 sizeof(stats), cookie);
+}
+
+/*
+ * Fills the caller's payload, or allocates one when *payload is NULL as for
+ * the IPC server, which has no size to pass. The caller frees the latter.
+ */
+int32_t Stream::getXrunStats(pal_param_payload **payload)
+{
+    pal_param_payload *stats = NULL;
+
+    if (!payload) {
+        PAL_ERR(LOG_TAG, "Invalid xrun stats payload");
+        return -EINVAL;
+    }
+
+    stats = *payload;
+    if (!stats) {
+        stats = (pal_param_payload *)calloc(1, sizeof(pal_param_payload) +
+                                            sizeof(pal_param_xrun_stats_t));
+        if (!stats) {
+            PAL_ERR(LOG_TAG, "Failed to allocate xrun stats payload");
+            return -ENOMEM;
+        }
+        stats->payload_size = sizeof(pal_param_xrun_stats_t);
+    } else if (stats->payload_size != sizeof(pal_param_xrun_stats_t)) {
+        PAL_ERR(LOG_TAG, "Invalid xrun stats payload size %u",
+                stats->payload_size);
+        return -EINVAL;
+    }
+
+    mXrunMutex.lock();
+    memcpy(stats->payload, &mXrunStats, sizeof(mXrunStats));
+    mXrunMutex.unlock();
+    *payload = stats;
+    return 0;
+}
+
+int32_t Stream::setXrunRecovery(pal_param_payload *payload)
+{
+    uint32_t recovery = 0;
+
+    if (!payload || payload->payload_size != sizeof(uint32_t)) {
+        PAL_ERR(LOG_TAG, "Invalid xrun recovery payload");
+        return -EINVAL;
+    }
+
+    memcpy(&recovery, payload->payload, sizeof(recovery));
+    if (recovery & ~(PAL_XRUN_RECOVERY_SILENCE | PAL_XRUN_RECOVERY_NOTIFY)) {
+        PAL_ERR(LOG_TAG, "Invalid xrun recovery %x", recovery);
+        return -EINVAL;
+    }
+
+    std::lock_guard<std::mutex> lck(mXrunMutex);
+    mXrunRecovery = recovery;
+    PAL_DBG(LOG_TAG, "xrun recovery %x", mXrunRecovery);
+    return 0;
+}
+
+/* seqlock writer side, readers retry while seq is odd or has moved */
+static void beginMirrorUpdate(pal_position_mirror_t *mirror)
+{
+    __atomic_store_n(&mirror->seq, mirror->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void endMirrorUpdate(pal_position_mirror_t *mirror)
+{
+    __atomic_store_n(&mirror->seq, mirror->seq + 1, __ATOMIC_RELEASE);
+}
+
+/* caller holds mMirrorMutex, the page is not published yet */
+void Stream::initPositionMirror_l()
+{
+    bool playback = mStreamAttr && mStreamAttr->direction == PAL_AUDIO_OUTPUT;
+
+    memset(mPosMirror, 0, sizeof(*mPosMirror));
+    if (mStreamAttr)
+        mPosMirror->sample_rate = playback ?
+                mStreamAttr->out_media_config.sample_rate :
+                mStreamAttr->in_media_config.sample_rate;
+    mMirrorFrames = 0;
+}
+
+int32_t Stream::getPositionMirror(const pal_position_mirror_t **mirror)
+{
+    std::lock_guard<std::mutex> lck(mMirrorMutex);
+
+    if (!mirror)
+        return -EINVAL;
+
+    /* a page handed out once is reused, it must stay valid until close */
+    if (!mPosMirror) {
+        if (!mOwnedPosMirror)
+            mOwnedPosMirror.reset(new (std::nothrow) pal_position_mirror_t);
+        if (!mOwnedPosMirror) {
+            PAL_ERR(LOG_TAG, "failed to allocate position mirror");
+            return -ENOMEM;
+        }
+        mPosMirror = mOwnedPosMirror.get();
+        initPositionMirror_l();
+    }
+    *mirror = mPosMirror;
+    return 0;
+}
+
+int32_t Stream::setPositionMirror(pal_position_mirror_t *mirror)
+{
+    std::lock_guard<std::mutex> lck(mMirrorMutex);
+
+    /*
+     * the owned page is kept until close, a client may still poll the
+     * pointer getPositionMirror returned; it just stops being updated
+     */
+    mPosMirror = mirror;
+    if (mPosMirror)
+        initPositionMirror_l();
+    PAL_DBG(LOG_TAG, "position mirror %pK on stream %pK", mirror, this);
+    return 0;
+}
+
+bool Stream::isPositionMirrored()
+{
+    std::lock_guard<std::mutex> lck(mMirrorMutex);
+
+    return mPosMirror != nullptr;
+}
+
+/*
+ * avail is the room (playback) or the data (capture) left in a ring of
+ * bufferFrames at hwTs, as reported by pcm_get_htimestamp.
+ */
+void Stream::publishPosition(uint32_t frames, bool playback, uint32_t avail,
+                             uint32_t bufferFrames, const struct timespec *hwTs)
+{
+    uint64_t queued = 0;
+    std::lock_guard<std::mutex> lck(mMirrorMutex);
+
+    if (!mPosMirror)
+        return;
+
+    mMirrorFrames += frames;
+    beginMirrorUpdate(mPosMirror);
+    mPosMirror->frames = mMirrorFrames;
+    if (hwTs) {
+        if (playback) {
+            queued = avail < bufferFrames ? bufferFrames - avail : 0;
+            mPosMirror->hw_frames = mMirrorFrames > queued ?
+                    mMirrorFrames - queued : 0;
+        } else {
+            mPosMirror->hw_frames = mMirrorFrames + avail;
+        }
+        mPosMirror->hw_time_ns = (int64_t)hwTs->tv_sec * 1000000000LL +
+                hwTs->tv_nsec;
+    }
+    mPosMirror->update_time_ns = (int64_t)monotonicNs();
+    endMirrorUpdate(mPosMirror);
+}
+
+/* the hardware pointer is both the transferred and the rendered position */
+void Stream::publishHwPosition(uint64_t hwFrames, const struct timespec *hwTs)
+{
+    std::lock_guard<std::mutex> lck(mMirrorMutex);
+
+    if (!mPosMirror)
+        return;
+
+    mMirrorFrames = hwFrames;
+    beginMirrorUpdate(mPosMirror);
+    mPosMirror->frames = hwFrames;
+    mPosMirror->hw_frames = hwFrames;
+    if (hwTs)
+        mPosMirror->hw_time_ns = (int64_t)hwTs->tv_sec * 1000000000LL +
+                hwTs->tv_nsec;
+    mPosMirror->update_time_ns = (int64_t)monotonicNs();
+    endMirrorUpdate(mPosMirror);
+}
+
+void Stream::publishSessionTime(const struct pal_session_time *stime)
+{
+    std::lock_guard<std::mutex> lck(mMirrorMutex);
+
+    if (!mPosMirror)
+        return;
+
+    beginMirrorUpdate(mPosMirror);
+    mPosMirror->dsp_time = *stime;
+    mPosMirror->dsp_time_update_ns = (int64_t)monotonicNs();
+    endMirrorUpdate(mPosMirror);
+}
+
 int32_t Stream::getTimestamp(struct pal_session_time *stime)
 {
     int32_t status = 0;
+    uint64_t sessionUs = 0;
+
     if (!stime) {
         status = -EINVAL;
         PAL_ERR(LOG_TAG, "Invalid session time pointer, status %d", status);
         goto exit;
     }
+
+    mTimelineMutex.lock();
+    if (mVSinkDeadlineNs) {
+        sessionUs = mVSinkBaseUs +
+                virtualSinkPlayedUs(mVSinkDeadlineNs, mVSinkRenderedUs);
+        mTimelineMutex.unlock();
+        setTimeUs(&stime->session_time, sessionUs);
+        setTimeUs(&stime->timestamp, sessionUs);
+        setTimeUs(&stime->absolute_time, monotonicNs() / 1000);
+        goto exit;
+    }
+    mTimelineMutex.unlock();
+
     if (rm->cardState == CARD_STATUS_OFFLINE) {
         status = -EINVAL;
         PAL_ERR(LOG_TAG, "Sound card offline, status %d", status);
@@ -817,8 +1363,21 @@ int32_t Stream::getTimestamp(struct pal_session_time *stime)
             rm->ssrHandler(CARD_STATUS_OFFLINE);
             status = -EINVAL;
         }
+        goto exit;
+    }
+
+    mTimelineMutex.lock();
+    if (mTimelineOffsetUs) {
+        setTimeUs(&stime->session_time,
+                  getTimeUs(&stime->session_time) + mTimelineOffsetUs);
+        setTimeUs(&stime->timestamp,
+                  getTimeUs(&stime->timestamp) + mTimelineOffsetUs);
     }
+    mLastSessionTimeUs = getTimeUs(&stime->session_time);
+    mTimelineMutex.unlock();
 exit:
+    if (!status)
+        publishSessionTime(stime);
     return status;
 }
 
@@ -416,7 +416,6 @@ int32_t StreamCommon::stop()
 int32_t StreamCommon::setVolume(struct pal_volume_data *volume)
 {
     int32_t status = 0;
-    uint8_t volSize = 0;
 
     PAL_DBG(LOG_TAG, "Enter. session handle - %pK", session);
     if (!volume || (volume->no_of_volpair == 0)) {
@@ -425,24 +424,14 @@ int32_t StreamCommon::setVolume(struct pal_volume_data *volume)
        goto exit;
     }
 
-    // if already allocated free and reallocate
-    if (mVolumeData) {
-        free(mVolumeData);
-        mVolumeData = NULL;
-    }
-
-    volSize = sizeof(uint32_t) + (sizeof(struct pal_channel_vol_kv) * (volume->no_of_volpair));
-    mVolumeData = (struct pal_volume_data *)calloc(1, volSize);
-    if (!mVolumeData) {
-        status = -ENOMEM;
-        PAL_ERR(LOG_TAG, "failed to calloc for volume data");
-        goto exit;
-    }
-
     /* Allow caching of stream volume as part of mVolumeData
      * till the pcm_open is not done or if sound card is offline.
      */
-    ar_mem_cpy(mVolumeData, volSize, volume, volSize);
+    status = cacheVolumeData(volume);
+    if (status) {
+        PAL_ERR(LOG_TAG, "failed to cache volume data");
+        goto exit;
+    }
     for (int32_t i=0; i < (mVolumeData->no_of_volpair); i++) {
         PAL_INFO(LOG_TAG, "Volume payload mask:%x vol:%f",
                       (mVolumeData->volume_pair[i].channel_mask), (mVolumeData->volume_pair[i].vol));
@@ -41,8 +41,6 @@
 #define COMPRESS_OFFLOAD_FRAGMENT_SIZE (32 * 1024)
 #define COMPRESS_OFFLOAD_NUM_FRAGMENTS 4
 
-std::condition_variable cvPause;
-
 static void handleSessionCallBack(uint64_t hdl, uint32_t event_id, void *data,
                                   uint32_t event_size)
 {
@@ -52,7 +50,9 @@ static void handleSessionCallBack(uint64_t hdl, uint32_t event_id, void *data,
     PAL_DBG(LOG_TAG,"Event id %x ", event_id);
     if (event_id == EVENT_ID_SOFT_PAUSE_PAUSE_COMPLETE) {
         PAL_DBG(LOG_TAG,"Pause Done");
-        cvPause.notify_all();
+        s = reinterpret_cast<Stream *>(hdl);
+        if (s)
+            s->notifyRampDone();
     }
     else {
         s = reinterpret_cast<Stream *>(hdl);
@@ -265,6 +265,8 @@ int32_t StreamCompress::close()
 
 StreamCompress::~StreamCompress()
 {
+    /* a session callback still running uses the stream */
+    rm->waitMixerEventCallbacks((uint64_t)this);
     rm->resetStreamInstanceID(this);
     rm->deregisterStream(this);
     if (mStreamAttr) {
@@ -728,11 +730,11 @@ int32_t StreamCompress::setParameters(uint32_t param_id, void *payload)
                 if (setConfigStatus) {
                     PAL_INFO(LOG_TAG, "DevicePP Mute failed");
                 }
-                usleep(MUTE_RAMP_PERIOD); // Wait for mute to ramp down
+                usleep(rm->getMuteRampPeriod()); // Wait for mute to ramp down
                 status = session->setParameters(this, 0,
                                                 PAL_PARAM_ID_DEVICE_ROTATION,
                                                 payload);
-                usleep(MUTE_RAMP_PERIOD); // Wait for channel swap to take affect
+                usleep(rm->getMuteRampPeriod()); // Wait for channel swap to take affect
                 setConfigStatus = session->setConfig(this, MODULE, DEVICEPP_UNMUTE);
                 if (setConfigStatus) {
                     PAL_INFO(LOG_TAG, "DevicePP Unmute failed");
@@ -758,7 +760,6 @@ int32_t StreamCompress::setVolume(struct pal_volume_data *volume)
 {
     int32_t status = 0;
     struct volume_set_param_info vol_set_param_info;
-    uint8_t volSize = 0;
 
     PAL_DBG(LOG_TAG, "Enter, session handle - %p", session);
     if (!volume || (volume->no_of_volpair == 0)) {
@@ -767,25 +768,14 @@ int32_t StreamCompress::setVolume(struct pal_volume_data *volume)
        goto exit;
     }
 
-    // if already allocated free and reallocate
-    if (mVolumeData) {
-        free(mVolumeData);
-        mVolumeData = NULL;
-    }
-
-    volSize = (sizeof(struct pal_volume_data) +
-            (sizeof(struct pal_channel_vol_kv) * (volume->no_of_volpair)));
-    mVolumeData = (struct pal_volume_data *)calloc(1, volSize);
-    if (!mVolumeData) {
-       PAL_ERR(LOG_TAG, "failed to calloc for volume data");
-       status = -ENOMEM;
-       goto exit;
-    }
-
     /* Allow caching of stream volume as part of mVolumeData
      * till the stream_start is not done or if sound card is offline.
      */
-    ar_mem_cpy(mVolumeData, volSize, volume, volSize);
+    status = cacheVolumeData(volume);
+    if (status) {
+       PAL_ERR(LOG_TAG, "failed to cache volume data");
+       goto exit;
+    }
     for (int32_t i = 0; i < (mVolumeData->no_of_volpair); i++) {
         PAL_VERBOSE(LOG_TAG, "Volume payload mask:%x vol:%f",
                (mVolumeData->volume_pair[i].channel_mask), (mVolumeData->volume_pair[i].vol));
@@ -804,13 +794,8 @@ int32_t StreamCompress::setVolume(struct pal_volume_data *volume)
                     vol_set_param_info.streams_.end(), mStreamAttr->type) !=
                     vol_set_param_info.streams_.end());
         if (isStreamAvail && vol_set_param_info.isVolumeUsingSetParam) {
-            uint8_t *volPayload = new uint8_t[sizeof(pal_param_payload) + volSize]();
-            pal_param_payload *pld = (pal_param_payload *)volPayload;
-            pld->payload_size = sizeof(struct pal_volume_data);
-            memcpy(pld->payload, mVolumeData, volSize);
             status = session->setParameters(this, TAG_STREAM_VOLUME,
-                    PAL_PARAM_ID_VOLUME_USING_SET_PARAM, (void *)pld);
-            delete[] volPayload;
+                    PAL_PARAM_ID_VOLUME_USING_SET_PARAM, (void *)getVolumeParamPayload());
         } else {
             status = session->setConfig(this, CALIBRATION, TAG_STREAM_VOLUME);
         }
@@ -853,7 +838,7 @@ int32_t StreamCompress::mute(bool state)
 int32_t StreamCompress::pause_l()
 {
     int32_t status = 0;
-    std::unique_lock<std::mutex> pauseLock(pauseMutex);
+    uint32_t rampCount = 0;
 
     //AF will try to pause the stream during SSR.
     if (rm->cardState == CARD_STATUS_OFFLINE) {
@@ -869,16 +854,15 @@ int32_t StreamCompress::pause_l()
     if (isPaused) {
         PAL_INFO(LOG_TAG, "Stream is already paused");
     } else {
+        rampCount = armRampWait();
         status = session->setConfig(this, MODULE, PAUSE_TAG);
         if (0 != status) {
             PAL_ERR(LOG_TAG,"session setConfig for pause failed with status %d",status);
             goto exit;
         }
         PAL_DBG(LOG_TAG, "Waiting for Pause to complete");
-        if (session->isPauseRegistrationDone)
-            cvPause.wait_for(pauseLock, std::chrono::microseconds(VOLUME_RAMP_PERIOD));
-        else
-            usleep(VOLUME_RAMP_PERIOD);
+        waitForRamp(rampCount, rm->getVolumeRampPeriod(),
+                session->isPauseRegistrationDone);
         isPaused = true;
         currentState = STREAM_PAUSED;
         PAL_VERBOSE(LOG_TAG,"session pause successful, state %d", currentState);
@@ -328,6 +328,10 @@ int32_t StreamInCall::stop()
     PAL_DBG(LOG_TAG, "Enter. session handle - %pK mStreamAttr->direction - %d state %d",
                 session, mStreamAttr->direction, currentState);
 
+    /* ssrDownHandler() stops with the cached state set, keep the timeline then */
+    if (cachedState == STREAM_IDLE || currentState == STREAM_IDLE)
+        resetTimeline();
+
     if (currentState == STREAM_STARTED || currentState == STREAM_PAUSED) {
         switch (mStreamAttr->direction) {
         case PAL_AUDIO_OUTPUT:
@@ -422,7 +426,6 @@ exit:
 int32_t StreamInCall::setVolume(struct pal_volume_data *volume)
 {
     int32_t status = 0;
-    uint8_t volSize = 0;
 
     PAL_DBG(LOG_TAG, "Enter. session handle - %pK", session);
     if (!volume || (volume->no_of_volpair == 0)) {
@@ -431,24 +434,14 @@ int32_t StreamInCall::setVolume(struct pal_volume_data *volume)
        goto exit;
     }
 
-    // if already allocated free and reallocate
-    if (mVolumeData) {
-        free(mVolumeData);
-        mVolumeData = NULL;
-    }
-
-    volSize = sizeof(uint32_t) + (sizeof(struct pal_channel_vol_kv) * (volume->no_of_volpair));
-    mVolumeData = (struct pal_volume_data *)calloc(1, volSize);
-    if (!mVolumeData) {
-        status = -ENOMEM;
-        PAL_ERR(LOG_TAG, "failed to calloc for volume data");
-        goto exit;
-    }
-
     /* Allow caching of stream volume as part of mVolumeData
      * till the pcm_open is not done or if sound card is offline.
      */
-    ar_mem_cpy(mVolumeData, volSize, volume, volSize);
+    status = cacheVolumeData(volume);
+    if (status) {
+        PAL_ERR(LOG_TAG, "failed to cache volume data");
+        goto exit;
+    }
     for (int32_t i=0; i < (mVolumeData->no_of_volpair); i++) {
         PAL_INFO(LOG_TAG, "Volume payload mask:%x vol:%f",
                       (mVolumeData->volume_pair[i].channel_mask), (mVolumeData->volume_pair[i].vol));
@@ -482,6 +475,7 @@ int32_t  StreamInCall::read(struct pal_buffer* buf)
 {
     int32_t status = 0;
     int32_t size;
+    uint64_t deadline = 0;
     PAL_VERBOSE(LOG_TAG, "Enter. session handle - %pK, state %d",
             session, currentState);
 
@@ -502,13 +496,15 @@ int32_t  StreamInCall::read(struct pal_buffer* buf)
         }
         size = buf->size;
         memset(buf->buffer, 0, size);
-        usleep((uint64_t)size * 1000000 / streamSize / sampleRate);
+        deadline = consumeVirtualSink(size, streamSize, sampleRate);
         PAL_DBG(LOG_TAG, "Sound card offline, dropped buffer size - %d", size);
-        status = size;
-        goto exit;
+        mStreamMutex.unlock();
+        waitVirtualSink(deadline);
+        return size;
     }
 
     if (currentState == STREAM_STARTED) {
+        leaveVirtualSink();
         status = session->read(this, SHMEM_ENDPOINT, buf, &size);
         if (0 != status) {
             PAL_ERR(LOG_TAG, "session read is failed with status %d", status);
@@ -552,6 +548,7 @@ int32_t  StreamInCall::write(struct pal_buffer* buf)
     uint32_t byteWidth = 0;
     uint32_t sampleRate = 0;
     uint32_t channelCount = 0;
+    uint64_t deadline = 0;
 
     PAL_VERBOSE(LOG_TAG, "Enter. session handle - %pK, state %d",
             session, currentState);
@@ -571,14 +568,16 @@ int32_t  StreamInCall::write(struct pal_buffer* buf)
             return -EINVAL;
         }
         size = buf->size;
-        usleep((uint64_t)size * 1000000 / frameSize / sampleRate);
+        deadline = consumeVirtualSink(size, frameSize, sampleRate);
         PAL_DBG(LOG_TAG, "dropped buffer size - %d", size);
         mStreamMutex.unlock();
+        waitVirtualSink(deadline);
         PAL_VERBOSE(LOG_TAG, "Exit size: %d", size);
         return size;
     }
 
     if (currentState == STREAM_STARTED) {
+        leaveVirtualSink();
         status = session->write(this, SHMEM_ENDPOINT, buf, &size, 0);
         mStreamMutex.unlock();
         if (0 != status) {
@@ -693,7 +692,7 @@ int32_t StreamInCall::mute(bool state)
 int32_t StreamInCall::pause_l()
 {
     int32_t status = 0;
-    std::unique_lock<std::mutex> pauseLock(pauseMutex);
+    uint32_t rampCount = 0;
     PAL_DBG(LOG_TAG, "Enter. session handle - %pK", session);
     if (rm->cardState == CARD_STATUS_OFFLINE) {
         cachedState = STREAM_PAUSED;
@@ -702,6 +701,7 @@ int32_t StreamInCall::pause_l()
         goto exit;
     }
 
+    rampCount = armRampWait();
     status = session->setConfig(this, MODULE, PAUSE_TAG);
     if (0 != status) {
         PAL_ERR(LOG_TAG, "session setConfig for pause failed with status %d",
@@ -709,10 +709,8 @@ int32_t StreamInCall::pause_l()
         goto exit;
     }
     PAL_DBG(LOG_TAG, "Waiting for Pause to complete");
-    if (session->isPauseRegistrationDone)
-        pauseCV.wait_for(pauseLock, std::chrono::microseconds(VOLUME_RAMP_PERIOD));
-    else
-        usleep(VOLUME_RAMP_PERIOD);
+    waitForRamp(rampCount, rm->getVolumeRampPeriod(),
+            session->isPauseRegistrationDone);
     isPaused = true;
     currentState = STREAM_PAUSED;
     PAL_DBG(LOG_TAG, "Exit. session setConfig successful");
@@ -422,6 +422,119 @@ exit :
     return status;
 }
 
+/*
+ * Queued buffers come back one by one through the client callback, the
+ * session always installs its own so only the client's tells if anyone
+ * listens. Called with mStreamMutex held.
+ */
+bool StreamNonTunnel::isQueueable()
+{
+    if (!mStreamAttr || !(mStreamAttr->flags & PAL_STREAM_FLAG_EXTERN_MEM) ||
+        !streamCb) {
+        PAL_ERR(LOG_TAG, "queued buffers need extern mem and a callback, flags 0x%x",
+                mStreamAttr ? mStreamAttr->flags : 0);
+        return false;
+    }
+    return true;
+}
+
+int32_t StreamNonTunnel::readBuffers(struct pal_buffer *bufs, uint32_t count)
+{
+    int32_t status = 0;
+    uint32_t queued = 0;
+
+    PAL_DBG(LOG_TAG, "Enter. session handle - %pK, state %d, count %u",
+            session, currentState, count);
+
+    mStreamMutex.lock();
+    if ((rm->cardState == CARD_STATUS_OFFLINE) || ssrInNTMode == true) {
+        PAL_ERR(LOG_TAG, "Sound card offline currentState %d",
+                currentState);
+        status = -ENETRESET;
+        goto exit;
+    }
+
+    if (currentState != STREAM_STARTED) {
+        PAL_ERR(LOG_TAG, "Stream not started yet, state %d", currentState);
+        status = -EINVAL;
+        goto exit;
+    }
+
+    if (!isQueueable()) {
+        status = -EINVAL;
+        goto exit;
+    }
+
+    status = session->readBuffers(this, bufs, count, &queued);
+    if (0 != status) {
+        PAL_ERR(LOG_TAG, "session read buffers failed with status %d", status);
+        if (status == -ENETRESET &&
+            rm->cardState != CARD_STATUS_OFFLINE) {
+            PAL_ERR(LOG_TAG, "Sound card offline, informing RM");
+            rm->ssrHandler(CARD_STATUS_OFFLINE);
+        }
+        goto exit;
+    }
+    mStreamMutex.unlock();
+    PAL_DBG(LOG_TAG, "Exit. queued %u buffers", queued);
+    return queued;
+exit:
+    mStreamMutex.unlock();
+    PAL_DBG(LOG_TAG, "session read buffers failed status %d", status);
+    return status;
+}
+
+int32_t StreamNonTunnel::writeBuffers(struct pal_buffer *bufs, uint32_t count)
+{
+    int32_t status = 0;
+    uint32_t queued = 0;
+
+    PAL_DBG(LOG_TAG, "Enter. session handle - %pK, state %d, count %u",
+            session, currentState, count);
+
+    mStreamMutex.lock();
+    if ((rm->cardState == CARD_STATUS_OFFLINE)
+            || ssrInNTMode == true) {
+        PAL_DBG(LOG_TAG, "sound card offline dropped %u buffers", count);
+        mStreamMutex.unlock();
+        return -ENETRESET;
+    }
+    if (!isQueueable()) {
+        mStreamMutex.unlock();
+        return -EINVAL;
+    }
+    mStreamMutex.unlock();
+
+    //we should allow writes to go through in Start/Pause state as well.
+    if ((currentState != STREAM_STARTED) &&
+        (currentState != STREAM_PAUSED)) {
+        PAL_ERR(LOG_TAG, "Stream not started yet, state %d", currentState);
+        if (currentState == STREAM_STOPPED)
+            status = -EIO;
+        else
+            status = -EINVAL;
+        goto exit;
+    }
+
+    status = session->writeBuffers(this, bufs, count, &queued);
+    if (0 != status) {
+        PAL_ERR(LOG_TAG, "session write buffers failed with status %d", status);
+        /* ENETRESET is the error code returned by AGM during SSR */
+        if (status == -ENETRESET &&
+            rm->cardState != CARD_STATUS_OFFLINE) {
+            PAL_ERR(LOG_TAG, "Sound card offline, informing RM");
+            rm->ssrHandler(CARD_STATUS_OFFLINE);
+        }
+        goto exit;
+    }
+    PAL_DBG(LOG_TAG, "Exit. queued %u buffers", queued);
+    return queued;
+
+exit:
+    PAL_DBG(LOG_TAG, "session write buffers failed status %d", status);
+    return status;
+}
+
 int32_t  StreamNonTunnel::registerCallBack(pal_stream_callback cb, uint64_t cookie)
 {
     streamCb = cb;
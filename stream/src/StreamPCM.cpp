@@ -56,6 +56,9 @@ StreamPCM::StreamPCM(const struct pal_stream_attributes *sattr, struct pal_devic
 
     session = NULL;
     mGainLevel = -1;
+    streamCb = NULL;
+    cookie = 0;
+    mXrunRecovery = rm->xrunRecoveryDefault;
     std::shared_ptr<Device> dev = nullptr;
     mStreamAttr = (struct pal_stream_attributes *)nullptr;
     inBufSize = BUF_SIZE_CAPTURE;
@@ -325,6 +328,8 @@ int32_t  StreamPCM::close()
 
 StreamPCM::~StreamPCM()
 {
+    /* a soft pause callback still running uses the stream */
+    rm->waitMixerEventCallbacks((uint64_t)this);
     cachedState = STREAM_IDLE;
 
     rm->resetStreamInstanceID(this);
@@ -631,6 +636,12 @@ int32_t StreamPCM::stop()
     PAL_DBG(LOG_TAG, "Enter. session handle - %pK mStreamAttr->direction - %d state %d",
                 session, mStreamAttr->direction, currentState);
 
+    /* ssrDownHandler() stops with the cached state set, keep the timeline then */
+    if (cachedState == STREAM_IDLE || currentState == STREAM_IDLE)
+        resetTimeline();
+    if (cachedState == STREAM_IDLE && currentState == STREAM_STARTED)
+        endBufferPolicySession();
+
     if (currentState == STREAM_STARTED || currentState == STREAM_PAUSED) {
         mStreamMutex.unlock();
         rm->lockActiveStream();
@@ -793,7 +804,6 @@ int32_t StreamPCM::setVolume(struct pal_volume_data *volume)
 {
     int32_t status = 0;
     struct volume_set_param_info vol_set_param_info;
-    uint8_t volSize = 0;
 
     PAL_DBG(LOG_TAG, "Enter. session handle - %pK", session);
     if (!volume || (volume->no_of_volpair == 0)) {
@@ -802,24 +812,14 @@ int32_t StreamPCM::setVolume(struct pal_volume_data *volume)
        goto exit;
     }
 
-    // if already allocated free and reallocate
-    if (mVolumeData) {
-        free(mVolumeData);
-        mVolumeData = NULL;
-    }
-
-    volSize = sizeof(uint32_t) + (sizeof(struct pal_channel_vol_kv) * (volume->no_of_volpair));
-    mVolumeData = (struct pal_volume_data *)calloc(1, volSize);
-    if (!mVolumeData) {
-        status = -ENOMEM;
-        PAL_ERR(LOG_TAG, "failed to calloc for volume data");
-        goto exit;
-    }
-
     /* Allow caching of stream volume as part of mVolumeData
      * till the stream_start is not done or if sound card is offline.
      */
-    ar_mem_cpy(mVolumeData, volSize, volume, volSize);
+    status = cacheVolumeData(volume);
+    if (status) {
+        PAL_ERR(LOG_TAG, "failed to cache volume data");
+        goto exit;
+    }
     for (int32_t i=0; i < (mVolumeData->no_of_volpair); i++) {
         PAL_INFO(LOG_TAG, "Volume payload mask:%x vol:%f",
                       (mVolumeData->volume_pair[i].channel_mask), (mVolumeData->volume_pair[i].vol));
@@ -838,13 +838,8 @@ int32_t StreamPCM::setVolume(struct pal_volume_data *volume)
                     vol_set_param_info.streams_.end(), mStreamAttr->type) !=
                     vol_set_param_info.streams_.end());
         if (isStreamAvail && vol_set_param_info.isVolumeUsingSetParam) {
-            uint8_t *volPayload = new uint8_t[sizeof(pal_param_payload) + volSize]();
-            pal_param_payload *pld = (pal_param_payload *)volPayload;
-            pld->payload_size = sizeof(struct pal_volume_data);
-            memcpy(pld->payload, mVolumeData, volSize);
             status = session->setParameters(this, TAG_STREAM_VOLUME,
-                    PAL_PARAM_ID_VOLUME_USING_SET_PARAM, (void *)pld);
-            delete[] volPayload;
+                    PAL_PARAM_ID_VOLUME_USING_SET_PARAM, (void *)getVolumeParamPayload());
         } else {
             status = session->setConfig(this, CALIBRATION, TAG_STREAM_VOLUME);
         }
@@ -868,6 +863,7 @@ int32_t  StreamPCM::read(struct pal_buffer* buf)
 {
     int32_t status = 0;
     int32_t size;
+    uint64_t deadline = 0;
     PAL_VERBOSE(LOG_TAG, "Enter. session handle - %pK, state %d",
             session, currentState);
 
@@ -888,13 +884,15 @@ int32_t  StreamPCM::read(struct pal_buffer* buf)
         }
         size = buf->size;
         memset(buf->buffer, 0, size);
-        usleep((uint64_t)size * 1000000 / streamSize / sampleRate);
+        deadline = consumeVirtualSink(size, streamSize, sampleRate);
         PAL_DBG(LOG_TAG, "Sound card offline, dropped buffer size - %d", size);
-        status = size;
-        goto exit;
+        mStreamMutex.unlock();
+        waitVirtualSink(deadline);
+        return size;
     }
 
     if (currentState == STREAM_STARTED) {
+        leaveVirtualSink();
         status = session->read(this, SHMEM_ENDPOINT, buf, &size);
         if (0 != status) {
             PAL_ERR(LOG_TAG, "session read is failed with status %d", status);
@@ -921,6 +919,7 @@ int32_t  StreamPCM::read(struct pal_buffer* buf)
         goto exit;
     }
     mStreamMutex.unlock();
+    notifyXrun();
     PAL_VERBOSE(LOG_TAG, "Exit. session read successful size - %d", size);
     return size;
 exit :
@@ -937,6 +936,7 @@ int32_t StreamPCM::write(struct pal_buffer* buf)
     uint32_t byteWidth = 0;
     uint32_t sampleRate = 0;
     uint32_t channelCount = 0;
+    uint64_t deadline = 0;
 
     PAL_VERBOSE(LOG_TAG, "Enter. session handle - %pK, state %d",
             session, currentState);
@@ -958,9 +958,10 @@ int32_t StreamPCM::write(struct pal_buffer* buf)
             goto exit;
         }
         size = buf->size;
-        usleep((uint64_t)size * 1000000 / frameSize / sampleRate);
+        deadline = consumeVirtualSink(size, frameSize, sampleRate);
         PAL_DBG(LOG_TAG, "dropped buffer size - %d", size);
         mStreamMutex.unlock();
+        waitVirtualSink(deadline);
         PAL_VERBOSE(LOG_TAG, "Exit size: %d", size);
         return size;
     }
@@ -968,8 +969,10 @@ int32_t StreamPCM::write(struct pal_buffer* buf)
     // we should allow writes to go through in Start/Pause state as well.
     if ((currentState == STREAM_STARTED) ||
         (currentState == STREAM_PAUSED) ) {
+        leaveVirtualSink();
         status = session->write(this, SHMEM_ENDPOINT, buf, &size, 0);
         mStreamMutex.unlock();
+        notifyXrun();
         if (0 != status) {
             PAL_ERR(LOG_TAG, "session write is failed with status %d", status);
 
@@ -1018,18 +1021,30 @@ exit:
     return status;
 }
 
-int32_t  StreamPCM::registerCallBack(pal_stream_callback /*cb*/, uint64_t /*cookie*/)
+int32_t  StreamPCM::registerCallBack(pal_stream_callback cb, uint64_t cookie)
 {
+    streamCb = cb;
+    this->cookie = cookie;
     return 0;
 }
 
-int32_t  StreamPCM::getCallBack(pal_stream_callback * /*cb*/)
+int32_t  StreamPCM::getCallBack(pal_stream_callback *cb)
 {
+    if (!cb)
+        return -EINVAL;
+
+    *cb = streamCb;
     return 0;
 }
 
-int32_t StreamPCM::getParameters(uint32_t /*param_id*/, void ** /*payload*/)
+int32_t StreamPCM::getParameters(uint32_t param_id, void **payload)
 {
+    if (param_id == PAL_PARAM_ID_XRUN_STATS) {
+        if (!payload)
+            return -EINVAL;
+        return getXrunStats((pal_param_payload **)payload);
+    }
+
     return 0;
 }
 
@@ -1097,11 +1112,11 @@ int32_t  StreamPCM::setParameters(uint32_t param_id, void *payload)
                 if (setConfigStatus) {
                     PAL_INFO(LOG_TAG, "DevicePP Mute failed");
                 }
-                usleep(MUTE_RAMP_PERIOD); // Wait for Mute ramp down to happen
+                usleep(rm->getMuteRampPeriod()); // Wait for Mute ramp down to happen
                 status = session->setParameters(this, 0,
                                                 PAL_PARAM_ID_DEVICE_ROTATION,
                                                 payload);
-                usleep(MUTE_RAMP_PERIOD); // Wait for channel swap to take affect
+                usleep(rm->getMuteRampPeriod()); // Wait for channel swap to take affect
                 setConfigStatus = session->setConfig(this, MODULE, DEVICEPP_UNMUTE);
                 if (setConfigStatus) {
                     PAL_INFO(LOG_TAG, "DevicePP Unmute failed");
@@ -1144,6 +1159,9 @@ int32_t  StreamPCM::setParameters(uint32_t param_id, void *payload)
                        status);
             break;
         }
+        case PAL_PARAM_ID_XRUN_RECOVERY:
+            status = setXrunRecovery((pal_param_payload *)payload);
+            break;
         default:
             PAL_ERR(LOG_TAG, "Unsupported param id %u", param_id);
             status = -EINVAL;
@@ -1180,7 +1198,7 @@ int32_t StreamPCM::mute(bool state)
 int32_t StreamPCM::pause_l()
 {
     int32_t status = 0;
-    std::unique_lock<std::mutex> pauseLock(pauseMutex);
+    uint32_t rampCount = 0;
     PAL_DBG(LOG_TAG, "Enter. session handle - %pK", session);
     if (rm->cardState == CARD_STATUS_OFFLINE) {
         cachedState = STREAM_PAUSED;
@@ -1192,6 +1210,7 @@ int32_t StreamPCM::pause_l()
     if (isPaused) {
         PAL_INFO(LOG_TAG, "Stream is already paused");
     } else {
+        rampCount = armRampWait();
         status = session->setConfig(this, MODULE, PAUSE_TAG);
         if (0 != status) {
            PAL_ERR(LOG_TAG, "session setConfig for pause failed with status %d",
@@ -1199,10 +1218,8 @@ int32_t StreamPCM::pause_l()
            goto exit;
         }
         PAL_DBG(LOG_TAG, "Waiting for Pause to complete");
-        if (session->isPauseRegistrationDone)
-            pauseCV.wait_for(pauseLock, std::chrono::microseconds(VOLUME_RAMP_PERIOD));
-        else
-            usleep(VOLUME_RAMP_PERIOD);
+        waitForRamp(rampCount, rm->getVolumeRampPeriod(),
+                session->isPauseRegistrationDone);
         isPaused = true;
         currentState = STREAM_PAUSED;
         PAL_DBG(LOG_TAG, "session setConfig successful");
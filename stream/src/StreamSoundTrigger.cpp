@@ -71,6 +71,7 @@
 #include "ResourceManager.h"
 #include "Device.h"
 #include "kvh2xml.h"
+#include "SecondStageScheduler.h"
 
 // TODO: find another way to print debug logs by default
 #define ST_DBG_LOGS
@@ -96,6 +97,7 @@ StreamSoundTrigger::StreamSoundTrigger(struct pal_stream_attributes *sattr,
     int32_t enable_concurrency_count = 0;
     int32_t disable_concurrency_count = 0;
     reader_ = nullptr;
+    kw_window_ = nullptr;
     detection_state_ = ENGINE_IDLE;
     notification_state_ = ENGINE_IDLE;
     inBufSize = BUF_SIZE_CAPTURE;
@@ -421,6 +423,10 @@ int32_t StreamSoundTrigger::getParameters(uint32_t param_id, void **payload) {
     PAL_DBG(LOG_TAG, "Enter, get parameter %u", param_id);
     if (param_id == PAL_PARAM_ID_STREAM_ATTRIBUTES) {
         pal_payload = (pal_param_payload *)(*payload);
+        if (!pal_payload) {
+            PAL_ERR(LOG_TAG, "Stream attributes need a caller payload");
+            return -EINVAL;
+        }
         if (pal_payload->payload_size != sizeof(struct pal_stream_attributes)) {
             PAL_ERR(LOG_TAG, "Invalid payload size %u", pal_payload->payload_size);
             return -EINVAL;
@@ -1768,6 +1774,10 @@ int32_t StreamSoundTrigger::SendRecognitionConfig(
         }
     }
 
+    /* size the shared keyword window once so detections do not allocate */
+    if (engines_.size() > 1)
+        kw_window_ = std::make_shared<KeywordWindow>(ring_buffer_size);
+
     // update custom config for 3rd party VA session
     if (!sm_cfg_->isQCVAUUID() && !sm_cfg_->isQCMDUUID()) {
         gsl_engine_->UpdateConfLevels(this, config, nullptr, 0);
@@ -2875,6 +2885,31 @@ exit:
 }
 
 void StreamSoundTrigger::SetDetectedToEngines(bool detected) {
+    std::shared_ptr<KeywordWindow> window = nullptr;
+
+    /*
+     * keyword data is read once and shared by all second stage engines,
+     * reuse the window storage unless an engine still holds it
+     */
+    if (detected) {
+        if (kw_window_ && kw_window_.use_count() == 1)
+            kw_window_->Reset();
+        else
+            kw_window_ = std::make_shared<KeywordWindow>();
+        window = kw_window_;
+    }
+
+    /*
+     * every engine reserves its range before any starts reading, a job
+     * already filling the window would refuse later reservations
+     */
+    if (window) {
+        for (auto& eng: engines_) {
+            if (eng->GetEngineId() != ST_SM_ID_SVA_F_STAGE_GMM)
+                eng->GetEngine()->SetKeywordWindow(window);
+        }
+    }
+
     for (auto& eng: engines_) {
         if (eng->GetEngineId() != ST_SM_ID_SVA_F_STAGE_GMM) {
             PAL_VERBOSE(LOG_TAG, "Notify detection event %d to engine %d",
@@ -3108,6 +3143,7 @@ int32_t StreamSoundTrigger::StIdle::ProcessEvent(
             if(st_stream_.gsl_engine_)
                 st_stream_.gsl_engine_->DetachStream(&st_stream_, true);
             st_stream_.reader_list_.clear();
+            st_stream_.kw_window_ = nullptr;
             if (st_stream_.sm_info_) {
                 delete st_stream_.sm_info_;
                 st_stream_.sm_info_ = nullptr;
@@ -3333,6 +3369,7 @@ int32_t StreamSoundTrigger::StLoaded::ProcessEvent(
             st_stream_.engines_.clear();
             st_stream_.gsl_engine_->DetachStream(&st_stream_, true);
             st_stream_.reader_list_.clear();
+            st_stream_.kw_window_ = nullptr;
             if (st_stream_.sm_info_) {
                 delete st_stream_.sm_info_;
                 st_stream_.sm_info_ = nullptr;
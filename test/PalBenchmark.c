@@ -0,0 +1,1059 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the
+ * disclaimer below) provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *     * Neither the name of Qualcomm Innovation Center, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+ * GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+ * HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * PalBenchmark: timing of PAL stream lifecycle, data path and control calls,
+ * plus the period wake-up rate each stream type is configured with.
+ *
+ * Meant to run against the simulated backend (--with-sim-backend) with the
+ * virtual clock, which makes numbers comparable between runs. Every result
+ * is one JSON object per line, after a "meta" line naming the device and
+ * build the run came from. With -b the run is compared against an earlier
+ * output of the same device and the exit code is non-zero on a regression.
+ * A run that cannot start (pal_init fails) or has nothing to compare
+ * against exits with 77, the automake skip code.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/utsname.h>
+#include <PalApi.h>
+#include <PalDefs.h>
+#ifdef PAL_SIM_BACKEND
+#include <PalSimBackend.h>
+#endif
+
+#define BENCH_MAX_RESULTS        128
+#define BENCH_MAX_NAME           64
+#define BENCH_DEFAULT_ITERATIONS 50
+#define BENCH_DEFAULT_TOLERANCE  10.0
+/* differences below this are noise whatever the relative change */
+#define BENCH_MIN_REGRESSION_US  5.0
+#define BENCH_SAMPLE_RATE        48000
+#define BENCH_CHANNELS           2
+#define BENCH_FRAME_BYTES        (BENCH_CHANNELS * 2)
+#define BENCH_BUF_COUNT          4
+#define BENCH_MAX_STREAMS        32
+/* non tunnel buffers kept in flight by the queued submission case */
+#define BENCH_NT_DEPTH           4
+#define BENCH_NT_PERIOD_MS       10
+#define BENCH_NT_TIMEOUT_MS      1000
+#define BENCH_MAX_ID             128
+/* automake convention for a run that cannot be made here */
+#define BENCH_SKIP               77
+#ifndef PAL_BENCH_BUILD_ID
+#define PAL_BENCH_BUILD_ID       "unknown"
+#endif
+
+struct bench_result {
+    char name[BENCH_MAX_NAME];
+    unsigned int samples;
+    unsigned int failures;
+    double mean;
+    double p50;
+    double p99;
+    double max;
+};
+
+struct bench_stream_cfg {
+    const char *name;
+    pal_stream_type_t type;
+    pal_stream_direction_t dir;
+    pal_device_id_t dev;
+};
+
+static const struct bench_stream_cfg bench_streams[] = {
+    {"low_latency", PAL_STREAM_LOW_LATENCY, PAL_AUDIO_OUTPUT, PAL_DEVICE_OUT_SPEAKER},
+    {"deep_buffer", PAL_STREAM_DEEP_BUFFER, PAL_AUDIO_OUTPUT, PAL_DEVICE_OUT_SPEAKER},
+    {"pcm_offload", PAL_STREAM_PCM_OFFLOAD, PAL_AUDIO_OUTPUT, PAL_DEVICE_OUT_SPEAKER},
+    {"generic", PAL_STREAM_GENERIC, PAL_AUDIO_OUTPUT, PAL_DEVICE_OUT_SPEAKER},
+    {"capture", PAL_STREAM_DEEP_BUFFER, PAL_AUDIO_INPUT, PAL_DEVICE_IN_HANDSET_MIC},
+    {"voip_tx", PAL_STREAM_VOIP_TX, PAL_AUDIO_INPUT, PAL_DEVICE_IN_HANDSET_MIC},
+};
+
+static const unsigned int bench_periods_ms[] = {1, 5, 10, 20};
+static const unsigned int bench_concurrency[] = {1, 2, 4, 8, 16, 32};
+
+static struct bench_result results[BENCH_MAX_RESULTS];
+static unsigned int num_results;
+static unsigned int iterations = BENCH_DEFAULT_ITERATIONS;
+static FILE *out;
+static char bench_device[BENCH_MAX_ID];
+static char bench_build[BENCH_MAX_ID];
+
+struct bench_nt_state {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    unsigned int done;
+};
+
+static struct bench_nt_state nt_state = {
+    PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0
+};
+
+static double now_us(clockid_t clk)
+{
+    struct timespec ts;
+
+    clock_gettime(clk, &ts);
+    return ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+static void bench_record_unit(const char *name, const char *unit, double *samples,
+                              unsigned int count, unsigned int failures)
+{
+    struct bench_result *r = NULL;
+    double sum = 0;
+    unsigned int i;
+
+    if (num_results >= BENCH_MAX_RESULTS)
+        return;
+
+    r = &results[num_results++];
+    memset(r, 0, sizeof(*r));
+    snprintf(r->name, sizeof(r->name), "%s", name);
+    r->samples = count;
+    r->failures = failures;
+    if (count) {
+        qsort(samples, count, sizeof(double), cmp_double);
+        for (i = 0; i < count; i++)
+            sum += samples[i];
+        r->mean = sum / count;
+        r->p50 = samples[count / 2];
+        r->p99 = samples[(count * 99) / 100];
+        r->max = samples[count - 1];
+    }
+
+    fprintf(out, "{\"name\":\"%s\",\"unit\":\"%s\",\"samples\":%u,\"failures\":%u,"
+            "\"mean\":%.2f,\"p50\":%.2f,\"p99\":%.2f,\"max\":%.2f}\n",
+            r->name, unit, r->samples, r->failures, r->mean, r->p50, r->p99, r->max);
+    fflush(out);
+}
+
+static void bench_record(const char *name, double *samples, unsigned int count,
+                         unsigned int failures)
+{
+    bench_record_unit(name, "us", samples, count, failures);
+}
+
+/* copies src into a JSON string value, quotes and control characters dropped */
+static void bench_copy_id(char *dst, const char *src)
+{
+    size_t n = 0;
+
+    for (; src && *src && n < BENCH_MAX_ID - 1; src++) {
+        if (*src != '"' && *src != '\\' && (unsigned char)*src >= ' ')
+            dst[n++] = *src;
+    }
+    dst[n] = '\0';
+}
+
+/*
+ * The device and build a run came from, PAL_BENCH_DEVICE/PAL_BENCH_BUILD
+ * when set (e.g. ro.product.device and ro.build.fingerprint on a target).
+ */
+static void bench_identify(void)
+{
+    struct utsname uts;
+    char host[BENCH_MAX_ID];
+
+    if (getenv("PAL_BENCH_DEVICE")) {
+        bench_copy_id(bench_device, getenv("PAL_BENCH_DEVICE"));
+    } else if (!uname(&uts)) {
+        snprintf(host, sizeof(host), "%s/%s", uts.nodename, uts.machine);
+        bench_copy_id(bench_device, host);
+    } else {
+        bench_copy_id(bench_device, "unknown");
+    }
+    bench_copy_id(bench_build, getenv("PAL_BENCH_BUILD") ?
+                  getenv("PAL_BENCH_BUILD") : PAL_BENCH_BUILD_ID);
+}
+
+static void bench_write_meta(bool realtime)
+{
+    fprintf(out, "{\"meta\":{\"device\":\"%s\",\"build\":\"%s\",\"clock\":\"%s\","
+            "\"iterations\":%u}}\n", bench_device, bench_build,
+            realtime ? "realtime" : "virtual", iterations);
+}
+
+static void bench_fill_media_config(struct pal_media_config *cfg)
+{
+    cfg->sample_rate = BENCH_SAMPLE_RATE;
+    cfg->bit_width = 16;
+    cfg->aud_fmt_id = PAL_AUDIO_FMT_PCM_S16_LE;
+    cfg->ch_info.channels = BENCH_CHANNELS;
+    cfg->ch_info.ch_map[0] = PAL_CHMAP_CHANNEL_FL;
+    cfg->ch_info.ch_map[1] = PAL_CHMAP_CHANNEL_FR;
+}
+
+static int32_t bench_callback(pal_stream_handle_t *stream_handle,
+                              uint32_t event_id, uint32_t *event_data,
+                              uint32_t event_size, uint64_t cookie)
+{
+    return 0;
+}
+
+static int bench_open(const struct bench_stream_cfg *cfg,
+                      pal_stream_handle_t **handle)
+{
+    struct pal_stream_attributes attr;
+    struct pal_device dev;
+
+    memset(&attr, 0, sizeof(attr));
+    memset(&dev, 0, sizeof(dev));
+    attr.type = cfg->type;
+    attr.direction = cfg->dir;
+    bench_fill_media_config(&attr.in_media_config);
+    bench_fill_media_config(&attr.out_media_config);
+    dev.id = cfg->dev;
+    bench_fill_media_config(&dev.config);
+
+    return pal_stream_open(&attr, 1, &dev, 0, NULL,
+                           (pal_stream_callback)bench_callback, 0, handle);
+}
+
+static int bench_set_period(pal_stream_handle_t *handle,
+                            const struct bench_stream_cfg *cfg,
+                            unsigned int period_ms)
+{
+    pal_buffer_config_t buf_cfg;
+
+    buf_cfg.buf_count = BENCH_BUF_COUNT;
+    buf_cfg.buf_size = BENCH_SAMPLE_RATE / 1000 * period_ms * BENCH_FRAME_BYTES;
+    buf_cfg.max_metadata_size = 0;
+
+    if (cfg->dir == PAL_AUDIO_INPUT)
+        return pal_stream_set_buffer_size(handle, &buf_cfg, NULL);
+
+    return pal_stream_set_buffer_size(handle, NULL, &buf_cfg);
+}
+
+static ssize_t bench_transfer(pal_stream_handle_t *handle,
+                              const struct bench_stream_cfg *cfg,
+                              uint8_t *data, size_t size)
+{
+    struct pal_buffer buf;
+
+    memset(&buf, 0, sizeof(buf));
+    buf.buffer = data;
+    buf.size = size;
+
+    if (cfg->dir == PAL_AUDIO_INPUT)
+        return pal_stream_read(handle, &buf);
+
+    return pal_stream_write(handle, &buf);
+}
+
+static int bench_init(void)
+{
+    double t = now_us(CLOCK_MONOTONIC);
+    int status = pal_init();
+
+    t = now_us(CLOCK_MONOTONIC) - t;
+    if (!status)
+        bench_record("pal_init", &t, 1, 0);
+    return status;
+}
+
+/* open/start/stop/close latency per stream type */
+static void bench_lifecycle(void)
+{
+    double *open_s = calloc(iterations, sizeof(double));
+    double *start_s = calloc(iterations, sizeof(double));
+    double *stop_s = calloc(iterations, sizeof(double));
+    double *close_s = calloc(iterations, sizeof(double));
+    pal_stream_handle_t *handle = NULL;
+    char name[BENCH_MAX_NAME];
+    unsigned int s, i, n, failures;
+    double t;
+
+    if (!open_s || !start_s || !stop_s || !close_s)
+        goto exit;
+
+    for (s = 0; s < sizeof(bench_streams) / sizeof(bench_streams[0]); s++) {
+        n = 0;
+        failures = 0;
+        for (i = 0; i < iterations; i++) {
+            t = now_us(CLOCK_MONOTONIC);
+            if (bench_open(&bench_streams[s], &handle)) {
+                failures++;
+                continue;
+            }
+            open_s[n] = now_us(CLOCK_MONOTONIC) - t;
+
+            t = now_us(CLOCK_MONOTONIC);
+            if (pal_stream_start(handle)) {
+                failures++;
+                pal_stream_close(handle);
+                continue;
+            }
+            start_s[n] = now_us(CLOCK_MONOTONIC) - t;
+
+            t = now_us(CLOCK_MONOTONIC);
+            pal_stream_stop(handle);
+            stop_s[n] = now_us(CLOCK_MONOTONIC) - t;
+
+            t = now_us(CLOCK_MONOTONIC);
+            pal_stream_close(handle);
+            close_s[n] = now_us(CLOCK_MONOTONIC) - t;
+            n++;
+        }
+        snprintf(name, sizeof(name), "open.%s", bench_streams[s].name);
+        bench_record(name, open_s, n, failures);
+        snprintf(name, sizeof(name), "start.%s", bench_streams[s].name);
+        bench_record(name, start_s, n, failures);
+        snprintf(name, sizeof(name), "stop.%s", bench_streams[s].name);
+        bench_record(name, stop_s, n, failures);
+        snprintf(name, sizeof(name), "close.%s", bench_streams[s].name);
+        bench_record(name, close_s, n, failures);
+    }
+
+exit:
+    free(open_s);
+    free(start_s);
+    free(stop_s);
+    free(close_s);
+}
+
+/* device switch on a running low latency stream, speaker <-> handset */
+static void bench_set_device(void)
+{
+    double *samples = calloc(iterations, sizeof(double));
+    pal_stream_handle_t *handle = NULL;
+    struct pal_device dev;
+    unsigned int i, n = 0, failures = 0;
+    double t;
+
+    if (!samples)
+        return;
+
+    if (bench_open(&bench_streams[0], &handle) || pal_stream_start(handle)) {
+        bench_record("set_device.switch", samples, 0, iterations);
+        goto exit;
+    }
+
+    memset(&dev, 0, sizeof(dev));
+    bench_fill_media_config(&dev.config);
+    for (i = 0; i < iterations; i++) {
+        dev.id = (i & 1) ? PAL_DEVICE_OUT_SPEAKER : PAL_DEVICE_OUT_HANDSET;
+        t = now_us(CLOCK_MONOTONIC);
+        if (pal_stream_set_device(handle, 1, &dev)) {
+            failures++;
+            continue;
+        }
+        samples[n++] = now_us(CLOCK_MONOTONIC) - t;
+    }
+    bench_record("set_device.switch", samples, n, failures);
+
+    pal_stream_stop(handle);
+    pal_stream_close(handle);
+exit:
+    free(samples);
+}
+
+/* low latency start/stop with a growing number of captures to route ec ref to */
+static void bench_ec_update(void)
+{
+    static const unsigned int captures[] = {1, 2, 4, 8};
+    double *samples = calloc(iterations, sizeof(double));
+    pal_stream_handle_t *tx[8];
+    pal_stream_handle_t *handle = NULL;
+    char name[BENCH_MAX_NAME];
+    unsigned int c, i, k, opened, n, failures;
+    double t;
+
+    if (!samples)
+        return;
+
+    for (c = 0; c < sizeof(captures) / sizeof(captures[0]); c++) {
+        n = 0;
+        failures = 0;
+        snprintf(name, sizeof(name), "ec_update.%u", captures[c]);
+        for (opened = 0; opened < captures[c]; opened++) {
+            if (bench_open(&bench_streams[5], &tx[opened]))
+                break;
+            if (pal_stream_start(tx[opened])) {
+                pal_stream_close(tx[opened]);
+                break;
+            }
+        }
+        if (opened < captures[c] || bench_open(&bench_streams[0], &handle)) {
+            bench_record(name, samples, 0, iterations);
+            goto close_tx;
+        }
+
+        for (i = 0; i < iterations; i++) {
+            t = now_us(CLOCK_MONOTONIC);
+            if (pal_stream_start(handle)) {
+                failures++;
+                continue;
+            }
+            pal_stream_stop(handle);
+            samples[n++] = now_us(CLOCK_MONOTONIC) - t;
+        }
+        bench_record(name, samples, n, failures);
+        pal_stream_close(handle);
+close_tx:
+        for (k = 0; k < opened; k++) {
+            pal_stream_stop(tx[k]);
+            pal_stream_close(tx[k]);
+        }
+    }
+    free(samples);
+}
+
+/* CPU spent per write/read call, excluding time blocked on the device */
+static void bench_data_path(const struct bench_stream_cfg *cfg, const char *op)
+{
+    double *samples = calloc(iterations, sizeof(double));
+    pal_stream_handle_t *handle = NULL;
+    uint8_t *data = NULL;
+    char name[BENCH_MAX_NAME];
+    unsigned int p, i, n, failures;
+    size_t size;
+    double t;
+
+    if (!samples)
+        return;
+
+    for (p = 0; p < sizeof(bench_periods_ms) / sizeof(bench_periods_ms[0]); p++) {
+        snprintf(name, sizeof(name), "%s_cpu.%ums", op, bench_periods_ms[p]);
+        n = 0;
+        failures = 0;
+        size = BENCH_SAMPLE_RATE / 1000 * bench_periods_ms[p] * BENCH_FRAME_BYTES;
+        data = calloc(1, size);
+        if (!data || bench_open(cfg, &handle)) {
+            bench_record(name, samples, 0, iterations);
+            free(data);
+            continue;
+        }
+        bench_set_period(handle, cfg, bench_periods_ms[p]);
+        if (pal_stream_start(handle)) {
+            bench_record(name, samples, 0, iterations);
+            goto close;
+        }
+
+        for (i = 0; i < iterations; i++) {
+            t = now_us(CLOCK_THREAD_CPUTIME_ID);
+            if (bench_transfer(handle, cfg, data, size) < 0) {
+                failures++;
+                continue;
+            }
+            samples[n++] = now_us(CLOCK_THREAD_CPUTIME_ID) - t;
+        }
+        bench_record(name, samples, n, failures);
+        pal_stream_stop(handle);
+close:
+        pal_stream_close(handle);
+        free(data);
+    }
+    free(samples);
+}
+
+struct bench_worker {
+    pthread_t thread;
+    const struct bench_stream_cfg *cfg;
+    pthread_barrier_t *barrier;
+    double *samples;
+    unsigned int count;
+    unsigned int failures;
+};
+
+static void *bench_worker_loop(void *arg)
+{
+    struct bench_worker *w = (struct bench_worker *)arg;
+    pal_stream_handle_t *handle = NULL;
+    size_t size = BENCH_SAMPLE_RATE / 100 * BENCH_FRAME_BYTES;
+    uint8_t *data = calloc(1, size);
+    bool opened = false;
+    unsigned int i;
+    double t;
+
+    if (data && !bench_open(w->cfg, &handle)) {
+        opened = true;
+        bench_set_period(handle, w->cfg, 10);
+        if (pal_stream_start(handle)) {
+            pal_stream_close(handle);
+            opened = false;
+        }
+    }
+    if (!opened)
+        w->failures++;
+
+    pthread_barrier_wait(w->barrier);
+    for (i = 0; opened && i < iterations; i++) {
+        t = now_us(CLOCK_THREAD_CPUTIME_ID);
+        if (bench_transfer(handle, w->cfg, data, size) < 0) {
+            w->failures++;
+            continue;
+        }
+        w->samples[w->count++] = now_us(CLOCK_THREAD_CPUTIME_ID) - t;
+    }
+
+    if (opened) {
+        pal_stream_stop(handle);
+        pal_stream_close(handle);
+    }
+    free(data);
+    return NULL;
+}
+
+/* per-call write cost with 1..32 playback streams running at once */
+static void bench_concurrency_scaling(void)
+{
+    static const unsigned int playback[] = {0, 1, 2, 3};
+    struct bench_worker workers[BENCH_MAX_STREAMS];
+    double *samples = calloc(BENCH_MAX_STREAMS * iterations, sizeof(double));
+    pthread_barrier_t barrier;
+    char name[BENCH_MAX_NAME];
+    unsigned int c, i, n, failures;
+
+    if (!samples)
+        return;
+
+    for (c = 0; c < sizeof(bench_concurrency) / sizeof(bench_concurrency[0]); c++) {
+        memset(workers, 0, sizeof(workers));
+        pthread_barrier_init(&barrier, NULL, bench_concurrency[c]);
+        for (i = 0; i < bench_concurrency[c]; i++) {
+            workers[i].cfg = &bench_streams[playback[i % 4]];
+            workers[i].barrier = &barrier;
+            workers[i].samples = samples + i * iterations;
+            pthread_create(&workers[i].thread, NULL, bench_worker_loop, &workers[i]);
+        }
+
+        n = 0;
+        failures = 0;
+        for (i = 0; i < bench_concurrency[c]; i++) {
+            pthread_join(workers[i].thread, NULL);
+            memmove(samples + n, workers[i].samples,
+                    workers[i].count * sizeof(double));
+            n += workers[i].count;
+            failures += workers[i].failures;
+        }
+        pthread_barrier_destroy(&barrier);
+
+        snprintf(name, sizeof(name), "concurrent_write_cpu.%u", bench_concurrency[c]);
+        bench_record(name, samples, n, failures);
+    }
+    free(samples);
+}
+
+static int32_t bench_nt_callback(pal_stream_handle_t *stream_handle,
+                                 uint32_t event_id, uint32_t *event_data,
+                                 uint32_t event_size, uint64_t cookie)
+{
+    if (event_id != PAL_STREAM_CBK_EVENT_WRITE_READY)
+        return 0;
+
+    pthread_mutex_lock(&nt_state.lock);
+    nt_state.done++;
+    pthread_cond_signal(&nt_state.cond);
+    pthread_mutex_unlock(&nt_state.lock);
+    return 0;
+}
+
+/* waits until target buffers came back, false on timeout */
+static bool bench_nt_wait(unsigned int target)
+{
+    struct timespec ts;
+    bool done = true;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += BENCH_NT_TIMEOUT_MS / 1000;
+    pthread_mutex_lock(&nt_state.lock);
+    while (nt_state.done < target && done)
+        done = !pthread_cond_timedwait(&nt_state.cond, &nt_state.lock, &ts);
+    done = nt_state.done >= target;
+    pthread_mutex_unlock(&nt_state.lock);
+    return done;
+}
+
+static int bench_nt_open(pal_stream_handle_t **handle)
+{
+    struct pal_stream_attributes attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PAL_STREAM_NON_TUNNEL;
+    attr.direction = PAL_AUDIO_INPUT_OUTPUT;
+    attr.flags = (pal_stream_flags_t)(PAL_STREAM_FLAG_NON_BLOCKING |
+                                      PAL_STREAM_FLAG_EXTERN_MEM);
+    bench_fill_media_config(&attr.in_media_config);
+    bench_fill_media_config(&attr.out_media_config);
+
+    return pal_stream_open(&attr, 0, NULL, 0, NULL,
+                           (pal_stream_callback)bench_nt_callback, 0, handle);
+}
+
+/*
+ * Wall time per buffer of a non tunnel write stream, one buffer per call
+ * waiting for each to come back (ping-pong) against BENCH_NT_DEPTH buffers
+ * kept queued through pal_stream_write_buffers. The simulated DSP idle
+ * time per buffer shows how much the device was starved in between.
+ */
+static void bench_nt_throughput(void)
+{
+    struct pal_buffer bufs[BENCH_NT_DEPTH];
+    pal_stream_handle_t *handle = NULL;
+    double *samples = calloc(iterations, sizeof(double));
+    double idle[2] = {0, 0};
+    const char *names[2] = {"nt_write.single", "nt_write.queued"};
+    size_t size = BENCH_SAMPLE_RATE / 1000 * BENCH_NT_PERIOD_MS * BENCH_FRAME_BYTES;
+    unsigned int mode, i, n, failures, queued, sent;
+    ssize_t ret;
+    double t;
+#ifdef PAL_SIM_BACKEND
+    struct pal_sim_stats stats;
+#endif
+
+    if (!samples)
+        return;
+
+    memset(bufs, 0, sizeof(bufs));
+    for (i = 0; i < BENCH_NT_DEPTH; i++) {
+        bufs[i].size = size;
+        bufs[i].alloc_info.alloc_handle = -1;
+        bufs[i].alloc_info.alloc_size = size;
+    }
+
+    for (mode = 0; mode < 2; mode++) {
+        n = 0;
+        failures = 0;
+        if (bench_nt_open(&handle)) {
+            bench_record(names[mode], samples, 0, iterations);
+            continue;
+        }
+        if (pal_stream_start(handle)) {
+            bench_record(names[mode], samples, 0, iterations);
+            pal_stream_close(handle);
+            continue;
+        }
+
+        pthread_mutex_lock(&nt_state.lock);
+        nt_state.done = 0;
+        pthread_mutex_unlock(&nt_state.lock);
+#ifdef PAL_SIM_BACKEND
+        pal_sim_reset_stats();
+#endif
+        sent = 0;
+        for (i = 0; i < iterations; i++) {
+            t = now_us(CLOCK_MONOTONIC);
+            if (mode == 0) {
+                ret = pal_stream_write(handle, &bufs[0]);
+                queued = ret < 0 ? 0 : 1;
+            } else {
+                /* top the queue back up to BENCH_NT_DEPTH */
+                queued = sent ? 1 : BENCH_NT_DEPTH;
+                ret = pal_stream_write_buffers(handle, bufs, queued);
+                queued = ret < 0 ? 0 : (unsigned int)ret;
+            }
+            sent += queued;
+            if (!queued || !bench_nt_wait(sent - (mode ? BENCH_NT_DEPTH - 1 : 0))) {
+                failures++;
+                break;
+            }
+            samples[n++] = now_us(CLOCK_MONOTONIC) - t;
+        }
+        bench_nt_wait(sent);
+#ifdef PAL_SIM_BACKEND
+        pal_sim_get_stats(&stats);
+        idle[mode] = stats.agm_buffers_done ?
+                     stats.agm_idle_ns / 1000.0 / stats.agm_buffers_done : 0;
+#endif
+        bench_record(names[mode], samples, n, failures);
+        pal_stream_stop(handle);
+        pal_stream_close(handle);
+    }
+
+#ifdef PAL_SIM_BACKEND
+    for (mode = 0; mode < 2; mode++) {
+        char name[BENCH_MAX_NAME];
+
+        snprintf(name, sizeof(name), "%s.dsp_idle", names[mode]);
+        bench_record(name, &idle[mode], 1, 0);
+    }
+#else
+    (void)idle;
+#endif
+    free(samples);
+}
+
+/*
+ * Period wake-ups per second each stream type ends up with when the client
+ * leaves buffer sizing to PAL, i.e. what the buffer policy picked.
+ */
+static void bench_wakeups(void)
+{
+    pal_stream_handle_t *handle = NULL;
+    char name[BENCH_MAX_NAME];
+    size_t in_size, out_size, size;
+    unsigned int s;
+    double rate;
+    int status;
+
+    for (s = 0; s < sizeof(bench_streams) / sizeof(bench_streams[0]); s++) {
+        snprintf(name, sizeof(name), "wakeups.%s", bench_streams[s].name);
+        if (bench_open(&bench_streams[s], &handle)) {
+            bench_record_unit(name, "wakeups_per_sec", &rate, 0, 1);
+            continue;
+        }
+
+        in_size = 0;
+        out_size = 0;
+        status = pal_stream_get_buffer_size(handle, &in_size, &out_size);
+        size = bench_streams[s].dir == PAL_AUDIO_INPUT ? in_size : out_size;
+        rate = size ? (double)BENCH_SAMPLE_RATE * BENCH_FRAME_BYTES / size : 0;
+        bench_record_unit(name, "wakeups_per_sec", &rate, (status || !size) ? 0 : 1,
+                          (status || !size) ? 1 : 0);
+        pal_stream_close(handle);
+    }
+}
+
+/* call cost of the control path on a running stream */
+static void bench_control(void)
+{
+    double *vol_s = calloc(iterations, sizeof(double));
+    double *mute_s = calloc(iterations, sizeof(double));
+    double *param_s = calloc(iterations, sizeof(double));
+    struct pal_volume_data *vol = NULL;
+    pal_param_payload *param = NULL;
+    pal_device_mute_t *dev_mute = NULL;
+    pal_stream_handle_t *handle = NULL;
+    unsigned int i, nv = 0, nm = 0, np = 0, fv = 0, fm = 0, fp = 0;
+    double t;
+
+    vol = calloc(1, sizeof(*vol) + sizeof(struct pal_channel_vol_kv));
+    param = calloc(1, sizeof(*param) + sizeof(pal_device_mute_t));
+    if (!vol_s || !mute_s || !param_s || !vol || !param)
+        goto exit;
+
+    if (bench_open(&bench_streams[0], &handle) || pal_stream_start(handle)) {
+        fv = fm = fp = iterations;
+        goto record;
+    }
+
+    vol->no_of_volpair = 1;
+    vol->volume_pair[0].channel_mask = 0x3;
+    param->payload_size = sizeof(pal_device_mute_t);
+    dev_mute = (pal_device_mute_t *)param->payload;
+    dev_mute->dir = PAL_AUDIO_OUTPUT;
+
+    for (i = 0; i < iterations; i++) {
+        vol->volume_pair[0].vol = (i & 1) ? 1.0f : 0.5f;
+        t = now_us(CLOCK_MONOTONIC);
+        if (pal_stream_set_volume(handle, vol))
+            fv++;
+        else
+            vol_s[nv++] = now_us(CLOCK_MONOTONIC) - t;
+
+        t = now_us(CLOCK_MONOTONIC);
+        if (pal_stream_set_mute(handle, !!(i & 1)))
+            fm++;
+        else
+            mute_s[nm++] = now_us(CLOCK_MONOTONIC) - t;
+
+        dev_mute->mute = !!(i & 1);
+        t = now_us(CLOCK_MONOTONIC);
+        if (pal_stream_set_param(handle, PAL_PARAM_ID_DEVICE_MUTE, param))
+            fp++;
+        else
+            param_s[np++] = now_us(CLOCK_MONOTONIC) - t;
+    }
+    pal_stream_stop(handle);
+    pal_stream_close(handle);
+
+record:
+    bench_record("set_volume", vol_s, nv, fv);
+    bench_record("set_mute", mute_s, nm, fm);
+    bench_record("set_param.device_mute", param_s, np, fp);
+exit:
+    free(vol);
+    free(param);
+    free(vol_s);
+    free(mute_s);
+    free(param_s);
+}
+
+/* position polling through the call against the shared position mirror */
+static void bench_position(void)
+{
+    double *call_s = calloc(iterations, sizeof(double));
+    double *mirror_s = calloc(iterations, sizeof(double));
+    const pal_position_mirror_t *mirror = NULL;
+    pal_position_mirror_t snap;
+    struct pal_session_time stime;
+    pal_stream_handle_t *handle = NULL;
+    uint8_t *data = NULL;
+    size_t in_size = 0, out_size = 0;
+    unsigned int i, nc = 0, nm = 0, fc = 0, fm = 0;
+    double t;
+
+    if (!call_s || !mirror_s)
+        goto exit;
+
+    if (bench_open(&bench_streams[0], &handle) ||
+        pal_stream_get_position_mirror(handle, &mirror) ||
+        pal_stream_start(handle) ||
+        pal_stream_get_buffer_size(handle, &in_size, &out_size) || !out_size) {
+        fc = fm = iterations;
+        goto record;
+    }
+
+    data = calloc(1, out_size);
+    for (i = 0; data && i < BENCH_BUF_COUNT; i++)
+        bench_transfer(handle, &bench_streams[0], data, out_size);
+
+    for (i = 0; i < iterations; i++) {
+        t = now_us(CLOCK_MONOTONIC);
+        if (pal_get_timestamp(handle, &stime))
+            fc++;
+        else
+            call_s[nc++] = now_us(CLOCK_MONOTONIC) - t;
+
+        t = now_us(CLOCK_MONOTONIC);
+        if (pal_position_mirror_read(mirror, &snap) || !snap.frames)
+            fm++;
+        else
+            mirror_s[nm++] = now_us(CLOCK_MONOTONIC) - t;
+    }
+    pal_stream_stop(handle);
+
+record:
+    if (handle)
+        pal_stream_close(handle);
+    bench_record("position.get_timestamp", call_s, nc, fc);
+    bench_record("position.mirror_read", mirror_s, nm, fm);
+exit:
+    free(data);
+    free(call_s);
+    free(mirror_s);
+}
+
+/*
+ * Compares p50 of every result against the same name in a previous run of
+ * the same device. Returns the number of regressions, or -BENCH_SKIP when
+ * the baseline has nothing this run can be compared with.
+ */
+static int bench_gate(const char *baseline, double tolerance)
+{
+    FILE *fp = fopen(baseline, "r");
+    char line[512];
+    char name[BENCH_MAX_NAME];
+    char device[BENCH_MAX_ID] = "";
+    char build[BENCH_MAX_ID] = "";
+    const char *field = NULL;
+    double base = 0;
+    unsigned int i, samples, budgets = 0;
+    int regressions = 0;
+
+    if (!fp) {
+        fprintf(stderr, "cannot open baseline %s: %s\n", baseline, strerror(errno));
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), fp)) {
+        if (!strncmp(line, "{\"meta\":", 8)) {
+            field = strstr(line, "\"device\":\"");
+            if (field)
+                sscanf(field, "\"device\":\"%127[^\"]\"", device);
+            field = strstr(line, "\"build\":\"");
+            if (field)
+                sscanf(field, "\"build\":\"%127[^\"]\"", build);
+            /* budgets only hold for the device they were measured on */
+            if (strcmp(device, bench_device)) {
+                fprintf(stderr, "baseline %s is from %s (%s), this is %s, "
+                        "gate skipped\n", baseline, device, build, bench_device);
+                fclose(fp);
+                return -BENCH_SKIP;
+            }
+            continue;
+        }
+        if (sscanf(line, "{\"name\":\"%63[^\"]\"", name) != 1)
+            continue;
+        /* an entry without samples was never measured, it is no budget */
+        field = strstr(line, "\"samples\":");
+        if (!field || sscanf(field, "\"samples\":%u", &samples) != 1 || !samples)
+            continue;
+        field = strstr(line, "\"p50\":");
+        if (!field || sscanf(field, "\"p50\":%lf", &base) != 1)
+            continue;
+        budgets++;
+
+        for (i = 0; i < num_results; i++) {
+            if (strcmp(results[i].name, name))
+                continue;
+            if (!results[i].samples) {
+                fprintf(stderr, "REGRESSION %s: no samples\n", name);
+                regressions++;
+            } else if (results[i].p50 > base * (1.0 + tolerance / 100.0) &&
+                       results[i].p50 - base > BENCH_MIN_REGRESSION_US) {
+                fprintf(stderr, "REGRESSION %s: p50 %.2f us, baseline %.2f us\n",
+                        name, results[i].p50, base);
+                regressions++;
+            }
+            break;
+        }
+        /* a case that silently stopped reporting must not pass the gate */
+        if (i == num_results) {
+            fprintf(stderr, "REGRESSION %s: not measured\n", name);
+            regressions++;
+        }
+    }
+    fclose(fp);
+
+    if (!device[0] || !budgets) {
+        fprintf(stderr, "baseline %s has no measured cases, regenerate it with "
+                "make benchmark-baseline on the reference device\n", baseline);
+        return -BENCH_SKIP;
+    }
+    return regressions;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stdout, "Usage: %s [-i iterations] [-o output] [-b baseline] "
+            "[-t tolerance_pct] [-r]\n"
+            "  -i  samples per measurement (default %d)\n"
+            "  -o  write JSON lines here instead of stdout, kept only when\n"
+            "      pal_init succeeds\n"
+            "  -b  fail when p50 regresses against this earlier output\n"
+            "  -t  allowed p50 regression in percent (default %.0f)\n"
+            "  -r  pace the simulated backend in real time\n",
+            prog, BENCH_DEFAULT_ITERATIONS, BENCH_DEFAULT_TOLERANCE);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *baseline = NULL;
+    const char *output = NULL;
+    char tmp[PATH_MAX];
+    double tolerance = BENCH_DEFAULT_TOLERANCE;
+    bool realtime = false;
+    int opt;
+    int status = 0;
+
+    while ((opt = getopt(argc, argv, "i:o:b:t:rh")) != -1) {
+        switch (opt) {
+        case 'i':
+            iterations = atoi(optarg);
+            break;
+        case 'o':
+            output = optarg;
+            break;
+        case 'b':
+            baseline = optarg;
+            break;
+        case 't':
+            tolerance = atof(optarg);
+            break;
+        case 'r':
+            realtime = true;
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : -EINVAL;
+        }
+    }
+    if (!iterations)
+        iterations = BENCH_DEFAULT_ITERATIONS;
+
+    /* a run that cannot start must not replace an earlier output */
+    if (output)
+        snprintf(tmp, sizeof(tmp), "%s.tmp", output);
+    out = output ? fopen(tmp, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "cannot open %s: %s\n", tmp, strerror(errno));
+        return -EINVAL;
+    }
+    bench_identify();
+    bench_write_meta(realtime);
+
+#ifdef PAL_SIM_BACKEND
+    pal_sim_set_clock_mode(realtime ? PAL_SIM_CLOCK_REALTIME : PAL_SIM_CLOCK_VIRTUAL);
+#else
+    (void)realtime;
+#endif
+
+    if (bench_init()) {
+        fprintf(stderr, "pal_init failed, benchmark skipped\n");
+        if (out != stdout) {
+            fclose(out);
+            unlink(tmp);
+        }
+        return BENCH_SKIP;
+    }
+    bench_lifecycle();
+    bench_set_device();
+    bench_ec_update();
+    bench_data_path(&bench_streams[0], "write");
+    bench_data_path(&bench_streams[4], "read");
+    bench_concurrency_scaling();
+    bench_nt_throughput();
+    bench_control();
+    bench_position();
+    bench_wakeups();
+    pal_deinit();
+
+    if (out != stdout) {
+        fclose(out);
+        if (rename(tmp, output)) {
+            fprintf(stderr, "cannot write %s: %s\n", output, strerror(errno));
+            return -EINVAL;
+        }
+    }
+
+    if (baseline) {
+        status = bench_gate(baseline, tolerance);
+        if (status == -BENCH_SKIP)
+            return BENCH_SKIP;
+        if (status > 0)
+            fprintf(stderr, "%d regression(s) against %s\n", status, baseline);
+    }
+    return status ? 1 : 0;
+}
@@ -0,0 +1,1225 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the
+ * disclaimer below) provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *     * Neither the name of Qualcomm Innovation Center, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+ * GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+ * HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * PalSimTest: functional checks of PAL internals whose effect the benchmark
+ * only sees as timing, e.g. cache reuse and counters. Built with
+ * --with-sim-backend and run by "make check"; every case prints one
+ * PASS/FAIL/SKIP line. Cases driving the PAL API are skipped when pal_init
+ * fails, e.g. without the platform XMLs.
+ */
+
+#define LOG_TAG "PAL: PalSimTest"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <errno.h>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+#include "PalApi.h"
+#include "PalCommon.h"
+#include "PayloadBuilder.h"
+#include "CalibrationCache.h"
+#include "EventDispatcher.h"
+#include "SecondStageScheduler.h"
+#include "DisplayPort.h"
+#include "USBAudio.h"
+#include "ResourceManager.h"
+#include "Stream.h"
+#include "PalSimBackend.h"
+#include <agm/agm_api.h>
+
+#define SIM_TEST_CHECK(cond)                                              \
+    do {                                                                  \
+        if (!(cond)) {                                                    \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __func__,        \
+                    __LINE__, #cond);                                     \
+            return -EINVAL;                                               \
+        }                                                                 \
+    } while (0)
+
+/* automake convention for a case that cannot run in this environment */
+#define SIM_TEST_SKIP 77
+#define SIM_TEST_WARMUP 2
+#define SIM_TEST_ITERATIONS 10
+
+struct sim_test {
+    const char *name;
+    int (*run)(void);
+};
+
+/* operator new calls made by the current thread */
+static thread_local uint64_t simTestNewCount;
+
+void *operator new(size_t size)
+{
+    void *p = malloc(size ? size : 1);
+
+    if (!p)
+        throw std::bad_alloc();
+    simTestNewCount++;
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+static int simInitStatus = -EAGAIN;
+
+/* cases driving the PAL API share one pal_init, skipped when it fails */
+static int sim_test_init(void)
+{
+    if (simInitStatus == -EAGAIN) {
+        simInitStatus = pal_init();
+        if (simInitStatus)
+            fprintf(stderr, "pal_init failed %d, PAL API cases skipped\n",
+                    simInitStatus);
+    }
+    return simInitStatus;
+}
+
+static void sim_test_media_config(struct pal_media_config *cfg)
+{
+    cfg->sample_rate = 48000;
+    cfg->bit_width = 16;
+    cfg->aud_fmt_id = PAL_AUDIO_FMT_PCM_S16_LE;
+    cfg->ch_info.channels = 2;
+    cfg->ch_info.ch_map[0] = PAL_CHMAP_CHANNEL_FL;
+    cfg->ch_info.ch_map[1] = PAL_CHMAP_CHANNEL_FR;
+}
+
+static int sim_test_open(pal_stream_type_t type, pal_stream_direction_t dir,
+                         pal_device_id_t id, pal_stream_handle_t **handle)
+{
+    struct pal_stream_attributes attr;
+    struct pal_device dev;
+
+    memset(&attr, 0, sizeof(attr));
+    memset(&dev, 0, sizeof(dev));
+    attr.type = type;
+    attr.direction = dir;
+    sim_test_media_config(&attr.in_media_config);
+    sim_test_media_config(&attr.out_media_config);
+    dev.id = id;
+    sim_test_media_config(&dev.config);
+
+    return pal_stream_open(&attr, 1, &dev, 0, NULL, NULL, 0, handle);
+}
+
+/* module the sim reports for the tag of sim_test_acdb_param */
+#define SIM_TEST_ACDB_MODULE 0x07001000
+
+/* one CKV, one param id and a two word param as sent by setParamTagACDB */
+static struct agm_acdb_param *sim_test_acdb_param(uint32_t value, size_t *size)
+{
+    struct agm_acdb_param *param = nullptr;
+    pal_key_value_pair_t *kv = nullptr;
+    pal_effect_custom_payload_t *custom = nullptr;
+    uint32_t blobSize = sizeof(pal_key_value_pair_t) +
+                        sizeof(pal_effect_custom_payload_t) + 2 * sizeof(uint32_t);
+
+    *size = sizeof(struct agm_acdb_param) + blobSize;
+    param = (struct agm_acdb_param *)calloc(1, *size);
+    if (!param)
+        return nullptr;
+
+    param->isTKV = PARAM_NONTKV;
+    param->tag = 0xC0000001;
+    param->num_kvs = 1;
+    param->blob_size = blobSize;
+    kv = (pal_key_value_pair_t *)param->blob;
+    kv->key = 0xA5000000;
+    kv->value = 1;
+    custom = (pal_effect_custom_payload_t *)(kv + 1);
+    custom->paramId = 0x08001000;
+    custom->data[0] = value;
+    custom->data[1] = ~value;
+
+    return param;
+}
+
+static int sim_test_acdb_key(struct agm_acdb_param *param, size_t size,
+                             calCacheKey *key)
+{
+    pal_key_value_pair_t *kv = (pal_key_value_pair_t *)param->blob;
+
+    key->miid = 0x4001;
+    key->graphKey.push_back(std::make_pair((int)param->isTKV, 0));
+    key->ckv.push_back(std::make_pair((int)kv->key, (int)kv->value));
+    key->setParam((uint8_t *)param, size);
+    return 0;
+}
+
+/* repeated ACDB parameter writes reuse the packed payload */
+static int test_cal_cache_acdb_param(void)
+{
+    std::shared_ptr<CalibrationCache> cache = CalibrationCache::getInstance();
+    std::shared_ptr<std::vector<uint8_t>> first = nullptr;
+    std::shared_ptr<std::vector<uint8_t>> payload = nullptr;
+    struct agm_acdb_param *param = nullptr;
+    struct agm_acdb_param *other = nullptr;
+    struct calCacheStats before, after;
+    calCacheKey key, otherKey;
+    PayloadBuilder builder;
+    unsigned int builds = 0;
+    size_t size = 0, otherSize = 0;
+    int status = -ENOMEM;
+
+    auto build = [&](struct agm_acdb_param *p) {
+        return [&, p](uint8_t **data, size_t *dataSize) -> int {
+            builds++;
+            return builder.payloadACDBParam(data, dataSize, (uint8_t *)p,
+                                            key.miid, 0);
+        };
+    };
+
+    param = sim_test_acdb_param(0x1234, &size);
+    other = sim_test_acdb_param(0x5678, &otherSize);
+    if (!param || !other)
+        goto exit;
+
+    sim_test_acdb_key(param, size, &key);
+    sim_test_acdb_key(other, otherSize, &otherKey);
+    cache->getStats(&before);
+
+    first = cache->getPayload(key, build(param), nullptr);
+    status = -EINVAL;
+    if (!first || builds != 1)
+        goto exit;
+
+    for (int i = 0; i < 10; i++) {
+        payload = cache->getPayload(key, build(param), nullptr);
+        if (!payload || *payload != *first)
+            goto exit;
+    }
+    if (builds != 1)
+        goto exit;
+
+    /* the packed payload does not depend on ACDB content */
+    cache->invalidate();
+    payload = cache->getPayload(key, build(param), nullptr);
+    if (!payload || builds != 1)
+        goto exit;
+
+    /* a different parameter value must not be served from the cache */
+    payload = cache->getPayload(otherKey, build(other), nullptr);
+    if (!payload || builds != 2 || *payload == *first)
+        goto exit;
+
+    cache->getStats(&after);
+    printf("cal_cache.acdb_param: %u builds, %llu rebuilds avoided\n", builds,
+           (unsigned long long)(after.hits - before.hits));
+    if (after.hits - before.hits != 11)
+        goto exit;
+    status = 0;
+
+exit:
+    free(param);
+    free(other);
+    return status;
+}
+
+/* writes param through the stream's session, counting the mixer writes */
+static int sim_test_acdb_write(Stream *stream, struct agm_acdb_param *param,
+                               size_t size, uint64_t *writes)
+{
+    pal_param_payload *payload = nullptr;
+    struct pal_sim_stats before, after;
+    int status;
+
+    payload = (pal_param_payload *)calloc(1, sizeof(*payload) + size);
+    if (!payload)
+        return -ENOMEM;
+    payload->payload_size = size;
+    memcpy(payload->payload, param, size);
+
+    pal_sim_get_stats(&before);
+    status = stream->rwACDBParameters(payload, 48000, true);
+    pal_sim_get_stats(&after);
+    *writes = after.mixer_set_calls - before.mixer_set_calls;
+    free(payload);
+    return status;
+}
+
+/*
+ * Writing the same ACDB parameter again skips the setParamTagACDB write,
+ * a different value is written.
+ */
+static int test_cal_cache_acdb_write(void)
+{
+    pal_stream_handle_t *handle = nullptr;
+    struct agm_acdb_param *param = nullptr;
+    struct agm_acdb_param *other = nullptr;
+    struct calCacheStats before, after;
+    Stream *stream = nullptr;
+    size_t size = 0, otherSize = 0;
+    uint64_t writes[3] = {0};
+    int status = -ENOMEM;
+
+    if (sim_test_init())
+        return SIM_TEST_SKIP;
+
+    param = sim_test_acdb_param(0x1234, &size);
+    other = sim_test_acdb_param(0x5678, &otherSize);
+    if (!param || !other)
+        goto exit;
+    pal_sim_add_tagged_module(param->tag, SIM_TEST_ACDB_MODULE);
+
+    status = sim_test_open(PAL_STREAM_LOW_LATENCY, PAL_AUDIO_OUTPUT,
+                           PAL_DEVICE_OUT_SPEAKER, &handle);
+    if (status)
+        goto exit;
+    status = pal_stream_start(handle);
+    if (status)
+        goto close;
+    stream = reinterpret_cast<Stream *>(handle);
+
+    CalibrationCache::getInstance()->getStats(&before);
+    status = sim_test_acdb_write(stream, param, size, &writes[0]);
+    if (!status)
+        status = sim_test_acdb_write(stream, param, size, &writes[1]);
+    if (!status)
+        status = sim_test_acdb_write(stream, other, otherSize, &writes[2]);
+    CalibrationCache::getInstance()->getStats(&after);
+    pal_stream_stop(handle);
+
+    printf("cal_cache.acdb_write: mixer writes %llu, repeated %llu, changed %llu\n",
+           (unsigned long long)writes[0], (unsigned long long)writes[1],
+           (unsigned long long)writes[2]);
+    if (!status && (writes[1] >= writes[0] || writes[2] != writes[0] ||
+                    after.skippedWrites - before.skippedWrites != 1))
+        status = -EINVAL;
+
+close:
+    pal_stream_close(handle);
+exit:
+    free(param);
+    free(other);
+    return status;
+}
+
+/*
+ * Payloads built and heap allocations made by payload builders per low
+ * latency start. Once the thread arenas are warm the count must stay flat
+ * and the arena must serve most payloads.
+ */
+static int test_payload_start_allocs(void)
+{
+    struct payloadAllocStats before, after;
+    pal_stream_handle_t *handle = nullptr;
+    uint32_t allocs[SIM_TEST_ITERATIONS];
+    uint32_t payloads[SIM_TEST_ITERATIONS];
+    int i;
+
+    if (sim_test_init())
+        return SIM_TEST_SKIP;
+
+    for (i = -SIM_TEST_WARMUP; i < SIM_TEST_ITERATIONS; i++) {
+        SIM_TEST_CHECK(!sim_test_open(PAL_STREAM_LOW_LATENCY, PAL_AUDIO_OUTPUT,
+                                      PAL_DEVICE_OUT_SPEAKER, &handle));
+        PayloadBuilder::getTotalAllocStats(&before);
+        if (pal_stream_start(handle)) {
+            pal_stream_close(handle);
+            SIM_TEST_CHECK(0);
+        }
+        PayloadBuilder::getTotalAllocStats(&after);
+        pal_stream_stop(handle);
+        pal_stream_close(handle);
+        if (i < 0)
+            continue;
+        allocs[i] = after.heapAllocs - before.heapAllocs;
+        payloads[i] = after.payloads - before.payloads;
+    }
+
+    printf("payload.start_allocs: %u payloads, %u heap allocations per start\n",
+           payloads[0], allocs[0]);
+    for (i = 0; i < SIM_TEST_ITERATIONS; i++) {
+        SIM_TEST_CHECK(allocs[i] <= allocs[0]);
+        SIM_TEST_CHECK(payloads[i] <= 1 || allocs[i] < payloads[i]);
+    }
+    return 0;
+}
+
+static int sim_test_xrun_stats(pal_stream_handle_t *handle,
+                               pal_param_xrun_stats_t *stats)
+{
+    pal_param_payload *payload = nullptr;
+    int status;
+
+    status = pal_stream_get_param(handle, PAL_PARAM_ID_XRUN_STATS, &payload);
+    if (status)
+        return status;
+    if (!payload || payload->payload_size != sizeof(*stats)) {
+        free(payload);
+        return -EINVAL;
+    }
+    memcpy(stats, payload->payload, sizeof(*stats));
+    free(payload);
+    return 0;
+}
+
+/*
+ * Starves a playback and a capture stream past their ring and checks that
+ * each xrun lands in its own counter only.
+ */
+static int test_xrun_counters(void)
+{
+    pal_stream_handle_t *handle = nullptr;
+    pal_param_xrun_stats_t stats;
+    size_t inSize = 0, outSize = 0;
+    void *buf = nullptr;
+    int status = 0;
+
+    if (sim_test_init())
+        return SIM_TEST_SKIP;
+
+    SIM_TEST_CHECK(!sim_test_open(PAL_STREAM_LOW_LATENCY, PAL_AUDIO_OUTPUT,
+                                  PAL_DEVICE_OUT_SPEAKER, &handle));
+    if (pal_stream_start(handle) ||
+        pal_stream_get_buffer_size(handle, &inSize, &outSize) || !outSize ||
+        !(buf = calloc(1, outSize))) {
+        status = -EINVAL;
+        goto close;
+    }
+    {
+        struct pal_buffer pb;
+
+        memset(&pb, 0, sizeof(pb));
+        pb.buffer = (uint8_t *)buf;
+        pb.size = outSize;
+        for (int i = 0; i < 8; i++)
+            pal_stream_write(handle, &pb);
+        usleep(500000);
+        pal_stream_write(handle, &pb);
+    }
+    status = sim_test_xrun_stats(handle, &stats);
+    if (!status && (stats.underruns < 1 || stats.overruns)) {
+        fprintf(stderr, "playback: %u underruns, %u overruns\n",
+                stats.underruns, stats.overruns);
+        status = -EINVAL;
+    }
+    free(buf);
+    buf = nullptr;
+close:
+    pal_stream_stop(handle);
+    pal_stream_close(handle);
+    SIM_TEST_CHECK(!status);
+
+    SIM_TEST_CHECK(!sim_test_open(PAL_STREAM_LOW_LATENCY, PAL_AUDIO_INPUT,
+                                  PAL_DEVICE_IN_HANDSET_MIC, &handle));
+    if (pal_stream_start(handle) ||
+        pal_stream_get_buffer_size(handle, &inSize, &outSize) || !inSize ||
+        !(buf = calloc(1, inSize))) {
+        status = -EINVAL;
+        goto close_in;
+    }
+    {
+        struct pal_buffer pb;
+
+        memset(&pb, 0, sizeof(pb));
+        pb.buffer = (uint8_t *)buf;
+        pb.size = inSize;
+        pal_stream_read(handle, &pb);
+        usleep(500000);
+        pal_stream_read(handle, &pb);
+    }
+    status = sim_test_xrun_stats(handle, &stats);
+    if (!status && (stats.overruns < 1 || stats.underruns)) {
+        fprintf(stderr, "capture: %u underruns, %u overruns\n",
+                stats.underruns, stats.overruns);
+        status = -EINVAL;
+    }
+    free(buf);
+close_in:
+    pal_stream_stop(handle);
+    pal_stream_close(handle);
+    SIM_TEST_CHECK(!status);
+
+    printf("xrun.counters: playback and capture xruns counted apart\n");
+    return 0;
+}
+
+struct sim_test_subscriber {
+    std::atomic<int> running;
+    std::atomic<int> calls;
+    std::atomic<bool> overlapped;
+    useconds_t delayUs;
+    /* taken by the callback, as an engine callback takes the engine lock */
+    std::mutex *lock;
+};
+
+static void sim_test_event_cb(uint64_t hdl, uint32_t event_id __unused,
+                              void *event_data __unused,
+                              uint32_t event_size __unused)
+{
+    struct sim_test_subscriber *sub = (struct sim_test_subscriber *)hdl;
+
+    if (sub->running.fetch_add(1))
+        sub->overlapped = true;
+    if (sub->delayUs)
+        usleep(sub->delayUs);
+    if (sub->lock) {
+        sub->lock->lock();
+        sub->lock->unlock();
+    }
+    sub->calls++;
+    sub->running--;
+}
+
+static bool sim_test_wait_calls(struct sim_test_subscriber *sub, int calls)
+{
+    for (int i = 0; i < 2000 && sub->calls < calls; i++)
+        usleep(1000);
+    return sub->calls >= calls;
+}
+
+static int sim_test_event_stat(EventDispatcher &dispatcher, int id,
+                               struct event_dispatch_stat *stat)
+{
+    std::vector<struct event_dispatch_stat> stats;
+
+    dispatcher.getStats(stats);
+    for (auto &it : stats) {
+        if (it.id == id) {
+            *stat = it;
+            return 0;
+        }
+    }
+    return -ENOENT;
+}
+
+/*
+ * Per-subscriber delivery latency with one subscriber blocking in its
+ * callback: the other subscriber must not wait behind it.
+ */
+static int test_event_dispatch_latency(void)
+{
+    EventDispatcher dispatcher;
+    struct sim_test_subscriber slow, fast;
+    struct event_dispatch_stat slowStat, fastStat;
+    uint32_t payload = 0;
+
+    slow.running = 0;
+    slow.calls = 0;
+    slow.overlapped = false;
+    slow.delayUs = 20000;
+    slow.lock = nullptr;
+    fast.running = 0;
+    fast.calls = 0;
+    fast.overlapped = false;
+    fast.delayUs = 0;
+    fast.lock = nullptr;
+
+    dispatcher.start();
+    SIM_TEST_CHECK(!dispatcher.subscribe(1, sim_test_event_cb, (uint64_t)&slow));
+    SIM_TEST_CHECK(!dispatcher.subscribe(2, sim_test_event_cb, (uint64_t)&fast));
+    for (int i = 0; i < SIM_TEST_ITERATIONS; i++) {
+        payload = i;
+        dispatcher.dispatch(1, i, &payload, sizeof(payload));
+        dispatcher.dispatch(2, i, &payload, sizeof(payload));
+        usleep(1000);
+    }
+    SIM_TEST_CHECK(sim_test_wait_calls(&fast, SIM_TEST_ITERATIONS));
+    SIM_TEST_CHECK(sim_test_wait_calls(&slow, SIM_TEST_ITERATIONS));
+    SIM_TEST_CHECK(!sim_test_event_stat(dispatcher, 1, &slowStat));
+    SIM_TEST_CHECK(!sim_test_event_stat(dispatcher, 2, &fastStat));
+    dispatcher.unsubscribe(1, sim_test_event_cb);
+    dispatcher.unsubscribe(2, sim_test_event_cb);
+    dispatcher.stop();
+
+    printf("event_dispatch.latency: blocking subscriber avg %llu us max %llu us, "
+           "other avg %llu us max %llu us\n",
+           (unsigned long long)slowStat.avgLatencyUs,
+           (unsigned long long)slowStat.maxLatencyUs,
+           (unsigned long long)fastStat.avgLatencyUs,
+           (unsigned long long)fastStat.maxLatencyUs);
+    SIM_TEST_CHECK(fastStat.delivered == SIM_TEST_ITERATIONS && !fastStat.dropped);
+    SIM_TEST_CHECK(fastStat.maxLatencyUs < slow.delayUs);
+    return 0;
+}
+
+/*
+ * One cookie on two ids is called back one event at a time. unsubscribe
+ * returns while the caller holds a lock the running callback waits for,
+ * and no queued event is delivered after it.
+ */
+static int test_event_dispatch_unsubscribe(void)
+{
+    EventDispatcher dispatcher;
+    struct sim_test_subscriber sub;
+    struct event_dispatch_stat stat;
+    std::mutex engineLock;
+
+    sub.running = 0;
+    sub.calls = 0;
+    sub.overlapped = false;
+    sub.delayUs = 5000;
+    sub.lock = nullptr;
+
+    dispatcher.start();
+    SIM_TEST_CHECK(!dispatcher.subscribe(1, sim_test_event_cb, (uint64_t)&sub));
+    SIM_TEST_CHECK(!dispatcher.subscribe(2, sim_test_event_cb, (uint64_t)&sub));
+    for (int i = 0; i < SIM_TEST_ITERATIONS; i++) {
+        dispatcher.dispatch(1, i, nullptr, 0);
+        dispatcher.dispatch(2, i, nullptr, 0);
+    }
+    SIM_TEST_CHECK(sim_test_wait_calls(&sub, 2 * SIM_TEST_ITERATIONS));
+    SIM_TEST_CHECK(!sub.overlapped);
+
+    /*
+     * Stop recognition path: unsubscribe under the engine lock while the
+     * first of several queued events waits for that lock in its callback.
+     */
+    sub.calls = 0;
+    sub.delayUs = 0;
+    sub.lock = &engineLock;
+    engineLock.lock();
+    for (int i = 0; i < SIM_TEST_ITERATIONS; i++)
+        dispatcher.dispatch(1, i, nullptr, 0);
+    for (int i = 0; i < 1000 && !sub.running; i++)
+        usleep(100);
+    SIM_TEST_CHECK(sub.running);
+    SIM_TEST_CHECK(!sim_test_event_stat(dispatcher, 1, &stat));
+    SIM_TEST_CHECK(!dispatcher.unsubscribe(1, sim_test_event_cb));
+    engineLock.unlock();
+    dispatcher.waitIdle((uint64_t)&sub);
+    SIM_TEST_CHECK(!sub.running);
+    usleep(100000);
+    SIM_TEST_CHECK(sub.calls == 1);
+    sub.lock = nullptr;
+
+    dispatcher.unsubscribe(2, sim_test_event_cb);
+    dispatcher.stop();
+
+    /* events dispatched while stopped are delivered after a restart */
+    sub.calls = 0;
+    sub.delayUs = 0;
+    SIM_TEST_CHECK(!dispatcher.subscribe(3, sim_test_event_cb, (uint64_t)&sub));
+    SIM_TEST_CHECK(!dispatcher.dispatch(3, 0, nullptr, 0));
+    dispatcher.start();
+    SIM_TEST_CHECK(sim_test_wait_calls(&sub, 1));
+    dispatcher.unsubscribe(3, sim_test_event_cb);
+    dispatcher.stop();
+
+    printf("event_dispatch.unsubscribe: no overlap, no callback after unsubscribe\n");
+    return 0;
+}
+
+/* a subscriber far behind makes dispatch wait, none of its events is lost */
+static int test_event_dispatch_backlog(void)
+{
+    const int count = 4 * EVENT_DISPATCH_QUEUE_DEPTH;
+    EventDispatcher dispatcher;
+    struct sim_test_subscriber sub;
+    struct event_dispatch_stat stat;
+
+    sub.running = 0;
+    sub.calls = 0;
+    sub.overlapped = false;
+    sub.delayUs = 1000;
+    sub.lock = nullptr;
+
+    dispatcher.start();
+    SIM_TEST_CHECK(!dispatcher.subscribe(1, sim_test_event_cb, (uint64_t)&sub));
+    for (int i = 0; i < count; i++)
+        SIM_TEST_CHECK(!dispatcher.dispatch(1, i, &i, sizeof(i)));
+    SIM_TEST_CHECK(sim_test_wait_calls(&sub, count));
+    SIM_TEST_CHECK(!sim_test_event_stat(dispatcher, 1, &stat));
+    dispatcher.unsubscribe(1, sim_test_event_cb);
+    dispatcher.stop();
+
+    printf("event_dispatch.backlog: %llu delivered, %llu dropped\n",
+           (unsigned long long)stat.delivered, (unsigned long long)stat.dropped);
+    SIM_TEST_CHECK(stat.delivered == (uint64_t)count && !stat.dropped);
+    return 0;
+}
+
+/*
+ * Two engines sharing the window of each detection: a reservation made
+ * after data was read is refused and must not release the reader of the
+ * accepted ones, and a warm window serves detections without allocating.
+ */
+static int test_keyword_window(void)
+{
+    const uint32_t kwSize = 3200;
+    PalRingBuffer ring(4 * kwSize);
+    PalRingBufferReader *reader = ring.newReader();
+    KeywordWindow window(kwSize);
+    std::vector<uint8_t> data(kwSize, 0x5a);
+    const uint8_t *first = nullptr;
+    const uint8_t *kw = nullptr;
+    uint64_t newCount = 0;
+    int32_t status = 0;
+
+    for (int i = -SIM_TEST_WARMUP; i < SIM_TEST_ITERATIONS; i++) {
+        if (i == 0)
+            newCount = simTestNewCount;
+        ring.reset();
+        window.Reset();
+        SIM_TEST_CHECK(!window.Reserve(reader, 0, kwSize / 2));
+        SIM_TEST_CHECK(!window.Reserve(reader, 0, kwSize));
+        SIM_TEST_CHECK(ring.write(data.data(), kwSize) == kwSize);
+
+        kw = window.Wait(0, kwSize, &status);
+        SIM_TEST_CHECK(kw && !status && !memcmp(kw, data.data(), kwSize));
+        if (!first)
+            first = kw;
+        SIM_TEST_CHECK(kw == first);
+
+        SIM_TEST_CHECK(window.Reserve(reader, 0, kwSize) == -EBUSY);
+        window.Done();
+        SIM_TEST_CHECK(reader->isEnabled());
+        window.Done();
+        SIM_TEST_CHECK(!reader->isEnabled());
+    }
+    newCount = simTestNewCount - newCount;
+
+    printf("keyword_window: %llu allocations over %d detections\n",
+           (unsigned long long)newCount, SIM_TEST_ITERATIONS);
+    SIM_TEST_CHECK(newCount == 0);
+    return 0;
+}
+
+/* 16 kHz mono 16 bit lab data, processed in 10 ms chunks */
+#define SIM_TEST_KW_BYTES_PER_MS 32
+#define SIM_TEST_KW_CHUNK (10 * SIM_TEST_KW_BYTES_PER_MS)
+#define SIM_TEST_KW_WINDOW_MS 1000
+#define SIM_TEST_KW_STREAMED_MS 200
+#define SIM_TEST_KW_CHUNK_COST_US 2000
+
+/*
+ * Stand-in for a second stage CAPI library: a fixed cost per chunk taken
+ * from the shared window and a verdict once rejectAt bytes (or the whole
+ * window) are processed. newCount holds the allocations of the last run.
+ */
+struct sim_test_stub_capi {
+    uint32_t rejectAt;
+    uint32_t processed;
+    int32_t status;
+    uint32_t size;
+    uint64_t newCount;
+    KeywordWindow *window;
+    struct sim_test_detection *det;
+    SecondStageTask task;
+};
+
+struct sim_test_detection {
+    std::mutex lock;
+    std::condition_variable cv;
+    int pending;
+    uint64_t verdictNs;
+};
+
+static uint64_t sim_test_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void sim_test_stub_capi_process(void *arg)
+{
+    struct sim_test_stub_capi *capi = (struct sim_test_stub_capi *)arg;
+    struct sim_test_detection *det = capi->det;
+    uint64_t newCount = simTestNewCount;
+    const uint8_t *data = nullptr;
+    int32_t status = 0;
+    bool reject = false;
+
+    for (capi->processed = 0; capi->processed < capi->size;
+         capi->processed += SIM_TEST_KW_CHUNK) {
+        data = capi->window->Wait(capi->processed, SIM_TEST_KW_CHUNK, &status);
+        if (!data)
+            break;
+        usleep(SIM_TEST_KW_CHUNK_COST_US);
+        if (capi->rejectAt && capi->processed >= capi->rejectAt) {
+            reject = true;
+            break;
+        }
+    }
+    capi->status = reject ? -EPERM : status;
+    /* first rejection cancels the other engines, as ProcessDetection does */
+    if (reject)
+        capi->window->Cancel();
+    capi->newCount = simTestNewCount - newCount;
+
+    std::lock_guard<std::mutex> lck(det->lock);
+    if (status != -ECANCELED && (reject || det->pending == 1))
+        det->verdictNs = sim_test_now_ns();
+    det->pending--;
+    det->cv.notify_all();
+}
+
+static void sim_test_stub_capi_init(struct sim_test_stub_capi *capi,
+                                    KeywordWindow *window,
+                                    struct sim_test_detection *det)
+{
+    memset(capi, 0, sizeof(*capi));
+    capi->size = SIM_TEST_KW_WINDOW_MS * SIM_TEST_KW_BYTES_PER_MS;
+    capi->window = window;
+    capi->det = det;
+    capi->task.run = sim_test_stub_capi_process;
+    capi->task.arg = capi;
+}
+
+/*
+ * Detection to verdict with a keyword and a user verification stub engine
+ * on the scheduler pool. The last SIM_TEST_KW_STREAMED_MS of the keyword
+ * arrive in real time after the first stage detection. newCount returns
+ * the allocations from submitting both engines up to the verdict, on the
+ * submitting thread and in the workers.
+ */
+static int sim_test_second_stage(PalRingBuffer &ring, KeywordWindow &window,
+                                 PalRingBufferReader *kwReader,
+                                 PalRingBufferReader *uvReader,
+                                 uint32_t rejectAt, uint64_t *latencyUs,
+                                 uint64_t *newCount,
+                                 struct sim_test_stub_capi *kw,
+                                 struct sim_test_stub_capi *uv)
+{
+    const uint32_t size = SIM_TEST_KW_WINDOW_MS * SIM_TEST_KW_BYTES_PER_MS;
+    const uint32_t streamed = SIM_TEST_KW_STREAMED_MS * SIM_TEST_KW_BYTES_PER_MS;
+    std::vector<uint8_t> data(size, 0x5a);
+    struct sim_test_detection *det = kw->det;
+    std::thread lab;
+    uint64_t detectedNs = 0;
+    uint64_t submitCount = 0;
+
+    kw->rejectAt = rejectAt;
+    uv->rejectAt = 0;
+    kw->processed = uv->processed = 0;
+    kw->status = uv->status = 0;
+    det->pending = 2;
+    det->verdictNs = 0;
+
+    ring.reset();
+    window.Reset();
+    detectedNs = sim_test_now_ns();
+    SIM_TEST_CHECK(!window.Reserve(kwReader, 0, size));
+    SIM_TEST_CHECK(!window.Reserve(uvReader, 0, size));
+    ring.write(data.data(), size - streamed);
+    lab = std::thread([&] {
+        for (uint32_t off = size - streamed; off < size; off += SIM_TEST_KW_CHUNK) {
+            usleep(10000);
+            ring.write(data.data() + off, SIM_TEST_KW_CHUNK);
+        }
+    });
+
+    submitCount = simTestNewCount;
+    SecondStageScheduler::GetInstance()->Submit(&kw->task);
+    SecondStageScheduler::GetInstance()->Submit(&uv->task);
+    {
+        std::unique_lock<std::mutex> lck(det->lock);
+        det->cv.wait(lck, [det] { return det->pending == 0; });
+    }
+    submitCount = simTestNewCount - submitCount;
+    lab.join();
+    window.Done();
+    window.Done();
+
+    SIM_TEST_CHECK(det->verdictNs > detectedNs);
+    *latencyUs = (det->verdictNs - detectedNs) / 1000;
+    *newCount = submitCount + kw->newCount + uv->newCount;
+    return 0;
+}
+
+static int test_second_stage_latency(void)
+{
+    const uint32_t size = SIM_TEST_KW_WINDOW_MS * SIM_TEST_KW_BYTES_PER_MS;
+    /* both engines run serially would need this long */
+    const uint64_t serialUs = SIM_TEST_KW_STREAMED_MS * 1000ULL +
+        2ULL * size / SIM_TEST_KW_CHUNK * SIM_TEST_KW_CHUNK_COST_US;
+    PalRingBuffer ring(2 * size);
+    PalRingBufferReader *kwReader = ring.newReader();
+    PalRingBufferReader *uvReader = ring.newReader();
+    KeywordWindow window(size);
+    struct sim_test_detection det;
+    struct sim_test_stub_capi kw, uv;
+    uint64_t acceptUs[SIM_TEST_ITERATIONS];
+    uint64_t rejectUs[SIM_TEST_ITERATIONS];
+    uint64_t newCount = 0;
+    uint64_t count = 0;
+    int i;
+
+    sim_test_stub_capi_init(&kw, &window, &det);
+    sim_test_stub_capi_init(&uv, &window, &det);
+    /* the pool and its workers are set up once, outside the counted path */
+    SecondStageScheduler::GetInstance();
+
+    for (i = 0; i < SIM_TEST_ITERATIONS; i++) {
+        SIM_TEST_CHECK(!sim_test_second_stage(ring, window, kwReader, uvReader,
+                                              0, &acceptUs[i], &count, &kw, &uv));
+        SIM_TEST_CHECK(!kw.status && !uv.status);
+        SIM_TEST_CHECK(kw.processed == size && uv.processed == size);
+        newCount += count;
+
+        /* the keyword engine rejects a quarter in, user verification stops */
+        SIM_TEST_CHECK(!sim_test_second_stage(ring, window, kwReader, uvReader,
+                                              size / 4, &rejectUs[i], &count,
+                                              &kw, &uv));
+        SIM_TEST_CHECK(kw.status == -EPERM && uv.status == -ECANCELED);
+        SIM_TEST_CHECK(uv.processed < size);
+        newCount += count;
+    }
+
+    std::sort(acceptUs, acceptUs + SIM_TEST_ITERATIONS);
+    std::sort(rejectUs, rejectUs + SIM_TEST_ITERATIONS);
+    printf("second_stage.latency: accept p50 %llu us max %llu us, "
+           "reject p50 %llu us max %llu us, serial %llu us, "
+           "%llu allocations over %d detections\n",
+           (unsigned long long)acceptUs[SIM_TEST_ITERATIONS / 2],
+           (unsigned long long)acceptUs[SIM_TEST_ITERATIONS - 1],
+           (unsigned long long)rejectUs[SIM_TEST_ITERATIONS / 2],
+           (unsigned long long)rejectUs[SIM_TEST_ITERATIONS - 1],
+           (unsigned long long)serialUs, (unsigned long long)newCount,
+           2 * SIM_TEST_ITERATIONS);
+    SIM_TEST_CHECK(acceptUs[SIM_TEST_ITERATIONS / 2] < serialUs);
+    SIM_TEST_CHECK(rejectUs[SIM_TEST_ITERATIONS / 2] <
+                   acceptUs[SIM_TEST_ITERATIONS / 2]);
+    SIM_TEST_CHECK(newCount == 0);
+    return 0;
+}
+
+/*
+ * The page pal_stream_get_position_mirror returned stays valid while
+ * another page is attached and detached again.
+ */
+static int test_position_mirror_page(void)
+{
+    pal_stream_handle_t *handle = nullptr;
+    const pal_position_mirror_t *owned = nullptr;
+    const pal_position_mirror_t *again = nullptr;
+    pal_position_mirror_t external, snapshot;
+    int status = 0;
+
+    if (sim_test_init())
+        return SIM_TEST_SKIP;
+
+    SIM_TEST_CHECK(!sim_test_open(PAL_STREAM_LOW_LATENCY, PAL_AUDIO_OUTPUT,
+                                  PAL_DEVICE_OUT_SPEAKER, &handle));
+    if (pal_stream_get_position_mirror(handle, &owned) ||
+        pal_stream_set_position_mirror(handle, &external) ||
+        pal_position_mirror_read(owned, &snapshot) ||
+        pal_stream_set_position_mirror(handle, NULL) ||
+        pal_stream_get_position_mirror(handle, &again) || again != owned)
+        status = -EINVAL;
+    pal_stream_close(handle);
+    SIM_TEST_CHECK(!status);
+    return 0;
+}
+
+static int64_t sim_test_mirror_age_ns(const pal_position_mirror_t *mirror,
+                                      uint64_t *hwFrames)
+{
+    pal_position_mirror_t snapshot;
+
+    if (pal_position_mirror_read(mirror, &snapshot) || !snapshot.hw_time_ns)
+        return -1;
+    *hwFrames = snapshot.hw_frames;
+    return (int64_t)sim_test_now_ns() - snapshot.hw_time_ns;
+}
+
+/*
+ * hw_time_ns is on CLOCK_MONOTONIC for a pcm and an mmap stream, and the
+ * mirror of an mmap stream advances with no position query at all.
+ */
+static int test_position_mirror_clock(void)
+{
+    const int64_t maxAgeNs = 1000000000LL;
+    pal_stream_handle_t *handle = nullptr;
+    const pal_position_mirror_t *mirror = nullptr;
+    struct pal_stream_attributes attr;
+    struct pal_device dev;
+    struct pal_mmap_buffer info;
+    struct pal_buffer pb;
+    size_t inSize = 0, outSize = 0;
+    uint64_t first = 0, last = 0;
+    int64_t age = -1;
+    void *buf = nullptr;
+    int status = 0;
+
+    if (sim_test_init())
+        return SIM_TEST_SKIP;
+
+    SIM_TEST_CHECK(!sim_test_open(PAL_STREAM_LOW_LATENCY, PAL_AUDIO_OUTPUT,
+                                  PAL_DEVICE_OUT_SPEAKER, &handle));
+    if (pal_stream_get_position_mirror(handle, &mirror) ||
+        pal_stream_start(handle) ||
+        pal_stream_get_buffer_size(handle, &inSize, &outSize) || !outSize ||
+        !(buf = calloc(1, outSize))) {
+        status = -EINVAL;
+    } else {
+        memset(&pb, 0, sizeof(pb));
+        pb.buffer = (uint8_t *)buf;
+        pb.size = outSize;
+        for (int i = 0; i < 4; i++)
+            pal_stream_write(handle, &pb);
+        age = sim_test_mirror_age_ns(mirror, &first);
+    }
+    free(buf);
+    pal_stream_stop(handle);
+    pal_stream_close(handle);
+    SIM_TEST_CHECK(!status);
+    printf("position_mirror.clock: pcm hw_time_ns %lld ns old\n", (long long)age);
+    SIM_TEST_CHECK(age >= 0 && age < maxAgeNs);
+
+    memset(&attr, 0, sizeof(attr));
+    memset(&dev, 0, sizeof(dev));
+    memset(&info, 0, sizeof(info));
+    attr.type = PAL_STREAM_ULTRA_LOW_LATENCY;
+    attr.flags = PAL_STREAM_FLAG_MMAP_NO_IRQ;
+    attr.direction = PAL_AUDIO_OUTPUT;
+    sim_test_media_config(&attr.out_media_config);
+    dev.id = PAL_DEVICE_OUT_SPEAKER;
+    sim_test_media_config(&dev.config);
+    if (pal_stream_open(&attr, 1, &dev, 0, NULL, NULL, 0, &handle))
+        return SIM_TEST_SKIP;
+    if (pal_stream_get_position_mirror(handle, &mirror) ||
+        pal_stream_create_mmap_buffer(handle, 480, &info) ||
+        pal_stream_start(handle)) {
+        status = -EINVAL;
+    } else {
+        /* poll the page only, as a client reading it from shared memory */
+        usleep(100000);
+        sim_test_mirror_age_ns(mirror, &first);
+        usleep(100000);
+        age = sim_test_mirror_age_ns(mirror, &last);
+    }
+    pal_stream_stop(handle);
+    pal_stream_close(handle);
+    SIM_TEST_CHECK(!status);
+    printf("position_mirror.clock: mmap hw_frames %llu -> %llu, %lld ns old\n",
+           (unsigned long long)first, (unsigned long long)last, (long long)age);
+    SIM_TEST_CHECK(last > first);
+    SIM_TEST_CHECK(age >= 0 && age < maxAgeNs);
+    return 0;
+}
+
+/* EXT_DISPLAY_TYPE_DP of DisplayPort.cpp */
+#define SIM_TEST_EXT_DISPLAY_DP 2
+
+/* (dis)connects a DisplayPort sink on stream of controller 0 */
+static int sim_test_dp_sink(struct mixer *mixer, pal_device_id_t id, int stream,
+                            bool connect)
+{
+    /* one 2ch LPCM 32-48 kHz 16-24 bit SAD and the speaker allocation */
+    static const uint8_t edid[] = {0x09, 0x07, 0x07, 0x01, 0x00, 0x00};
+    pal_param_device_connection_t conn;
+    char name[MIXER_PATH_MAX_LENGTH];
+    struct mixer_ctl *ctl = nullptr;
+
+    if (connect) {
+        if (stream)
+            snprintf(name, sizeof(name), "External Display%d Type", stream);
+        else
+            snprintf(name, sizeof(name), "External Display Type");
+        ctl = mixer_get_ctl_by_name(mixer, name);
+        if (!ctl || mixer_ctl_set_value(ctl, 0, SIM_TEST_EXT_DISPLAY_DP))
+            return -EINVAL;
+        if (stream)
+            snprintf(name, sizeof(name), "Display Port%d EDID", stream);
+        else
+            snprintf(name, sizeof(name), "Display Port EDID");
+        ctl = mixer_get_ctl_by_name(mixer, name);
+        if (!ctl || mixer_ctl_set_array(ctl, edid, sizeof(edid)))
+            return -EINVAL;
+    }
+
+    memset(&conn, 0, sizeof(conn));
+    conn.id = id;
+    conn.connection_state = connect;
+    conn.device_config.dp_config.controller = 0;
+    conn.device_config.dp_config.stream = stream;
+    return pal_set_param(PAL_PARAM_ID_DEVICE_CONNECTION, (void *)&conn, sizeof(conn));
+}
+
+/*
+ * Two MST sinks share the DisplayPort device object: unplugging the first
+ * one drops its EDID and keeps the one of the sink still connected.
+ */
+static int test_dp_edid_mst(void)
+{
+    struct mixer *mixer = nullptr;
+    bool firstCached, secondCached;
+
+    if (sim_test_init() ||
+        ResourceManager::getInstance()->getHwAudioMixer(&mixer) || !mixer)
+        return SIM_TEST_SKIP;
+
+    if (sim_test_dp_sink(mixer, PAL_DEVICE_OUT_AUX_DIGITAL, 0, true))
+        return SIM_TEST_SKIP;
+    if (!DisplayPort::isEdidCached(0, 0)) {
+        sim_test_dp_sink(mixer, PAL_DEVICE_OUT_AUX_DIGITAL, 0, false);
+        return SIM_TEST_SKIP;
+    }
+    SIM_TEST_CHECK(!sim_test_dp_sink(mixer, PAL_DEVICE_OUT_AUX_DIGITAL_1, 1, true));
+    SIM_TEST_CHECK(DisplayPort::isEdidCached(0, 1));
+
+    SIM_TEST_CHECK(!sim_test_dp_sink(mixer, PAL_DEVICE_OUT_AUX_DIGITAL, 0, false));
+    firstCached = DisplayPort::isEdidCached(0, 0);
+    secondCached = DisplayPort::isEdidCached(0, 1);
+    sim_test_dp_sink(mixer, PAL_DEVICE_OUT_AUX_DIGITAL_1, 1, false);
+    SIM_TEST_CHECK(!firstCached && secondCached);
+    SIM_TEST_CHECK(!DisplayPort::isEdidCached(0, 1));
+    return 0;
+}
+
+/* the profile setup getCapability does once the stream info is parsed */
+class SimTestUSBCardConfig : public USBCardConfig {
+public:
+    SimTestUSBCardConfig(struct pal_usb_device_address addr) :
+        USBCardConfig(addr) {}
+    using USBCardConfig::setProfiles;
+};
+
+static std::shared_ptr<USBDeviceConfig> sim_test_usb_profile(usb_usecase_type_t type,
+                                                             unsigned int bitWidth,
+                                                             unsigned int channels,
+                                                             const char *rates)
+{
+    std::shared_ptr<USBDeviceConfig> profile(new USBDeviceConfig());
+    char rates_str[64];
+
+    snprintf(rates_str, sizeof(rates_str), "Rates: %s", rates);
+    profile->setType(type);
+    profile->setBitWidth(bitWidth);
+    profile->setChannels(channels);
+    profile->getSampleRates(type, rates_str);
+    return profile;
+}
+
+static int sim_test_usb_best(SimTestUSBCardConfig &card, unsigned int bitWidth,
+                             unsigned int channels, struct pal_media_config *config)
+{
+    struct pal_stream_attributes sattr;
+    struct pal_device_info devinfo = {};
+
+    memset(&sattr, 0, sizeof(sattr));
+    memset(config, 0, sizeof(*config));
+    sattr.out_media_config.sample_rate = 48000;
+    sattr.out_media_config.bit_width = bitWidth;
+    sattr.out_media_config.ch_info.channels = channels;
+    config->bit_width = bitWidth;
+    return card.readBestConfig(config, &sattr, true, &devinfo, false);
+}
+
+/*
+ * readBestConfig picks the channel group of the target bit width from the
+ * profile index: the requested channels, else the playback maximum, in
+ * parse order. No group of that width leaves rate and channels untouched.
+ */
+static int test_usb_best_config(void)
+{
+    struct pal_usb_device_address addr = {};
+    SimTestUSBCardConfig card(addr);
+    struct pal_media_config config;
+
+    card.setProfiles({
+        sim_test_usb_profile(USB_PLAYBACK, 16, 2, "44100"),
+        sim_test_usb_profile(USB_PLAYBACK, 16, 2, "48000"),
+        sim_test_usb_profile(USB_PLAYBACK, 16, 6, "48000"),
+        sim_test_usb_profile(USB_PLAYBACK, 24, 1, "96000"),
+        /* capture channels do not count towards the playback maximum */
+        sim_test_usb_profile(USB_CAPTURE, 16, 8, "48000"),
+    }, 0);
+
+    SIM_TEST_CHECK(!sim_test_usb_best(card, 16, 2, &config));
+    SIM_TEST_CHECK(config.bit_width == 16 && config.sample_rate == 48000 &&
+                   config.ch_info.channels == 2);
+
+    SIM_TEST_CHECK(!sim_test_usb_best(card, 16, 4, &config));
+    SIM_TEST_CHECK(config.bit_width == 16 && config.sample_rate == 48000 &&
+                   config.ch_info.channels == 6);
+
+    SIM_TEST_CHECK(!sim_test_usb_best(card, 24, 2, &config));
+    SIM_TEST_CHECK(config.bit_width == 24 && !config.sample_rate &&
+                   !config.ch_info.channels);
+    return 0;
+}
+
+static const struct sim_test sim_tests[] = {
+    {"cal_cache.acdb_param", test_cal_cache_acdb_param},
+    {"cal_cache.acdb_write", test_cal_cache_acdb_write},
+    {"payload.start_allocs", test_payload_start_allocs},
+    {"xrun.counters", test_xrun_counters},
+    {"event_dispatch.latency", test_event_dispatch_latency},
+    {"event_dispatch.unsubscribe", test_event_dispatch_unsubscribe},
+    {"event_dispatch.backlog", test_event_dispatch_backlog},
+    {"keyword_window", test_keyword_window},
+    {"second_stage.latency", test_second_stage_latency},
+    {"position_mirror.page", test_position_mirror_page},
+    {"position_mirror.clock", test_position_mirror_clock},
+    {"dp_edid.mst", test_dp_edid_mst},
+    {"usb.best_config", test_usb_best_config},
+};
+
+int main(int argc, char *argv[])
+{
+    unsigned int failed = 0, passed = 0;
+    int status;
+
+    for (size_t i = 0; i < sizeof(sim_tests) / sizeof(sim_tests[0]); i++) {
+        if (argc > 1 && strcmp(argv[1], sim_tests[i].name))
+            continue;
+        status = sim_tests[i].run();
+        printf("%s %s (%d)\n", status == SIM_TEST_SKIP ? "SKIP" :
+               status ? "FAIL" : "PASS", sim_tests[i].name, status);
+        if (status == SIM_TEST_SKIP)
+            continue;
+        if (status)
+            failed++;
+        else
+            passed++;
+    }
+
+    if (simInitStatus == 0)
+        pal_deinit();
+    if (failed)
+        return 1;
+    return passed ? 0 : SIM_TEST_SKIP;
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the
+ * disclaimer below) provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *     * Neither the name of Qualcomm Innovation Center, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+ * GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+ * HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SOUND_MODEL_CACHE_H
+#define SOUND_MODEL_CACHE_H
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "SoundTriggerUtils.h"
+
+/* upper bound of model data and parsed headers kept by the cache */
+#define SM_CACHE_MAX_BYTES (4 * 1024 * 1024)
+/* bytes hashed at each end of a model, the rest is only compared on a hit */
+#define SM_CACHE_HASH_SPAN 4096
+
+/* a model as loaded by a client, only referenced for the duration of a call */
+struct SoundModelRef {
+    const uint8_t *data;
+    uint32_t size;
+};
+
+/*
+ * Keeps parsed sound model headers keyed on the model content, and merged
+ * models keyed on the set of constituent models, so that a client that
+ * loads and unloads repeatedly reuses earlier SML results. The hash only
+ * picks the entry; every hit is confirmed against a copy of the models the
+ * entry was built from. Entries are evicted least recently used first once
+ * SM_CACHE_MAX_BYTES is exceeded.
+ */
+class SoundModelCache {
+public:
+    static std::shared_ptr<SoundModelCache> GetInstance();
+    static uint64_t Hash(const uint8_t *data, uint32_t size);
+    /* header lookups leave the model data of info untouched */
+    bool GetHeader(const uint8_t *data, uint32_t size, SoundModelInfo *info);
+    void PutHeader(const uint8_t *data, uint32_t size, SoundModelInfo *info);
+    /* models are the constituents, in any order */
+    bool GetMerged(std::vector<SoundModelRef> models, SoundModelInfo *info);
+    void PutMerged(std::vector<SoundModelRef> models, SoundModelInfo *info);
+
+private:
+    SoundModelCache();
+    struct CacheEntry {
+        bool merged;
+        std::vector<uint64_t> key;
+        /* constituents in key order, to confirm a hit */
+        std::vector<std::vector<uint8_t>> models;
+        std::unique_ptr<SoundModelInfo> info;
+        size_t bytes;
+    };
+    typedef std::pair<bool, std::vector<uint64_t>> CacheKey;
+
+    static std::vector<uint64_t> MakeKey(std::vector<SoundModelRef> &models);
+    static bool Matches(const CacheEntry &entry,
+                        const std::vector<SoundModelRef> &models);
+    bool Get(bool merged, std::vector<SoundModelRef> &models,
+             SoundModelInfo *info);
+    void Put(bool merged, std::vector<SoundModelRef> &models,
+             SoundModelInfo *info);
+
+    static std::shared_ptr<SoundModelCache> cache_;
+    std::mutex lock_;
+    std::list<CacheEntry> lru_;
+    std::map<CacheKey, std::list<CacheEntry>::iterator> index_;
+    size_t bytes_;
+    uint32_t hits_;
+    uint32_t misses_;
+};
+
+#endif // SOUND_MODEL_CACHE_H
@@ -435,6 +435,7 @@ public:
     SoundModelInfo();
     SoundModelInfo(SoundModelInfo &rhs) = delete;
     SoundModelInfo & operator=(SoundModelInfo &rhs);
+    void CopyHeaderInfo(SoundModelInfo &rhs);
     ~SoundModelInfo();
     int32_t SetKeyPhrases(listen_model_type *model, uint32_t num_phrases);
     int32_t SetUsers(listen_model_type *model, uint32_t num_users);
@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted (subject to the limitations in the
+ * disclaimer below) provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *
+ *     * Neither the name of Qualcomm Innovation Center, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * NO EXPRESS OR IMPLIED LICENSES TO ANY PARTY'S PATENT RIGHTS ARE
+ * GRANTED BY THIS LICENSE. THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT
+ * HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define LOG_TAG "PAL: SoundModelCache"
+
+#include <algorithm>
+#include <string.h>
+#include "PalCommon.h"
+#include "SoundModelCache.h"
+
+#define FNV1A_64_OFFSET 0xcbf29ce484222325ULL
+#define FNV1A_64_PRIME 0x100000001b3ULL
+
+std::shared_ptr<SoundModelCache> SoundModelCache::cache_ = nullptr;
+
+SoundModelCache::SoundModelCache() :
+    bytes_(0),
+    hits_(0),
+    misses_(0)
+{
+}
+
+std::shared_ptr<SoundModelCache> SoundModelCache::GetInstance() {
+    static std::once_flag once;
+
+    std::call_once(once, [] {
+        cache_ = std::shared_ptr<SoundModelCache>(new SoundModelCache());
+    });
+    return cache_;
+}
+
+/*
+ * Hashes the size and at most SM_CACHE_HASH_SPAN bytes at either end, which
+ * is enough to tell models apart in practice. It is no proof of equality,
+ * Get compares the whole model before it reports a hit.
+ */
+uint64_t SoundModelCache::Hash(const uint8_t *data, uint32_t size) {
+    uint64_t hash = FNV1A_64_OFFSET;
+    uint32_t head = std::min<uint32_t>(size, SM_CACHE_HASH_SPAN);
+    uint32_t tail = std::max<uint32_t>(head, size - head);
+
+    for (uint32_t i = 0; i < sizeof(size); i++) {
+        hash ^= (size >> (i * 8)) & 0xff;
+        hash *= FNV1A_64_PRIME;
+    }
+    for (uint32_t i = 0; data && i < head; i++) {
+        hash ^= data[i];
+        hash *= FNV1A_64_PRIME;
+    }
+    for (uint32_t i = tail; data && i < size; i++) {
+        hash ^= data[i];
+        hash *= FNV1A_64_PRIME;
+    }
+
+    return hash;
+}
+
+/* sorts models into key order and returns their hashes */
+std::vector<uint64_t> SoundModelCache::MakeKey(
+    std::vector<SoundModelRef> &models) {
+
+    std::vector<std::pair<uint64_t, SoundModelRef>> hashed;
+    std::vector<uint64_t> key;
+
+    for (auto &model : models)
+        hashed.push_back(std::make_pair(Hash(model.data, model.size), model));
+    std::sort(hashed.begin(), hashed.end(),
+              [](const std::pair<uint64_t, SoundModelRef> &a,
+                 const std::pair<uint64_t, SoundModelRef> &b) {
+                  return a.first < b.first;
+              });
+    for (size_t i = 0; i < hashed.size(); i++) {
+        key.push_back(hashed[i].first);
+        models[i] = hashed[i].second;
+    }
+
+    return key;
+}
+
+bool SoundModelCache::Matches(const CacheEntry &entry,
+                              const std::vector<SoundModelRef> &models) {
+
+    if (entry.models.size() != models.size())
+        return false;
+
+    for (size_t i = 0; i < models.size(); i++) {
+        if (entry.models[i].size() != models[i].size ||
+            (models[i].size &&
+             memcmp(entry.models[i].data(), models[i].data, models[i].size)))
+            return false;
+    }
+
+    return true;
+}
+
+bool SoundModelCache::Get(bool merged, std::vector<SoundModelRef> &models,
+                          SoundModelInfo *info) {
+
+    std::vector<uint64_t> key = MakeKey(models);
+    std::lock_guard<std::mutex> lck(lock_);
+    auto it = index_.find(std::make_pair(merged, key));
+
+    if (it == index_.end()) {
+        misses_++;
+        return false;
+    }
+
+    /* same hash but other content, Put replaces the entry */
+    if (!Matches(*(it->second), models)) {
+        misses_++;
+        PAL_DBG(LOG_TAG, "%s hash collision", merged ? "merged model" : "header");
+        return false;
+    }
+
+    /* most recently used entries live at the front */
+    lru_.splice(lru_.begin(), lru_, it->second);
+    if (merged)
+        *info = *(it->second->info);
+    else
+        info->CopyHeaderInfo(*(it->second->info));
+    hits_++;
+    PAL_VERBOSE(LOG_TAG, "%s hit, hits %u misses %u",
+                merged ? "merged model" : "header", hits_, misses_);
+
+    return true;
+}
+
+void SoundModelCache::Put(bool merged, std::vector<SoundModelRef> &models,
+                          SoundModelInfo *info) {
+
+    CacheEntry entry;
+
+    entry.merged = merged;
+    entry.key = MakeKey(models);
+    entry.bytes = sizeof(SoundModelInfo);
+    for (auto &model : models) {
+        if (!model.data)
+            return;
+        entry.bytes += model.size;
+    }
+    if (entry.bytes > SM_CACHE_MAX_BYTES) {
+        PAL_DBG(LOG_TAG, "models of %zu bytes too large to cache", entry.bytes);
+        return;
+    }
+
+    entry.info = std::unique_ptr<SoundModelInfo>(new SoundModelInfo());
+    if (merged)
+        *(entry.info) = *info;
+    else
+        entry.info->CopyHeaderInfo(*info);
+    entry.bytes += entry.info->GetModelSize() +
+        entry.info->GetNumKeyPhrases() * MAX_STRING_LEN +
+        entry.info->GetConfLevelsSize() * (MAX_KW_USERS_NAME_LEN + 2);
+
+    if (entry.bytes > SM_CACHE_MAX_BYTES) {
+        PAL_DBG(LOG_TAG, "model of %zu bytes too large to cache", entry.bytes);
+        return;
+    }
+    for (auto &model : models)
+        entry.models.emplace_back(model.data, model.data + model.size);
+
+    std::lock_guard<std::mutex> lck(lock_);
+    CacheKey cacheKey = std::make_pair(merged, entry.key);
+    auto it = index_.find(cacheKey);
+    if (it != index_.end()) {
+        bytes_ -= it->second->bytes;
+        lru_.erase(it->second);
+        index_.erase(it);
+    }
+
+    while (!lru_.empty() && bytes_ + entry.bytes > SM_CACHE_MAX_BYTES) {
+        bytes_ -= lru_.back().bytes;
+        index_.erase(std::make_pair(lru_.back().merged, lru_.back().key));
+        lru_.pop_back();
+    }
+
+    bytes_ += entry.bytes;
+    lru_.push_front(std::move(entry));
+    index_[cacheKey] = lru_.begin();
+    PAL_DBG(LOG_TAG, "cached %s, %zu entries %zu bytes",
+            merged ? "merged model" : "header", lru_.size(), bytes_);
+}
+
+bool SoundModelCache::GetHeader(const uint8_t *data, uint32_t size,
+                                SoundModelInfo *info) {
+
+    std::vector<SoundModelRef> models(1, SoundModelRef{data, size});
+
+    if (!info || !data)
+        return false;
+
+    return Get(false, models, info);
+}
+
+void SoundModelCache::PutHeader(const uint8_t *data, uint32_t size,
+                                SoundModelInfo *info) {
+
+    std::vector<SoundModelRef> models(1, SoundModelRef{data, size});
+
+    if (!info || !data)
+        return;
+
+    Put(false, models, info);
+}
+
+bool SoundModelCache::GetMerged(std::vector<SoundModelRef> models,
+                                SoundModelInfo *info) {
+
+    if (!info || models.size() < 2)
+        return false;
+
+    return Get(true, models, info);
+}
+
+void SoundModelCache::PutMerged(std::vector<SoundModelRef> models,
+                                SoundModelInfo *info) {
+
+    if (!info || !info->GetModelData() || models.size() < 2)
+        return;
+
+    Put(true, models, info);
+}
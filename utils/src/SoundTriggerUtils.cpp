@@ -297,6 +297,18 @@ SoundModelInfo & SoundModelInfo::operator =(SoundModelInfo &smi) {
     if (sm_data_)
         memcpy(sm_data_, smi.sm_data_, sm_size_);
 
+    CopyHeaderInfo(smi);
+
+    PAL_VERBOSE(LOG_TAG, "Exit");
+    return *this;
+}
+
+/* copies what QuerySoundModel parses out of the header, not the model data */
+void SoundModelInfo::CopyHeaderInfo(SoundModelInfo &smi) {
+
+    if (this == &smi)
+        return;
+
     /* Free cf_levels and det_cf_levels if they exists, then create and copy them */
     if (cf_levels_)
         free(cf_levels_);
@@ -344,9 +356,6 @@ SoundModelInfo & SoundModelInfo::operator =(SoundModelInfo &smi) {
                 &smi.cf_levels_kw_users_[i][0] + MAX_KW_USERS_NAME_LEN,
                 &cf_levels_kw_users_[i][0]);
     }
-
-    PAL_VERBOSE(LOG_TAG, "Exit");
-    return *this;
 }
 
 void SoundModelInfo::FreeArrayPtrs(char **arr, uint32_t arr_len)